@@ -2,6 +2,17 @@
 
 #include <thread>
 
+#if !defined(_WIN32)
+    #include <unistd.h> // sysconf
+    #include <fcntl.h> // open
+    #include <sys/mman.h> // mmap
+    #include <sys/stat.h> // fstat
+#endif
+
+#if defined(__linux__)
+    #include <pthread.h> // pthread_setaffinity_np
+#endif
+
 namespace codec {
 
 
@@ -33,14 +44,32 @@ namespace codec {
     #pragma warning(disable: 4752) // found Intel(R) Advanced Vector Extensions; consider using /arch:AVX
 #endif
 
+#ifdef TRY_AVX512
+    bool CpuHasAVX512 = false;
+#endif
+#ifdef TRY_GFNI
+    bool CpuHasGFNI = false;
+#endif
 #ifdef TRY_AVX2
     bool CpuHasAVX2 = false;
 #endif
 
 bool CpuHasSSSE3 = false;
 
-#define CPUID_EBX_AVX2    0x00000020
-#define CPUID_ECX_SSSE3   0x00000200
+#ifdef TRY_CLMUL
+    bool CpuHasCLMUL = false;
+#endif
+
+#define CPUID_EBX_AVX2      0x00000020
+#define CPUID_EBX_AVX512F   0x00010000
+#define CPUID_EBX_AVX512BW  0x40000000
+#define CPUID_ECX_SSSE3     0x00000200
+#define CPUID_ECX_GFNI      0x00000100
+#define CPUID_ECX_PCLMULQDQ 0x00000002
+#define CPUID_ECX_SSE41     0x00080000
+#define CPUID_ECX_OSXSAVE   0x08000000
+#define XCR0_SSE_AVX        0x00000006
+#define XCR0_AVX512         0x000000e0
 
 static void _cpuid(unsigned int cpu_info[4U], const unsigned int cpu_info_type)
 {
@@ -79,10 +108,24 @@ static void _cpuid(unsigned int cpu_info[4U], const unsigned int cpu_info_type)
 #endif
 }
 
+// Reads the XCR0 register: which register states the OS saves
+static uint64_t _xgetbv0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0" : "=a" (eax), "=d" (edx) : "c" (0U));
+    return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
 #elif defined(USE_SSE2NEON)
 bool CpuHasSSSE3 = true;
 #endif // defined(TARGET_MOBILE)
 
+static void SelectXORKernels();
+
 
 void InitializeCPUArch()
 {
@@ -107,9 +150,33 @@ void InitializeCPUArch()
     _cpuid(cpu_info, 1);
     CpuHasSSSE3 = ((cpu_info[2] & CPUID_ECX_SSSE3) != 0);
 
+#if defined(TRY_CLMUL)
+    CpuHasCLMUL = CpuHasSSSE3 &&
+        (cpu_info[2] & CPUID_ECX_PCLMULQDQ) != 0 &&
+        (cpu_info[2] & CPUID_ECX_SSE41) != 0;
+#endif // TRY_CLMUL
+
 #if defined(TRY_AVX2)
+    // The AVX2 kernels are always compiled in, so also check that the OS
+    // preserves the YMM registers before selecting them
+    const bool os_saves_avx = (cpu_info[2] & CPUID_ECX_OSXSAVE) != 0 &&
+        (_xgetbv0() & XCR0_SSE_AVX) == XCR0_SSE_AVX;
+
     _cpuid(cpu_info, 7);
-    CpuHasAVX2 = ((cpu_info[1] & CPUID_EBX_AVX2) != 0);
+    CpuHasAVX2 = os_saves_avx && ((cpu_info[1] & CPUID_EBX_AVX2) != 0);
+
+#if defined(TRY_AVX512)
+    // AVX-512 also needs the opmask and upper ZMM registers saved
+    const bool os_saves_avx512 = os_saves_avx &&
+        (_xgetbv0() & XCR0_AVX512) == XCR0_AVX512;
+    CpuHasAVX512 = os_saves_avx512 &&
+        (cpu_info[1] & CPUID_EBX_AVX512F) != 0 &&
+        (cpu_info[1] & CPUID_EBX_AVX512BW) != 0;
+#endif // TRY_AVX512
+
+#if defined(TRY_GFNI)
+    CpuHasGFNI = CpuHasAVX2 && (cpu_info[2] & CPUID_ECX_GFNI) != 0;
+#endif // TRY_GFNI
 #endif // TRY_AVX2
 
 #ifndef USE_SSSE3_OPT
@@ -118,47 +185,509 @@ void InitializeCPUArch()
 #ifndef USE_AVX2_OPT
     CpuHasAVX2 = false;
 #endif // USE_AVX2_OPT
+#if defined(TRY_AVX512) && !defined(USE_AVX512_OPT)
+    CpuHasAVX512 = false;
+#endif // USE_AVX512_OPT
+#if defined(TRY_GFNI) && (!defined(USE_GFNI_OPT) || !defined(USE_AVX2_OPT))
+    CpuHasGFNI = false;
+#endif // USE_GFNI_OPT
+#if defined(TRY_CLMUL) && !defined(USE_CLMUL_OPT)
+    CpuHasCLMUL = false;
+#endif // USE_CLMUL_OPT
 
 #endif // TARGET_MOBILE
+
+    SelectXORKernels();
 }
 
 
 //------------------------------------------------------------------------------
-// XOR Memory
+// Worker Pool
 
-void xor_mem(
-    void * RESTRICT vx, const void * RESTRICT vy,
-    uint64_t bytes)
+// Number of polls before an idle worker parks on the condition variable
+static const unsigned kWorkerSpinCount = 4000;
+
+// Tasks per participating thread, so that uneven tasks balance out
+static const unsigned kTasksPerThread = 4;
+
+// Pool state word: [ generation : 31 ][ open : 1 ][ active workers : 32 ]
+static const uint64_t kPoolActiveMask = 0xffffffffULL;
+static const uint64_t kPoolOpenBit = 1ULL << 32;
+static const unsigned kPoolGenerationShift = 33;
+
+// Set on pool workers and on a caller while it runs a parallel loop
+static thread_local bool InParallelLoop = false;
+
+static FORCE_INLINE void SpinPause()
 {
-#if defined(TRY_AVX2)
-    if (CpuHasAVX2)
+#if !defined(TARGET_MOBILE)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+static void SetThreadAffinity(std::thread& thread, unsigned cpu_index)
+{
+#if defined(_WIN32)
+    if (cpu_index < 64)
+        ::SetThreadAffinityMask(thread.native_handle(), (DWORD_PTR)1 << cpu_index);
+#elif defined(__linux__) && !defined(ANDROID)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu_index, &cpu_set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set);
+#else
+    (void)thread;
+    (void)cpu_index;
+#endif
+}
+
+class WorkerPool
+{
+public:
+    ~WorkerPool()
+    {
+        Stop();
+    }
+
+    void Start(unsigned thread_count, const unsigned* affinity);
+    void Stop();
+
+    unsigned ThreadCount() const
+    {
+        return ThreadCountValue;
+    }
+
+    // Returns false if the caller must run the loop itself
+    bool Run(unsigned count, ParallelTask task, const void* context);
+
+protected:
+    std::vector<std::thread> Workers;
+    std::atomic<unsigned> ThreadCountValue{1};
+
+    // Held by the thread that owns the current loop
+    std::mutex DispatchLock;
+
+    // Parking for idle workers
+    std::mutex ParkLock;
+    std::condition_variable ParkCondition;
+    std::atomic<unsigned> ParkedCount{0};
+    std::atomic<bool> Terminated{false};
+
+    // See kPoolGenerationShift
+    std::atomic<uint64_t> State{0};
+
+    // Current loop: Only written while no workers are active
+    ParallelTask Task = nullptr;
+    const void* Context = nullptr;
+    unsigned Count = 0;
+    unsigned Grain = 1;
+    std::atomic<unsigned> NextIndex{0};
+
+    void WorkerLoop();
+    void RunTasks();
+};
+
+static WorkerPool Pool;
+static std::atomic<bool> PoolStarted(false);
+
+void WorkerPool::Start(unsigned thread_count, const unsigned* affinity)
+{
+    Stop();
+
+    Terminated = false;
+    ThreadCountValue = thread_count;
+
+    const unsigned worker_count = thread_count - 1;
+    Workers.reserve(worker_count);
+    for (unsigned i = 0; i < worker_count; ++i)
+    {
+        Workers.emplace_back(&WorkerPool::WorkerLoop, this);
+        if (affinity)
+            SetThreadAffinity(Workers.back(), affinity[i]);
+    }
+}
+
+void WorkerPool::Stop()
+{
+    if (Workers.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> locker(ParkLock);
+        Terminated = true;
+        ParkCondition.notify_all();
+    }
+
+    for (std::thread& worker : Workers)
+        worker.join();
+    Workers.clear();
+
+    ThreadCountValue = 1;
+}
+
+void WorkerPool::RunTasks()
+{
+    const unsigned count = Count;
+    const unsigned grain = Grain;
+
+    for (;;)
+    {
+        const unsigned begin = NextIndex.fetch_add(grain);
+        if (begin >= count)
+            break;
+        const unsigned end = count - begin > grain ? begin + grain : count;
+
+        Task(Context, begin, end);
+    }
+}
+
+bool WorkerPool::Run(unsigned count, ParallelTask task, const void* context)
+{
+    if (InParallelLoop || Workers.empty())
+        return false;
+
+    std::unique_lock<std::mutex> dispatch(DispatchLock, std::try_to_lock);
+    if (!dispatch.owns_lock())
+        return false;
+
+    Task = task;
+    Context = context;
+    Count = count;
+    Grain = count / (ThreadCountValue * kTasksPerThread);
+    if (Grain < 1)
+        Grain = 1;
+    NextIndex.store(0, std::memory_order_relaxed);
+
+    // Open the loop to workers
+    const uint64_t generation = (State.load() >> kPoolGenerationShift) + 1;
+    State = (generation << kPoolGenerationShift) | kPoolOpenBit;
+
+    if (ParkedCount > 0)
+    {
+        std::lock_guard<std::mutex> locker(ParkLock);
+        ParkCondition.notify_all();
+    }
+
+    InParallelLoop = true;
+    RunTasks();
+    InParallelLoop = false;
+
+    // Close the loop and wait for workers that joined it to finish
+    State.fetch_and(~kPoolOpenBit);
+    while ((State.load() & kPoolActiveMask) != 0)
+        SpinPause();
+
+    return true;
+}
+
+void WorkerPool::WorkerLoop()
+{
+    InParallelLoop = true;
+
+    uint64_t seen_generation = 0;
+    auto is_new_loop = [&seen_generation](uint64_t state) -> bool {
+        return (state & kPoolOpenBit) != 0 &&
+            (state >> kPoolGenerationShift) != seen_generation;
+    };
+
+    for (;;)
     {
-        M256 * RESTRICT x32 = reinterpret_cast<M256 *>(vx);
-        const M256 * RESTRICT y32 = reinterpret_cast<const M256 *>(vy);
-        while (bytes >= 128)
+        uint64_t state = State.load();
+
+        // Spin, then park until a new loop is opened
+        for (unsigned spins = 0; !is_new_loop(state) && !Terminated; ++spins)
         {
-            const M256 x0 = _mm256_xor_si256(_mm256_loadu_si256(x32),     _mm256_loadu_si256(y32));
-            const M256 x1 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 1), _mm256_loadu_si256(y32 + 1));
-            const M256 x2 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 2), _mm256_loadu_si256(y32 + 2));
-            const M256 x3 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 3), _mm256_loadu_si256(y32 + 3));
-            _mm256_storeu_si256(x32, x0);
-            _mm256_storeu_si256(x32 + 1, x1);
-            _mm256_storeu_si256(x32 + 2, x2);
-            _mm256_storeu_si256(x32 + 3, x3);
-            x32 += 4, y32 += 4;
-            bytes -= 128;
-        };
-        if (bytes > 0)
+            if (spins < kWorkerSpinCount)
+            {
+                SpinPause();
+                state = State.load();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> locker(ParkLock);
+            ++ParkedCount;
+            ParkCondition.wait(locker, [&]() -> bool {
+                state = State.load();
+                return is_new_loop(state) || Terminated;
+            });
+            --ParkedCount;
+        }
+
+        if (Terminated)
+            return;
+
+        const uint64_t generation = state >> kPoolGenerationShift;
+        seen_generation = generation;
+
+        // Join the loop while it is still open
+        while ((state & kPoolOpenBit) != 0 &&
+            (state >> kPoolGenerationShift) == generation)
         {
-            const M256 x0 = _mm256_xor_si256(_mm256_loadu_si256(x32),     _mm256_loadu_si256(y32));
-            const M256 x1 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 1), _mm256_loadu_si256(y32 + 1));
-            _mm256_storeu_si256(x32, x0);
-            _mm256_storeu_si256(x32 + 1, x1);
+            if (State.compare_exchange_weak(state, state + 1))
+            {
+                RunTasks();
+                State.fetch_sub(1);
+                break;
+            }
         }
-        return;
     }
+}
+
+bool StartWorkerPool(unsigned thread_count, const unsigned* affinity)
+{
+    if (thread_count == 0)
+    {
+        thread_count = std::thread::hardware_concurrency();
+        if (thread_count == 0)
+            thread_count = 1;
+        affinity = nullptr;
+    }
+
+    Pool.Start(thread_count, affinity);
+    PoolStarted = true;
+    return true;
+}
+
+void StopWorkerPool()
+{
+    Pool.Stop();
+}
+
+bool IsWorkerPoolStarted()
+{
+    return PoolStarted;
+}
+
+unsigned GetThreadCount()
+{
+    return Pool.ThreadCount();
+}
+
+void ParallelForTasks(unsigned count, ParallelTask task, const void* context)
+{
+    if (!Pool.Run(count, task, context))
+        task(context, 0, count);
+}
+
+
+//------------------------------------------------------------------------------
+// Byte Slices
+
+static ExecutionMode SelectedMode = ExecuteLayers;
+static uint64_t SelectedSliceBytes = 0;
+
+// Fallback when the cache size cannot be queried
+static const uint64_t kDefaultL2CacheBytes = 256 * 1024;
+
+static uint64_t GetL2CacheBytes()
+{
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+    const long l2_bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (l2_bytes > 0)
+        return static_cast<uint64_t>(l2_bytes);
+#endif
+    return kDefaultL2CacheBytes;
+}
+
+void SetExecutionMode(ExecutionMode mode, uint64_t slice_bytes)
+{
+    SelectedMode = mode;
+    SelectedSliceBytes = slice_bytes;
+}
+
+uint64_t GetSliceBytes(uint64_t buffer_bytes, unsigned piece_count)
+{
+    if (SelectedMode == ExecuteLayers)
+        return buffer_bytes;
+
+    return GetBatchSliceBytes(buffer_bytes, piece_count);
+}
+
+uint64_t GetBatchSliceBytes(uint64_t buffer_bytes, unsigned piece_count)
+{
+    uint64_t slice_bytes = SelectedSliceBytes;
+    if (slice_bytes == 0)
+    {
+        static const uint64_t kL2CacheBytes = GetL2CacheBytes();
+
+        // Leave half of L2 for the multiply tables and stack
+        slice_bytes = (kL2CacheBytes / 2 / piece_count) & ~(uint64_t)63;
+        if (slice_bytes < kMinSliceBytes)
+            slice_bytes = kMinSliceBytes;
+    }
+
+    if (slice_bytes > buffer_bytes)
+        return buffer_bytes;
+    return slice_bytes;
+}
+
+
+unsigned GetColumnWorkers(uint64_t buffer_bytes)
+{
+    if (SelectedMode != ExecuteColumns)
+        return 1;
+
+    const uint64_t thread_count = GetThreadCount();
+
+    const uint64_t max_workers = buffer_bytes / kMinColumnBytes;
+    if (max_workers < thread_count)
+        return max_workers > 0 ? static_cast<unsigned>(max_workers) : 1;
+    return static_cast<unsigned>(thread_count);
+}
+
+void GetColumnRange(
+    uint64_t buffer_bytes,
+    unsigned workers,
+    unsigned worker,
+    uint64_t& begin,
+    uint64_t& end)
+{
+    const uint64_t blocks = buffer_bytes / 64;
+    begin = (blocks * worker / workers) * 64;
+    end = (blocks * (worker + 1) / workers) * 64;
+}
+
+
+//------------------------------------------------------------------------------
+// Prefetch
+
+#ifdef PREFETCH_NEXT_OPT
+bool PrefetchNextEnabled = false;
+#endif // PREFETCH_NEXT_OPT
+
+
+//------------------------------------------------------------------------------
+// Streaming Stores
+
+static StreamingStores SelectedStreaming = StreamAuto;
+
+// Fallback when the cache size cannot be queried
+static const uint64_t kDefaultLLCBytes = 8 * 1024 * 1024;
+
+static uint64_t GetLLCBytes()
+{
+#if defined(_SC_LEVEL3_CACHE_SIZE)
+    const long l3_bytes = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (l3_bytes > 0)
+        return static_cast<uint64_t>(l3_bytes);
+#endif
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+    const long l2_bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (l2_bytes > 0)
+        return static_cast<uint64_t>(l2_bytes);
+#endif
+    return kDefaultLLCBytes;
+}
+
+void SetStreamingStores(StreamingStores mode)
+{
+    SelectedStreaming = mode;
+}
+
+bool UseStreamingStores(
+    uint64_t stripe_bytes,
+    void* const* outputs,
+    unsigned count)
+{
+    if (SelectedStreaming == StreamNever)
+        return false;
+
+    if (SelectedStreaming == StreamAuto)
+    {
+        static const uint64_t kLLCBytes = GetLLCBytes();
+        if (stripe_bytes <= kLLCBytes)
+            return false;
+    }
+
+    for (unsigned i = 0; i < count; ++i)
+        if ((uintptr_t)outputs[i] % kStreamAlignBytes != 0)
+            return false;
+    return true;
+}
+
+
+//------------------------------------------------------------------------------
+// Erasure Cache
+
+void ErasureKey::Initialize(
+    unsigned m,
+    unsigned original_count,
+    unsigned recovery_count,
+    const void* const * const original,
+    const void* const * const recovery)
+{
+    M = m;
+    OriginalCount = original_count;
+
+    const unsigned bit_count = m + original_count;
+    Bits.assign((bit_count + 63) / 64, 0);
+
+    for (unsigned i = 0; i < recovery_count; ++i)
+        if (!recovery[i])
+            Bits[i / 64] |= (uint64_t)1 << (i % 64);
+    for (unsigned i = recovery_count; i < m; ++i)
+        Bits[i / 64] |= (uint64_t)1 << (i % 64);
+    for (unsigned i = 0; i < original_count; ++i)
+    {
+        if (!original[i])
+        {
+            const unsigned bit = m + i;
+            Bits[bit / 64] |= (uint64_t)1 << (bit % 64);
+        }
+    }
+
+    // FNV-1a over the words
+    uint64_t hash = 14695981039346656037ULL ^ ((uint64_t)m << 32 | original_count);
+    for (uint64_t word : Bits)
+    {
+        hash ^= word;
+        hash *= 1099511628211ULL;
+    }
+    Hash = hash;
+}
+
+
+//------------------------------------------------------------------------------
+// XOR Memory
+
+#if defined(TRY_AVX2)
+
+static TARGET_AVX2 void xor_mem_avx2(
+    void * RESTRICT vx, const void * RESTRICT vy,
+    uint64_t bytes)
+{
+    M256 * RESTRICT x32 = reinterpret_cast<M256 *>(vx);
+    const M256 * RESTRICT y32 = reinterpret_cast<const M256 *>(vy);
+    while (bytes >= 128)
+    {
+        const M256 x0 = _mm256_xor_si256(_mm256_loadu_si256(x32),     _mm256_loadu_si256(y32));
+        const M256 x1 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 1), _mm256_loadu_si256(y32 + 1));
+        const M256 x2 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 2), _mm256_loadu_si256(y32 + 2));
+        const M256 x3 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 3), _mm256_loadu_si256(y32 + 3));
+        _mm256_storeu_si256(x32, x0);
+        _mm256_storeu_si256(x32 + 1, x1);
+        _mm256_storeu_si256(x32 + 2, x2);
+        _mm256_storeu_si256(x32 + 3, x3);
+        x32 += 4, y32 += 4;
+        bytes -= 128;
+    };
+    if (bytes > 0)
+    {
+        const M256 x0 = _mm256_xor_si256(_mm256_loadu_si256(x32),     _mm256_loadu_si256(y32));
+        const M256 x1 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 1), _mm256_loadu_si256(y32 + 1));
+        _mm256_storeu_si256(x32, x0);
+        _mm256_storeu_si256(x32 + 1, x1);
+    }
+}
+
 #endif // TRY_AVX2
 
+static void xor_mem_sse2(
+    void * RESTRICT vx, const void * RESTRICT vy,
+    uint64_t bytes)
+{
     M128 * RESTRICT x16 = reinterpret_cast<M128 *>(vx);
     const M128 * RESTRICT y16 = reinterpret_cast<const M128 *>(vy);
     do
@@ -176,52 +705,61 @@ void xor_mem(
     } while (bytes > 0);
 }
 
+void (*xor_mem)(
+    void * RESTRICT x, const void * RESTRICT y,
+    uint64_t bytes) = xor_mem_sse2;
+
+
 #ifdef M1_OPT
 
-void xor_mem_2to1(
+#if defined(TRY_AVX2)
+
+static TARGET_AVX2 void xor_mem_2to1_avx2(
     void * RESTRICT x,
     const void * RESTRICT y,
     const void * RESTRICT z,
     uint64_t bytes)
 {
-#if defined(TRY_AVX2)
-    if (CpuHasAVX2)
+    M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
+    const M256 * RESTRICT y32 = reinterpret_cast<const M256 *>(y);
+    const M256 * RESTRICT z32 = reinterpret_cast<const M256 *>(z);
+    while (bytes >= 128)
     {
-        M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
-        const M256 * RESTRICT y32 = reinterpret_cast<const M256 *>(y);
-        const M256 * RESTRICT z32 = reinterpret_cast<const M256 *>(z);
-        while (bytes >= 128)
-        {
-            M256 x0 = _mm256_xor_si256(_mm256_loadu_si256(x32), _mm256_loadu_si256(y32));
-            x0 = _mm256_xor_si256(x0, _mm256_loadu_si256(z32));
-            M256 x1 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 1), _mm256_loadu_si256(y32 + 1));
-            x1 = _mm256_xor_si256(x1, _mm256_loadu_si256(z32 + 1));
-            M256 x2 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 2), _mm256_loadu_si256(y32 + 2));
-            x2 = _mm256_xor_si256(x2, _mm256_loadu_si256(z32 + 2));
-            M256 x3 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 3), _mm256_loadu_si256(y32 + 3));
-            x3 = _mm256_xor_si256(x3, _mm256_loadu_si256(z32 + 3));
-            _mm256_storeu_si256(x32, x0);
-            _mm256_storeu_si256(x32 + 1, x1);
-            _mm256_storeu_si256(x32 + 2, x2);
-            _mm256_storeu_si256(x32 + 3, x3);
-            x32 += 4, y32 += 4, z32 += 4;
-            bytes -= 128;
-        };
-
-        if (bytes > 0)
-        {
-            M256 x0 = _mm256_xor_si256(_mm256_loadu_si256(x32),     _mm256_loadu_si256(y32));
-            x0 = _mm256_xor_si256(x0, _mm256_loadu_si256(z32));
-            M256 x1 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 1), _mm256_loadu_si256(y32 + 1));
-            x1 = _mm256_xor_si256(x1, _mm256_loadu_si256(z32 + 1));
-            _mm256_storeu_si256(x32, x0);
-            _mm256_storeu_si256(x32 + 1, x1);
-        }
+        M256 x0 = _mm256_xor_si256(_mm256_loadu_si256(x32), _mm256_loadu_si256(y32));
+        x0 = _mm256_xor_si256(x0, _mm256_loadu_si256(z32));
+        M256 x1 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 1), _mm256_loadu_si256(y32 + 1));
+        x1 = _mm256_xor_si256(x1, _mm256_loadu_si256(z32 + 1));
+        M256 x2 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 2), _mm256_loadu_si256(y32 + 2));
+        x2 = _mm256_xor_si256(x2, _mm256_loadu_si256(z32 + 2));
+        M256 x3 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 3), _mm256_loadu_si256(y32 + 3));
+        x3 = _mm256_xor_si256(x3, _mm256_loadu_si256(z32 + 3));
+        _mm256_storeu_si256(x32, x0);
+        _mm256_storeu_si256(x32 + 1, x1);
+        _mm256_storeu_si256(x32 + 2, x2);
+        _mm256_storeu_si256(x32 + 3, x3);
+        x32 += 4, y32 += 4, z32 += 4;
+        bytes -= 128;
+    };
 
-        return;
+    if (bytes > 0)
+    {
+        M256 x0 = _mm256_xor_si256(_mm256_loadu_si256(x32),     _mm256_loadu_si256(y32));
+        x0 = _mm256_xor_si256(x0, _mm256_loadu_si256(z32));
+        M256 x1 = _mm256_xor_si256(_mm256_loadu_si256(x32 + 1), _mm256_loadu_si256(y32 + 1));
+        x1 = _mm256_xor_si256(x1, _mm256_loadu_si256(z32 + 1));
+        _mm256_storeu_si256(x32, x0);
+        _mm256_storeu_si256(x32 + 1, x1);
     }
+}
+
 #endif // TRY_AVX2
 
+static void xor_mem_2to1_sse2(
+    void * RESTRICT x,
+    const void * RESTRICT y,
+    const void * RESTRICT z,
+    uint64_t bytes)
+{
     M128 * RESTRICT x16 = reinterpret_cast<M128 *>(x);
     const M128 * RESTRICT y16 = reinterpret_cast<const M128 *>(y);
     const M128 * RESTRICT z16 = reinterpret_cast<const M128 *>(z);
@@ -244,90 +782,104 @@ void xor_mem_2to1(
     } while (bytes > 0);
 }
 
+void (*xor_mem_2to1)(
+    void * RESTRICT x,
+    const void * RESTRICT y,
+    const void * RESTRICT z,
+    uint64_t bytes) = xor_mem_2to1_sse2;
+
+
 #endif // M1_OPT
 
 #ifdef USE_VECTOR4_OPT
 
-void xor_mem4(
+#if defined(TRY_AVX2)
+
+static TARGET_AVX2 void xor_mem4_avx2(
     void * RESTRICT vx_0, const void * RESTRICT vy_0,
     void * RESTRICT vx_1, const void * RESTRICT vy_1,
     void * RESTRICT vx_2, const void * RESTRICT vy_2,
     void * RESTRICT vx_3, const void * RESTRICT vy_3,
     uint64_t bytes)
 {
-#if defined(TRY_AVX2)
-    if (CpuHasAVX2)
+    M256 * RESTRICT       x32_0 = reinterpret_cast<M256 *>      (vx_0);
+    const M256 * RESTRICT y32_0 = reinterpret_cast<const M256 *>(vy_0);
+    M256 * RESTRICT       x32_1 = reinterpret_cast<M256 *>      (vx_1);
+    const M256 * RESTRICT y32_1 = reinterpret_cast<const M256 *>(vy_1);
+    M256 * RESTRICT       x32_2 = reinterpret_cast<M256 *>      (vx_2);
+    const M256 * RESTRICT y32_2 = reinterpret_cast<const M256 *>(vy_2);
+    M256 * RESTRICT       x32_3 = reinterpret_cast<M256 *>      (vx_3);
+    const M256 * RESTRICT y32_3 = reinterpret_cast<const M256 *>(vy_3);
+    while (bytes >= 128)
     {
-        M256 * RESTRICT       x32_0 = reinterpret_cast<M256 *>      (vx_0);
-        const M256 * RESTRICT y32_0 = reinterpret_cast<const M256 *>(vy_0);
-        M256 * RESTRICT       x32_1 = reinterpret_cast<M256 *>      (vx_1);
-        const M256 * RESTRICT y32_1 = reinterpret_cast<const M256 *>(vy_1);
-        M256 * RESTRICT       x32_2 = reinterpret_cast<M256 *>      (vx_2);
-        const M256 * RESTRICT y32_2 = reinterpret_cast<const M256 *>(vy_2);
-        M256 * RESTRICT       x32_3 = reinterpret_cast<M256 *>      (vx_3);
-        const M256 * RESTRICT y32_3 = reinterpret_cast<const M256 *>(vy_3);
-        while (bytes >= 128)
-        {
-            const M256 x0_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0),     _mm256_loadu_si256(y32_0));
-            const M256 x1_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0 + 1), _mm256_loadu_si256(y32_0 + 1));
-            const M256 x2_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0 + 2), _mm256_loadu_si256(y32_0 + 2));
-            const M256 x3_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0 + 3), _mm256_loadu_si256(y32_0 + 3));
-            _mm256_storeu_si256(x32_0, x0_0);
-            _mm256_storeu_si256(x32_0 + 1, x1_0);
-            _mm256_storeu_si256(x32_0 + 2, x2_0);
-            _mm256_storeu_si256(x32_0 + 3, x3_0);
-            x32_0 += 4, y32_0 += 4;
-            const M256 x0_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1),     _mm256_loadu_si256(y32_1));
-            const M256 x1_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1 + 1), _mm256_loadu_si256(y32_1 + 1));
-            const M256 x2_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1 + 2), _mm256_loadu_si256(y32_1 + 2));
-            const M256 x3_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1 + 3), _mm256_loadu_si256(y32_1 + 3));
-            _mm256_storeu_si256(x32_1, x0_1);
-            _mm256_storeu_si256(x32_1 + 1, x1_1);
-            _mm256_storeu_si256(x32_1 + 2, x2_1);
-            _mm256_storeu_si256(x32_1 + 3, x3_1);
-            x32_1 += 4, y32_1 += 4;
-            const M256 x0_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2),     _mm256_loadu_si256(y32_2));
-            const M256 x1_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2 + 1), _mm256_loadu_si256(y32_2 + 1));
-            const M256 x2_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2 + 2), _mm256_loadu_si256(y32_2 + 2));
-            const M256 x3_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2 + 3), _mm256_loadu_si256(y32_2 + 3));
-            _mm256_storeu_si256(x32_2, x0_2);
-            _mm256_storeu_si256(x32_2 + 1, x1_2);
-            _mm256_storeu_si256(x32_2 + 2, x2_2);
-            _mm256_storeu_si256(x32_2 + 3, x3_2);
-            x32_2 += 4, y32_2 += 4;
-            const M256 x0_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3),     _mm256_loadu_si256(y32_3));
-            const M256 x1_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3 + 1), _mm256_loadu_si256(y32_3 + 1));
-            const M256 x2_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3 + 2), _mm256_loadu_si256(y32_3 + 2));
-            const M256 x3_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3 + 3), _mm256_loadu_si256(y32_3 + 3));
-            _mm256_storeu_si256(x32_3,     x0_3);
-            _mm256_storeu_si256(x32_3 + 1, x1_3);
-            _mm256_storeu_si256(x32_3 + 2, x2_3);
-            _mm256_storeu_si256(x32_3 + 3, x3_3);
-            x32_3 += 4, y32_3 += 4;
-            bytes -= 128;
-        }
-        if (bytes > 0)
-        {
-            const M256 x0_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0),     _mm256_loadu_si256(y32_0));
-            const M256 x1_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0 + 1), _mm256_loadu_si256(y32_0 + 1));
-            const M256 x0_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1),     _mm256_loadu_si256(y32_1));
-            const M256 x1_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1 + 1), _mm256_loadu_si256(y32_1 + 1));
-            _mm256_storeu_si256(x32_0, x0_0);
-            _mm256_storeu_si256(x32_0 + 1, x1_0);
-            _mm256_storeu_si256(x32_1, x0_1);
-            _mm256_storeu_si256(x32_1 + 1, x1_1);
-            const M256 x0_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2),     _mm256_loadu_si256(y32_2));
-            const M256 x1_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2 + 1), _mm256_loadu_si256(y32_2 + 1));
-            const M256 x0_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3),     _mm256_loadu_si256(y32_3));
-            const M256 x1_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3 + 1), _mm256_loadu_si256(y32_3 + 1));
-            _mm256_storeu_si256(x32_2,     x0_2);
-            _mm256_storeu_si256(x32_2 + 1, x1_2);
-            _mm256_storeu_si256(x32_3,     x0_3);
-            _mm256_storeu_si256(x32_3 + 1, x1_3);
-        }
-        return;
+        const M256 x0_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0),     _mm256_loadu_si256(y32_0));
+        const M256 x1_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0 + 1), _mm256_loadu_si256(y32_0 + 1));
+        const M256 x2_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0 + 2), _mm256_loadu_si256(y32_0 + 2));
+        const M256 x3_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0 + 3), _mm256_loadu_si256(y32_0 + 3));
+        _mm256_storeu_si256(x32_0, x0_0);
+        _mm256_storeu_si256(x32_0 + 1, x1_0);
+        _mm256_storeu_si256(x32_0 + 2, x2_0);
+        _mm256_storeu_si256(x32_0 + 3, x3_0);
+        x32_0 += 4, y32_0 += 4;
+        const M256 x0_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1),     _mm256_loadu_si256(y32_1));
+        const M256 x1_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1 + 1), _mm256_loadu_si256(y32_1 + 1));
+        const M256 x2_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1 + 2), _mm256_loadu_si256(y32_1 + 2));
+        const M256 x3_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1 + 3), _mm256_loadu_si256(y32_1 + 3));
+        _mm256_storeu_si256(x32_1, x0_1);
+        _mm256_storeu_si256(x32_1 + 1, x1_1);
+        _mm256_storeu_si256(x32_1 + 2, x2_1);
+        _mm256_storeu_si256(x32_1 + 3, x3_1);
+        x32_1 += 4, y32_1 += 4;
+        const M256 x0_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2),     _mm256_loadu_si256(y32_2));
+        const M256 x1_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2 + 1), _mm256_loadu_si256(y32_2 + 1));
+        const M256 x2_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2 + 2), _mm256_loadu_si256(y32_2 + 2));
+        const M256 x3_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2 + 3), _mm256_loadu_si256(y32_2 + 3));
+        _mm256_storeu_si256(x32_2, x0_2);
+        _mm256_storeu_si256(x32_2 + 1, x1_2);
+        _mm256_storeu_si256(x32_2 + 2, x2_2);
+        _mm256_storeu_si256(x32_2 + 3, x3_2);
+        x32_2 += 4, y32_2 += 4;
+        const M256 x0_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3),     _mm256_loadu_si256(y32_3));
+        const M256 x1_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3 + 1), _mm256_loadu_si256(y32_3 + 1));
+        const M256 x2_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3 + 2), _mm256_loadu_si256(y32_3 + 2));
+        const M256 x3_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3 + 3), _mm256_loadu_si256(y32_3 + 3));
+        _mm256_storeu_si256(x32_3,     x0_3);
+        _mm256_storeu_si256(x32_3 + 1, x1_3);
+        _mm256_storeu_si256(x32_3 + 2, x2_3);
+        _mm256_storeu_si256(x32_3 + 3, x3_3);
+        x32_3 += 4, y32_3 += 4;
+        bytes -= 128;
     }
+    if (bytes > 0)
+    {
+        const M256 x0_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0),     _mm256_loadu_si256(y32_0));
+        const M256 x1_0 = _mm256_xor_si256(_mm256_loadu_si256(x32_0 + 1), _mm256_loadu_si256(y32_0 + 1));
+        const M256 x0_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1),     _mm256_loadu_si256(y32_1));
+        const M256 x1_1 = _mm256_xor_si256(_mm256_loadu_si256(x32_1 + 1), _mm256_loadu_si256(y32_1 + 1));
+        _mm256_storeu_si256(x32_0, x0_0);
+        _mm256_storeu_si256(x32_0 + 1, x1_0);
+        _mm256_storeu_si256(x32_1, x0_1);
+        _mm256_storeu_si256(x32_1 + 1, x1_1);
+        const M256 x0_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2),     _mm256_loadu_si256(y32_2));
+        const M256 x1_2 = _mm256_xor_si256(_mm256_loadu_si256(x32_2 + 1), _mm256_loadu_si256(y32_2 + 1));
+        const M256 x0_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3),     _mm256_loadu_si256(y32_3));
+        const M256 x1_3 = _mm256_xor_si256(_mm256_loadu_si256(x32_3 + 1), _mm256_loadu_si256(y32_3 + 1));
+        _mm256_storeu_si256(x32_2,     x0_2);
+        _mm256_storeu_si256(x32_2 + 1, x1_2);
+        _mm256_storeu_si256(x32_3,     x0_3);
+        _mm256_storeu_si256(x32_3 + 1, x1_3);
+    }
+}
+
 #endif // TRY_AVX2
+
+static void xor_mem4_sse2(
+    void * RESTRICT vx_0, const void * RESTRICT vy_0,
+    void * RESTRICT vx_1, const void * RESTRICT vy_1,
+    void * RESTRICT vx_2, const void * RESTRICT vy_2,
+    void * RESTRICT vx_3, const void * RESTRICT vy_3,
+    uint64_t bytes)
+{
     M128 * RESTRICT       x16_0 = reinterpret_cast<M128 *>      (vx_0);
     const M128 * RESTRICT y16_0 = reinterpret_cast<const M128 *>(vy_0);
     M128 * RESTRICT       x16_1 = reinterpret_cast<M128 *>      (vx_1);
@@ -378,7 +930,41 @@ void xor_mem4(
     } while (bytes > 0);
 }
 
+void (*xor_mem4)(
+    void * RESTRICT x_0, const void * RESTRICT y_0,
+    void * RESTRICT x_1, const void * RESTRICT y_1,
+    void * RESTRICT x_2, const void * RESTRICT y_2,
+    void * RESTRICT x_3, const void * RESTRICT y_3,
+    uint64_t bytes) = xor_mem4_sse2;
+
+
+#endif // USE_VECTOR4_OPT
+
+// Points the XOR routines at the widest versions the CPU supports
+static void SelectXORKernels()
+{
+#if defined(TRY_AVX2)
+    if (CpuHasAVX2)
+    {
+        xor_mem = xor_mem_avx2;
+#ifdef M1_OPT
+        xor_mem_2to1 = xor_mem_2to1_avx2;
+#endif // M1_OPT
+#ifdef USE_VECTOR4_OPT
+        xor_mem4 = xor_mem4_avx2;
 #endif // USE_VECTOR4_OPT
+        return;
+    }
+#endif // TRY_AVX2
+
+    xor_mem = xor_mem_sse2;
+#ifdef M1_OPT
+    xor_mem_2to1 = xor_mem_2to1_sse2;
+#endif // M1_OPT
+#ifdef USE_VECTOR4_OPT
+    xor_mem4 = xor_mem4_sse2;
+#endif // USE_VECTOR4_OPT
+}
 
 void VectorXOR_Threads(
     const uint64_t bytes,
@@ -390,16 +976,15 @@ void VectorXOR_Threads(
     if (count >= 4)
     {
         int i_end = count - 4;
-#pragma omp parallel for
-        for (int i = 0; i <= i_end; i += 4)
-        {
+        ParallelFor(i_end / 4 + 1, [=](unsigned j) {
+            const unsigned i = j * 4;
             xor_mem4(
                 x[i + 0], y[i + 0],
                 x[i + 1], y[i + 1],
                 x[i + 2], y[i + 2],
                 x[i + 3], y[i + 3],
                 bytes);
-        }
+        });
         count %= 4;
         i_end -= count;
         x += i_end;
@@ -441,4 +1026,198 @@ void VectorXOR(
 }
 
 
+//------------------------------------------------------------------------------
+// Mapped Files
+
+bool MappedFile::Open(const char* path)
+{
+    Close();
+
+#ifdef _WIN32
+    File = ::CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (File == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!::GetFileSizeEx(File, &size) || size.QuadPart <= 0)
+    {
+        Close();
+        return false;
+    }
+
+    Mapping = ::CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!Mapping)
+    {
+        Close();
+        return false;
+    }
+
+    Data = (const uint8_t*)::MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!Data)
+    {
+        Close();
+        return false;
+    }
+    Bytes = static_cast<uint64_t>(size.QuadPart);
+#else
+    const int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* data = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+        return false;
+    Data = (const uint8_t*)data;
+    Bytes = static_cast<uint64_t>(info.st_size);
+#endif // _WIN32
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (Data)
+        ::UnmapViewOfFile(Data);
+    if (Mapping)
+        ::CloseHandle(Mapping);
+    if (File != INVALID_HANDLE_VALUE)
+        ::CloseHandle(File);
+    Mapping = nullptr;
+    File = INVALID_HANDLE_VALUE;
+#else
+    if (Data)
+        ::munmap((void*)Data, static_cast<size_t>(Bytes));
+#endif // _WIN32
+
+    Data = nullptr;
+    Bytes = 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Large Allocations
+
+static const uint64_t kHugePageBytes = 2 * 1024 * 1024;
+
+static uint64_t RoundUpBytes(uint64_t bytes, uint64_t multiple)
+{
+    return (bytes + multiple - 1) / multiple * multiple;
+}
+
+bool LargeAllocation::Allocate(uint64_t bytes)
+{
+    Free();
+
+    if (bytes <= 0)
+        return false;
+
+#ifdef _WIN32
+    // Large pages need the SeLockMemoryPrivilege, so expect this to fail
+    const SIZE_T large_page_bytes = ::GetLargePageMinimum();
+    if (large_page_bytes != 0 && bytes >= large_page_bytes)
+    {
+        const uint64_t mapped_bytes = RoundUpBytes(bytes, large_page_bytes);
+        Data = (uint8_t*)::VirtualAlloc(nullptr, static_cast<SIZE_T>(mapped_bytes),
+            MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+        HugePages = (Data != nullptr);
+    }
+
+    if (!Data)
+        Data = (uint8_t*)::VirtualAlloc(nullptr, static_cast<SIZE_T>(bytes),
+            MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!Data)
+        return false;
+#else
+    const uint64_t page_bytes = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+    // Explicit huge pages come from a pool the administrator reserves with
+    // vm.nr_hugepages, and the mapping fails when the pool is too small
+    if (bytes >= kHugePageBytes)
+    {
+        const uint64_t mapped_bytes = RoundUpBytes(bytes, kHugePageBytes);
+        void* data = ::mmap(nullptr, static_cast<size_t>(mapped_bytes), PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (21 << MAP_HUGE_SHIFT), -1, 0);
+        if (data != MAP_FAILED)
+        {
+            Data = (uint8_t*)data;
+            MappedBytes = mapped_bytes;
+            HugePages = true;
+        }
+    }
+#endif // MAP_HUGETLB
+
+    if (!Data)
+    {
+        const uint64_t mapped_bytes = RoundUpBytes(bytes, page_bytes);
+
+        // Map an extra huge page so the start can be moved to a huge page
+        // boundary, where transparent huge pages can back the first bytes
+        const uint64_t slack_bytes = (bytes >= kHugePageBytes) ? kHugePageBytes : 0;
+
+        void* data = ::mmap(nullptr, static_cast<size_t>(mapped_bytes + slack_bytes),
+            PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED)
+            return false;
+
+        uint8_t* start = (uint8_t*)data;
+        if (slack_bytes > 0)
+        {
+            const uintptr_t address = (uintptr_t)data;
+            start = (uint8_t*)RoundUpBytes(address, kHugePageBytes);
+
+            // Unmap the slack before and after the aligned range
+            const size_t head_bytes = static_cast<size_t>(start - (uint8_t*)data);
+            const size_t tail_bytes = static_cast<size_t>(slack_bytes - head_bytes);
+            if (head_bytes > 0)
+                ::munmap(data, head_bytes);
+            if (tail_bytes > 0)
+                ::munmap(start + mapped_bytes, tail_bytes);
+
+#if defined(MADV_HUGEPAGE)
+            // Failure only means the memory stays on normal pages
+            ::madvise(start, static_cast<size_t>(mapped_bytes), MADV_HUGEPAGE);
+#endif // MADV_HUGEPAGE
+        }
+
+        Data = start;
+        MappedBytes = mapped_bytes;
+    }
+#endif // _WIN32
+
+    Bytes = bytes;
+    return true;
+}
+
+void LargeAllocation::Free()
+{
+    if (Data)
+    {
+#ifdef _WIN32
+        ::VirtualFree(Data, 0, MEM_RELEASE);
+#else
+        ::munmap(Data, static_cast<size_t>(MappedBytes));
+#endif // _WIN32
+    }
+
+    Data = nullptr;
+    Bytes = 0;
+    MappedBytes = 0;
+    HugePages = false;
+}
+
+
 } // namespace codec
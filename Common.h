@@ -105,6 +105,7 @@
 #include <malloc.h>
 #endif //_WIN32
 #include <vector>
+#include <list>
 #include <atomic>
 #include <memory>
 #include <mutex>
@@ -121,6 +122,9 @@
 // Enable using SIMD instructions
 #define USE_SSSE3_OPT
 #define USE_AVX2_OPT
+#define USE_AVX512_OPT
+#define USE_GFNI_OPT
+#define USE_CLMUL_OPT
 
 // Avoid calculating final FFT values in decoder using bitfield
 #define ERROR_BITFIELD_OPT
@@ -128,12 +132,20 @@
 // Interleave butterfly operations between layer pairs in FFT
 #define INTERLEAVE_BUTTERFLY4_OPT
 
+// Interleave butterfly operations between layer triples in FFT where the
+// registers allow it (AVX-512 for GF(2^16), AVX2 for GF(2^8))
+#define INTERLEAVE_BUTTERFLY8_OPT
+
 // Optimize M=1 case
 #define M1_OPT
 
 // Unroll inner loops 4 times
 #define USE_VECTOR4_OPT
 
+// Prefetch the pieces of the next butterfly while the current one runs, when
+// enabled at runtime by codec_set_prefetch()
+#define PREFETCH_NEXT_OPT
+
 // MacOS M1
 #if defined(__aarch64__)
   #define USE_SSE2NEON
@@ -197,13 +209,51 @@
     #define TARGET_MOBILE
 #endif // ANDROID
 
-#if defined(__AVX2__) || (defined (_MSC_VER) && _MSC_VER >= 1900)
+// The AVX2 kernels are built into every x86 binary and picked at runtime,
+// so a generic x86-64 build still uses them on CPUs that support AVX2
+#if !defined(TARGET_MOBILE)
     #define TRY_AVX2 /* 256-bit */
     #include <immintrin.h>
     #define ALIGN_BYTES 32
-#else // __AVX2__
+#else // TARGET_MOBILE
     #define ALIGN_BYTES 16
-#endif // __AVX2__
+#endif // TARGET_MOBILE
+
+// AVX-512BW kernels are picked the same way where the compiler knows them
+#if !defined(TARGET_MOBILE) && (!defined(_MSC_VER) || _MSC_VER >= 1910)
+    #define TRY_AVX512 /* 512-bit */
+#endif
+
+// Carry-less multiply kernels for the low memory FF16 mode
+#if !defined(TARGET_MOBILE)
+    #define TRY_CLMUL
+#endif
+
+// GFNI kernels (VEX-encoded, on top of AVX2) need a compiler that knows GFNI
+#if !defined(TARGET_MOBILE) && ( \
+    (defined(__clang__) && __clang_major__ >= 7) || \
+    (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 8) || \
+    (defined(_MSC_VER) && _MSC_VER >= 1920))
+    #define TRY_GFNI
+#endif
+
+// Compiler-specific keyword to build one function for a wider instruction set
+// than the rest of the translation unit.  MSVC emits any intrinsic anywhere
+#if !defined(TARGET_MOBILE) && !defined(_MSC_VER)
+    #define TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+    #define TARGET_AVX512_GFNI __attribute__((target("avx512f,avx512bw,gfni")))
+    #define TARGET_GFNI __attribute__((target("avx2,gfni")))
+    #define TARGET_CLMUL __attribute__((target("pclmul,sse4.1")))
+    #define TARGET_AVX2 __attribute__((target("avx2")))
+    #define TARGET_SSSE3 __attribute__((target("ssse3")))
+#else
+    #define TARGET_AVX512
+    #define TARGET_AVX512_GFNI
+    #define TARGET_GFNI
+    #define TARGET_CLMUL
+    #define TARGET_AVX2
+    #define TARGET_SSSE3
+#endif
 
 #if !defined(TARGET_MOBILE)
     // Note: MSVC currently only supports SSSE3 but not AVX2
@@ -243,6 +293,11 @@
     #define M256 __m256i
 #endif
 
+#ifdef TRY_AVX512
+    // Compiler-specific 512-bit SIMD register keyword
+    #define M512 __m512i
+#endif
+
 // Compiler-specific C++11 restrict keyword
 #define RESTRICT __restrict
 
@@ -286,12 +341,24 @@ void InitializeCPUArch();
 #endif
 
 #if !defined(TARGET_MOBILE)
+# if defined(TRY_AVX512)
+    // Does CPU support AVX-512F and AVX-512BW?
+    extern bool CpuHasAVX512;
+# endif
+# if defined(TRY_GFNI)
+    // Does CPU support GFNI alongside AVX2?
+    extern bool CpuHasGFNI;
+# endif
 # if defined(TRY_AVX2)
     // Does CPU support AVX2?
     extern bool CpuHasAVX2;
 # endif
     // Does CPU support SSSE3?
     extern bool CpuHasSSSE3;
+# if defined(TRY_CLMUL)
+    // Does CPU support PCLMULQDQ and SSE4.1?
+    extern bool CpuHasCLMUL;
+# endif
 #elif defined(USE_SSE2NEON)
     extern bool CpuHasSSSE3;
 #endif // TARGET_MOBILE
@@ -322,21 +389,58 @@ FORCE_INLINE unsigned NextPow2(unsigned n)
     return 2UL << LastNonzeroBit32(n - 1);
 }
 
+#ifdef PREFETCH_NEXT_OPT
+
+// Leading bytes of each piece to prefetch.  Pieces are separate allocations,
+// so the hardware prefetchers only pick up a stream after its first misses
+static const unsigned kPrefetchBytes = 256;
+
+// Set by codec_set_prefetch().  Off by default
+extern bool PrefetchNextEnabled;
+
+// Requests the leading bytes of a piece into cache
+FORCE_INLINE void PrefetchPiece(const void* piece)
+{
+    if (!piece || !PrefetchNextEnabled)
+        return;
+
+    const char* data = reinterpret_cast<const char*>(piece);
+    for (unsigned offset = 0; offset < kPrefetchBytes; offset += 64)
+    {
+#ifdef _MSC_VER
+        _mm_prefetch(data + offset, _MM_HINT_T0);
+#else
+        __builtin_prefetch(data + offset, 0, 3);
+#endif
+    }
+}
+
+// Prefetches the pieces {0, dist, ..., dist * (ways - 1)} of a butterfly
+FORCE_INLINE void PrefetchButterfly(void* const* pieces, unsigned dist, unsigned ways)
+{
+    for (unsigned k = 0; k < ways; ++k)
+        PrefetchPiece(pieces[dist * k]);
+}
+
+#endif // PREFETCH_NEXT_OPT
+
 
 //------------------------------------------------------------------------------
 // XOR Memory
 //
-// This works for both 8-bit and 16-bit finite fields
+// This works for both 8-bit and 16-bit finite fields.
+// Each routine points at the widest version the CPU supports,
+// selected by InitializeCPUArch()
 
 // x[] ^= y[]
-void xor_mem(
+extern void (*xor_mem)(
     void * RESTRICT x, const void * RESTRICT y,
     uint64_t bytes);
 
 #ifdef M1_OPT
 
 // x[] ^= y[] ^ z[]
-void xor_mem_2to1(
+extern void (*xor_mem_2to1)(
     void * RESTRICT x,
     const void * RESTRICT y,
     const void * RESTRICT z,
@@ -347,7 +451,7 @@ void xor_mem_2to1(
 #ifdef USE_VECTOR4_OPT
 
 // For i = {0, 1, 2, 3}: x_i[] ^= x_i[]
-void xor_mem4(
+extern void (*xor_mem4)(
     void * RESTRICT x_0, const void * RESTRICT y_0,
     void * RESTRICT x_1, const void * RESTRICT y_1,
     void * RESTRICT x_2, const void * RESTRICT y_2,
@@ -415,6 +519,268 @@ protected:
 };
 
 
+//------------------------------------------------------------------------------
+// Worker Pool
+//
+// Parallel loops are dispatched to a persistent pool of worker threads owned
+// by the library.  The calling thread also runs tasks while the workers help.
+// Idle workers spin for a short time before parking on a condition variable,
+// so back-to-back loops do not pay for a thread wake-up.
+//
+// Loops started from inside another parallel loop, or while another thread
+// is using the pool, run on the calling thread.
+
+// Runs tasks [begin, end) of a parallel loop
+typedef void (*ParallelTask)(const void* context, unsigned begin, unsigned end);
+
+// Starts the worker pool with thread_count threads including the caller.
+// thread_count = 0 uses one thread per hardware thread.
+// affinity: Optional array of thread_count - 1 CPU indices to pin workers to
+bool StartWorkerPool(unsigned thread_count, const unsigned* affinity);
+
+// Stops the worker pool so that parallel loops run on the calling thread
+void StopWorkerPool();
+
+// Returns true if the worker pool has been started
+bool IsWorkerPoolStarted();
+
+// Returns the number of threads that run parallel loops, including the caller
+unsigned GetThreadCount();
+
+// Runs task over [0, count) using the worker pool
+void ParallelForTasks(unsigned count, ParallelTask task, const void* context);
+
+template<typename Fn>
+static void InvokeParallelTask(const void* context, unsigned begin, unsigned end)
+{
+    const Fn& fn = *static_cast<const Fn*>(context);
+    for (unsigned i = begin; i < end; ++i)
+        fn(i);
+}
+
+// Runs fn(i) for each i in [0, count) using the worker pool
+template<typename Fn>
+static FORCE_INLINE void ParallelFor(unsigned count, const Fn& fn)
+{
+    if (count <= 1)
+    {
+        if (count == 1)
+            fn(0);
+        return;
+    }
+    ParallelForTasks(count, &InvokeParallelTask<Fn>, &fn);
+}
+
+// Runs fn(r, i_begin, count) over the butterfly spans of one FFT layer.
+// Each of group_count groups starts at r = group * group_size and has a
+// span of butterflies [r, r + span), where span is a power of two.  Spans
+// are split into chunks [i_begin, i_begin + count) when there are too few
+// groups to give every thread work
+template<typename Fn>
+static FORCE_INLINE void ParallelForSpans(
+    unsigned group_count,
+    unsigned group_size,
+    unsigned span,
+    const Fn& fn)
+{
+    const unsigned thread_count = GetThreadCount();
+    unsigned chunk = span;
+    while (chunk > 1 && group_count * (span / chunk) < thread_count)
+        chunk >>= 1;
+
+    const unsigned chunk_count = span / chunk;
+    ParallelFor(group_count * chunk_count, [&](unsigned tile) {
+        const unsigned r = (tile / chunk_count) * group_size;
+        fn(r, r + (tile % chunk_count) * chunk, chunk);
+    });
+}
+
+
+//------------------------------------------------------------------------------
+// Byte Slices
+//
+// Every byte column of the pieces is transformed independently, so the whole
+// encode/decode pipeline can be run on one slice of every piece at a time.
+
+// Minimum slice size, to amortize per-butterfly table loads
+static const uint64_t kMinSliceBytes = 4096;
+
+// Set by codec_set_execution_mode()
+void SetExecutionMode(ExecutionMode mode, uint64_t slice_bytes);
+
+// Returns the number of bytes to process per slice for piece_count pieces.
+// Returns buffer_bytes if the data should not be sliced
+uint64_t GetSliceBytes(uint64_t buffer_bytes, unsigned piece_count);
+
+// Minimum bytes per column worker in ExecuteColumns mode
+static const uint64_t kMinColumnBytes = 1024;
+
+// Returns the number of bytes per slice when many stripes are split into
+// (stripe, slice) tiles.  Slices are used in every execution mode
+uint64_t GetBatchSliceBytes(uint64_t buffer_bytes, unsigned piece_count);
+
+// Returns the number of column workers to split buffer_bytes across.
+// Returns 1 if the data should not be split across threads
+unsigned GetColumnWorkers(uint64_t buffer_bytes);
+
+// Returns the 64-byte aligned range [begin, end) of each piece for a worker
+void GetColumnRange(
+    uint64_t buffer_bytes,
+    unsigned workers,
+    unsigned worker,
+    uint64_t& begin,
+    uint64_t& end);
+
+// Array of buffer pointers advanced to a byte offset
+class SlicePointers
+{
+public:
+    SlicePointers(const void* const* pointers, unsigned count)
+        : Pointers(pointers)
+        , Sliced(count)
+    {
+    }
+
+    // Returns the pointers advanced by offset bytes.  Null pointers stay null
+    void** Offset(uint64_t offset)
+    {
+        const unsigned count = static_cast<unsigned>(Sliced.size());
+        for (unsigned i = 0; i < count; ++i)
+        {
+            uint8_t* data = (uint8_t*)Pointers[i];
+            Sliced[i] = data ? data + offset : nullptr;
+        }
+        return Sliced.data();
+    }
+
+protected:
+    const void* const* Pointers;
+    std::vector<void*> Sliced;
+};
+
+
+//------------------------------------------------------------------------------
+// Streaming Stores
+//
+// The last FFT layer of the encoder and the reveal step of the decoder write
+// outputs that the codec never reads again.  For stripes larger than the
+// last-level cache, non-temporal stores keep those writes from evicting data
+// that is still needed and skip the read-for-ownership of each output line.
+
+// Alignment needed by every output written with streaming stores
+static const uint64_t kStreamAlignBytes = 64;
+
+// Set by codec_set_streaming_stores()
+void SetStreamingStores(StreamingStores mode);
+
+// Returns true if the count outputs of a stripe that touches stripe_bytes in
+// total should be written with streaming stores.  Returns false if any of the
+// non-null outputs is not aligned to kStreamAlignBytes
+bool UseStreamingStores(
+    uint64_t stripe_bytes,
+    void* const* outputs,
+    unsigned count);
+
+// Stores for kernels templated on kStream.  The kernel must run _mm_sfence()
+// after its last streaming store
+#define STORE_256(kStream, ptr, value) { \
+    if (kStream) _mm256_stream_si256(ptr, value); \
+    else _mm256_storeu_si256(ptr, value); }
+#define STORE_512(kStream, ptr, value) { \
+    if (kStream) _mm512_stream_si512(ptr, value); \
+    else _mm512_storeu_si512(ptr, value); }
+
+
+//------------------------------------------------------------------------------
+// Erasure Cache
+//
+// Bounded LRU cache of decoder state for recently seen erasure patterns.
+// When a device fails, many stripes in a row are missing the same pieces, so
+// the error locator evaluated for the first stripe can be reused.
+
+// Which of the m + original_count decoder inputs are missing
+struct ErasureKey
+{
+    unsigned M = 0;
+    unsigned OriginalCount = 0;
+    uint64_t Hash = 0;
+    std::vector<uint64_t> Bits;
+
+    void Initialize(
+        unsigned m,
+        unsigned original_count,
+        unsigned recovery_count,
+        const void* const * const original,
+        const void* const * const recovery);
+
+    bool operator==(const ErasureKey& other) const
+    {
+        return Hash == other.Hash &&
+            M == other.M &&
+            OriginalCount == other.OriginalCount &&
+            Bits == other.Bits;
+    }
+};
+
+template<class T>
+class ErasureCache
+{
+public:
+    // Set the maximum number of entries.  0 disables the cache
+    void SetCapacity(unsigned entries)
+    {
+        std::lock_guard<std::mutex> locker(Lock);
+        Capacity = entries;
+        Trim();
+    }
+
+    bool IsEnabled() const
+    {
+        return Capacity != 0;
+    }
+
+    // Returns nullptr if the pattern is not cached
+    std::shared_ptr<const T> Find(const ErasureKey& key)
+    {
+        std::lock_guard<std::mutex> locker(Lock);
+        for (auto it = Entries.begin(); it != Entries.end(); ++it)
+        {
+            if (it->first == key)
+            {
+                // Move to front
+                Entries.splice(Entries.begin(), Entries, it);
+                return Entries.front().second;
+            }
+        }
+        return nullptr;
+    }
+
+    void Insert(const ErasureKey& key, const std::shared_ptr<const T>& value)
+    {
+        std::lock_guard<std::mutex> locker(Lock);
+        for (auto it = Entries.begin(); it != Entries.end(); ++it)
+        {
+            // Another thread may have inserted it first
+            if (it->first == key)
+                return;
+        }
+        Entries.emplace_front(key, value);
+        Trim();
+    }
+
+protected:
+    std::mutex Lock;
+    std::atomic<unsigned> Capacity{0};
+    std::list<std::pair<ErasureKey, std::shared_ptr<const T>>> Entries;
+
+    void Trim()
+    {
+        while (Entries.size() > Capacity)
+            Entries.pop_back();
+    }
+};
+
+
 //------------------------------------------------------------------------------
 // SIMD-Safe Aligned Memory Allocations
 
@@ -447,4 +813,71 @@ static FORCE_INLINE void SIMDSafeFree(void* ptr)
 }
 
 
+//------------------------------------------------------------------------------
+// Large Allocations
+//
+// Zero-filled, page-aligned memory for multiply tables and work buffers that
+// span many pages.  Large requests first try explicit 2 MB huge pages, then
+// fall back to normal pages aligned to 2 MB and marked for transparent huge
+// pages, so random table lookups and long buffer sweeps take fewer TLB misses.
+
+class LargeAllocation
+{
+public:
+    LargeAllocation() {}
+    LargeAllocation(const LargeAllocation&) = delete;
+    LargeAllocation& operator=(const LargeAllocation&) = delete;
+    ~LargeAllocation()
+    {
+        Free();
+    }
+
+    // Returns false if bytes is zero or out of memory
+    bool Allocate(uint64_t bytes);
+    void Free();
+
+    uint8_t* Data = nullptr;
+    uint64_t Bytes = 0;
+
+    // True if backed by explicit huge pages rather than normal pages
+    bool HugePages = false;
+
+protected:
+    // Size of the mapping at Data, a whole number of pages
+    uint64_t MappedBytes = 0;
+};
+
+
+//------------------------------------------------------------------------------
+// Mapped Files
+//
+// Read-only mapping of a whole file.  The pages come from the OS file cache,
+// so every process that maps the same file shares one copy of them.
+
+class MappedFile
+{
+public:
+    MappedFile() {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile()
+    {
+        Close();
+    }
+
+    // Returns false if the file cannot be opened, is empty, or cannot be mapped
+    bool Open(const char* path);
+    void Close();
+
+    const uint8_t* Data = nullptr;
+    uint64_t Bytes = 0;
+
+#ifdef _WIN32
+protected:
+    HANDLE File = INVALID_HANDLE_VALUE;
+    HANDLE Mapping = nullptr;
+#endif // _WIN32
+};
+
+
 } // namespace codec
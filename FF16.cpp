@@ -3,6 +3,8 @@
 #ifdef HAS_FF16
 
 #include <string.h>
+#include <stdio.h>
+#include <string>
 
 #ifdef _MSC_VER
     #pragma warning(disable: 4752) // found Intel(R) Advanced Vector Extensions; consider using /arch:AVX
@@ -11,21 +13,6 @@
 namespace codec { namespace ff16 {
 
 
-//------------------------------------------------------------------------------
-// Datatypes and Constants
-
-// Basis used for generating logarithm tables
-static const ffe_t kCantorBasis[kBits] = {
-    0x0001, 0xACCA, 0x3C0E, 0x163E,
-    0xC582, 0xED2E, 0x914C, 0x4012,
-    0x6C98, 0x10D8, 0x6A72, 0xB900,
-    0xFDB8, 0xFB34, 0xFF38, 0x991E
-};
-
-// Using the Cantor basis here enables us to avoid a lot of extra calculations
-// when applying the formal derivative in decoding.
-
-
 //------------------------------------------------------------------------------
 // Field Operations
 
@@ -80,39 +67,398 @@ static FORCE_INLINE void FWHT_4(ffe_t* data, unsigned s)
     data[s2 + s] = t3;
 }
 
+// Elements per block of the FWHT that is transformed while it sits in L1 cache
+static const unsigned kFWHTBlock = 4096;
+
+// Full FWHT of count contiguous elements, where count is a power of two
+static void (*FWHT_Block)(ffe_t* data, unsigned count);
+
+// FWHT_4() on data + i with stride dist, for i in [0, count)
+static void (*FWHT_Span4)(ffe_t* data, unsigned dist, unsigned count);
+
+// FWHT_2() on data + i and data + i + dist, for i in [0, count)
+static void (*FWHT_Span2)(ffe_t* data, unsigned dist, unsigned count);
+
+// x[i] = x[i] * y[i] (mod kModulus), fully reduced, for i in [0, count)
+static void (*MulModElements)(ffe_t* x, const ffe_t* y, unsigned count);
+
+static void FWHT_Span4_ref(ffe_t* data, unsigned dist, unsigned count)
+{
+    for (unsigned i = 0; i < count; ++i)
+        FWHT_4(data + i, dist);
+}
+
+static void FWHT_Span2_ref(ffe_t* data, unsigned dist, unsigned count)
+{
+    for (unsigned i = 0; i < count; ++i)
+        FWHT_2(data[i], data[i + dist]);
+}
+
+static void FWHT_Block_ref(ffe_t* data, unsigned count)
+{
+    // Decimation in time: Unroll 2 layers at a time
+    unsigned dist = 1, dist4 = 4;
+    for (; dist4 <= count; dist = dist4, dist4 <<= 2)
+    {
+        // For each set of dist*4 elements:
+        for (unsigned r = 0; r < count; r += dist4)
+            FWHT_Span4_ref(data + r, dist, dist);
+    }
+
+    // If there is one layer left:
+    if (dist < count)
+        FWHT_Span2_ref(data, dist, dist);
+}
+
+static void MulModElements_ref(ffe_t* x, const ffe_t* y, unsigned count)
+{
+    for (unsigned i = 0; i < count; ++i)
+        x[i] = static_cast<ffe_t>(((unsigned)x[i] * (unsigned)y[i]) % kModulus);
+}
+
+// The vector versions give the same results as AddMod() and SubMod() in every
+// lane: A carry out of the 16-bit add wraps around as +1, and a borrow out of
+// the 16-bit subtract wraps around as -1.  Unsigned compares are done with
+// saturating subtracts, which SSSE3 has
+
+#if defined(TRY_AVX2)
+
+// {a, b} = {a + b, a - b} (Mod Q) in each of 16 lanes
+#define FWHT_2_256(a, b) { \
+        const M256 sum = _mm256_add_epi16(a, b); \
+        const M256 dif = _mm256_sub_epi16(a, b); \
+        const M256 no_carry = _mm256_cmpeq_epi16(_mm256_subs_epu16(a, sum), zero); \
+        const M256 no_borrow = _mm256_cmpeq_epi16(_mm256_subs_epu16(b, a), zero); \
+        a = _mm256_add_epi16(_mm256_add_epi16(sum, one), no_carry); \
+        b = _mm256_sub_epi16(_mm256_sub_epi16(dif, one), no_borrow); }
+
+// FWHT_2() between lanes dist apart, where y holds x with each pair of lanes
+// swapped.  AddMod() is symmetric, so one FWHT_2(y, x) gives the sum for the
+// lower lane of each pair and the difference for the upper lane
+#define FWHT_2_LANES_256(x, y, blend) { \
+        M256 sums = y, difs = x; \
+        FWHT_2_256(sums, difs); \
+        x = blend; }
+
+static TARGET_AVX2 void FWHT_Span4_avx2(ffe_t* data, unsigned dist, unsigned count)
+{
+    const M256 zero = _mm256_setzero_si256();
+    const M256 one = _mm256_set1_epi16(1);
+
+    unsigned i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        M256* t0_ptr = reinterpret_cast<M256*>(data + i);
+        M256* t1_ptr = reinterpret_cast<M256*>(data + i + dist);
+        M256* t2_ptr = reinterpret_cast<M256*>(data + i + dist * 2);
+        M256* t3_ptr = reinterpret_cast<M256*>(data + i + dist * 3);
+
+        M256 t0 = _mm256_loadu_si256(t0_ptr);
+        M256 t1 = _mm256_loadu_si256(t1_ptr);
+        M256 t2 = _mm256_loadu_si256(t2_ptr);
+        M256 t3 = _mm256_loadu_si256(t3_ptr);
+
+        FWHT_2_256(t0, t1);
+        FWHT_2_256(t2, t3);
+        FWHT_2_256(t0, t2);
+        FWHT_2_256(t1, t3);
+
+        _mm256_storeu_si256(t0_ptr, t0);
+        _mm256_storeu_si256(t1_ptr, t1);
+        _mm256_storeu_si256(t2_ptr, t2);
+        _mm256_storeu_si256(t3_ptr, t3);
+    }
+
+    FWHT_Span4_ref(data + i, dist, count - i);
+}
+
+static TARGET_AVX2 void FWHT_Span2_avx2(ffe_t* data, unsigned dist, unsigned count)
+{
+    const M256 zero = _mm256_setzero_si256();
+    const M256 one = _mm256_set1_epi16(1);
+
+    unsigned i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        M256* t0_ptr = reinterpret_cast<M256*>(data + i);
+        M256* t1_ptr = reinterpret_cast<M256*>(data + i + dist);
+
+        M256 t0 = _mm256_loadu_si256(t0_ptr);
+        M256 t1 = _mm256_loadu_si256(t1_ptr);
+
+        FWHT_2_256(t0, t1);
+
+        _mm256_storeu_si256(t0_ptr, t0);
+        _mm256_storeu_si256(t1_ptr, t1);
+    }
+
+    FWHT_Span2_ref(data + i, dist, count - i);
+}
+
+static TARGET_AVX2 void FWHT_Block_avx2(ffe_t* data, unsigned count)
+{
+    if (count < 16)
+    {
+        FWHT_Block_ref(data, count);
+        return;
+    }
+
+    const M256 zero = _mm256_setzero_si256();
+    const M256 one = _mm256_set1_epi16(1);
+    const M256 swap_words = _mm256_setr_epi8(
+        2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+        2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+
+    // Layers with dist = 1, 2, 4, 8 within each register
+    M256* data32 = reinterpret_cast<M256*>(data);
+    for (unsigned i = 0; i < count; i += 16, ++data32)
+    {
+        M256 x = _mm256_loadu_si256(data32);
+        M256 y;
+
+        y = _mm256_shuffle_epi8(x, swap_words);
+        FWHT_2_LANES_256(x, y, _mm256_blend_epi16(sums, difs, 0xAA));
+
+        y = _mm256_shuffle_epi32(x, 0xB1);
+        FWHT_2_LANES_256(x, y, _mm256_blend_epi16(sums, difs, 0xCC));
+
+        y = _mm256_shuffle_epi32(x, 0x4E);
+        FWHT_2_LANES_256(x, y, _mm256_blend_epi16(sums, difs, 0xF0));
+
+        y = _mm256_permute4x64_epi64(x, 0x4E);
+        FWHT_2_LANES_256(x, y, _mm256_blend_epi32(sums, difs, 0xF0));
+
+        _mm256_storeu_si256(data32, x);
+    }
+
+    // Decimation in time: Unroll 2 layers at a time
+    unsigned dist = 16, dist4 = 64;
+    for (; dist4 <= count; dist = dist4, dist4 <<= 2)
+    {
+        // For each set of dist*4 elements:
+        for (unsigned r = 0; r < count; r += dist4)
+            FWHT_Span4_avx2(data + r, dist, dist);
+    }
+
+    // If there is one layer left:
+    if (dist < count)
+        FWHT_Span2_avx2(data, dist, dist);
+}
+
+static TARGET_AVX2 void MulModElements_avx2(ffe_t* x, const ffe_t* y, unsigned count)
+{
+    const M256 zero = _mm256_setzero_si256();
+    const M256 one = _mm256_set1_epi16(1);
+    const M256 modulus = _mm256_set1_epi16(-1);
+
+    unsigned i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        M256* x_ptr = reinterpret_cast<M256*>(x + i);
+        const M256 x_reg = _mm256_loadu_si256(x_ptr);
+        const M256 y_reg = _mm256_loadu_si256(reinterpret_cast<const M256*>(y + i));
+
+        // 2^16 = 1 (mod kModulus), so the product reduces to lo + hi
+        M256 lo = _mm256_mullo_epi16(x_reg, y_reg);
+        M256 hi = _mm256_mulhi_epu16(x_reg, y_reg);
+        FWHT_2_256(lo, hi);
+
+        // Map kModulus to 0
+        lo = _mm256_andnot_si256(_mm256_cmpeq_epi16(lo, modulus), lo);
+        _mm256_storeu_si256(x_ptr, lo);
+    }
+
+    MulModElements_ref(x + i, y + i, count - i);
+}
+
+#endif // TRY_AVX2
+
+// {a, b} = {a + b, a - b} (Mod Q) in each of 8 lanes
+#define FWHT_2_128(a, b) { \
+        const M128 sum = _mm_add_epi16(a, b); \
+        const M128 dif = _mm_sub_epi16(a, b); \
+        const M128 no_carry = _mm_cmpeq_epi16(_mm_subs_epu16(a, sum), zero); \
+        const M128 no_borrow = _mm_cmpeq_epi16(_mm_subs_epu16(b, a), zero); \
+        a = _mm_add_epi16(_mm_add_epi16(sum, one), no_carry); \
+        b = _mm_sub_epi16(_mm_sub_epi16(dif, one), no_borrow); }
+
+// FWHT_2() between lanes dist apart as in FWHT_2_LANES_256, where upper_mask
+// selects the upper lane of each pair
+#define FWHT_2_LANES_128(x, y, upper_mask) { \
+        M128 sums = y, difs = x; \
+        FWHT_2_128(sums, difs); \
+        x = _mm_or_si128(_mm_and_si128(upper_mask, difs), _mm_andnot_si128(upper_mask, sums)); }
+
+static TARGET_SSSE3 void FWHT_Span4_ssse3(ffe_t* data, unsigned dist, unsigned count)
+{
+    const M128 zero = _mm_setzero_si128();
+    const M128 one = _mm_set1_epi16(1);
+
+    unsigned i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        M128* t0_ptr = reinterpret_cast<M128*>(data + i);
+        M128* t1_ptr = reinterpret_cast<M128*>(data + i + dist);
+        M128* t2_ptr = reinterpret_cast<M128*>(data + i + dist * 2);
+        M128* t3_ptr = reinterpret_cast<M128*>(data + i + dist * 3);
+
+        M128 t0 = _mm_loadu_si128(t0_ptr);
+        M128 t1 = _mm_loadu_si128(t1_ptr);
+        M128 t2 = _mm_loadu_si128(t2_ptr);
+        M128 t3 = _mm_loadu_si128(t3_ptr);
+
+        FWHT_2_128(t0, t1);
+        FWHT_2_128(t2, t3);
+        FWHT_2_128(t0, t2);
+        FWHT_2_128(t1, t3);
+
+        _mm_storeu_si128(t0_ptr, t0);
+        _mm_storeu_si128(t1_ptr, t1);
+        _mm_storeu_si128(t2_ptr, t2);
+        _mm_storeu_si128(t3_ptr, t3);
+    }
+
+    FWHT_Span4_ref(data + i, dist, count - i);
+}
+
+static TARGET_SSSE3 void FWHT_Span2_ssse3(ffe_t* data, unsigned dist, unsigned count)
+{
+    const M128 zero = _mm_setzero_si128();
+    const M128 one = _mm_set1_epi16(1);
+
+    unsigned i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        M128* t0_ptr = reinterpret_cast<M128*>(data + i);
+        M128* t1_ptr = reinterpret_cast<M128*>(data + i + dist);
+
+        M128 t0 = _mm_loadu_si128(t0_ptr);
+        M128 t1 = _mm_loadu_si128(t1_ptr);
+
+        FWHT_2_128(t0, t1);
+
+        _mm_storeu_si128(t0_ptr, t0);
+        _mm_storeu_si128(t1_ptr, t1);
+    }
+
+    FWHT_Span2_ref(data + i, dist, count - i);
+}
+
+static TARGET_SSSE3 void FWHT_Block_ssse3(ffe_t* data, unsigned count)
+{
+    if (count < 8)
+    {
+        FWHT_Block_ref(data, count);
+        return;
+    }
+
+    const M128 zero = _mm_setzero_si128();
+    const M128 one = _mm_set1_epi16(1);
+    const M128 swap_words = _mm_setr_epi8(
+        2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const M128 upper_1 = _mm_setr_epi16(0, -1, 0, -1, 0, -1, 0, -1);
+    const M128 upper_2 = _mm_setr_epi16(0, 0, -1, -1, 0, 0, -1, -1);
+    const M128 upper_4 = _mm_setr_epi16(0, 0, 0, 0, -1, -1, -1, -1);
+
+    // Layers with dist = 1, 2, 4 within each register
+    M128* data16 = reinterpret_cast<M128*>(data);
+    for (unsigned i = 0; i < count; i += 8, ++data16)
+    {
+        M128 x = _mm_loadu_si128(data16);
+        M128 y;
+
+        y = _mm_shuffle_epi8(x, swap_words);
+        FWHT_2_LANES_128(x, y, upper_1);
+
+        y = _mm_shuffle_epi32(x, 0xB1);
+        FWHT_2_LANES_128(x, y, upper_2);
+
+        y = _mm_shuffle_epi32(x, 0x4E);
+        FWHT_2_LANES_128(x, y, upper_4);
+
+        _mm_storeu_si128(data16, x);
+    }
+
+    // Decimation in time: Unroll 2 layers at a time
+    unsigned dist = 8, dist4 = 32;
+    for (; dist4 <= count; dist = dist4, dist4 <<= 2)
+    {
+        // For each set of dist*4 elements:
+        for (unsigned r = 0; r < count; r += dist4)
+            FWHT_Span4_ssse3(data + r, dist, dist);
+    }
+
+    // If there is one layer left:
+    if (dist < count)
+        FWHT_Span2_ssse3(data, dist, dist);
+}
+
+static TARGET_SSSE3 void MulModElements_ssse3(ffe_t* x, const ffe_t* y, unsigned count)
+{
+    const M128 zero = _mm_setzero_si128();
+    const M128 one = _mm_set1_epi16(1);
+    const M128 modulus = _mm_set1_epi16(-1);
+
+    unsigned i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        M128* x_ptr = reinterpret_cast<M128*>(x + i);
+        const M128 x_reg = _mm_loadu_si128(x_ptr);
+        const M128 y_reg = _mm_loadu_si128(reinterpret_cast<const M128*>(y + i));
+
+        // 2^16 = 1 (mod kModulus), so the product reduces to lo + hi
+        M128 lo = _mm_mullo_epi16(x_reg, y_reg);
+        M128 hi = _mm_mulhi_epu16(x_reg, y_reg);
+        FWHT_2_128(lo, hi);
+
+        // Map kModulus to 0
+        lo = _mm_andnot_si128(_mm_cmpeq_epi16(lo, modulus), lo);
+        _mm_storeu_si128(x_ptr, lo);
+    }
+
+    MulModElements_ref(x + i, y + i, count - i);
+}
+
 // Decimation in time (DIT) Fast Walsh-Hadamard Transform
-// Unrolls pairs of layers to perform cross-layer operations in registers
+// The layers within each L1-sized block run first, one block per task, and
+// the layers across blocks follow.  Every layer keeps the order of the
+// scalar transform, so the results are the same
 // m_truncated: Number of elements that are non-zero at the front of data
 static void FWHT(ffe_t* data, const unsigned m, const unsigned m_truncated)
 {
+    const unsigned block = m < kFWHTBlock ? m : kFWHTBlock;
+
+    // Blocks past m_truncated are all zeros and stay that way
+    ParallelFor((m_truncated + block - 1) / block, [&](unsigned b) {
+        FWHT_Block(data + b * block, block);
+    });
+
     // Decimation in time: Unroll 2 layers at a time
-    unsigned dist = 1, dist4 = 4;
+    unsigned dist = block, dist4 = block * 4;
     for (; dist4 <= m; dist = dist4, dist4 <<= 2)
     {
         // For each set of dist*4 elements:
-#pragma omp parallel for
-        for (int r = 0; r < (int)m_truncated; r += dist4)
-        {
-            // For each set of dist elements:
-            const int i_end = r + dist;
-            for (int i = r; i < i_end; ++i)
-                FWHT_4(data + i, dist);
-        }
+        ParallelForSpans((m_truncated + dist4 - 1) / dist4, dist4, dist, [&](unsigned, unsigned i_begin, unsigned count) {
+            FWHT_Span4(data + i_begin, dist, count);
+        });
     }
 
     // If there is one layer left:
     if (dist < m)
-#pragma omp parallel for
-        for (int i = 0; i < (int)dist; ++i)
-            FWHT_2(data[i], data[i + dist]);
+    {
+        ParallelForSpans(1, m, dist, [&](unsigned, unsigned i_begin, unsigned count) {
+            FWHT_Span2(data + i_begin, dist, count);
+        });
+    }
 }
 
 
 //------------------------------------------------------------------------------
-// Logarithm Tables
+// Generated Tables
 
-static ffe_t LogLUT[kOrder];
-static ffe_t ExpLUT[kOrder];
+// LogLUT[], ExpLUT[], FFTSkew[] and LogWalsh[] are generated at build time by
+// TableGenerator.cpp
+#include "FF16Tables.h"
 
 
 // Returns a * Log(b)
@@ -132,43 +478,6 @@ static ffe_t MultiplyLog(ffe_t a, ffe_t log_b)
 }
 
 
-// Initialize LogLUT[], ExpLUT[]
-static void InitializeLogarithmTables()
-{
-    // LFSR table generation:
-
-    unsigned state = 1;
-    for (unsigned i = 0; i < kModulus; ++i)
-    {
-        ExpLUT[state] = static_cast<ffe_t>(i);
-        state <<= 1;
-        if (state >= kOrder)
-            state ^= kPolynomial;
-    }
-    ExpLUT[0] = kModulus;
-
-    // Conversion to Cantor basis:
-
-    LogLUT[0] = 0;
-    for (unsigned i = 0; i < kBits; ++i)
-    {
-        const ffe_t basis = kCantorBasis[i];
-        const unsigned width = static_cast<unsigned>(1UL << i);
-
-        for (unsigned j = 0; j < width; ++j)
-            LogLUT[j + width] = LogLUT[j] ^ basis;
-    }
-
-    for (unsigned i = 0; i < kOrder; ++i)
-        LogLUT[i] = ExpLUT[LogLUT[i]];
-
-    for (unsigned i = 0; i < kOrder; ++i)
-        ExpLUT[LogLUT[i]] = i;
-
-    ExpLUT[kModulus] = ExpLUT[0];
-}
-
-
 //------------------------------------------------------------------------------
 // Multiplies
 
@@ -223,23 +532,18 @@ static const Multiply128LUT_t* Multiply128LUT = nullptr;
 
 #if defined(TRY_AVX2)
 
-struct Multiply256LUT_t
-{
-    M256 Lo[4];
-    M256 Hi[4];
-};
-
-static const Multiply256LUT_t* Multiply256LUT = nullptr;
-
+// The AVX2 kernels share Multiply128LUT: Each 16-byte table is broadcast into
+// both lanes as it is loaded, which costs nothing over a 256-bit load and
+// keeps half as many bytes of tables in cache as storing it twice
 #define MUL_TABLES_256(table, log_m) \
-        const M256 T0_lo_##table = _mm256_loadu_si256(&Multiply256LUT[log_m].Lo[0]); \
-        const M256 T1_lo_##table = _mm256_loadu_si256(&Multiply256LUT[log_m].Lo[1]); \
-        const M256 T2_lo_##table = _mm256_loadu_si256(&Multiply256LUT[log_m].Lo[2]); \
-        const M256 T3_lo_##table = _mm256_loadu_si256(&Multiply256LUT[log_m].Lo[3]); \
-        const M256 T0_hi_##table = _mm256_loadu_si256(&Multiply256LUT[log_m].Hi[0]); \
-        const M256 T1_hi_##table = _mm256_loadu_si256(&Multiply256LUT[log_m].Hi[1]); \
-        const M256 T2_hi_##table = _mm256_loadu_si256(&Multiply256LUT[log_m].Hi[2]); \
-        const M256 T3_hi_##table = _mm256_loadu_si256(&Multiply256LUT[log_m].Hi[3]);
+        const M256 T0_lo_##table = _mm256_broadcastsi128_si256(_mm_loadu_si128(&Multiply128LUT[log_m].Lo[0])); \
+        const M256 T1_lo_##table = _mm256_broadcastsi128_si256(_mm_loadu_si128(&Multiply128LUT[log_m].Lo[1])); \
+        const M256 T2_lo_##table = _mm256_broadcastsi128_si256(_mm_loadu_si128(&Multiply128LUT[log_m].Lo[2])); \
+        const M256 T3_lo_##table = _mm256_broadcastsi128_si256(_mm_loadu_si128(&Multiply128LUT[log_m].Lo[3])); \
+        const M256 T0_hi_##table = _mm256_broadcastsi128_si256(_mm_loadu_si128(&Multiply128LUT[log_m].Hi[0])); \
+        const M256 T1_hi_##table = _mm256_broadcastsi128_si256(_mm_loadu_si128(&Multiply128LUT[log_m].Hi[1])); \
+        const M256 T2_hi_##table = _mm256_broadcastsi128_si256(_mm_loadu_si128(&Multiply128LUT[log_m].Hi[2])); \
+        const M256 T3_hi_##table = _mm256_broadcastsi128_si256(_mm_loadu_si128(&Multiply128LUT[log_m].Hi[3]));
 
 // 256-bit {prod_lo, prod_hi} = {value_lo, value_hi} * log_m
 #define MUL_256(value_lo, value_hi, table) { \
@@ -267,6 +571,138 @@ static const Multiply256LUT_t* Multiply256LUT = nullptr;
 
 #endif // TRY_AVX2
 
+
+#if defined(TRY_AVX512)
+
+/*
+    A zmm register holds one whole 64-byte ALTMAP block {lo, hi}.  Each table
+    pairs the lo-product LUT for one nibble with the hi-product LUT for the
+    nibble in the other half, so that {lo, hi} and its lane-swapped copy
+    {hi, lo} need four shuffles in total:
+
+        TA = {T0_lo, T2_hi}, TB = {T1_lo, T3_hi} apply to {lo, hi}
+        TC = {T2_lo, T0_hi}, TD = {T3_lo, T1_hi} apply to {hi, lo}
+
+    The tables are assembled from Multiply128LUT with two broadcasts each when
+    the kernel starts, so every PSHUFB kernel shares the same 8 MB of tables.
+*/
+#define MUL_TABLE_512(log_m, lo, hi) \
+        _mm512_mask_broadcast_i32x4( \
+            _mm512_maskz_broadcast_i32x4(0x00ff, _mm_loadu_si128(&Multiply128LUT[log_m].Lo[lo])), \
+            0xff00, _mm_loadu_si128(&Multiply128LUT[log_m].Hi[hi]))
+
+/*
+    GCC 12 reports "'__Y' is used uninitialized" inside the unmasked forms of
+    _mm512_shuffle_i64x2(), _mm512_srli_epi64(), _mm512_set1_epi64() and
+    _mm512_inserti64x4(): Its headers pass them _mm512_undefined_epi32(),
+    which initializes __Y from itself, as the unused merge source.  That is a
+    false positive.  The zero-masking forms with every lane selected merge
+    into _mm512_setzero_si512() instead and compile to the same instructions,
+    so the kernels use these wrappers
+*/
+#define SWAP_256_512(value) _mm512_maskz_shuffle_i64x2(0xff, value, value, 0x4e)
+#define SRLI_512(value, bits) _mm512_maskz_srli_epi64(0xff, value, bits)
+#define SET1_EPI64_512(value) _mm512_maskz_set1_epi64(0xff, value)
+#define INSERT_HI_256_512(lo, hi) _mm512_maskz_inserti64x4(0xff, lo, hi, 1)
+
+#define MUL_TABLES_512(table, log_m) \
+        const M512 TA_##table = MUL_TABLE_512(log_m, 0, 2); \
+        const M512 TB_##table = MUL_TABLE_512(log_m, 1, 3); \
+        const M512 TC_##table = MUL_TABLE_512(log_m, 2, 0); \
+        const M512 TD_##table = MUL_TABLE_512(log_m, 3, 1);
+
+// 512-bit prod = value * log_m
+#define MUL_512(value, table) { \
+            const M512 swapped = SWAP_256_512(value); \
+            const M512 data_0 = _mm512_and_si512(value, clr_mask); \
+            const M512 data_1 = _mm512_and_si512(SRLI_512(value, 4), clr_mask); \
+            const M512 data_2 = _mm512_and_si512(swapped, clr_mask); \
+            const M512 data_3 = _mm512_and_si512(SRLI_512(swapped, 4), clr_mask); \
+            prod = _mm512_ternarylogic_epi32( \
+                _mm512_shuffle_epi8(TA_##table, data_0), \
+                _mm512_shuffle_epi8(TB_##table, data_1), \
+                _mm512_shuffle_epi8(TC_##table, data_2), 0x96); \
+            prod = _mm512_xor_si512(prod, _mm512_shuffle_epi8(TD_##table, data_3)); }
+
+// x ^= y * log_m
+#define MULADD_512(x, y, table) { \
+            M512 prod; \
+            MUL_512(y, table); \
+            x = _mm512_xor_si512(x, prod); }
+
+#endif // TRY_AVX512
+
+
+#if defined(TRY_GFNI)
+
+/*
+    A constant multiply is linear over GF(2), so on the ALTMAP bytes it splits
+    into four 8x8 bit matrices applied with gf2p8affineqb:
+
+        prod_lo = Value[0] * lo + Value[1] * hi
+        prod_hi = Value[2] * lo + Value[3] * hi
+
+    Byte 7 - i of each matrix holds output bit i.  That is 32 bytes per value
+    in place of the 256-byte PSHUFB tables.
+*/
+struct Multiply16Affine_t
+{
+    uint64_t Value[4];
+};
+
+static const Multiply16Affine_t* Multiply16Affine = nullptr;
+
+#define MUL_TABLES_GFNI_256(table, log_m) \
+        const M256 A_ll_##table = _mm256_set1_epi64x(Multiply16Affine[log_m].Value[0]); \
+        const M256 A_lh_##table = _mm256_set1_epi64x(Multiply16Affine[log_m].Value[1]); \
+        const M256 A_hl_##table = _mm256_set1_epi64x(Multiply16Affine[log_m].Value[2]); \
+        const M256 A_hh_##table = _mm256_set1_epi64x(Multiply16Affine[log_m].Value[3]);
+
+// 256-bit {prod_lo, prod_hi} = {value_lo, value_hi} * log_m
+#define MUL_GFNI_256(value_lo, value_hi, table) { \
+            prod_lo = _mm256_xor_si256( \
+                _mm256_gf2p8affine_epi64_epi8(value_lo, A_ll_##table, 0), \
+                _mm256_gf2p8affine_epi64_epi8(value_hi, A_lh_##table, 0)); \
+            prod_hi = _mm256_xor_si256( \
+                _mm256_gf2p8affine_epi64_epi8(value_lo, A_hl_##table, 0), \
+                _mm256_gf2p8affine_epi64_epi8(value_hi, A_hh_##table, 0)); }
+
+// {x_lo, x_hi} ^= {y_lo, y_hi} * log_m
+#define MULADD_GFNI_256(x_lo, x_hi, y_lo, y_hi, table) { \
+            M256 prod_lo, prod_hi; \
+            MUL_GFNI_256(y_lo, y_hi, table); \
+            x_lo = _mm256_xor_si256(x_lo, prod_lo); \
+            x_hi = _mm256_xor_si256(x_hi, prod_hi); }
+
+#if defined(TRY_AVX512)
+
+// The matrices differ per 64-bit lane, so {lo, hi} takes {Value[0], Value[3]}
+// and its lane-swapped copy {hi, lo} takes {Value[1], Value[2]}
+#define MUL_TABLES_GFNI_512(table, log_m) \
+        const M512 A_##table = INSERT_HI_256_512( \
+            SET1_EPI64_512(Multiply16Affine[log_m].Value[0]), \
+            _mm256_set1_epi64x(Multiply16Affine[log_m].Value[3])); \
+        const M512 B_##table = INSERT_HI_256_512( \
+            SET1_EPI64_512(Multiply16Affine[log_m].Value[1]), \
+            _mm256_set1_epi64x(Multiply16Affine[log_m].Value[2]));
+
+// 512-bit prod = value * log_m
+#define MUL_GFNI_512(value, table) { \
+            const M512 swapped = SWAP_256_512(value); \
+            prod = _mm512_xor_si512( \
+                _mm512_gf2p8affine_epi64_epi8(value, A_##table, 0), \
+                _mm512_gf2p8affine_epi64_epi8(swapped, B_##table, 0)); }
+
+// x ^= y * log_m
+#define MULADD_GFNI_512(x, y, table) { \
+            M512 prod; \
+            MUL_GFNI_512(y, table); \
+            x = _mm512_xor_si512(x, prod); }
+
+#endif // TRY_AVX512
+
+#endif // TRY_GFNI
+
 // Stores the partial products of x * y at offset x + y * 65536
 // Repeated accesses from the same y value are faster
 struct Product16Table
@@ -344,205 +780,519 @@ static FORCE_INLINE void RefMul(
 }
 
 
-static void InitializeMultiplyTables()
-{
-    // If we cannot use the PSHUFB instruction, generate Multiply8LUT:
-    if (!CpuHasSSSE3)
-    {
-        Multiply16LUT = new Product16Table[65536];
 
-        // For each log_m multiplicand:
-#pragma omp parallel for
-        for (int log_m = 0; log_m < (int)kOrder; ++log_m)
-        {
-            const Product16Table& lut = Multiply16LUT[log_m];
+#if defined(TRY_CLMUL)
 
-            for (unsigned nibble = 0, shift = 0; nibble < 4; ++nibble, shift += 4)
-            {
-                ffe_t* nibble_lut = (ffe_t*)&lut.LUT[nibble * 16];
+/*
+    Table-free multiply for low memory use: The ALTMAP symbols are moved from
+    the Cantor basis to the polynomial basis, widened to 32-bit lanes and
+    multiplied by the constant with PCLMULQDQ.  Barrett reduction brings each
+    product back under kPolynomial before converting back to the Cantor basis.
+
+    The basis changes are fixed linear maps, so they use PSHUFB nibble tables
+    shaped like one Multiply128LUT_t entry.  Those and the Barrett constant
+    are the only state: 256 bytes in place of a table per field element.
+*/
 
-                for (unsigned x_nibble = 0; x_nibble < 16; ++x_nibble)
-                {
-                    const ffe_t prod = MultiplyLog(x_nibble << shift, static_cast<ffe_t>(log_m));
-                    nibble_lut[x_nibble] = prod;
-                }
-            }
-        }
+static Multiply128LUT_t CantorToPolyLUT, PolyToCantorLUT;
 
-        return;
-    }
+// floor(x^32 / kPolynomial)
+static uint32_t BarrettMu = 0;
 
-#if defined(TRY_AVX2)
-    if (CpuHasAVX2)
-        Multiply256LUT = reinterpret_cast<const Multiply256LUT_t*>(SIMDSafeAllocate(sizeof(Multiply256LUT_t) * kOrder));
-    else
-#endif // TRY_AVX2
-        Multiply128LUT = reinterpret_cast<const Multiply128LUT_t*>(SIMDSafeAllocate(sizeof(Multiply128LUT_t) * kOrder));
+// Returns x converted from the Cantor basis to the polynomial basis
+static ffe_t CantorToPoly(ffe_t x)
+{
+    ffe_t poly = 0;
+    for (unsigned i = 0; i < kBits; ++i)
+        if (x & (1 << i))
+            poly ^= kCantorBasis[i];
+    return poly;
+}
 
-    // For each value we could multiply by:
-#pragma omp parallel for
-    for (int log_m = 0; log_m < (int)kOrder; ++log_m)
+// Initialize CantorToPolyLUT, PolyToCantorLUT and BarrettMu
+static void InitializeCarrylessTables()
+{
+    std::vector<ffe_t> poly_to_cantor(kOrder);
+    for (unsigned x = 0; x < kOrder; ++x)
+        poly_to_cantor[CantorToPoly(static_cast<ffe_t>(x))] = static_cast<ffe_t>(x);
+
+    for (unsigned i = 0, shift = 0; i < 4; ++i, shift += 4)
     {
-        // For each 4 bits of the finite field width in bits:
-        for (unsigned i = 0, shift = 0; i < 4; ++i, shift += 4)
+        uint8_t to_poly_lo[16], to_poly_hi[16], to_cantor_lo[16], to_cantor_hi[16];
+        for (unsigned x = 0; x < 16; ++x)
         {
-            // Construct 16 entry LUT for PSHUFB
-            uint8_t prod_lo[16], prod_hi[16];
-            for (ffe_t x = 0; x < 16; ++x)
-            {
-                const ffe_t prod = MultiplyLog(x << shift, static_cast<ffe_t>(log_m));
-                prod_lo[x] = static_cast<uint8_t>(prod);
-                prod_hi[x] = static_cast<uint8_t>(prod >> 8);
-            }
-
-            const M128 value_lo = _mm_loadu_si128((M128*)prod_lo);
-            const M128 value_hi = _mm_loadu_si128((M128*)prod_hi);
-
-            // Store in 128-bit wide table
-#if defined(TRY_AVX2)
-            if (!CpuHasAVX2)
-#endif // TRY_AVX2
-            {
-                _mm_storeu_si128((M128*)&Multiply128LUT[log_m].Lo[i], value_lo);
-                _mm_storeu_si128((M128*)&Multiply128LUT[log_m].Hi[i], value_hi);
-            }
+            const ffe_t to_poly = CantorToPoly(static_cast<ffe_t>(x << shift));
+            const ffe_t to_cantor = poly_to_cantor[x << shift];
+            to_poly_lo[x] = static_cast<uint8_t>(to_poly);
+            to_poly_hi[x] = static_cast<uint8_t>(to_poly >> 8);
+            to_cantor_lo[x] = static_cast<uint8_t>(to_cantor);
+            to_cantor_hi[x] = static_cast<uint8_t>(to_cantor >> 8);
+        }
+        memcpy(&CantorToPolyLUT.Lo[i], to_poly_lo, 16);
+        memcpy(&CantorToPolyLUT.Hi[i], to_poly_hi, 16);
+        memcpy(&PolyToCantorLUT.Lo[i], to_cantor_lo, 16);
+        memcpy(&PolyToCantorLUT.Hi[i], to_cantor_hi, 16);
+    }
 
-            // Store in 256-bit wide table
-#if defined(TRY_AVX2)
-            if (CpuHasAVX2)
-            {
-                _mm256_storeu_si256((M256*)&Multiply256LUT[log_m].Lo[i],
-                    _mm256_broadcastsi128_si256(value_lo));
-                _mm256_storeu_si256((M256*)&Multiply256LUT[log_m].Hi[i],
-                    _mm256_broadcastsi128_si256(value_hi));
-            }
-#endif // TRY_AVX2
+    // Long division of x^32 by kPolynomial
+    uint64_t remainder = (uint64_t)1 << 32;
+    uint32_t quotient = 0;
+    for (int bit = 32; bit >= (int)kBits; --bit)
+    {
+        if (remainder & ((uint64_t)1 << bit))
+        {
+            quotient |= 1u << (bit - kBits);
+            remainder ^= (uint64_t)kPolynomial << (bit - kBits);
         }
     }
+    BarrettMu = quotient;
 }
 
+// Constants for multiplying by one value, held in registers
+struct CarrylessMultiplier
+{
+    M128 ToPoly[8];
+    M128 ToCantor[8];
+    M128 Constant; // Polynomial basis value in the low qword
+    M128 Mu;
+    M128 Poly;
+};
 
-static void mul_mem(
-    void * RESTRICT x, const void * RESTRICT y,
-    ffe_t log_m, uint64_t bytes)
+static TARGET_CLMUL FORCE_INLINE void LoadCarrylessMultiplier(
+    CarrylessMultiplier& mul,
+    ffe_t log_m)
 {
-#if defined(TRY_AVX2)
-    if (CpuHasAVX2)
+    for (unsigned i = 0; i < 4; ++i)
     {
-        MUL_TABLES_256(0, log_m);
+        mul.ToPoly[i] = _mm_loadu_si128(&CantorToPolyLUT.Lo[i]);
+        mul.ToPoly[i + 4] = _mm_loadu_si128(&CantorToPolyLUT.Hi[i]);
+        mul.ToCantor[i] = _mm_loadu_si128(&PolyToCantorLUT.Lo[i]);
+        mul.ToCantor[i + 4] = _mm_loadu_si128(&PolyToCantorLUT.Hi[i]);
+    }
+    mul.Constant = _mm_cvtsi32_si128(CantorToPoly(ExpLUT[log_m]));
+    mul.Mu = _mm_cvtsi32_si128(static_cast<int>(BarrettMu));
+    mul.Poly = _mm_cvtsi32_si128(static_cast<int>(kPolynomial));
+}
 
-        const M256 clr_mask = _mm256_set1_epi8(0x0f);
+// {lo, hi} = linear map of {lo, hi} given by nibble LUTs {T0..3_lo, T0..3_hi}
+static TARGET_CLMUL FORCE_INLINE void ConvertBasis128(
+    const M128* lut,
+    M128& lo, M128& hi)
+{
+    const M128 clr_mask = _mm_set1_epi8(0x0f);
+
+    const M128 data_0 = _mm_and_si128(lo, clr_mask);
+    const M128 data_1 = _mm_and_si128(_mm_srli_epi64(lo, 4), clr_mask);
+    const M128 data_2 = _mm_and_si128(hi, clr_mask);
+    const M128 data_3 = _mm_and_si128(_mm_srli_epi64(hi, 4), clr_mask);
+
+    lo = _mm_xor_si128(
+        _mm_xor_si128(_mm_shuffle_epi8(lut[0], data_0), _mm_shuffle_epi8(lut[1], data_1)),
+        _mm_xor_si128(_mm_shuffle_epi8(lut[2], data_2), _mm_shuffle_epi8(lut[3], data_3)));
+    hi = _mm_xor_si128(
+        _mm_xor_si128(_mm_shuffle_epi8(lut[4], data_0), _mm_shuffle_epi8(lut[5], data_1)),
+        _mm_xor_si128(_mm_shuffle_epi8(lut[6], data_2), _mm_shuffle_epi8(lut[7], data_3)));
+}
 
-        M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
-        const M256 * RESTRICT y32 = reinterpret_cast<const M256 *>(y);
+// Carry-less products of four 32-bit lanes with the low 32 bits of c.
+// Each product has at most 31 bits so the lanes do not overlap
+#define CLMUL_32x4(v, c) \
+    _mm_unpacklo_epi64(_mm_clmulepi64_si128(v, c, 0x00), _mm_clmulepi64_si128(v, c, 0x01))
 
-        do
-        {
-#define MUL_256_LS(x_ptr, y_ptr) { \
-            const M256 data_lo = _mm256_loadu_si256(y_ptr); \
-            const M256 data_hi = _mm256_loadu_si256(y_ptr + 1); \
-            M256 prod_lo, prod_hi; \
-            MUL_256(data_lo, data_hi, 0); \
-            _mm256_storeu_si256(x_ptr, prod_lo); \
-            _mm256_storeu_si256(x_ptr + 1, prod_hi); }
+// Four 16-bit polynomials in 32-bit lanes times the constant, mod kPolynomial
+static TARGET_CLMUL FORCE_INLINE M128 MulModCarryless(
+    const CarrylessMultiplier& mul,
+    M128 v)
+{
+    const M128 prod = CLMUL_32x4(v, mul.Constant);
 
-            MUL_256_LS(x32, y32);
-            y32 += 2, x32 += 2;
+    // Barrett reduction: q = ((prod >> 16) * mu) >> 16, prod ^= q * P
+    const M128 quot = _mm_srli_epi32(CLMUL_32x4(_mm_srli_epi32(prod, 16), mul.Mu), 16);
+    return _mm_xor_si128(prod, CLMUL_32x4(quot, mul.Poly));
+}
 
-            bytes -= 64;
-        } while (bytes > 0);
+// {lo, hi} = {lo, hi} * log_m for 16 ALTMAP symbols
+static TARGET_CLMUL FORCE_INLINE void MulCarryless(
+    const CarrylessMultiplier& mul,
+    M128& lo, M128& hi)
+{
+    ConvertBasis128(mul.ToPoly, lo, hi);
 
-        return;
+    const M128 zero = _mm_setzero_si128();
+    const M128 words_0 = _mm_unpacklo_epi8(lo, hi);
+    const M128 words_1 = _mm_unpackhi_epi8(lo, hi);
+
+    const M128 prod_0 = _mm_packus_epi32(
+        MulModCarryless(mul, _mm_unpacklo_epi16(words_0, zero)),
+        MulModCarryless(mul, _mm_unpackhi_epi16(words_0, zero)));
+    const M128 prod_1 = _mm_packus_epi32(
+        MulModCarryless(mul, _mm_unpacklo_epi16(words_1, zero)),
+        MulModCarryless(mul, _mm_unpackhi_epi16(words_1, zero)));
+
+    const M128 byte_mask = _mm_set1_epi16(0x00ff);
+    lo = _mm_packus_epi16(_mm_and_si128(prod_0, byte_mask), _mm_and_si128(prod_1, byte_mask));
+    hi = _mm_packus_epi16(_mm_srli_epi16(prod_0, 8), _mm_srli_epi16(prod_1, 8));
+
+    ConvertBasis128(mul.ToCantor, lo, hi);
+}
+
+#endif // TRY_CLMUL
+
+
+// Which multiply tables the kernels read.  These values are stored in table
+// images, so a retired value is never reused: 3 was a separate 16 MB table
+// for the AVX-512 kernels
+enum MultiplyTableLayout
+{
+    LayoutNone      = 0, // No tables: Carry-less multiply
+    LayoutProduct16 = 1, // Multiply16LUT
+    Layout128       = 2, // Multiply128LUT
+    LayoutAffine    = 4, // Multiply16Affine
+};
+
+// Returns the layout of the tables used by the kernels for this CPU
+static MultiplyTableLayout SelectMultiplyTableLayout()
+{
+    if (!CpuHasSSSE3)
+        return LayoutProduct16;
+#if defined(TRY_GFNI)
+    if (CpuHasGFNI)
+        return LayoutAffine;
+#endif // TRY_GFNI
+    return Layout128;
+}
+
+static bool MultiplyTablesReady = false;
+
+/*
+    Returns memory for the tables built below, or null if out of memory.
+
+    Each kernel call looks up a different log_m, so huge pages keep these
+    lookups from missing the TLB.  The allocation is never freed: Worker
+    threads and other static objects may still run kernels while the
+    process exits, after a static LargeAllocation would have been unmapped.
+*/
+static uint8_t* AllocateMultiplyTables(uint64_t bytes)
+{
+    LargeAllocation* memory = new LargeAllocation;
+    if (!memory->Allocate(bytes))
+    {
+        delete memory;
+        return nullptr;
     }
-#endif // TRY_AVX2
+    return memory->Data;
+}
 
-    if (CpuHasSSSE3)
+// Returns false if out of memory
+static bool InitializeMultiplyTables()
+{
+    if (MultiplyTablesReady)
+        return true;
+
+    const MultiplyTableLayout layout = SelectMultiplyTableLayout();
+
+    // If we cannot use the PSHUFB instruction, generate Multiply8LUT:
+    if (layout == LayoutProduct16)
     {
-        MUL_TABLES_128(0, log_m);
+        uint8_t* data = AllocateMultiplyTables(sizeof(Product16Table) * kOrder);
+        if (!data)
+            return false;
+        Multiply16LUT = reinterpret_cast<const Product16Table*>(data);
+
+        // For each log_m multiplicand:
+        ParallelFor(kOrder, [&](unsigned log_m) {
+            const Product16Table& lut = Multiply16LUT[log_m];
+
+            for (unsigned nibble = 0, shift = 0; nibble < 4; ++nibble, shift += 4)
+            {
+                ffe_t* nibble_lut = (ffe_t*)&lut.LUT[nibble * 16];
+
+                for (unsigned x_nibble = 0; x_nibble < 16; ++x_nibble)
+                {
+                    const ffe_t prod = MultiplyLog(x_nibble << shift, static_cast<ffe_t>(log_m));
+                    nibble_lut[x_nibble] = prod;
+                }
+            }
+        });
 
-        const M128 clr_mask = _mm_set1_epi8(0x0f);
+        MultiplyTablesReady = true;
+        return true;
+    }
 
-        M128 * RESTRICT x16 = reinterpret_cast<M128 *>(x);
-        const M128 * RESTRICT y16 = reinterpret_cast<const M128 *>(y);
+#if defined(TRY_GFNI)
+    // The GFNI kernels only need four affine matrices per value
+    if (layout == LayoutAffine)
+    {
+        uint8_t* data = AllocateMultiplyTables(sizeof(Multiply16Affine_t) * kOrder);
+        if (!data)
+            return false;
+        Multiply16Affine = reinterpret_cast<const Multiply16Affine_t*>(data);
 
-        do
-        {
-#define MUL_128_LS(x_ptr, y_ptr) { \
-                const M128 data_lo = _mm_loadu_si128(y_ptr); \
-                const M128 data_hi = _mm_loadu_si128(y_ptr + 2); \
-                M128 prod_lo, prod_hi; \
-                MUL_128(data_lo, data_hi, 0); \
-                _mm_storeu_si128(x_ptr, prod_lo); \
-                _mm_storeu_si128(x_ptr + 2, prod_hi); }
+        ParallelFor(kOrder, [&](unsigned log_m) {
+            uint64_t matrix[4] = { 0, 0, 0, 0 };
 
-            MUL_128_LS(x16 + 1, y16 + 1);
-            MUL_128_LS(x16, y16);
-            x16 += 4, y16 += 4;
+            // For each input bit j, set column j of the rows for the output bits
+            for (unsigned j = 0; j < 16; ++j)
+            {
+                const ffe_t prod = MultiplyLog(static_cast<ffe_t>(1 << j), static_cast<ffe_t>(log_m));
+
+                for (unsigned i = 0; i < 16; ++i)
+                    if (prod & (1 << i))
+                        matrix[(i / 8) * 2 + j / 8] |= (uint64_t)1 << ((7 - i % 8) * 8 + j % 8);
+            }
 
-            bytes -= 64;
-        } while (bytes > 0);
+            memcpy((void*)&Multiply16Affine[log_m], matrix, sizeof(matrix));
+        });
 
-        return;
+        MultiplyTablesReady = true;
+        return true;
     }
+#endif // TRY_GFNI
 
-    RefMul(x, y, log_m, bytes);
+    uint8_t* data = AllocateMultiplyTables(sizeof(Multiply128LUT_t) * kOrder);
+    if (!data)
+        return false;
+    Multiply128LUT = reinterpret_cast<const Multiply128LUT_t*>(data);
+
+    // For each value we could multiply by:
+    ParallelFor(kOrder, [&](unsigned log_m) {
+        // For each 4 bits of the finite field width in bits:
+        for (unsigned i = 0, shift = 0; i < 4; ++i, shift += 4)
+        {
+            // Construct 16 entry LUT for PSHUFB
+            uint8_t prod_lo[16], prod_hi[16];
+            for (ffe_t x = 0; x < 16; ++x)
+            {
+                const ffe_t prod = MultiplyLog(x << shift, static_cast<ffe_t>(log_m));
+                prod_lo[x] = static_cast<uint8_t>(prod);
+                prod_hi[x] = static_cast<uint8_t>(prod >> 8);
+            }
+
+            // Store in 128-bit wide table
+            memcpy((void*)&Multiply128LUT[log_m].Lo[i], prod_lo, 16);
+            memcpy((void*)&Multiply128LUT[log_m].Hi[i], prod_hi, 16);
+        }
+    });
+
+    MultiplyTablesReady = true;
+    return true;
 }
 
 
-//------------------------------------------------------------------------------
-// FFT
+static void (*mul_mem)(
+    void * RESTRICT x, const void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes);
+
+// mul_mem() writing x[] with streaming stores where the CPU has them
+static void (*mul_mem_stream)(
+    void * RESTRICT x, const void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes);
+
+#if defined(TRY_CLMUL)
+
+static TARGET_CLMUL void mul_mem_clmul(
+    void * RESTRICT x, const void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    CarrylessMultiplier mul;
+    LoadCarrylessMultiplier(mul, log_m);
+
+    M128 * RESTRICT x16 = reinterpret_cast<M128 *>(x);
+    const M128 * RESTRICT y16 = reinterpret_cast<const M128 *>(y);
+
+    do
+    {
+        for (unsigned i = 0; i < 2; ++i)
+        {
+            M128 lo = _mm_loadu_si128(y16 + i);
+            M128 hi = _mm_loadu_si128(y16 + i + 2);
+            MulCarryless(mul, lo, hi);
+            _mm_storeu_si128(x16 + i, lo);
+            _mm_storeu_si128(x16 + i + 2, hi);
+        }
+        x16 += 4, y16 += 4;
 
-// Twisted factors used in FFT
-static ffe_t FFTSkew[kModulus];
+        bytes -= 64;
+    } while (bytes > 0);
+}
 
-// Factors used in the evaluation of the error locator polynomial
-static ffe_t LogWalsh[kOrder];
+#endif // TRY_CLMUL
 
+#if defined(TRY_AVX512) && defined(TRY_GFNI)
 
-static void FFTInitialize()
+template<bool kStream = false>
+static TARGET_AVX512_GFNI void mul_mem_avx512_gfni(
+    void * RESTRICT x, const void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
 {
-    ffe_t temp[kBits - 1];
+    MUL_TABLES_GFNI_512(0, log_m);
+
+    M512 * RESTRICT x64 = reinterpret_cast<M512 *>(x);
+    const M512 * RESTRICT y64 = reinterpret_cast<const M512 *>(y);
+
+    do
+    {
+        const M512 data = _mm512_loadu_si512(y64);
+        M512 prod;
+        MUL_GFNI_512(data, 0);
+        STORE_512(kStream, x64, prod);
+        y64++, x64++;
+
+        bytes -= 64;
+    } while (bytes > 0);
+
+    if (kStream)
+        _mm_sfence();
+}
+
+#endif // TRY_AVX512 && TRY_GFNI
+
+#if defined(TRY_GFNI)
 
-    // Generate FFT skew vector {1}:
+template<bool kStream = false>
+static TARGET_GFNI void mul_mem_gfni(
+    void * RESTRICT x, const void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    MUL_TABLES_GFNI_256(0, log_m);
 
-    for (unsigned i = 1; i < kBits; ++i)
-        temp[i - 1] = static_cast<ffe_t>(1UL << i);
+    M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
+    const M256 * RESTRICT y32 = reinterpret_cast<const M256 *>(y);
 
-    for (unsigned m = 0; m < (kBits - 1); ++m)
+    do
     {
-        const unsigned step = 1UL << (m + 1);
+#define MUL_GFNI_256_LS(x_ptr, y_ptr) { \
+        const M256 data_lo = _mm256_loadu_si256(y_ptr); \
+        const M256 data_hi = _mm256_loadu_si256(y_ptr + 1); \
+        M256 prod_lo, prod_hi; \
+        MUL_GFNI_256(data_lo, data_hi, 0); \
+        STORE_256(kStream, x_ptr, prod_lo); \
+        STORE_256(kStream, x_ptr + 1, prod_hi); }
 
-        FFTSkew[(1UL << m) - 1] = 0;
+        MUL_GFNI_256_LS(x32, y32);
+        y32 += 2, x32 += 2;
 
-        for (unsigned i = m; i < (kBits - 1); ++i)
-        {
-            const unsigned s = (1UL << (i + 1));
+        bytes -= 64;
+    } while (bytes > 0);
 
-            for (unsigned j = (1UL << m) - 1; j < s; j += step)
-                FFTSkew[j + s] = FFTSkew[j] ^ temp[i];
-        }
+    if (kStream)
+        _mm_sfence();
+}
 
-        temp[m] = kModulus - LogLUT[MultiplyLog(temp[m], LogLUT[temp[m] ^ 1])];
+#endif // TRY_GFNI
 
-        for (unsigned i = m + 1; i < (kBits - 1); ++i)
-        {
-            const ffe_t sum = AddMod(LogLUT[temp[i] ^ 1], temp[m]);
-            temp[i] = MultiplyLog(temp[i], sum);
-        }
-    }
+#if defined(TRY_AVX512)
+
+template<bool kStream = false>
+static TARGET_AVX512 void mul_mem_avx512(
+    void * RESTRICT x, const void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    MUL_TABLES_512(0, log_m);
+
+    const M512 clr_mask = _mm512_set1_epi8(0x0f);
+
+    M512 * RESTRICT x64 = reinterpret_cast<M512 *>(x);
+    const M512 * RESTRICT y64 = reinterpret_cast<const M512 *>(y);
+
+    do
+    {
+        const M512 data = _mm512_loadu_si512(y64);
+        M512 prod;
+        MUL_512(data, 0);
+        STORE_512(kStream, x64, prod);
+        y64++, x64++;
+
+        bytes -= 64;
+    } while (bytes > 0);
 
-    for (unsigned i = 0; i < kModulus; ++i)
-        FFTSkew[i] = LogLUT[FFTSkew[i]];
+    if (kStream)
+        _mm_sfence();
+}
+
+#endif // TRY_AVX512
+
+#if defined(TRY_AVX2)
+
+template<bool kStream = false>
+static TARGET_AVX2 void mul_mem_avx2(
+    void * RESTRICT x, const void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    MUL_TABLES_256(0, log_m);
+
+    const M256 clr_mask = _mm256_set1_epi8(0x0f);
+
+    M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
+    const M256 * RESTRICT y32 = reinterpret_cast<const M256 *>(y);
+
+    do
+    {
+#define MUL_256_LS(x_ptr, y_ptr) { \
+        const M256 data_lo = _mm256_loadu_si256(y_ptr); \
+        const M256 data_hi = _mm256_loadu_si256(y_ptr + 1); \
+        M256 prod_lo, prod_hi; \
+        MUL_256(data_lo, data_hi, 0); \
+        STORE_256(kStream, x_ptr, prod_lo); \
+        STORE_256(kStream, x_ptr + 1, prod_hi); }
+
+        MUL_256_LS(x32, y32);
+        y32 += 2, x32 += 2;
+
+        bytes -= 64;
+    } while (bytes > 0);
+
+    if (kStream)
+        _mm_sfence();
+}
+
+#endif // TRY_AVX2
+
+static TARGET_SSSE3 void mul_mem_ssse3(
+    void * RESTRICT x, const void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    MUL_TABLES_128(0, log_m);
+
+    const M128 clr_mask = _mm_set1_epi8(0x0f);
+
+    M128 * RESTRICT x16 = reinterpret_cast<M128 *>(x);
+    const M128 * RESTRICT y16 = reinterpret_cast<const M128 *>(y);
+
+    do
+    {
+#define MUL_128_LS(x_ptr, y_ptr) { \
+            const M128 data_lo = _mm_loadu_si128(y_ptr); \
+            const M128 data_hi = _mm_loadu_si128(y_ptr + 2); \
+            M128 prod_lo, prod_hi; \
+            MUL_128(data_lo, data_hi, 0); \
+            _mm_storeu_si128(x_ptr, prod_lo); \
+            _mm_storeu_si128(x_ptr + 2, prod_hi); }
 
-    // Precalculate FWHT(Log[i]):
+        MUL_128_LS(x16 + 1, y16 + 1);
+        MUL_128_LS(x16, y16);
+        x16 += 4, y16 += 4;
 
-    for (unsigned i = 0; i < kOrder; ++i)
-        LogWalsh[i] = LogLUT[i];
-    LogWalsh[0] = 0;
+        bytes -= 64;
+    } while (bytes > 0);
+}
 
-    FWHT(LogWalsh, kOrder, kOrder);
+static void mul_mem_ref(
+    void * RESTRICT x, const void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    RefMul(x, y, log_m, bytes);
 }
 
+
+//------------------------------------------------------------------------------
+// FFT
+
+// FFTSkew[] holds the twisted factors used in FFT, and LogWalsh[] the factors
+// used in the evaluation of the error locator polynomial.  The FFT routines
+// read the factor for index i from skewLUT[i - 1], so the decoder can pass
+// FFTSkew itself instead of a pointer before the start of the table
+
 /*
     Decimation in time IFFT:
 
@@ -598,132 +1348,525 @@ static void FFTInitialize()
 */
 
 // 2-way butterfly
-static void IFFT_DIT2(
+static void (*IFFT_DIT2)(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes);
+
+#if defined(TRY_CLMUL)
+
+static TARGET_CLMUL void IFFT_DIT2_clmul(
     void * RESTRICT x, void * RESTRICT y,
     ffe_t log_m, uint64_t bytes)
 {
-#if defined(TRY_AVX2)
-    if (CpuHasAVX2)
+    CarrylessMultiplier mul;
+    LoadCarrylessMultiplier(mul, log_m);
+
+    M128 * RESTRICT x16 = reinterpret_cast<M128 *>(x);
+    M128 * RESTRICT y16 = reinterpret_cast<M128 *>(y);
+
+    do
     {
-        MUL_TABLES_256(0, log_m);
+        for (unsigned i = 0; i < 2; ++i)
+        {
+            const M128 x_lo = _mm_loadu_si128(x16 + i);
+            const M128 x_hi = _mm_loadu_si128(x16 + i + 2);
+            M128 y_lo = _mm_xor_si128(_mm_loadu_si128(y16 + i), x_lo);
+            M128 y_hi = _mm_xor_si128(_mm_loadu_si128(y16 + i + 2), x_hi);
+            _mm_storeu_si128(y16 + i, y_lo);
+            _mm_storeu_si128(y16 + i + 2, y_hi);
+            MulCarryless(mul, y_lo, y_hi);
+            _mm_storeu_si128(x16 + i, _mm_xor_si128(x_lo, y_lo));
+            _mm_storeu_si128(x16 + i + 2, _mm_xor_si128(x_hi, y_hi));
+        }
+        x16 += 4, y16 += 4;
 
-        const M256 clr_mask = _mm256_set1_epi8(0x0f);
+        bytes -= 64;
+    } while (bytes > 0);
+}
 
-        M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
-        M256 * RESTRICT y32 = reinterpret_cast<M256 *>(y);
+#endif // TRY_CLMUL
 
-        do
-        {
-#define IFFTB_256(x_ptr, y_ptr) { \
-            M256 x_lo = _mm256_loadu_si256(x_ptr); \
-            M256 x_hi = _mm256_loadu_si256(x_ptr + 1); \
-            M256 y_lo = _mm256_loadu_si256(y_ptr); \
-            M256 y_hi = _mm256_loadu_si256(y_ptr + 1); \
-            y_lo = _mm256_xor_si256(y_lo, x_lo); \
-            y_hi = _mm256_xor_si256(y_hi, x_hi); \
-            _mm256_storeu_si256(y_ptr, y_lo); \
-            _mm256_storeu_si256(y_ptr + 1, y_hi); \
-            MULADD_256(x_lo, x_hi, y_lo, y_hi, 0); \
-            _mm256_storeu_si256(x_ptr, x_lo); \
-            _mm256_storeu_si256(x_ptr + 1, x_hi); }
-
-            IFFTB_256(x32, y32);
-            y32 += 2, x32 += 2;
-
-            bytes -= 64;
-        } while (bytes > 0);
+#if defined(TRY_AVX512) && defined(TRY_GFNI)
 
-        return;
-    }
-#endif // TRY_AVX2
+static TARGET_AVX512_GFNI void IFFT_DIT2_avx512_gfni(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    MUL_TABLES_GFNI_512(0, log_m);
 
-    if (CpuHasSSSE3)
+    M512 * RESTRICT x64 = reinterpret_cast<M512 *>(x);
+    M512 * RESTRICT y64 = reinterpret_cast<M512 *>(y);
+
+    do
     {
-        MUL_TABLES_128(0, log_m);
+        M512 x_reg = _mm512_loadu_si512(x64);
+        M512 y_reg = _mm512_loadu_si512(y64);
+        y_reg = _mm512_xor_si512(y_reg, x_reg);
+        _mm512_storeu_si512(y64, y_reg);
+        MULADD_GFNI_512(x_reg, y_reg, 0);
+        _mm512_storeu_si512(x64, x_reg);
+        y64++, x64++;
 
-        const M128 clr_mask = _mm_set1_epi8(0x0f);
+        bytes -= 64;
+    } while (bytes > 0);
+}
 
-        M128 * RESTRICT x16 = reinterpret_cast<M128 *>(x);
-        M128 * RESTRICT y16 = reinterpret_cast<M128 *>(y);
+#endif // TRY_AVX512 && TRY_GFNI
 
-        do
-        {
-#define IFFTB_128(x_ptr, y_ptr) { \
-                M128 x_lo = _mm_loadu_si128(x_ptr); \
-                M128 x_hi = _mm_loadu_si128(x_ptr + 2); \
-                M128 y_lo = _mm_loadu_si128(y_ptr); \
-                M128 y_hi = _mm_loadu_si128(y_ptr + 2); \
-                y_lo = _mm_xor_si128(y_lo, x_lo); \
-                y_hi = _mm_xor_si128(y_hi, x_hi); \
-                _mm_storeu_si128(y_ptr, y_lo); \
-                _mm_storeu_si128(y_ptr + 2, y_hi); \
-                MULADD_128(x_lo, x_hi, y_lo, y_hi, 0); \
-                _mm_storeu_si128(x_ptr, x_lo); \
-                _mm_storeu_si128(x_ptr + 2, x_hi); }
-
-            IFFTB_128(x16 + 1, y16 + 1);
-            IFFTB_128(x16, y16);
-            x16 += 4, y16 += 4;
-
-            bytes -= 64;
-        } while (bytes > 0);
+#if defined(TRY_GFNI)
 
-        return;
-    }
+static TARGET_GFNI void IFFT_DIT2_gfni(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    MUL_TABLES_GFNI_256(0, log_m);
 
-    // Reference version:
-    xor_mem(y, x, bytes);
-    RefMulAdd(x, y, log_m, bytes);
+    M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
+    M256 * RESTRICT y32 = reinterpret_cast<M256 *>(y);
+
+    do
+    {
+#define IFFTB_GFNI_256(x_ptr, y_ptr) { \
+        M256 x_lo = _mm256_loadu_si256(x_ptr); \
+        M256 x_hi = _mm256_loadu_si256(x_ptr + 1); \
+        M256 y_lo = _mm256_loadu_si256(y_ptr); \
+        M256 y_hi = _mm256_loadu_si256(y_ptr + 1); \
+        y_lo = _mm256_xor_si256(y_lo, x_lo); \
+        y_hi = _mm256_xor_si256(y_hi, x_hi); \
+        _mm256_storeu_si256(y_ptr, y_lo); \
+        _mm256_storeu_si256(y_ptr + 1, y_hi); \
+        MULADD_GFNI_256(x_lo, x_hi, y_lo, y_hi, 0); \
+        _mm256_storeu_si256(x_ptr, x_lo); \
+        _mm256_storeu_si256(x_ptr + 1, x_hi); }
+
+        IFFTB_GFNI_256(x32, y32);
+        y32 += 2, x32 += 2;
+
+        bytes -= 64;
+    } while (bytes > 0);
 }
 
+#endif // TRY_GFNI
 
-// 4-way butterfly
-static void IFFT_DIT4(
-    uint64_t bytes,
-    void** work,
-    unsigned dist,
-    const ffe_t log_m01,
-    const ffe_t log_m23,
-    const ffe_t log_m02)
+#if defined(TRY_AVX512)
+
+static TARGET_AVX512 void IFFT_DIT2_avx512(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
 {
-#ifdef INTERLEAVE_BUTTERFLY4_OPT
+    MUL_TABLES_512(0, log_m);
 
-#if defined(TRY_AVX2)
+    const M512 clr_mask = _mm512_set1_epi8(0x0f);
 
-    if (CpuHasAVX2)
+    M512 * RESTRICT x64 = reinterpret_cast<M512 *>(x);
+    M512 * RESTRICT y64 = reinterpret_cast<M512 *>(y);
+
+    do
     {
-        MUL_TABLES_256(01, log_m01);
-        MUL_TABLES_256(23, log_m23);
-        MUL_TABLES_256(02, log_m02);
+        M512 x_reg = _mm512_loadu_si512(x64);
+        M512 y_reg = _mm512_loadu_si512(y64);
+        y_reg = _mm512_xor_si512(y_reg, x_reg);
+        _mm512_storeu_si512(y64, y_reg);
+        MULADD_512(x_reg, y_reg, 0);
+        _mm512_storeu_si512(x64, x_reg);
+        y64++, x64++;
 
-        const M256 clr_mask = _mm256_set1_epi8(0x0f);
+        bytes -= 64;
+    } while (bytes > 0);
+}
 
-        M256 * RESTRICT work0 = reinterpret_cast<M256 *>(work[0]);
-        M256 * RESTRICT work1 = reinterpret_cast<M256 *>(work[dist]);
-        M256 * RESTRICT work2 = reinterpret_cast<M256 *>(work[dist * 2]);
-        M256 * RESTRICT work3 = reinterpret_cast<M256 *>(work[dist * 3]);
+#endif // TRY_AVX512
 
-        do
-        {
-            M256 work_reg_lo_0 = _mm256_loadu_si256(work0);
-            M256 work_reg_hi_0 = _mm256_loadu_si256(work0 + 1);
-            M256 work_reg_lo_1 = _mm256_loadu_si256(work1);
-            M256 work_reg_hi_1 = _mm256_loadu_si256(work1 + 1);
+#if defined(TRY_AVX2)
 
-            // First layer:
-            work_reg_lo_1 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_1);
-            work_reg_hi_1 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_1);
-            if (log_m01 != kModulus)
-                MULADD_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_1, work_reg_hi_1, 01);
+static TARGET_AVX2 void IFFT_DIT2_avx2(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    MUL_TABLES_256(0, log_m);
 
-            M256 work_reg_lo_2 = _mm256_loadu_si256(work2);
-            M256 work_reg_hi_2 = _mm256_loadu_si256(work2 + 1);
-            M256 work_reg_lo_3 = _mm256_loadu_si256(work3);
-            M256 work_reg_hi_3 = _mm256_loadu_si256(work3 + 1);
+    const M256 clr_mask = _mm256_set1_epi8(0x0f);
 
-            work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_2, work_reg_lo_3);
-            work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_2, work_reg_hi_3);
-            if (log_m23 != kModulus)
+    M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
+    M256 * RESTRICT y32 = reinterpret_cast<M256 *>(y);
+
+    do
+    {
+#define IFFTB_256(x_ptr, y_ptr) { \
+        M256 x_lo = _mm256_loadu_si256(x_ptr); \
+        M256 x_hi = _mm256_loadu_si256(x_ptr + 1); \
+        M256 y_lo = _mm256_loadu_si256(y_ptr); \
+        M256 y_hi = _mm256_loadu_si256(y_ptr + 1); \
+        y_lo = _mm256_xor_si256(y_lo, x_lo); \
+        y_hi = _mm256_xor_si256(y_hi, x_hi); \
+        _mm256_storeu_si256(y_ptr, y_lo); \
+        _mm256_storeu_si256(y_ptr + 1, y_hi); \
+        MULADD_256(x_lo, x_hi, y_lo, y_hi, 0); \
+        _mm256_storeu_si256(x_ptr, x_lo); \
+        _mm256_storeu_si256(x_ptr + 1, x_hi); }
+
+        IFFTB_256(x32, y32);
+        y32 += 2, x32 += 2;
+
+        bytes -= 64;
+    } while (bytes > 0);
+}
+
+#endif // TRY_AVX2
+
+static TARGET_SSSE3 void IFFT_DIT2_ssse3(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    MUL_TABLES_128(0, log_m);
+
+    const M128 clr_mask = _mm_set1_epi8(0x0f);
+
+    M128 * RESTRICT x16 = reinterpret_cast<M128 *>(x);
+    M128 * RESTRICT y16 = reinterpret_cast<M128 *>(y);
+
+    do
+    {
+#define IFFTB_128(x_ptr, y_ptr) { \
+            M128 x_lo = _mm_loadu_si128(x_ptr); \
+            M128 x_hi = _mm_loadu_si128(x_ptr + 2); \
+            M128 y_lo = _mm_loadu_si128(y_ptr); \
+            M128 y_hi = _mm_loadu_si128(y_ptr + 2); \
+            y_lo = _mm_xor_si128(y_lo, x_lo); \
+            y_hi = _mm_xor_si128(y_hi, x_hi); \
+            _mm_storeu_si128(y_ptr, y_lo); \
+            _mm_storeu_si128(y_ptr + 2, y_hi); \
+            MULADD_128(x_lo, x_hi, y_lo, y_hi, 0); \
+            _mm_storeu_si128(x_ptr, x_lo); \
+            _mm_storeu_si128(x_ptr + 2, x_hi); }
+
+        IFFTB_128(x16 + 1, y16 + 1);
+        IFFTB_128(x16, y16);
+        x16 += 4, y16 += 4;
+
+        bytes -= 64;
+    } while (bytes > 0);
+}
+
+static void IFFT_DIT2_ref(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    xor_mem(y, x, bytes);
+    RefMulAdd(x, y, log_m, bytes);
+}
+
+
+// Bits set by TrivialSkews4() for skews of kModulus, which skip their multiply
+static const unsigned kTrivial01 = 1;
+static const unsigned kTrivial23 = 2;
+static const unsigned kTrivial02 = 4;
+
+// Returns the index of the 4-way butterfly version for these skews.  The
+// versions are specialized at compile time so the byte loops do not test
+// the skews, and versions with no multiplies load no tables
+static FORCE_INLINE unsigned TrivialSkews4(
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    return (log_m01 == kModulus ? kTrivial01 : 0) |
+        (log_m23 == kModulus ? kTrivial23 : 0) |
+        (log_m02 == kModulus ? kTrivial02 : 0);
+}
+
+// 4-way butterfly over pieces {i, i + dist, i + dist * 2, i + dist * 3} for
+// each i in [0, count), indexed by TrivialSkews4().  The skews are the same
+// across the span, so each kernel loads its multiply tables once per call
+static void (*IFFT_DIT4[8])(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02);
+
+#ifdef INTERLEAVE_BUTTERFLY4_OPT
+
+#if defined(TRY_AVX512) && defined(TRY_GFNI)
+
+template<unsigned kTrivial>
+static TARGET_AVX512_GFNI void IFFT_DIT4_avx512_gfni(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    MUL_TABLES_GFNI_512(01, log_m01);
+    MUL_TABLES_GFNI_512(23, log_m23);
+    MUL_TABLES_GFNI_512(02, log_m02);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
+
+        M512 * RESTRICT work0 = reinterpret_cast<M512 *>(work[i]);
+        M512 * RESTRICT work1 = reinterpret_cast<M512 *>(work[i + dist]);
+        M512 * RESTRICT work2 = reinterpret_cast<M512 *>(work[i + dist * 2]);
+        M512 * RESTRICT work3 = reinterpret_cast<M512 *>(work[i + dist * 3]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            M512 work_reg_0 = _mm512_loadu_si512(work0);
+            M512 work_reg_1 = _mm512_loadu_si512(work1);
+
+            // First layer:
+            work_reg_1 = _mm512_xor_si512(work_reg_0, work_reg_1);
+            if (!(kTrivial & kTrivial01))
+                MULADD_GFNI_512(work_reg_0, work_reg_1, 01);
+
+            M512 work_reg_2 = _mm512_loadu_si512(work2);
+            M512 work_reg_3 = _mm512_loadu_si512(work3);
+
+            work_reg_3 = _mm512_xor_si512(work_reg_2, work_reg_3);
+            if (!(kTrivial & kTrivial23))
+                MULADD_GFNI_512(work_reg_2, work_reg_3, 23);
+
+            // Second layer:
+            work_reg_2 = _mm512_xor_si512(work_reg_0, work_reg_2);
+            work_reg_3 = _mm512_xor_si512(work_reg_1, work_reg_3);
+            if (!(kTrivial & kTrivial02))
+            {
+                MULADD_GFNI_512(work_reg_0, work_reg_2, 02);
+                MULADD_GFNI_512(work_reg_1, work_reg_3, 02);
+            }
+
+            _mm512_storeu_si512(work0, work_reg_0);
+            _mm512_storeu_si512(work1, work_reg_1);
+            _mm512_storeu_si512(work2, work_reg_2);
+            _mm512_storeu_si512(work3, work_reg_3);
+
+            work0++, work1++, work2++, work3++;
+
+            piece_bytes -= 64;
+        } while (piece_bytes > 0);
+    }
+}
+
+#endif // TRY_AVX512 && TRY_GFNI
+
+#if defined(TRY_GFNI)
+
+template<unsigned kTrivial>
+static TARGET_GFNI void IFFT_DIT4_gfni(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    MUL_TABLES_GFNI_256(01, log_m01);
+    MUL_TABLES_GFNI_256(23, log_m23);
+    MUL_TABLES_GFNI_256(02, log_m02);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
+
+        M256 * RESTRICT work0 = reinterpret_cast<M256 *>(work[i]);
+        M256 * RESTRICT work1 = reinterpret_cast<M256 *>(work[i + dist]);
+        M256 * RESTRICT work2 = reinterpret_cast<M256 *>(work[i + dist * 2]);
+        M256 * RESTRICT work3 = reinterpret_cast<M256 *>(work[i + dist * 3]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            M256 work_reg_lo_0 = _mm256_loadu_si256(work0);
+            M256 work_reg_hi_0 = _mm256_loadu_si256(work0 + 1);
+            M256 work_reg_lo_1 = _mm256_loadu_si256(work1);
+            M256 work_reg_hi_1 = _mm256_loadu_si256(work1 + 1);
+
+            // First layer:
+            work_reg_lo_1 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_1);
+            work_reg_hi_1 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_1);
+            if (!(kTrivial & kTrivial01))
+                MULADD_GFNI_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_1, work_reg_hi_1, 01);
+
+            M256 work_reg_lo_2 = _mm256_loadu_si256(work2);
+            M256 work_reg_hi_2 = _mm256_loadu_si256(work2 + 1);
+            M256 work_reg_lo_3 = _mm256_loadu_si256(work3);
+            M256 work_reg_hi_3 = _mm256_loadu_si256(work3 + 1);
+
+            work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_2, work_reg_lo_3);
+            work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_2, work_reg_hi_3);
+            if (!(kTrivial & kTrivial23))
+                MULADD_GFNI_256(work_reg_lo_2, work_reg_hi_2, work_reg_lo_3, work_reg_hi_3, 23);
+
+            // Second layer:
+            work_reg_lo_2 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_2);
+            work_reg_hi_2 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_2);
+            work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_1, work_reg_lo_3);
+            work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_1, work_reg_hi_3);
+            if (!(kTrivial & kTrivial02))
+            {
+                MULADD_GFNI_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_2, work_reg_hi_2, 02);
+                MULADD_GFNI_256(work_reg_lo_1, work_reg_hi_1, work_reg_lo_3, work_reg_hi_3, 02);
+            }
+
+            _mm256_storeu_si256(work0, work_reg_lo_0);
+            _mm256_storeu_si256(work0 + 1, work_reg_hi_0);
+            _mm256_storeu_si256(work1, work_reg_lo_1);
+            _mm256_storeu_si256(work1 + 1, work_reg_hi_1);
+            _mm256_storeu_si256(work2, work_reg_lo_2);
+            _mm256_storeu_si256(work2 + 1, work_reg_hi_2);
+            _mm256_storeu_si256(work3, work_reg_lo_3);
+            _mm256_storeu_si256(work3 + 1, work_reg_hi_3);
+
+            work0 += 2, work1 += 2, work2 += 2, work3 += 2;
+
+            piece_bytes -= 64;
+        } while (piece_bytes > 0);
+    }
+}
+
+#endif // TRY_GFNI
+
+#if defined(TRY_AVX512)
+
+template<unsigned kTrivial>
+static TARGET_AVX512 void IFFT_DIT4_avx512(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    // All three tables stay resident in the 32 zmm registers
+    MUL_TABLES_512(01, log_m01);
+    MUL_TABLES_512(23, log_m23);
+    MUL_TABLES_512(02, log_m02);
+
+    const M512 clr_mask = _mm512_set1_epi8(0x0f);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
+
+        M512 * RESTRICT work0 = reinterpret_cast<M512 *>(work[i]);
+        M512 * RESTRICT work1 = reinterpret_cast<M512 *>(work[i + dist]);
+        M512 * RESTRICT work2 = reinterpret_cast<M512 *>(work[i + dist * 2]);
+        M512 * RESTRICT work3 = reinterpret_cast<M512 *>(work[i + dist * 3]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            M512 work_reg_0 = _mm512_loadu_si512(work0);
+            M512 work_reg_1 = _mm512_loadu_si512(work1);
+
+            // First layer:
+            work_reg_1 = _mm512_xor_si512(work_reg_0, work_reg_1);
+            if (!(kTrivial & kTrivial01))
+                MULADD_512(work_reg_0, work_reg_1, 01);
+
+            M512 work_reg_2 = _mm512_loadu_si512(work2);
+            M512 work_reg_3 = _mm512_loadu_si512(work3);
+
+            work_reg_3 = _mm512_xor_si512(work_reg_2, work_reg_3);
+            if (!(kTrivial & kTrivial23))
+                MULADD_512(work_reg_2, work_reg_3, 23);
+
+            // Second layer:
+            work_reg_2 = _mm512_xor_si512(work_reg_0, work_reg_2);
+            work_reg_3 = _mm512_xor_si512(work_reg_1, work_reg_3);
+            if (!(kTrivial & kTrivial02))
+            {
+                MULADD_512(work_reg_0, work_reg_2, 02);
+                MULADD_512(work_reg_1, work_reg_3, 02);
+            }
+
+            _mm512_storeu_si512(work0, work_reg_0);
+            _mm512_storeu_si512(work1, work_reg_1);
+            _mm512_storeu_si512(work2, work_reg_2);
+            _mm512_storeu_si512(work3, work_reg_3);
+
+            work0++, work1++, work2++, work3++;
+
+            piece_bytes -= 64;
+        } while (piece_bytes > 0);
+    }
+}
+
+#endif // TRY_AVX512
+
+#if defined(TRY_AVX2)
+
+template<unsigned kTrivial>
+static TARGET_AVX2 void IFFT_DIT4_avx2(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    MUL_TABLES_256(01, log_m01);
+    MUL_TABLES_256(23, log_m23);
+    MUL_TABLES_256(02, log_m02);
+
+    const M256 clr_mask = _mm256_set1_epi8(0x0f);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
+
+        M256 * RESTRICT work0 = reinterpret_cast<M256 *>(work[i]);
+        M256 * RESTRICT work1 = reinterpret_cast<M256 *>(work[i + dist]);
+        M256 * RESTRICT work2 = reinterpret_cast<M256 *>(work[i + dist * 2]);
+        M256 * RESTRICT work3 = reinterpret_cast<M256 *>(work[i + dist * 3]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            M256 work_reg_lo_0 = _mm256_loadu_si256(work0);
+            M256 work_reg_hi_0 = _mm256_loadu_si256(work0 + 1);
+            M256 work_reg_lo_1 = _mm256_loadu_si256(work1);
+            M256 work_reg_hi_1 = _mm256_loadu_si256(work1 + 1);
+
+            // First layer:
+            work_reg_lo_1 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_1);
+            work_reg_hi_1 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_1);
+            if (!(kTrivial & kTrivial01))
+                MULADD_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_1, work_reg_hi_1, 01);
+
+            M256 work_reg_lo_2 = _mm256_loadu_si256(work2);
+            M256 work_reg_hi_2 = _mm256_loadu_si256(work2 + 1);
+            M256 work_reg_lo_3 = _mm256_loadu_si256(work3);
+            M256 work_reg_hi_3 = _mm256_loadu_si256(work3 + 1);
+
+            work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_2, work_reg_lo_3);
+            work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_2, work_reg_hi_3);
+            if (!(kTrivial & kTrivial23))
                 MULADD_256(work_reg_lo_2, work_reg_hi_2, work_reg_lo_3, work_reg_hi_3, 23);
 
             // Second layer:
@@ -731,7 +1874,7 @@ static void IFFT_DIT4(
             work_reg_hi_2 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_2);
             work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_1, work_reg_lo_3);
             work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_1, work_reg_hi_3);
-            if (log_m02 != kModulus)
+            if (!(kTrivial & kTrivial02))
             {
                 MULADD_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_2, work_reg_hi_2, 02);
                 MULADD_256(work_reg_lo_1, work_reg_hi_1, work_reg_lo_3, work_reg_hi_3, 02);
@@ -748,26 +1891,42 @@ static void IFFT_DIT4(
 
             work0 += 2, work1 += 2, work2 += 2, work3 += 2;
 
-            bytes -= 64;
-        } while (bytes > 0);
-
-        return;
+            piece_bytes -= 64;
+        } while (piece_bytes > 0);
     }
+}
 
 #endif // TRY_AVX2
 
-    if (CpuHasSSSE3)
+template<unsigned kTrivial>
+static TARGET_SSSE3 void IFFT_DIT4_ssse3(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    MUL_TABLES_128(01, log_m01);
+    MUL_TABLES_128(23, log_m23);
+    MUL_TABLES_128(02, log_m02);
+
+    const M128 clr_mask = _mm_set1_epi8(0x0f);
+
+    for (unsigned i = 0; i < count; ++i)
     {
-        MUL_TABLES_128(01, log_m01);
-        MUL_TABLES_128(23, log_m23);
-        MUL_TABLES_128(02, log_m02);
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
 
-        const M128 clr_mask = _mm_set1_epi8(0x0f);
+        M128 * RESTRICT work0 = reinterpret_cast<M128 *>(work[i]);
+        M128 * RESTRICT work1 = reinterpret_cast<M128 *>(work[i + dist]);
+        M128 * RESTRICT work2 = reinterpret_cast<M128 *>(work[i + dist * 2]);
+        M128 * RESTRICT work3 = reinterpret_cast<M128 *>(work[i + dist * 3]);
 
-        M128 * RESTRICT work0 = reinterpret_cast<M128 *>(work[0]);
-        M128 * RESTRICT work1 = reinterpret_cast<M128 *>(work[dist]);
-        M128 * RESTRICT work2 = reinterpret_cast<M128 *>(work[dist * 2]);
-        M128 * RESTRICT work3 = reinterpret_cast<M128 *>(work[dist * 3]);
+        uint64_t piece_bytes = bytes;
 
         do
         {
@@ -781,7 +1940,7 @@ static void IFFT_DIT4(
                 // First layer:
                 work_reg_lo_1 = _mm_xor_si128(work_reg_lo_0, work_reg_lo_1);
                 work_reg_hi_1 = _mm_xor_si128(work_reg_hi_0, work_reg_hi_1);
-                if (log_m01 != kModulus)
+                if (!(kTrivial & kTrivial01))
                     MULADD_128(work_reg_lo_0, work_reg_hi_0, work_reg_lo_1, work_reg_hi_1, 01);
 
                 M128 work_reg_lo_2 = _mm_loadu_si128(work2);
@@ -791,7 +1950,7 @@ static void IFFT_DIT4(
 
                 work_reg_lo_3 = _mm_xor_si128(work_reg_lo_2, work_reg_lo_3);
                 work_reg_hi_3 = _mm_xor_si128(work_reg_hi_2, work_reg_hi_3);
-                if (log_m23 != kModulus)
+                if (!(kTrivial & kTrivial23))
                     MULADD_128(work_reg_lo_2, work_reg_hi_2, work_reg_lo_3, work_reg_hi_3, 23);
 
                 // Second layer:
@@ -799,7 +1958,7 @@ static void IFFT_DIT4(
                 work_reg_hi_2 = _mm_xor_si128(work_reg_hi_0, work_reg_hi_2);
                 work_reg_lo_3 = _mm_xor_si128(work_reg_lo_1, work_reg_lo_3);
                 work_reg_hi_3 = _mm_xor_si128(work_reg_hi_1, work_reg_hi_3);
-                if (log_m02 != kModulus)
+                if (!(kTrivial & kTrivial02))
                 {
                     MULADD_128(work_reg_lo_0, work_reg_hi_0, work_reg_lo_2, work_reg_hi_2, 02);
                     MULADD_128(work_reg_lo_1, work_reg_hi_1, work_reg_lo_3, work_reg_hi_3, 02);
@@ -818,410 +1977,952 @@ static void IFFT_DIT4(
             }
 
             work0 += 2, work1 += 2, work2 += 2, work3 += 2;
-            bytes -= 64;
-        } while (bytes > 0);
-
-        return;
+            piece_bytes -= 64;
+        } while (piece_bytes > 0);
     }
+}
 
 #endif // INTERLEAVE_BUTTERFLY4_OPT
 
-    // First layer:
-    if (log_m01 == kModulus)
-        xor_mem(work[dist], work[0], bytes);
-    else
-        IFFT_DIT2(work[0], work[dist], log_m01, bytes);
+static void IFFT_DIT4_ref(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
+
+        // First layer:
+        if (log_m01 == kModulus)
+            xor_mem(work[i + dist], work[i], bytes);
+        else
+            IFFT_DIT2(work[i], work[i + dist], log_m01, bytes);
 
-    if (log_m23 == kModulus)
-        xor_mem(work[dist * 3], work[dist * 2], bytes);
-    else
-        IFFT_DIT2(work[dist * 2], work[dist * 3], log_m23, bytes);
+        if (log_m23 == kModulus)
+            xor_mem(work[i + dist * 3], work[i + dist * 2], bytes);
+        else
+            IFFT_DIT2(work[i + dist * 2], work[i + dist * 3], log_m23, bytes);
 
-    // Second layer:
-    if (log_m02 == kModulus)
-    {
-        xor_mem(work[dist * 2], work[0], bytes);
-        xor_mem(work[dist * 3], work[dist], bytes);
-    }
-    else
-    {
-        IFFT_DIT2(work[0], work[dist * 2], log_m02, bytes);
-        IFFT_DIT2(work[dist], work[dist * 3], log_m02, bytes);
+        // Second layer:
+        if (log_m02 == kModulus)
+        {
+            xor_mem(work[i + dist * 2], work[i], bytes);
+            xor_mem(work[i + dist * 3], work[i + dist], bytes);
+        }
+        else
+        {
+            IFFT_DIT2(work[i], work[i + dist * 2], log_m02, bytes);
+            IFFT_DIT2(work[i + dist], work[i + dist * 3], log_m02, bytes);
+        }
     }
 }
 
 
-// Unrolled IFFT for encoder
-static void IFFT_DIT_Encoder(
-    const uint64_t bytes,
-    const void* const* data,
-    const unsigned m_truncated,
+// 8-way butterfly: Three layers over pieces {0, dist, ..., dist * 7} in
+// registers.  Left null when no SIMD version exists, in which case the layer
+// loops stick to 4-way butterflies rather than composing this from them.
+// Runs count butterflies starting at pieces 0 to count - 1 with one set of
+// multiply tables
+static void (*IFFT_DIT8)(
+    uint64_t bytes,
     void** work,
-    void** xor_result,
-    const unsigned m,
-    const ffe_t* skewLUT)
-{
-    // I tried rolling the memcpy/memset into the first layer of the FFT and
-    // found that it only yields a 4% performance improvement, which is not
-    // worth the extra complexity.
-#pragma omp parallel for
-    for (int i = 0; i < (int)m_truncated; ++i)
-        memcpy(work[i], data[i], bytes);
-#pragma omp parallel for
-    for (int i = m_truncated; i < (int)m; ++i)
-        memset(work[i], 0, bytes);
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m45,
+    const ffe_t log_m67,
+    const ffe_t log_m02,
+    const ffe_t log_m46,
+    const ffe_t log_m04);
 
-    // I tried splitting up the first few layers into L3-cache sized blocks but
-    // found that it only provides about 5% performance boost, which is not
-    // worth the extra complexity.
+#ifdef INTERLEAVE_BUTTERFLY8_OPT
 
-    // Decimation in time: Unroll 2 layers at a time
-    unsigned dist = 1, dist4 = 4;
-    for (; dist4 <= m; dist = dist4, dist4 <<= 2)
+#if defined(TRY_AVX512) && defined(TRY_GFNI)
+
+static TARGET_AVX512_GFNI void IFFT_DIT8_avx512_gfni(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m45,
+    const ffe_t log_m67,
+    const ffe_t log_m02,
+    const ffe_t log_m46,
+    const ffe_t log_m04)
+{
+    MUL_TABLES_GFNI_512(01, log_m01);
+    MUL_TABLES_GFNI_512(23, log_m23);
+    MUL_TABLES_GFNI_512(45, log_m45);
+    MUL_TABLES_GFNI_512(67, log_m67);
+    MUL_TABLES_GFNI_512(02, log_m02);
+    MUL_TABLES_GFNI_512(46, log_m46);
+    MUL_TABLES_GFNI_512(04, log_m04);
+
+    for (unsigned i = 0; i < count; ++i)
     {
-        // For each set of dist*4 elements:
-#pragma omp parallel for
-        for (int r = 0; r < (int)m_truncated; r += dist4)
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 8);
+#endif // PREFETCH_NEXT_OPT
+
+        M512 * RESTRICT work0 = reinterpret_cast<M512 *>(work[i]);
+        M512 * RESTRICT work1 = reinterpret_cast<M512 *>(work[i + dist]);
+        M512 * RESTRICT work2 = reinterpret_cast<M512 *>(work[i + dist * 2]);
+        M512 * RESTRICT work3 = reinterpret_cast<M512 *>(work[i + dist * 3]);
+        M512 * RESTRICT work4 = reinterpret_cast<M512 *>(work[i + dist * 4]);
+        M512 * RESTRICT work5 = reinterpret_cast<M512 *>(work[i + dist * 5]);
+        M512 * RESTRICT work6 = reinterpret_cast<M512 *>(work[i + dist * 6]);
+        M512 * RESTRICT work7 = reinterpret_cast<M512 *>(work[i + dist * 7]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
         {
-            const unsigned i_end = r + dist;
-            const ffe_t log_m01 = skewLUT[i_end];
-            const ffe_t log_m02 = skewLUT[i_end + dist];
-            const ffe_t log_m23 = skewLUT[i_end + dist * 2];
+            M512 work_reg_0 = _mm512_loadu_si512(work0);
+            M512 work_reg_1 = _mm512_loadu_si512(work1);
+            M512 work_reg_2 = _mm512_loadu_si512(work2);
+            M512 work_reg_3 = _mm512_loadu_si512(work3);
+            M512 work_reg_4 = _mm512_loadu_si512(work4);
+            M512 work_reg_5 = _mm512_loadu_si512(work5);
+            M512 work_reg_6 = _mm512_loadu_si512(work6);
+            M512 work_reg_7 = _mm512_loadu_si512(work7);
+
+            // First layer:
+            work_reg_1 = _mm512_xor_si512(work_reg_0, work_reg_1);
+            if (log_m01 != kModulus)
+                MULADD_GFNI_512(work_reg_0, work_reg_1, 01);
+            work_reg_3 = _mm512_xor_si512(work_reg_2, work_reg_3);
+            if (log_m23 != kModulus)
+                MULADD_GFNI_512(work_reg_2, work_reg_3, 23);
+            work_reg_5 = _mm512_xor_si512(work_reg_4, work_reg_5);
+            if (log_m45 != kModulus)
+                MULADD_GFNI_512(work_reg_4, work_reg_5, 45);
+            work_reg_7 = _mm512_xor_si512(work_reg_6, work_reg_7);
+            if (log_m67 != kModulus)
+                MULADD_GFNI_512(work_reg_6, work_reg_7, 67);
 
-            // For each set of dist elements:
-            for (int i = r; i < (int)i_end; ++i)
+            // Second layer:
+            work_reg_2 = _mm512_xor_si512(work_reg_0, work_reg_2);
+            work_reg_3 = _mm512_xor_si512(work_reg_1, work_reg_3);
+            if (log_m02 != kModulus)
             {
-                IFFT_DIT4(
-                    bytes,
-                    work + i,
-                    dist,
-                    log_m01,
-                    log_m23,
-                    log_m02);
+                MULADD_GFNI_512(work_reg_0, work_reg_2, 02);
+                MULADD_GFNI_512(work_reg_1, work_reg_3, 02);
+            }
+            work_reg_6 = _mm512_xor_si512(work_reg_4, work_reg_6);
+            work_reg_7 = _mm512_xor_si512(work_reg_5, work_reg_7);
+            if (log_m46 != kModulus)
+            {
+                MULADD_GFNI_512(work_reg_4, work_reg_6, 46);
+                MULADD_GFNI_512(work_reg_5, work_reg_7, 46);
             }
-        }
 
-        // I tried alternating sweeps left->right and right->left to reduce cache misses.
-        // It provides about 1% performance boost when done for both FFT and IFFT, so it
-        // does not seem to be worth the extra complexity.
-    }
+            // Third layer:
+            work_reg_4 = _mm512_xor_si512(work_reg_0, work_reg_4);
+            work_reg_5 = _mm512_xor_si512(work_reg_1, work_reg_5);
+            work_reg_6 = _mm512_xor_si512(work_reg_2, work_reg_6);
+            work_reg_7 = _mm512_xor_si512(work_reg_3, work_reg_7);
+            if (log_m04 != kModulus)
+            {
+                MULADD_GFNI_512(work_reg_0, work_reg_4, 04);
+                MULADD_GFNI_512(work_reg_1, work_reg_5, 04);
+                MULADD_GFNI_512(work_reg_2, work_reg_6, 04);
+                MULADD_GFNI_512(work_reg_3, work_reg_7, 04);
+            }
 
-    // If there is one layer left:
-    if (dist < m)
-    {
-        // Assuming that dist = m / 2
-        DEBUG_ASSERT(dist * 2 == m);
+            _mm512_storeu_si512(work0, work_reg_0);
+            _mm512_storeu_si512(work1, work_reg_1);
+            _mm512_storeu_si512(work2, work_reg_2);
+            _mm512_storeu_si512(work3, work_reg_3);
+            _mm512_storeu_si512(work4, work_reg_4);
+            _mm512_storeu_si512(work5, work_reg_5);
+            _mm512_storeu_si512(work6, work_reg_6);
+            _mm512_storeu_si512(work7, work_reg_7);
 
-        const ffe_t log_m = skewLUT[dist];
+            work0++, work1++, work2++, work3++, work4++, work5++, work6++, work7++;
 
-        if (log_m == kModulus)
-            VectorXOR_Threads(bytes, dist, work + dist, work);
-        else
-        {
-#pragma omp parallel for
-            for (int i = 0; i < (int)dist; ++i)
-            {
-                IFFT_DIT2(
-                    work[i],
-                    work[i + dist],
-                    log_m,
-                    bytes);
-            }
-        }
+            piece_bytes -= 64;
+        } while (piece_bytes > 0);
     }
-
-    // I tried unrolling this but it does not provide more than 5% performance
-    // improvement for 16-bit finite fields, so it's not worth the complexity.
-    if (xor_result)
-        VectorXOR_Threads(bytes, m, xor_result, work);
 }
 
+#endif // TRY_AVX512 && TRY_GFNI
 
-// Basic no-frills version for decoder
-static void IFFT_DIT_Decoder(
-    const uint64_t bytes,
-    const unsigned m_truncated,
+#if defined(TRY_AVX512)
+
+static TARGET_AVX512 void IFFT_DIT8_avx512(
+    uint64_t bytes,
     void** work,
-    const unsigned m,
-    const ffe_t* skewLUT)
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m45,
+    const ffe_t log_m67,
+    const ffe_t log_m02,
+    const ffe_t log_m46,
+    const ffe_t log_m04)
 {
-    // Decimation in time: Unroll 2 layers at a time
-    unsigned dist = 1, dist4 = 4;
-    for (; dist4 <= m; dist = dist4, dist4 <<= 2)
+    // The seven tables do not all fit in the 32 zmm registers, so some are reloaded from L1
+    MUL_TABLES_512(01, log_m01);
+    MUL_TABLES_512(23, log_m23);
+    MUL_TABLES_512(45, log_m45);
+    MUL_TABLES_512(67, log_m67);
+    MUL_TABLES_512(02, log_m02);
+    MUL_TABLES_512(46, log_m46);
+    MUL_TABLES_512(04, log_m04);
+
+    const M512 clr_mask = _mm512_set1_epi8(0x0f);
+
+    for (unsigned i = 0; i < count; ++i)
     {
-        // For each set of dist*4 elements:
-#pragma omp parallel for
-        for (int r = 0; r < (int)m_truncated; r += dist4)
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 8);
+#endif // PREFETCH_NEXT_OPT
+
+        M512 * RESTRICT work0 = reinterpret_cast<M512 *>(work[i]);
+        M512 * RESTRICT work1 = reinterpret_cast<M512 *>(work[i + dist]);
+        M512 * RESTRICT work2 = reinterpret_cast<M512 *>(work[i + dist * 2]);
+        M512 * RESTRICT work3 = reinterpret_cast<M512 *>(work[i + dist * 3]);
+        M512 * RESTRICT work4 = reinterpret_cast<M512 *>(work[i + dist * 4]);
+        M512 * RESTRICT work5 = reinterpret_cast<M512 *>(work[i + dist * 5]);
+        M512 * RESTRICT work6 = reinterpret_cast<M512 *>(work[i + dist * 6]);
+        M512 * RESTRICT work7 = reinterpret_cast<M512 *>(work[i + dist * 7]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
         {
-            const unsigned i_end = r + dist;
-            const ffe_t log_m01 = skewLUT[i_end];
-            const ffe_t log_m02 = skewLUT[i_end + dist];
-            const ffe_t log_m23 = skewLUT[i_end + dist * 2];
+            M512 work_reg_0 = _mm512_loadu_si512(work0);
+            M512 work_reg_1 = _mm512_loadu_si512(work1);
+            M512 work_reg_2 = _mm512_loadu_si512(work2);
+            M512 work_reg_3 = _mm512_loadu_si512(work3);
+            M512 work_reg_4 = _mm512_loadu_si512(work4);
+            M512 work_reg_5 = _mm512_loadu_si512(work5);
+            M512 work_reg_6 = _mm512_loadu_si512(work6);
+            M512 work_reg_7 = _mm512_loadu_si512(work7);
+
+            // First layer:
+            work_reg_1 = _mm512_xor_si512(work_reg_0, work_reg_1);
+            if (log_m01 != kModulus)
+                MULADD_512(work_reg_0, work_reg_1, 01);
+            work_reg_3 = _mm512_xor_si512(work_reg_2, work_reg_3);
+            if (log_m23 != kModulus)
+                MULADD_512(work_reg_2, work_reg_3, 23);
+            work_reg_5 = _mm512_xor_si512(work_reg_4, work_reg_5);
+            if (log_m45 != kModulus)
+                MULADD_512(work_reg_4, work_reg_5, 45);
+            work_reg_7 = _mm512_xor_si512(work_reg_6, work_reg_7);
+            if (log_m67 != kModulus)
+                MULADD_512(work_reg_6, work_reg_7, 67);
 
-            // For each set of dist elements:
-            for (int i = r; i < (int)i_end; ++i)
+            // Second layer:
+            work_reg_2 = _mm512_xor_si512(work_reg_0, work_reg_2);
+            work_reg_3 = _mm512_xor_si512(work_reg_1, work_reg_3);
+            if (log_m02 != kModulus)
             {
-                IFFT_DIT4(
-                    bytes,
-                    work + i,
-                    dist,
-                    log_m01,
-                    log_m23,
-                    log_m02);
+                MULADD_512(work_reg_0, work_reg_2, 02);
+                MULADD_512(work_reg_1, work_reg_3, 02);
             }
-        }
+            work_reg_6 = _mm512_xor_si512(work_reg_4, work_reg_6);
+            work_reg_7 = _mm512_xor_si512(work_reg_5, work_reg_7);
+            if (log_m46 != kModulus)
+            {
+                MULADD_512(work_reg_4, work_reg_6, 46);
+                MULADD_512(work_reg_5, work_reg_7, 46);
+            }
+
+            // Third layer:
+            work_reg_4 = _mm512_xor_si512(work_reg_0, work_reg_4);
+            work_reg_5 = _mm512_xor_si512(work_reg_1, work_reg_5);
+            work_reg_6 = _mm512_xor_si512(work_reg_2, work_reg_6);
+            work_reg_7 = _mm512_xor_si512(work_reg_3, work_reg_7);
+            if (log_m04 != kModulus)
+            {
+                MULADD_512(work_reg_0, work_reg_4, 04);
+                MULADD_512(work_reg_1, work_reg_5, 04);
+                MULADD_512(work_reg_2, work_reg_6, 04);
+                MULADD_512(work_reg_3, work_reg_7, 04);
+            }
+
+            _mm512_storeu_si512(work0, work_reg_0);
+            _mm512_storeu_si512(work1, work_reg_1);
+            _mm512_storeu_si512(work2, work_reg_2);
+            _mm512_storeu_si512(work3, work_reg_3);
+            _mm512_storeu_si512(work4, work_reg_4);
+            _mm512_storeu_si512(work5, work_reg_5);
+            _mm512_storeu_si512(work6, work_reg_6);
+            _mm512_storeu_si512(work7, work_reg_7);
+
+            work0++, work1++, work2++, work3++, work4++, work5++, work6++, work7++;
+
+            piece_bytes -= 64;
+        } while (piece_bytes > 0);
     }
+}
 
-    // If there is one layer left:
-    if (dist < m)
-    {
-        // Assuming that dist = m / 2
-        DEBUG_ASSERT(dist * 2 == m);
+#endif // TRY_AVX512
 
-        const ffe_t log_m = skewLUT[dist];
+#endif // INTERLEAVE_BUTTERFLY8_OPT
 
-        if (log_m == kModulus)
-            VectorXOR_Threads(bytes, dist, work + dist, work);
-        else
+
+// {x_out, y_out} ^= IFFT_DIT2( {x_in, y_in} )
+static void (*IFFT_DIT2_xor)(
+    void * RESTRICT x_in, void * RESTRICT y_in,
+    void * RESTRICT x_out, void * RESTRICT y_out,
+    const ffe_t log_m, uint64_t bytes);
+
+#if defined(TRY_CLMUL)
+
+static TARGET_CLMUL void IFFT_DIT2_xor_clmul(
+    void * RESTRICT x_in, void * RESTRICT y_in,
+    void * RESTRICT x_out, void * RESTRICT y_out,
+    const ffe_t log_m, uint64_t bytes)
+{
+    CarrylessMultiplier mul;
+    LoadCarrylessMultiplier(mul, log_m);
+
+    const M128 * RESTRICT x16_in = reinterpret_cast<const M128 *>(x_in);
+    const M128 * RESTRICT y16_in = reinterpret_cast<const M128 *>(y_in);
+    M128 * RESTRICT x16_out = reinterpret_cast<M128 *>(x_out);
+    M128 * RESTRICT y16_out = reinterpret_cast<M128 *>(y_out);
+
+    do
+    {
+        for (unsigned i = 0; i < 2; ++i)
         {
-#pragma omp parallel for
-            for (int i = 0; i < (int)dist; ++i)
-            {
-                IFFT_DIT2(
-                    work[i],
-                    work[i + dist],
-                    log_m,
-                    bytes);
-            }
+            const M128 x_lo = _mm_loadu_si128(x16_in + i);
+            const M128 x_hi = _mm_loadu_si128(x16_in + i + 2);
+            M128 y_lo = _mm_xor_si128(_mm_loadu_si128(y16_in + i), x_lo);
+            M128 y_hi = _mm_xor_si128(_mm_loadu_si128(y16_in + i + 2), x_hi);
+            _mm_storeu_si128(y16_out + i, _mm_xor_si128(_mm_loadu_si128(y16_out + i), y_lo));
+            _mm_storeu_si128(y16_out + i + 2, _mm_xor_si128(_mm_loadu_si128(y16_out + i + 2), y_hi));
+            MulCarryless(mul, y_lo, y_hi);
+            _mm_storeu_si128(x16_out + i, _mm_xor_si128(_mm_loadu_si128(x16_out + i), _mm_xor_si128(x_lo, y_lo)));
+            _mm_storeu_si128(x16_out + i + 2, _mm_xor_si128(_mm_loadu_si128(x16_out + i + 2), _mm_xor_si128(x_hi, y_hi)));
         }
-    }
+        x16_in += 4, y16_in += 4, x16_out += 4, y16_out += 4;
+
+        bytes -= 64;
+    } while (bytes > 0);
 }
 
-/*
-    Decimation in time FFT:
+#endif // TRY_CLMUL
 
-    The decimation in time FFT algorithm allows us to unroll 2 layers at a time,
-    performing calculations on local registers and faster cache memory.
+#if defined(TRY_AVX512) && defined(TRY_GFNI)
 
-    Each ^___^ below indicates a butterfly between the associated indices.
+static TARGET_AVX512_GFNI void IFFT_DIT2_xor_avx512_gfni(
+    void * RESTRICT x_in, void * RESTRICT y_in,
+    void * RESTRICT x_out, void * RESTRICT y_out,
+    const ffe_t log_m, uint64_t bytes)
+{
+    MUL_TABLES_GFNI_512(0, log_m);
 
-    The fft_butterfly(x, y) operation:
+    const M512 * RESTRICT x64_in = reinterpret_cast<const M512 *>(x_in);
+    const M512 * RESTRICT y64_in = reinterpret_cast<const M512 *>(y_in);
+    M512 * RESTRICT x64_out = reinterpret_cast<M512 *>(x_out);
+    M512 * RESTRICT y64_out = reinterpret_cast<M512 *>(y_out);
 
-        if (log_m != kModulus)
-            x[] ^= exp(log(y[]) + log_m)
-        y[] ^= x[]
+    do
+    {
+        M512 x_reg = _mm512_loadu_si512(x64_in);
+        M512 y_reg = _mm512_loadu_si512(y64_in);
+        y_reg = _mm512_xor_si512(y_reg, x_reg);
+        _mm512_storeu_si512(y64_out, _mm512_xor_si512(_mm512_loadu_si512(y64_out), y_reg));
+        MULADD_GFNI_512(x_reg, y_reg, 0);
+        _mm512_storeu_si512(x64_out, _mm512_xor_si512(_mm512_loadu_si512(x64_out), x_reg));
+        y64_in++, x64_in++, y64_out++, x64_out++;
 
-    Layer 0:
-        0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7
-        ^_______________^
-          ^_______________^
-            ^_______________^
-              ^_______________^
-                ^_______________^
-                  ^_______________^
-                    ^_______________^
-                      ^_______________^
+        bytes -= 64;
+    } while (bytes > 0);
+}
 
-    Layer 1:
-        0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 
-        ^_______^       ^_______^
-          ^_______^       ^_______^
-            ^_______^       ^_______^
-              ^_______^       ^_______^
-  
-    Layer 2:
-        0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7
-        ^___^   ^___^   ^___^   ^___^
-          ^___^   ^___^   ^___^   ^___^
+#endif // TRY_AVX512 && TRY_GFNI
 
-    Layer 3:
-        0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7
-        ^_^ ^_^ ^_^ ^_^ ^_^ ^_^ ^_^ ^_^
+#if defined(TRY_GFNI)
 
-    DIT layer 0-1 operations, grouped 4 at a time:
-        {0-0', 4-4', 0-4, 0'-4'},
-        {1-1', 5-5', 1-5, 1'-5'},
+static TARGET_GFNI void IFFT_DIT2_xor_gfni(
+    void * RESTRICT x_in, void * RESTRICT y_in,
+    void * RESTRICT x_out, void * RESTRICT y_out,
+    const ffe_t log_m, uint64_t bytes)
+{
+    MUL_TABLES_GFNI_256(0, log_m);
 
-    DIT layer 1-2 operations, grouped 4 at a time:
-        {0-4, 2-6, 0-2, 4-6},
-        {1-5, 3-7, 1-3, 5-7},
+    const M256 * RESTRICT x32_in = reinterpret_cast<const M256 *>(x_in);
+    const M256 * RESTRICT y32_in = reinterpret_cast<const M256 *>(y_in);
+    M256 * RESTRICT x32_out = reinterpret_cast<M256 *>(x_out);
+    M256 * RESTRICT y32_out = reinterpret_cast<M256 *>(y_out);
 
-    DIT layer 2-3 operations, grouped 4 at a time:
-        {0-2, 1-3, 0-1, 2-3},
-        {4-6, 5-7, 4-5, 6-7},
-*/
+    do
+    {
+#define IFFTB_GFNI_256_XOR(x_ptr_in, y_ptr_in, x_ptr_out, y_ptr_out) { \
+        M256 x_lo = _mm256_loadu_si256(x_ptr_in); \
+        M256 x_hi = _mm256_loadu_si256(x_ptr_in + 1); \
+        M256 y_lo = _mm256_loadu_si256(y_ptr_in); \
+        M256 y_hi = _mm256_loadu_si256(y_ptr_in + 1); \
+        y_lo = _mm256_xor_si256(y_lo, x_lo); \
+        y_hi = _mm256_xor_si256(y_hi, x_hi); \
+        _mm256_storeu_si256(y_ptr_out, _mm256_xor_si256(_mm256_loadu_si256(y_ptr_out), y_lo)); \
+        _mm256_storeu_si256(y_ptr_out + 1, _mm256_xor_si256(_mm256_loadu_si256(y_ptr_out + 1), y_hi)); \
+        MULADD_GFNI_256(x_lo, x_hi, y_lo, y_hi, 0); \
+        _mm256_storeu_si256(x_ptr_out, _mm256_xor_si256(_mm256_loadu_si256(x_ptr_out), x_lo)); \
+        _mm256_storeu_si256(x_ptr_out + 1, _mm256_xor_si256(_mm256_loadu_si256(x_ptr_out + 1), x_hi)); }
+
+        IFFTB_GFNI_256_XOR(x32_in, y32_in, x32_out, y32_out);
+        y32_in += 2, x32_in += 2, y32_out += 2, x32_out += 2;
 
-// 2-way butterfly
-static void FFT_DIT2(
-    void * RESTRICT x, void * RESTRICT y,
-    ffe_t log_m, uint64_t bytes)
+        bytes -= 64;
+    } while (bytes > 0);
+}
+
+#endif // TRY_GFNI
+
+#if defined(TRY_AVX512)
+
+static TARGET_AVX512 void IFFT_DIT2_xor_avx512(
+    void * RESTRICT x_in, void * RESTRICT y_in,
+    void * RESTRICT x_out, void * RESTRICT y_out,
+    const ffe_t log_m, uint64_t bytes)
 {
-#if defined(TRY_AVX2)
-    if (CpuHasAVX2)
+    MUL_TABLES_512(0, log_m);
+
+    const M512 clr_mask = _mm512_set1_epi8(0x0f);
+
+    const M512 * RESTRICT x64_in = reinterpret_cast<const M512 *>(x_in);
+    const M512 * RESTRICT y64_in = reinterpret_cast<const M512 *>(y_in);
+    M512 * RESTRICT x64_out = reinterpret_cast<M512 *>(x_out);
+    M512 * RESTRICT y64_out = reinterpret_cast<M512 *>(y_out);
+
+    do
     {
-        MUL_TABLES_256(0, log_m);
+        M512 x_reg = _mm512_loadu_si512(x64_in);
+        M512 y_reg = _mm512_loadu_si512(y64_in);
+        y_reg = _mm512_xor_si512(y_reg, x_reg);
+        _mm512_storeu_si512(y64_out, _mm512_xor_si512(_mm512_loadu_si512(y64_out), y_reg));
+        MULADD_512(x_reg, y_reg, 0);
+        _mm512_storeu_si512(x64_out, _mm512_xor_si512(_mm512_loadu_si512(x64_out), x_reg));
+        y64_in++, x64_in++, y64_out++, x64_out++;
 
-        const M256 clr_mask = _mm256_set1_epi8(0x0f);
+        bytes -= 64;
+    } while (bytes > 0);
+}
 
-        M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
-        M256 * RESTRICT y32 = reinterpret_cast<M256 *>(y);
+#endif // TRY_AVX512
 
-        do
-        {
-#define FFTB_256(x_ptr, y_ptr) { \
-            M256 x_lo = _mm256_loadu_si256(x_ptr); \
-            M256 x_hi = _mm256_loadu_si256(x_ptr + 1); \
-            M256 y_lo = _mm256_loadu_si256(y_ptr); \
-            M256 y_hi = _mm256_loadu_si256(y_ptr + 1); \
-            MULADD_256(x_lo, x_hi, y_lo, y_hi, 0); \
-            _mm256_storeu_si256(x_ptr, x_lo); \
-            _mm256_storeu_si256(x_ptr + 1, x_hi); \
-            y_lo = _mm256_xor_si256(y_lo, x_lo); \
-            y_hi = _mm256_xor_si256(y_hi, x_hi); \
-            _mm256_storeu_si256(y_ptr, y_lo); \
-            _mm256_storeu_si256(y_ptr + 1, y_hi); }
-
-            FFTB_256(x32, y32);
-            y32 += 2, x32 += 2;
-
-            bytes -= 64;
-        } while (bytes > 0);
+#if defined(TRY_AVX2)
 
-        return;
-    }
-#endif // TRY_AVX2
+static TARGET_AVX2 void IFFT_DIT2_xor_avx2(
+    void * RESTRICT x_in, void * RESTRICT y_in,
+    void * RESTRICT x_out, void * RESTRICT y_out,
+    const ffe_t log_m, uint64_t bytes)
+{
+    MUL_TABLES_256(0, log_m);
 
-    if (CpuHasSSSE3)
+    const M256 clr_mask = _mm256_set1_epi8(0x0f);
+
+    const M256 * RESTRICT x32_in = reinterpret_cast<const M256 *>(x_in);
+    const M256 * RESTRICT y32_in = reinterpret_cast<const M256 *>(y_in);
+    M256 * RESTRICT x32_out = reinterpret_cast<M256 *>(x_out);
+    M256 * RESTRICT y32_out = reinterpret_cast<M256 *>(y_out);
+
+    do
     {
-        MUL_TABLES_128(0, log_m);
+#define IFFTB_256_XOR(x_ptr_in, y_ptr_in, x_ptr_out, y_ptr_out) { \
+        M256 x_lo = _mm256_loadu_si256(x_ptr_in); \
+        M256 x_hi = _mm256_loadu_si256(x_ptr_in + 1); \
+        M256 y_lo = _mm256_loadu_si256(y_ptr_in); \
+        M256 y_hi = _mm256_loadu_si256(y_ptr_in + 1); \
+        y_lo = _mm256_xor_si256(y_lo, x_lo); \
+        y_hi = _mm256_xor_si256(y_hi, x_hi); \
+        _mm256_storeu_si256(y_ptr_out, _mm256_xor_si256(_mm256_loadu_si256(y_ptr_out), y_lo)); \
+        _mm256_storeu_si256(y_ptr_out + 1, _mm256_xor_si256(_mm256_loadu_si256(y_ptr_out + 1), y_hi)); \
+        MULADD_256(x_lo, x_hi, y_lo, y_hi, 0); \
+        _mm256_storeu_si256(x_ptr_out, _mm256_xor_si256(_mm256_loadu_si256(x_ptr_out), x_lo)); \
+        _mm256_storeu_si256(x_ptr_out + 1, _mm256_xor_si256(_mm256_loadu_si256(x_ptr_out + 1), x_hi)); }
+
+        IFFTB_256_XOR(x32_in, y32_in, x32_out, y32_out);
+        y32_in += 2, x32_in += 2, y32_out += 2, x32_out += 2;
 
-        const M128 clr_mask = _mm_set1_epi8(0x0f);
+        bytes -= 64;
+    } while (bytes > 0);
+}
 
-        M128 * RESTRICT x16 = reinterpret_cast<M128 *>(x);
-        M128 * RESTRICT y16 = reinterpret_cast<M128 *>(y);
+#endif // TRY_AVX2
 
-        do
-        {
-#define FFTB_128(x_ptr, y_ptr) { \
-                M128 x_lo = _mm_loadu_si128(x_ptr); \
-                M128 x_hi = _mm_loadu_si128(x_ptr + 2); \
-                M128 y_lo = _mm_loadu_si128(y_ptr); \
-                M128 y_hi = _mm_loadu_si128(y_ptr + 2); \
-                MULADD_128(x_lo, x_hi, y_lo, y_hi, 0); \
-                _mm_storeu_si128(x_ptr, x_lo); \
-                _mm_storeu_si128(x_ptr + 2, x_hi); \
-                y_lo = _mm_xor_si128(y_lo, x_lo); \
-                y_hi = _mm_xor_si128(y_hi, x_hi); \
-                _mm_storeu_si128(y_ptr, y_lo); \
-                _mm_storeu_si128(y_ptr + 2, y_hi); }
-
-            FFTB_128(x16 + 1, y16 + 1);
-            FFTB_128(x16, y16);
-            x16 += 4, y16 += 4;
-
-            bytes -= 64;
-        } while (bytes > 0);
+static TARGET_SSSE3 void IFFT_DIT2_xor_ssse3(
+    void * RESTRICT x_in, void * RESTRICT y_in,
+    void * RESTRICT x_out, void * RESTRICT y_out,
+    const ffe_t log_m, uint64_t bytes)
+{
+    MUL_TABLES_128(0, log_m);
 
-        return;
-    }
+    const M128 clr_mask = _mm_set1_epi8(0x0f);
 
-    // Reference version:
-    RefMulAdd(x, y, log_m, bytes);
-    xor_mem(y, x, bytes);
+    const M128 * RESTRICT x16_in = reinterpret_cast<const M128 *>(x_in);
+    const M128 * RESTRICT y16_in = reinterpret_cast<const M128 *>(y_in);
+    M128 * RESTRICT x16_out = reinterpret_cast<M128 *>(x_out);
+    M128 * RESTRICT y16_out = reinterpret_cast<M128 *>(y_out);
+
+    do
+    {
+#define IFFTB_128_XOR(x_ptr_in, y_ptr_in, x_ptr_out, y_ptr_out) { \
+            M128 x_lo = _mm_loadu_si128(x_ptr_in); \
+            M128 x_hi = _mm_loadu_si128(x_ptr_in + 2); \
+            M128 y_lo = _mm_loadu_si128(y_ptr_in); \
+            M128 y_hi = _mm_loadu_si128(y_ptr_in + 2); \
+            y_lo = _mm_xor_si128(y_lo, x_lo); \
+            y_hi = _mm_xor_si128(y_hi, x_hi); \
+            _mm_storeu_si128(y_ptr_out, _mm_xor_si128(_mm_loadu_si128(y_ptr_out), y_lo)); \
+            _mm_storeu_si128(y_ptr_out + 2, _mm_xor_si128(_mm_loadu_si128(y_ptr_out + 2), y_hi)); \
+            MULADD_128(x_lo, x_hi, y_lo, y_hi, 0); \
+            _mm_storeu_si128(x_ptr_out, _mm_xor_si128(_mm_loadu_si128(x_ptr_out), x_lo)); \
+            _mm_storeu_si128(x_ptr_out + 2, _mm_xor_si128(_mm_loadu_si128(x_ptr_out + 2), x_hi)); }
+
+        IFFTB_128_XOR(x16_in + 1, y16_in + 1, x16_out + 1, y16_out + 1);
+        IFFTB_128_XOR(x16_in, y16_in, x16_out, y16_out);
+        y16_in += 4, x16_in += 4, y16_out += 4, x16_out += 4;
+
+        bytes -= 64;
+    } while (bytes > 0);
+}
+
+static void IFFT_DIT2_xor_ref(
+    void * RESTRICT x_in, void * RESTRICT y_in,
+    void * RESTRICT x_out, void * RESTRICT y_out,
+    const ffe_t log_m, uint64_t bytes)
+{
+    xor_mem(y_in, x_in, bytes);
+    RefMulAdd(x_in, y_in, log_m, bytes);
+    xor_mem(y_out, y_in, bytes);
+    xor_mem(x_out, x_in, bytes);
 }
 
 
-// 4-way butterfly
-static void FFT_DIT4(
+// xor_result ^= IFFT_DIT4(work) over the same span, indexed by TrivialSkews4()
+static void (*IFFT_DIT4_xor[8])(
     uint64_t bytes,
-    void** work,
+    void** work_in,
+    void** xor_out,
     unsigned dist,
+    unsigned count,
     const ffe_t log_m01,
     const ffe_t log_m23,
-    const ffe_t log_m02)
-{
+    const ffe_t log_m02);
+
 #ifdef INTERLEAVE_BUTTERFLY4_OPT
 
-#if defined(TRY_AVX2)
+#if defined(TRY_AVX512) && defined(TRY_GFNI)
 
-    if (CpuHasAVX2)
+template<unsigned kTrivial>
+static TARGET_AVX512_GFNI void IFFT_DIT4_xor_avx512_gfni(
+    uint64_t bytes,
+    void** work_in,
+    void** xor_out,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    MUL_TABLES_GFNI_512(01, log_m01);
+    MUL_TABLES_GFNI_512(23, log_m23);
+    MUL_TABLES_GFNI_512(02, log_m02);
+
+    for (unsigned i = 0; i < count; ++i)
     {
-        MUL_TABLES_256(01, log_m01);
-        MUL_TABLES_256(23, log_m23);
-        MUL_TABLES_256(02, log_m02);
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+        {
+            PrefetchButterfly(work_in + i + 1, dist, 4);
+            PrefetchButterfly(xor_out + i + 1, dist, 4);
+        }
+#endif // PREFETCH_NEXT_OPT
 
-        const M256 clr_mask = _mm256_set1_epi8(0x0f);
+        const M512 * RESTRICT work0 = reinterpret_cast<const M512 *>(work_in[i]);
+        const M512 * RESTRICT work1 = reinterpret_cast<const M512 *>(work_in[i + dist]);
+        const M512 * RESTRICT work2 = reinterpret_cast<const M512 *>(work_in[i + dist * 2]);
+        const M512 * RESTRICT work3 = reinterpret_cast<const M512 *>(work_in[i + dist * 3]);
+        M512 * RESTRICT xor0 = reinterpret_cast<M512 *>(xor_out[i]);
+        M512 * RESTRICT xor1 = reinterpret_cast<M512 *>(xor_out[i + dist]);
+        M512 * RESTRICT xor2 = reinterpret_cast<M512 *>(xor_out[i + dist * 2]);
+        M512 * RESTRICT xor3 = reinterpret_cast<M512 *>(xor_out[i + dist * 3]);
 
-        M256 * RESTRICT work0 = reinterpret_cast<M256 *>(work[0]);
-        M256 * RESTRICT work1 = reinterpret_cast<M256 *>(work[dist]);
-        M256 * RESTRICT work2 = reinterpret_cast<M256 *>(work[dist * 2]);
-        M256 * RESTRICT work3 = reinterpret_cast<M256 *>(work[dist * 3]);
+        uint64_t piece_bytes = bytes;
 
         do
         {
-            M256 work_reg_lo_0 = _mm256_loadu_si256(work0);
-            M256 work_reg_hi_0 = _mm256_loadu_si256(work0 + 1);
-            M256 work_reg_lo_1 = _mm256_loadu_si256(work1);
-            M256 work_reg_hi_1 = _mm256_loadu_si256(work1 + 1);
-            M256 work_reg_lo_2 = _mm256_loadu_si256(work2);
-            M256 work_reg_hi_2 = _mm256_loadu_si256(work2 + 1);
-            M256 work_reg_lo_3 = _mm256_loadu_si256(work3);
-            M256 work_reg_hi_3 = _mm256_loadu_si256(work3 + 1);
+            M512 work_reg_0 = _mm512_loadu_si512(work0);
+            M512 work_reg_1 = _mm512_loadu_si512(work1);
 
             // First layer:
-            if (log_m02 != kModulus)
+            work_reg_1 = _mm512_xor_si512(work_reg_0, work_reg_1);
+            if (!(kTrivial & kTrivial01))
+                MULADD_GFNI_512(work_reg_0, work_reg_1, 01);
+
+            M512 work_reg_2 = _mm512_loadu_si512(work2);
+            M512 work_reg_3 = _mm512_loadu_si512(work3);
+
+            work_reg_3 = _mm512_xor_si512(work_reg_2, work_reg_3);
+            if (!(kTrivial & kTrivial23))
+                MULADD_GFNI_512(work_reg_2, work_reg_3, 23);
+
+            // Second layer:
+            work_reg_2 = _mm512_xor_si512(work_reg_0, work_reg_2);
+            work_reg_3 = _mm512_xor_si512(work_reg_1, work_reg_3);
+            if (!(kTrivial & kTrivial02))
             {
-                MULADD_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_2, work_reg_hi_2, 02);
-                MULADD_256(work_reg_lo_1, work_reg_hi_1, work_reg_lo_3, work_reg_hi_3, 02);
+                MULADD_GFNI_512(work_reg_0, work_reg_2, 02);
+                MULADD_GFNI_512(work_reg_1, work_reg_3, 02);
             }
-            work_reg_lo_2 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_2);
-            work_reg_hi_2 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_2);
-            work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_1, work_reg_lo_3);
-            work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_1, work_reg_hi_3);
 
-            // Second layer:
-            if (log_m01 != kModulus)
-                MULADD_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_1, work_reg_hi_1, 01);
-            work_reg_lo_1 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_1);
+            _mm512_storeu_si512(xor0, _mm512_xor_si512(work_reg_0, _mm512_loadu_si512(xor0)));
+            _mm512_storeu_si512(xor1, _mm512_xor_si512(work_reg_1, _mm512_loadu_si512(xor1)));
+            _mm512_storeu_si512(xor2, _mm512_xor_si512(work_reg_2, _mm512_loadu_si512(xor2)));
+            _mm512_storeu_si512(xor3, _mm512_xor_si512(work_reg_3, _mm512_loadu_si512(xor3)));
+
+            work0++, work1++, work2++, work3++;
+            xor0++, xor1++, xor2++, xor3++;
+
+            piece_bytes -= 64;
+        } while (piece_bytes > 0);
+    }
+}
+
+#endif // TRY_AVX512 && TRY_GFNI
+
+#if defined(TRY_GFNI)
+
+template<unsigned kTrivial>
+static TARGET_GFNI void IFFT_DIT4_xor_gfni(
+    uint64_t bytes,
+    void** work_in,
+    void** xor_out,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    MUL_TABLES_GFNI_256(01, log_m01);
+    MUL_TABLES_GFNI_256(23, log_m23);
+    MUL_TABLES_GFNI_256(02, log_m02);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+        {
+            PrefetchButterfly(work_in + i + 1, dist, 4);
+            PrefetchButterfly(xor_out + i + 1, dist, 4);
+        }
+#endif // PREFETCH_NEXT_OPT
+
+        const M256 * RESTRICT work0 = reinterpret_cast<const M256 *>(work_in[i]);
+        const M256 * RESTRICT work1 = reinterpret_cast<const M256 *>(work_in[i + dist]);
+        const M256 * RESTRICT work2 = reinterpret_cast<const M256 *>(work_in[i + dist * 2]);
+        const M256 * RESTRICT work3 = reinterpret_cast<const M256 *>(work_in[i + dist * 3]);
+        M256 * RESTRICT xor0 = reinterpret_cast<M256 *>(xor_out[i]);
+        M256 * RESTRICT xor1 = reinterpret_cast<M256 *>(xor_out[i + dist]);
+        M256 * RESTRICT xor2 = reinterpret_cast<M256 *>(xor_out[i + dist * 2]);
+        M256 * RESTRICT xor3 = reinterpret_cast<M256 *>(xor_out[i + dist * 3]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            M256 work_reg_lo_0 = _mm256_loadu_si256(work0);
+            M256 work_reg_hi_0 = _mm256_loadu_si256(work0 + 1);
+            M256 work_reg_lo_1 = _mm256_loadu_si256(work1);
+            M256 work_reg_hi_1 = _mm256_loadu_si256(work1 + 1);
+
+            // First layer:
+            work_reg_lo_1 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_1);
             work_reg_hi_1 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_1);
+            if (!(kTrivial & kTrivial01))
+                MULADD_GFNI_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_1, work_reg_hi_1, 01);
 
-            _mm256_storeu_si256(work0, work_reg_lo_0);
-            _mm256_storeu_si256(work0 + 1, work_reg_hi_0);
-            _mm256_storeu_si256(work1, work_reg_lo_1);
-            _mm256_storeu_si256(work1 + 1, work_reg_hi_1);
+            M256 work_reg_lo_2 = _mm256_loadu_si256(work2);
+            M256 work_reg_hi_2 = _mm256_loadu_si256(work2 + 1);
+            M256 work_reg_lo_3 = _mm256_loadu_si256(work3);
+            M256 work_reg_hi_3 = _mm256_loadu_si256(work3 + 1);
 
-            if (log_m23 != kModulus)
-                MULADD_256(work_reg_lo_2, work_reg_hi_2, work_reg_lo_3, work_reg_hi_3, 23);
             work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_2, work_reg_lo_3);
             work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_2, work_reg_hi_3);
+            if (!(kTrivial & kTrivial23))
+                MULADD_GFNI_256(work_reg_lo_2, work_reg_hi_2, work_reg_lo_3, work_reg_hi_3, 23);
 
-            _mm256_storeu_si256(work2, work_reg_lo_2);
-            _mm256_storeu_si256(work2 + 1, work_reg_hi_2);
-            _mm256_storeu_si256(work3, work_reg_lo_3);
-            _mm256_storeu_si256(work3 + 1, work_reg_hi_3);
+            // Second layer:
+            work_reg_lo_2 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_2);
+            work_reg_hi_2 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_2);
+            work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_1, work_reg_lo_3);
+            work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_1, work_reg_hi_3);
+            if (!(kTrivial & kTrivial02))
+            {
+                MULADD_GFNI_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_2, work_reg_hi_2, 02);
+                MULADD_GFNI_256(work_reg_lo_1, work_reg_hi_1, work_reg_lo_3, work_reg_hi_3, 02);
+            }
+
+            work_reg_lo_0 = _mm256_xor_si256(work_reg_lo_0, _mm256_loadu_si256(xor0));
+            work_reg_hi_0 = _mm256_xor_si256(work_reg_hi_0, _mm256_loadu_si256(xor0 + 1));
+            work_reg_lo_1 = _mm256_xor_si256(work_reg_lo_1, _mm256_loadu_si256(xor1));
+            work_reg_hi_1 = _mm256_xor_si256(work_reg_hi_1, _mm256_loadu_si256(xor1 + 1));
+            work_reg_lo_2 = _mm256_xor_si256(work_reg_lo_2, _mm256_loadu_si256(xor2));
+            work_reg_hi_2 = _mm256_xor_si256(work_reg_hi_2, _mm256_loadu_si256(xor2 + 1));
+            work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_3, _mm256_loadu_si256(xor3));
+            work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_3, _mm256_loadu_si256(xor3 + 1));
+
+            _mm256_storeu_si256(xor0, work_reg_lo_0);
+            _mm256_storeu_si256(xor0 + 1, work_reg_hi_0);
+            _mm256_storeu_si256(xor1, work_reg_lo_1);
+            _mm256_storeu_si256(xor1 + 1, work_reg_hi_1);
+            _mm256_storeu_si256(xor2, work_reg_lo_2);
+            _mm256_storeu_si256(xor2 + 1, work_reg_hi_2);
+            _mm256_storeu_si256(xor3, work_reg_lo_3);
+            _mm256_storeu_si256(xor3 + 1, work_reg_hi_3);
 
             work0 += 2, work1 += 2, work2 += 2, work3 += 2;
+            xor0 += 2, xor1 += 2, xor2 += 2, xor3 += 2;
+
+            piece_bytes -= 64;
+        } while (piece_bytes > 0);
+    }
+}
 
-            bytes -= 64;
-        } while (bytes > 0);
+#endif // TRY_GFNI
 
-        return;
+#if defined(TRY_AVX512)
+
+template<unsigned kTrivial>
+static TARGET_AVX512 void IFFT_DIT4_xor_avx512(
+    uint64_t bytes,
+    void** work_in,
+    void** xor_out,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    // All three tables stay resident in the 32 zmm registers
+    MUL_TABLES_512(01, log_m01);
+    MUL_TABLES_512(23, log_m23);
+    MUL_TABLES_512(02, log_m02);
+
+    const M512 clr_mask = _mm512_set1_epi8(0x0f);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+        {
+            PrefetchButterfly(work_in + i + 1, dist, 4);
+            PrefetchButterfly(xor_out + i + 1, dist, 4);
+        }
+#endif // PREFETCH_NEXT_OPT
+
+        const M512 * RESTRICT work0 = reinterpret_cast<const M512 *>(work_in[i]);
+        const M512 * RESTRICT work1 = reinterpret_cast<const M512 *>(work_in[i + dist]);
+        const M512 * RESTRICT work2 = reinterpret_cast<const M512 *>(work_in[i + dist * 2]);
+        const M512 * RESTRICT work3 = reinterpret_cast<const M512 *>(work_in[i + dist * 3]);
+        M512 * RESTRICT xor0 = reinterpret_cast<M512 *>(xor_out[i]);
+        M512 * RESTRICT xor1 = reinterpret_cast<M512 *>(xor_out[i + dist]);
+        M512 * RESTRICT xor2 = reinterpret_cast<M512 *>(xor_out[i + dist * 2]);
+        M512 * RESTRICT xor3 = reinterpret_cast<M512 *>(xor_out[i + dist * 3]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            M512 work_reg_0 = _mm512_loadu_si512(work0);
+            M512 work_reg_1 = _mm512_loadu_si512(work1);
+
+            // First layer:
+            work_reg_1 = _mm512_xor_si512(work_reg_0, work_reg_1);
+            if (!(kTrivial & kTrivial01))
+                MULADD_512(work_reg_0, work_reg_1, 01);
+
+            M512 work_reg_2 = _mm512_loadu_si512(work2);
+            M512 work_reg_3 = _mm512_loadu_si512(work3);
+
+            work_reg_3 = _mm512_xor_si512(work_reg_2, work_reg_3);
+            if (!(kTrivial & kTrivial23))
+                MULADD_512(work_reg_2, work_reg_3, 23);
+
+            // Second layer:
+            work_reg_2 = _mm512_xor_si512(work_reg_0, work_reg_2);
+            work_reg_3 = _mm512_xor_si512(work_reg_1, work_reg_3);
+            if (!(kTrivial & kTrivial02))
+            {
+                MULADD_512(work_reg_0, work_reg_2, 02);
+                MULADD_512(work_reg_1, work_reg_3, 02);
+            }
+
+            _mm512_storeu_si512(xor0, _mm512_xor_si512(work_reg_0, _mm512_loadu_si512(xor0)));
+            _mm512_storeu_si512(xor1, _mm512_xor_si512(work_reg_1, _mm512_loadu_si512(xor1)));
+            _mm512_storeu_si512(xor2, _mm512_xor_si512(work_reg_2, _mm512_loadu_si512(xor2)));
+            _mm512_storeu_si512(xor3, _mm512_xor_si512(work_reg_3, _mm512_loadu_si512(xor3)));
+
+            work0++, work1++, work2++, work3++;
+            xor0++, xor1++, xor2++, xor3++;
+
+            piece_bytes -= 64;
+        } while (piece_bytes > 0);
+    }
+}
+
+#endif // TRY_AVX512
+
+#if defined(TRY_AVX2)
+
+template<unsigned kTrivial>
+static TARGET_AVX2 void IFFT_DIT4_xor_avx2(
+    uint64_t bytes,
+    void** work_in,
+    void** xor_out,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    MUL_TABLES_256(01, log_m01);
+    MUL_TABLES_256(23, log_m23);
+    MUL_TABLES_256(02, log_m02);
+
+    const M256 clr_mask = _mm256_set1_epi8(0x0f);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+        {
+            PrefetchButterfly(work_in + i + 1, dist, 4);
+            PrefetchButterfly(xor_out + i + 1, dist, 4);
+        }
+#endif // PREFETCH_NEXT_OPT
+
+        const M256 * RESTRICT work0 = reinterpret_cast<const M256 *>(work_in[i]);
+        const M256 * RESTRICT work1 = reinterpret_cast<const M256 *>(work_in[i + dist]);
+        const M256 * RESTRICT work2 = reinterpret_cast<const M256 *>(work_in[i + dist * 2]);
+        const M256 * RESTRICT work3 = reinterpret_cast<const M256 *>(work_in[i + dist * 3]);
+        M256 * RESTRICT xor0 = reinterpret_cast<M256 *>(xor_out[i]);
+        M256 * RESTRICT xor1 = reinterpret_cast<M256 *>(xor_out[i + dist]);
+        M256 * RESTRICT xor2 = reinterpret_cast<M256 *>(xor_out[i + dist * 2]);
+        M256 * RESTRICT xor3 = reinterpret_cast<M256 *>(xor_out[i + dist * 3]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            M256 work_reg_lo_0 = _mm256_loadu_si256(work0);
+            M256 work_reg_hi_0 = _mm256_loadu_si256(work0 + 1);
+            M256 work_reg_lo_1 = _mm256_loadu_si256(work1);
+            M256 work_reg_hi_1 = _mm256_loadu_si256(work1 + 1);
+
+            // First layer:
+            work_reg_lo_1 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_1);
+            work_reg_hi_1 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_1);
+            if (!(kTrivial & kTrivial01))
+                MULADD_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_1, work_reg_hi_1, 01);
+
+            M256 work_reg_lo_2 = _mm256_loadu_si256(work2);
+            M256 work_reg_hi_2 = _mm256_loadu_si256(work2 + 1);
+            M256 work_reg_lo_3 = _mm256_loadu_si256(work3);
+            M256 work_reg_hi_3 = _mm256_loadu_si256(work3 + 1);
+
+            work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_2, work_reg_lo_3);
+            work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_2, work_reg_hi_3);
+            if (!(kTrivial & kTrivial23))
+                MULADD_256(work_reg_lo_2, work_reg_hi_2, work_reg_lo_3, work_reg_hi_3, 23);
+
+            // Second layer:
+            work_reg_lo_2 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_2);
+            work_reg_hi_2 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_2);
+            work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_1, work_reg_lo_3);
+            work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_1, work_reg_hi_3);
+            if (!(kTrivial & kTrivial02))
+            {
+                MULADD_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_2, work_reg_hi_2, 02);
+                MULADD_256(work_reg_lo_1, work_reg_hi_1, work_reg_lo_3, work_reg_hi_3, 02);
+            }
+
+            work_reg_lo_0 = _mm256_xor_si256(work_reg_lo_0, _mm256_loadu_si256(xor0));
+            work_reg_hi_0 = _mm256_xor_si256(work_reg_hi_0, _mm256_loadu_si256(xor0 + 1));
+            work_reg_lo_1 = _mm256_xor_si256(work_reg_lo_1, _mm256_loadu_si256(xor1));
+            work_reg_hi_1 = _mm256_xor_si256(work_reg_hi_1, _mm256_loadu_si256(xor1 + 1));
+            work_reg_lo_2 = _mm256_xor_si256(work_reg_lo_2, _mm256_loadu_si256(xor2));
+            work_reg_hi_2 = _mm256_xor_si256(work_reg_hi_2, _mm256_loadu_si256(xor2 + 1));
+            work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_3, _mm256_loadu_si256(xor3));
+            work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_3, _mm256_loadu_si256(xor3 + 1));
+
+            _mm256_storeu_si256(xor0, work_reg_lo_0);
+            _mm256_storeu_si256(xor0 + 1, work_reg_hi_0);
+            _mm256_storeu_si256(xor1, work_reg_lo_1);
+            _mm256_storeu_si256(xor1 + 1, work_reg_hi_1);
+            _mm256_storeu_si256(xor2, work_reg_lo_2);
+            _mm256_storeu_si256(xor2 + 1, work_reg_hi_2);
+            _mm256_storeu_si256(xor3, work_reg_lo_3);
+            _mm256_storeu_si256(xor3 + 1, work_reg_hi_3);
+
+            work0 += 2, work1 += 2, work2 += 2, work3 += 2;
+            xor0 += 2, xor1 += 2, xor2 += 2, xor3 += 2;
+
+            piece_bytes -= 64;
+        } while (piece_bytes > 0);
     }
+}
 
 #endif // TRY_AVX2
 
-    if (CpuHasSSSE3)
+template<unsigned kTrivial>
+static TARGET_SSSE3 void IFFT_DIT4_xor_ssse3(
+    uint64_t bytes,
+    void** work_in,
+    void** xor_out,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    MUL_TABLES_128(01, log_m01);
+    MUL_TABLES_128(23, log_m23);
+    MUL_TABLES_128(02, log_m02);
+
+    const M128 clr_mask = _mm_set1_epi8(0x0f);
+
+    for (unsigned i = 0; i < count; ++i)
     {
-        MUL_TABLES_128(01, log_m01);
-        MUL_TABLES_128(23, log_m23);
-        MUL_TABLES_128(02, log_m02);
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+        {
+            PrefetchButterfly(work_in + i + 1, dist, 4);
+            PrefetchButterfly(xor_out + i + 1, dist, 4);
+        }
+#endif // PREFETCH_NEXT_OPT
 
-        const M128 clr_mask = _mm_set1_epi8(0x0f);
+        const M128 * RESTRICT work0 = reinterpret_cast<const M128 *>(work_in[i]);
+        const M128 * RESTRICT work1 = reinterpret_cast<const M128 *>(work_in[i + dist]);
+        const M128 * RESTRICT work2 = reinterpret_cast<const M128 *>(work_in[i + dist * 2]);
+        const M128 * RESTRICT work3 = reinterpret_cast<const M128 *>(work_in[i + dist * 3]);
+        M128 * RESTRICT xor0 = reinterpret_cast<M128 *>(xor_out[i]);
+        M128 * RESTRICT xor1 = reinterpret_cast<M128 *>(xor_out[i + dist]);
+        M128 * RESTRICT xor2 = reinterpret_cast<M128 *>(xor_out[i + dist * 2]);
+        M128 * RESTRICT xor3 = reinterpret_cast<M128 *>(xor_out[i + dist * 3]);
 
-        M128 * RESTRICT work0 = reinterpret_cast<M128 *>(work[0]);
-        M128 * RESTRICT work1 = reinterpret_cast<M128 *>(work[dist]);
-        M128 * RESTRICT work2 = reinterpret_cast<M128 *>(work[dist * 2]);
-        M128 * RESTRICT work3 = reinterpret_cast<M128 *>(work[dist * 3]);
+        uint64_t piece_bytes = bytes;
 
         do
         {
@@ -1231,125 +2932,1869 @@ static void FFT_DIT4(
                 M128 work_reg_hi_0 = _mm_loadu_si128(work0 + 2);
                 M128 work_reg_lo_1 = _mm_loadu_si128(work1);
                 M128 work_reg_hi_1 = _mm_loadu_si128(work1 + 2);
+
+                // First layer:
+                work_reg_lo_1 = _mm_xor_si128(work_reg_lo_0, work_reg_lo_1);
+                work_reg_hi_1 = _mm_xor_si128(work_reg_hi_0, work_reg_hi_1);
+                if (!(kTrivial & kTrivial01))
+                    MULADD_128(work_reg_lo_0, work_reg_hi_0, work_reg_lo_1, work_reg_hi_1, 01);
+
                 M128 work_reg_lo_2 = _mm_loadu_si128(work2);
                 M128 work_reg_hi_2 = _mm_loadu_si128(work2 + 2);
                 M128 work_reg_lo_3 = _mm_loadu_si128(work3);
                 M128 work_reg_hi_3 = _mm_loadu_si128(work3 + 2);
 
-                // First layer:
-                if (log_m02 != kModulus)
-                {
-                    MULADD_128(work_reg_lo_0, work_reg_hi_0, work_reg_lo_2, work_reg_hi_2, 02);
-                    MULADD_128(work_reg_lo_1, work_reg_hi_1, work_reg_lo_3, work_reg_hi_3, 02);
-                }
+                work_reg_lo_3 = _mm_xor_si128(work_reg_lo_2, work_reg_lo_3);
+                work_reg_hi_3 = _mm_xor_si128(work_reg_hi_2, work_reg_hi_3);
+                if (!(kTrivial & kTrivial23))
+                    MULADD_128(work_reg_lo_2, work_reg_hi_2, work_reg_lo_3, work_reg_hi_3, 23);
+
+                // Second layer:
                 work_reg_lo_2 = _mm_xor_si128(work_reg_lo_0, work_reg_lo_2);
                 work_reg_hi_2 = _mm_xor_si128(work_reg_hi_0, work_reg_hi_2);
                 work_reg_lo_3 = _mm_xor_si128(work_reg_lo_1, work_reg_lo_3);
                 work_reg_hi_3 = _mm_xor_si128(work_reg_hi_1, work_reg_hi_3);
+                if (!(kTrivial & kTrivial02))
+                {
+                    MULADD_128(work_reg_lo_0, work_reg_hi_0, work_reg_lo_2, work_reg_hi_2, 02);
+                    MULADD_128(work_reg_lo_1, work_reg_hi_1, work_reg_lo_3, work_reg_hi_3, 02);
+                }
 
-                // Second layer:
-                if (log_m01 != kModulus)
-                    MULADD_128(work_reg_lo_0, work_reg_hi_0, work_reg_lo_1, work_reg_hi_1, 01);
-                work_reg_lo_1 = _mm_xor_si128(work_reg_lo_0, work_reg_lo_1);
-                work_reg_hi_1 = _mm_xor_si128(work_reg_hi_0, work_reg_hi_1);
-
-                _mm_storeu_si128(work0, work_reg_lo_0);
-                _mm_storeu_si128(work0 + 2, work_reg_hi_0);
-                _mm_storeu_si128(work1, work_reg_lo_1);
-                _mm_storeu_si128(work1 + 2, work_reg_hi_1);
-
-                if (log_m23 != kModulus)
-                    MULADD_128(work_reg_lo_2, work_reg_hi_2, work_reg_lo_3, work_reg_hi_3, 23);
-                work_reg_lo_3 = _mm_xor_si128(work_reg_lo_2, work_reg_lo_3);
-                work_reg_hi_3 = _mm_xor_si128(work_reg_hi_2, work_reg_hi_3);
-
-                _mm_storeu_si128(work2, work_reg_lo_2);
-                _mm_storeu_si128(work2 + 2, work_reg_hi_2);
-                _mm_storeu_si128(work3, work_reg_lo_3);
-                _mm_storeu_si128(work3 + 2, work_reg_hi_3);
+                work_reg_lo_0 = _mm_xor_si128(work_reg_lo_0, _mm_loadu_si128(xor0));
+                work_reg_hi_0 = _mm_xor_si128(work_reg_hi_0, _mm_loadu_si128(xor0 + 2));
+                work_reg_lo_1 = _mm_xor_si128(work_reg_lo_1, _mm_loadu_si128(xor1));
+                work_reg_hi_1 = _mm_xor_si128(work_reg_hi_1, _mm_loadu_si128(xor1 + 2));
+                work_reg_lo_2 = _mm_xor_si128(work_reg_lo_2, _mm_loadu_si128(xor2));
+                work_reg_hi_2 = _mm_xor_si128(work_reg_hi_2, _mm_loadu_si128(xor2 + 2));
+                work_reg_lo_3 = _mm_xor_si128(work_reg_lo_3, _mm_loadu_si128(xor3));
+                work_reg_hi_3 = _mm_xor_si128(work_reg_hi_3, _mm_loadu_si128(xor3 + 2));
+
+                _mm_storeu_si128(xor0, work_reg_lo_0);
+                _mm_storeu_si128(xor0 + 2, work_reg_hi_0);
+                _mm_storeu_si128(xor1, work_reg_lo_1);
+                _mm_storeu_si128(xor1 + 2, work_reg_hi_1);
+                _mm_storeu_si128(xor2, work_reg_lo_2);
+                _mm_storeu_si128(xor2 + 2, work_reg_hi_2);
+                _mm_storeu_si128(xor3, work_reg_lo_3);
+                _mm_storeu_si128(xor3 + 2, work_reg_hi_3);
 
                 work0++, work1++, work2++, work3++;
+                xor0++, xor1++, xor2++, xor3++;
             }
 
             work0 += 2, work1 += 2, work2 += 2, work3 += 2;
-            bytes -= 64;
-        } while (bytes > 0);
-
-        return;
+            xor0 += 2, xor1 += 2, xor2 += 2, xor3 += 2;
+            piece_bytes -= 64;
+        } while (piece_bytes > 0);
     }
+}
 
 #endif // INTERLEAVE_BUTTERFLY4_OPT
 
-    // First layer:
-    if (log_m02 == kModulus)
-    {
-        xor_mem(work[dist * 2], work[0], bytes);
-        xor_mem(work[dist * 3], work[dist], bytes);
-    }
-    else
+static void IFFT_DIT4_xor_ref(
+    uint64_t bytes,
+    void** work_in,
+    void** xor_out,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    for (unsigned i = 0; i < count; ++i)
     {
-        FFT_DIT2(work[0], work[dist * 2], log_m02, bytes);
-        FFT_DIT2(work[dist], work[dist * 3], log_m02, bytes);
-    }
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+        {
+            PrefetchButterfly(work_in + i + 1, dist, 4);
+            PrefetchButterfly(xor_out + i + 1, dist, 4);
+        }
+#endif // PREFETCH_NEXT_OPT
+
+        // First layer:
+        if (log_m01 == kModulus)
+            xor_mem(work_in[i + dist], work_in[i], bytes);
+        else
+            IFFT_DIT2(work_in[i], work_in[i + dist], log_m01, bytes);
+
+        if (log_m23 == kModulus)
+            xor_mem(work_in[i + dist * 3], work_in[i + dist * 2], bytes);
+        else
+            IFFT_DIT2(work_in[i + dist * 2], work_in[i + dist * 3], log_m23, bytes);
 
-    // Second layer:
-    if (log_m01 == kModulus)
-        xor_mem(work[dist], work[0], bytes);
-    else
-        FFT_DIT2(work[0], work[dist], log_m01, bytes);
+        // Second layer:
+        if (log_m02 == kModulus)
+        {
+            xor_mem(work_in[i + dist * 2], work_in[i], bytes);
+            xor_mem(work_in[i + dist * 3], work_in[i + dist], bytes);
+        }
+        else
+        {
+            IFFT_DIT2(work_in[i], work_in[i + dist * 2], log_m02, bytes);
+            IFFT_DIT2(work_in[i + dist], work_in[i + dist * 3], log_m02, bytes);
+        }
 
-    if (log_m23 == kModulus)
-        xor_mem(work[dist * 3], work[dist * 2], bytes);
-    else
-        FFT_DIT2(work[dist * 2], work[dist * 3], log_m23, bytes);
+        xor_mem(xor_out[i], work_in[i], bytes);
+        xor_mem(xor_out[i + dist], work_in[i + dist], bytes);
+        xor_mem(xor_out[i + dist * 2], work_in[i + dist * 2], bytes);
+        xor_mem(xor_out[i + dist * 3], work_in[i + dist * 3], bytes);
+    }
 }
 
 
-// In-place FFT for encoder and decoder
-static void FFT_DIT(
+// Unrolled IFFT for encoder
+static void IFFT_DIT_Encoder(
     const uint64_t bytes,
-    void** work,
+    const void* const* data,
     const unsigned m_truncated,
+    void** work,
+    void** xor_result,
     const unsigned m,
     const ffe_t* skewLUT)
 {
+    // I tried rolling the memcpy/memset into the first layer of the FFT and
+    // found that it only yields a 4% performance improvement, which is not
+    // worth the extra complexity.
+    ParallelFor(m_truncated, [&](unsigned i) {
+        memcpy(work[i], data[i], bytes);
+    });
+    ParallelFor(m - m_truncated, [&](unsigned i) {
+        memset(work[m_truncated + i], 0, bytes);
+    });
+
+    // I tried splitting up the first few layers into L3-cache sized blocks but
+    // found that it only provides about 5% performance boost, which is not
+    // worth the extra complexity.
+
+    unsigned dist = 1;
+
+#ifdef INTERLEAVE_BUTTERFLY8_OPT
+    // Decimation in time: Unroll 3 layers at a time while 8-way butterflies
+    // are available, leaving the remaining layers to the loop below.  The
+    // final layers are left to the 4-way or 2-way xor butterflies, which also
+    // accumulate into xor_result
+    for (unsigned dist8 = 8; IFFT_DIT8 && dist8 <= m && !(xor_result && dist8 == m); dist = dist8, dist8 <<= 3)
+    {
+        // For each set of dist*8 elements:
+        ParallelForSpans((m_truncated + dist8 - 1) / dist8, dist8, dist, [&](unsigned r, unsigned i_begin, unsigned count) {
+            const unsigned i_end = r + dist;
+            const ffe_t log_m01 = skewLUT[i_end - 1];
+            const ffe_t log_m02 = skewLUT[i_end + dist - 1];
+            const ffe_t log_m23 = skewLUT[i_end + dist * 2 - 1];
+            const ffe_t log_m04 = skewLUT[i_end + dist * 3 - 1];
+            const ffe_t log_m45 = skewLUT[i_end + dist * 4 - 1];
+            const ffe_t log_m46 = skewLUT[i_end + dist * 5 - 1];
+            const ffe_t log_m67 = skewLUT[i_end + dist * 6 - 1];
+
+            // For each set of dist elements in this chunk:
+            IFFT_DIT8(
+                bytes,
+                work + i_begin,
+                dist,
+                count,
+                log_m01,
+                log_m23,
+                log_m45,
+                log_m67,
+                log_m02,
+                log_m46,
+                log_m04);
+        });
+    }
+#endif // INTERLEAVE_BUTTERFLY8_OPT
+
     // Decimation in time: Unroll 2 layers at a time
-    unsigned dist4 = m, dist = m >> 2;
-    for (; dist != 0; dist4 = dist, dist >>= 2)
+    unsigned dist4 = dist * 4;
+    for (; dist4 <= m; dist = dist4, dist4 <<= 2)
     {
         // For each set of dist*4 elements:
-#pragma omp parallel for
-        for (int r = 0; r < (int)m_truncated; r += dist4)
-        {
+        ParallelForSpans((m_truncated + dist4 - 1) / dist4, dist4, dist, [&](unsigned r, unsigned i_begin, unsigned count) {
             const unsigned i_end = r + dist;
-            const ffe_t log_m01 = skewLUT[i_end];
-            const ffe_t log_m02 = skewLUT[i_end + dist];
-            const ffe_t log_m23 = skewLUT[i_end + dist * 2];
+            const ffe_t log_m01 = skewLUT[i_end - 1];
+            const ffe_t log_m02 = skewLUT[i_end + dist - 1];
+            const ffe_t log_m23 = skewLUT[i_end + dist * 2 - 1];
+            const unsigned trivial = TrivialSkews4(log_m01, log_m23, log_m02);
 
-            // For each set of dist elements:
-            for (int i = r; i < (int)i_end; ++i)
+            if (dist4 == m && xor_result)
             {
-                FFT_DIT4(
+                // For each set of dist elements in this chunk:
+                IFFT_DIT4_xor[trivial](
                     bytes,
-                    work + i,
+                    work + i_begin,
+                    xor_result + i_begin,
                     dist,
+                    count,
                     log_m01,
                     log_m23,
                     log_m02);
             }
-        }
+            else
+            {
+                // For each set of dist elements in this chunk:
+                IFFT_DIT4[trivial](
+                    bytes,
+                    work + i_begin,
+                    dist,
+                    count,
+                    log_m01,
+                    log_m23,
+                    log_m02);
+            }
+        });
+
+        // I tried alternating sweeps left->right and right->left to reduce cache misses.
+        // It provides about 1% performance boost when done for both FFT and IFFT, so it
+        // does not seem to be worth the extra complexity.
     }
 
     // If there is one layer left:
-    if (dist4 == 2)
+    if (dist < m)
     {
-#pragma omp parallel for
-        for (int r = 0; r < (int)m_truncated; r += 2)
-        {
-            const ffe_t log_m = skewLUT[r + 1];
+        // Assuming that dist = m / 2
+        DEBUG_ASSERT(dist * 2 == m);
+
+        const ffe_t log_m = skewLUT[dist - 1];
 
+        if (xor_result)
+        {
             if (log_m == kModulus)
-                xor_mem(work[r + 1], work[r], bytes);
+            {
+                ParallelFor(dist, [&](unsigned i) {
+                    xor_mem_2to1(xor_result[i + dist], work[i], work[i + dist], bytes);
+                    xor_mem(xor_result[i], work[i], bytes);
+                });
+            }
+            else
+            {
+                ParallelFor(dist, [&](unsigned i) {
+#ifdef PREFETCH_NEXT_OPT
+                    if (i + 1 < dist)
+                    {
+                        PrefetchButterfly(work + i + 1, dist, 2);
+                        PrefetchButterfly(xor_result + i + 1, dist, 2);
+                    }
+#endif // PREFETCH_NEXT_OPT
+                    IFFT_DIT2_xor(
+                        work[i],
+                        work[i + dist],
+                        xor_result[i],
+                        xor_result[i + dist],
+                        log_m,
+                        bytes);
+                });
+            }
+        }
+        else
+        {
+            if (log_m == kModulus)
+                VectorXOR_Threads(bytes, dist, work + dist, work);
+            else
+            {
+                ParallelFor(dist, [&](unsigned i) {
+#ifdef PREFETCH_NEXT_OPT
+                    if (i + 1 < dist)
+                        PrefetchButterfly(work + i + 1, dist, 2);
+#endif // PREFETCH_NEXT_OPT
+                    IFFT_DIT2(
+                        work[i],
+                        work[i + dist],
+                        log_m,
+                        bytes);
+                });
+            }
+        }
+    }
+}
+
+
+// Basic no-frills version for decoder
+static void IFFT_DIT_Decoder(
+    const uint64_t bytes,
+    const unsigned m_truncated,
+    void** work,
+    const unsigned m,
+    const ffe_t* skewLUT)
+{
+    unsigned dist = 1;
+
+#ifdef INTERLEAVE_BUTTERFLY8_OPT
+    // Decimation in time: Unroll 3 layers at a time while 8-way butterflies
+    // are available, leaving the remaining layers to the loop below
+    for (unsigned dist8 = 8; IFFT_DIT8 && dist8 <= m; dist = dist8, dist8 <<= 3)
+    {
+        // For each set of dist*8 elements:
+        ParallelForSpans((m_truncated + dist8 - 1) / dist8, dist8, dist, [&](unsigned r, unsigned i_begin, unsigned count) {
+            const unsigned i_end = r + dist;
+            const ffe_t log_m01 = skewLUT[i_end - 1];
+            const ffe_t log_m02 = skewLUT[i_end + dist - 1];
+            const ffe_t log_m23 = skewLUT[i_end + dist * 2 - 1];
+            const ffe_t log_m04 = skewLUT[i_end + dist * 3 - 1];
+            const ffe_t log_m45 = skewLUT[i_end + dist * 4 - 1];
+            const ffe_t log_m46 = skewLUT[i_end + dist * 5 - 1];
+            const ffe_t log_m67 = skewLUT[i_end + dist * 6 - 1];
+
+            // For each set of dist elements in this chunk:
+            IFFT_DIT8(
+                bytes,
+                work + i_begin,
+                dist,
+                count,
+                log_m01,
+                log_m23,
+                log_m45,
+                log_m67,
+                log_m02,
+                log_m46,
+                log_m04);
+        });
+    }
+#endif // INTERLEAVE_BUTTERFLY8_OPT
+
+    // Decimation in time: Unroll 2 layers at a time
+    unsigned dist4 = dist * 4;
+    for (; dist4 <= m; dist = dist4, dist4 <<= 2)
+    {
+        // For each set of dist*4 elements:
+        ParallelForSpans((m_truncated + dist4 - 1) / dist4, dist4, dist, [&](unsigned r, unsigned i_begin, unsigned count) {
+            const unsigned i_end = r + dist;
+            const ffe_t log_m01 = skewLUT[i_end - 1];
+            const ffe_t log_m02 = skewLUT[i_end + dist - 1];
+            const ffe_t log_m23 = skewLUT[i_end + dist * 2 - 1];
+            const unsigned trivial = TrivialSkews4(log_m01, log_m23, log_m02);
+
+            // For each set of dist elements in this chunk:
+            IFFT_DIT4[trivial](
+                bytes,
+                work + i_begin,
+                dist,
+                count,
+                log_m01,
+                log_m23,
+                log_m02);
+        });
+    }
+
+    // If there is one layer left:
+    if (dist < m)
+    {
+        // Assuming that dist = m / 2
+        DEBUG_ASSERT(dist * 2 == m);
+
+        const ffe_t log_m = skewLUT[dist - 1];
+
+        if (log_m == kModulus)
+            VectorXOR_Threads(bytes, dist, work + dist, work);
+        else
+        {
+            ParallelFor(dist, [&](unsigned i) {
+#ifdef PREFETCH_NEXT_OPT
+                if (i + 1 < dist)
+                    PrefetchButterfly(work + i + 1, dist, 2);
+#endif // PREFETCH_NEXT_OPT
+                IFFT_DIT2(
+                    work[i],
+                    work[i + dist],
+                    log_m,
+                    bytes);
+            });
+        }
+    }
+}
+
+/*
+    Decimation in time FFT:
+
+    The decimation in time FFT algorithm allows us to unroll 2 layers at a time,
+    performing calculations on local registers and faster cache memory.
+
+    Each ^___^ below indicates a butterfly between the associated indices.
+
+    The fft_butterfly(x, y) operation:
+
+        if (log_m != kModulus)
+            x[] ^= exp(log(y[]) + log_m)
+        y[] ^= x[]
+
+    Layer 0:
+        0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7
+        ^_______________^
+          ^_______________^
+            ^_______________^
+              ^_______________^
+                ^_______________^
+                  ^_______________^
+                    ^_______________^
+                      ^_______________^
+
+    Layer 1:
+        0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 
+        ^_______^       ^_______^
+          ^_______^       ^_______^
+            ^_______^       ^_______^
+              ^_______^       ^_______^
+  
+    Layer 2:
+        0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7
+        ^___^   ^___^   ^___^   ^___^
+          ^___^   ^___^   ^___^   ^___^
+
+    Layer 3:
+        0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7
+        ^_^ ^_^ ^_^ ^_^ ^_^ ^_^ ^_^ ^_^
+
+    DIT layer 0-1 operations, grouped 4 at a time:
+        {0-0', 4-4', 0-4, 0'-4'},
+        {1-1', 5-5', 1-5, 1'-5'},
+
+    DIT layer 1-2 operations, grouped 4 at a time:
+        {0-4, 2-6, 0-2, 4-6},
+        {1-5, 3-7, 1-3, 5-7},
+
+    DIT layer 2-3 operations, grouped 4 at a time:
+        {0-2, 1-3, 0-1, 2-3},
+        {4-6, 5-7, 4-5, 6-7},
+*/
+
+// 2-way butterfly
+static void (*FFT_DIT2)(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes);
+
+// FFT_DIT2() writing with streaming stores, for the last layer of the encoder
+static void (*FFT_DIT2_stream)(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes);
+
+#if defined(TRY_CLMUL)
+
+static TARGET_CLMUL void FFT_DIT2_clmul(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    CarrylessMultiplier mul;
+    LoadCarrylessMultiplier(mul, log_m);
+
+    M128 * RESTRICT x16 = reinterpret_cast<M128 *>(x);
+    M128 * RESTRICT y16 = reinterpret_cast<M128 *>(y);
+
+    do
+    {
+        for (unsigned i = 0; i < 2; ++i)
+        {
+            const M128 y_lo = _mm_loadu_si128(y16 + i);
+            const M128 y_hi = _mm_loadu_si128(y16 + i + 2);
+            M128 prod_lo = y_lo, prod_hi = y_hi;
+            MulCarryless(mul, prod_lo, prod_hi);
+            const M128 x_lo = _mm_xor_si128(_mm_loadu_si128(x16 + i), prod_lo);
+            const M128 x_hi = _mm_xor_si128(_mm_loadu_si128(x16 + i + 2), prod_hi);
+            _mm_storeu_si128(x16 + i, x_lo);
+            _mm_storeu_si128(x16 + i + 2, x_hi);
+            _mm_storeu_si128(y16 + i, _mm_xor_si128(y_lo, x_lo));
+            _mm_storeu_si128(y16 + i + 2, _mm_xor_si128(y_hi, x_hi));
+        }
+        x16 += 4, y16 += 4;
+
+        bytes -= 64;
+    } while (bytes > 0);
+}
+
+#endif // TRY_CLMUL
+
+#if defined(TRY_AVX512) && defined(TRY_GFNI)
+
+template<bool kStream = false>
+static TARGET_AVX512_GFNI void FFT_DIT2_avx512_gfni(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    MUL_TABLES_GFNI_512(0, log_m);
+
+    M512 * RESTRICT x64 = reinterpret_cast<M512 *>(x);
+    M512 * RESTRICT y64 = reinterpret_cast<M512 *>(y);
+
+    do
+    {
+        M512 x_reg = _mm512_loadu_si512(x64);
+        M512 y_reg = _mm512_loadu_si512(y64);
+        MULADD_GFNI_512(x_reg, y_reg, 0);
+        STORE_512(kStream, x64, x_reg);
+        y_reg = _mm512_xor_si512(y_reg, x_reg);
+        STORE_512(kStream, y64, y_reg);
+        y64++, x64++;
+
+        bytes -= 64;
+    } while (bytes > 0);
+
+    if (kStream)
+        _mm_sfence();
+}
+
+#endif // TRY_AVX512 && TRY_GFNI
+
+#if defined(TRY_GFNI)
+
+template<bool kStream = false>
+static TARGET_GFNI void FFT_DIT2_gfni(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    MUL_TABLES_GFNI_256(0, log_m);
+
+    M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
+    M256 * RESTRICT y32 = reinterpret_cast<M256 *>(y);
+
+    do
+    {
+#define FFTB_GFNI_256(x_ptr, y_ptr) { \
+        M256 x_lo = _mm256_loadu_si256(x_ptr); \
+        M256 x_hi = _mm256_loadu_si256(x_ptr + 1); \
+        M256 y_lo = _mm256_loadu_si256(y_ptr); \
+        M256 y_hi = _mm256_loadu_si256(y_ptr + 1); \
+        MULADD_GFNI_256(x_lo, x_hi, y_lo, y_hi, 0); \
+        STORE_256(kStream, x_ptr, x_lo); \
+        STORE_256(kStream, x_ptr + 1, x_hi); \
+        y_lo = _mm256_xor_si256(y_lo, x_lo); \
+        y_hi = _mm256_xor_si256(y_hi, x_hi); \
+        STORE_256(kStream, y_ptr, y_lo); \
+        STORE_256(kStream, y_ptr + 1, y_hi); }
+
+        FFTB_GFNI_256(x32, y32);
+        y32 += 2, x32 += 2;
+
+        bytes -= 64;
+    } while (bytes > 0);
+
+    if (kStream)
+        _mm_sfence();
+}
+
+#endif // TRY_GFNI
+
+#if defined(TRY_AVX512)
+
+template<bool kStream = false>
+static TARGET_AVX512 void FFT_DIT2_avx512(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    MUL_TABLES_512(0, log_m);
+
+    const M512 clr_mask = _mm512_set1_epi8(0x0f);
+
+    M512 * RESTRICT x64 = reinterpret_cast<M512 *>(x);
+    M512 * RESTRICT y64 = reinterpret_cast<M512 *>(y);
+
+    do
+    {
+        M512 x_reg = _mm512_loadu_si512(x64);
+        M512 y_reg = _mm512_loadu_si512(y64);
+        MULADD_512(x_reg, y_reg, 0);
+        STORE_512(kStream, x64, x_reg);
+        y_reg = _mm512_xor_si512(y_reg, x_reg);
+        STORE_512(kStream, y64, y_reg);
+        y64++, x64++;
+
+        bytes -= 64;
+    } while (bytes > 0);
+
+    if (kStream)
+        _mm_sfence();
+}
+
+#endif // TRY_AVX512
+
+#if defined(TRY_AVX2)
+
+template<bool kStream = false>
+static TARGET_AVX2 void FFT_DIT2_avx2(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    MUL_TABLES_256(0, log_m);
+
+    const M256 clr_mask = _mm256_set1_epi8(0x0f);
+
+    M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
+    M256 * RESTRICT y32 = reinterpret_cast<M256 *>(y);
+
+    do
+    {
+#define FFTB_256(x_ptr, y_ptr) { \
+        M256 x_lo = _mm256_loadu_si256(x_ptr); \
+        M256 x_hi = _mm256_loadu_si256(x_ptr + 1); \
+        M256 y_lo = _mm256_loadu_si256(y_ptr); \
+        M256 y_hi = _mm256_loadu_si256(y_ptr + 1); \
+        MULADD_256(x_lo, x_hi, y_lo, y_hi, 0); \
+        STORE_256(kStream, x_ptr, x_lo); \
+        STORE_256(kStream, x_ptr + 1, x_hi); \
+        y_lo = _mm256_xor_si256(y_lo, x_lo); \
+        y_hi = _mm256_xor_si256(y_hi, x_hi); \
+        STORE_256(kStream, y_ptr, y_lo); \
+        STORE_256(kStream, y_ptr + 1, y_hi); }
+
+        FFTB_256(x32, y32);
+        y32 += 2, x32 += 2;
+
+        bytes -= 64;
+    } while (bytes > 0);
+
+    if (kStream)
+        _mm_sfence();
+}
+
+#endif // TRY_AVX2
+
+static TARGET_SSSE3 void FFT_DIT2_ssse3(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    MUL_TABLES_128(0, log_m);
+
+    const M128 clr_mask = _mm_set1_epi8(0x0f);
+
+    M128 * RESTRICT x16 = reinterpret_cast<M128 *>(x);
+    M128 * RESTRICT y16 = reinterpret_cast<M128 *>(y);
+
+    do
+    {
+#define FFTB_128(x_ptr, y_ptr) { \
+            M128 x_lo = _mm_loadu_si128(x_ptr); \
+            M128 x_hi = _mm_loadu_si128(x_ptr + 2); \
+            M128 y_lo = _mm_loadu_si128(y_ptr); \
+            M128 y_hi = _mm_loadu_si128(y_ptr + 2); \
+            MULADD_128(x_lo, x_hi, y_lo, y_hi, 0); \
+            _mm_storeu_si128(x_ptr, x_lo); \
+            _mm_storeu_si128(x_ptr + 2, x_hi); \
+            y_lo = _mm_xor_si128(y_lo, x_lo); \
+            y_hi = _mm_xor_si128(y_hi, x_hi); \
+            _mm_storeu_si128(y_ptr, y_lo); \
+            _mm_storeu_si128(y_ptr + 2, y_hi); }
+
+        FFTB_128(x16 + 1, y16 + 1);
+        FFTB_128(x16, y16);
+        x16 += 4, y16 += 4;
+
+        bytes -= 64;
+    } while (bytes > 0);
+}
+
+static void FFT_DIT2_ref(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    RefMulAdd(x, y, log_m, bytes);
+    xor_mem(y, x, bytes);
+}
+
+
+// 4-way butterfly over the same span of count pieces as IFFT_DIT4(), indexed
+// by TrivialSkews4()
+static void (*FFT_DIT4[8])(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02);
+
+// FFT_DIT4() writing with streaming stores, for the last layer of the encoder
+static void (*FFT_DIT4_stream[8])(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02);
+
+#ifdef INTERLEAVE_BUTTERFLY4_OPT
+
+#if defined(TRY_AVX512) && defined(TRY_GFNI)
+
+template<unsigned kTrivial, bool kStream = false>
+static TARGET_AVX512_GFNI void FFT_DIT4_avx512_gfni(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    MUL_TABLES_GFNI_512(01, log_m01);
+    MUL_TABLES_GFNI_512(23, log_m23);
+    MUL_TABLES_GFNI_512(02, log_m02);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
+
+        M512 * RESTRICT work0 = reinterpret_cast<M512 *>(work[i]);
+        M512 * RESTRICT work1 = reinterpret_cast<M512 *>(work[i + dist]);
+        M512 * RESTRICT work2 = reinterpret_cast<M512 *>(work[i + dist * 2]);
+        M512 * RESTRICT work3 = reinterpret_cast<M512 *>(work[i + dist * 3]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            M512 work_reg_0 = _mm512_loadu_si512(work0);
+            M512 work_reg_1 = _mm512_loadu_si512(work1);
+            M512 work_reg_2 = _mm512_loadu_si512(work2);
+            M512 work_reg_3 = _mm512_loadu_si512(work3);
+
+            // First layer:
+            if (!(kTrivial & kTrivial02))
+            {
+                MULADD_GFNI_512(work_reg_0, work_reg_2, 02);
+                MULADD_GFNI_512(work_reg_1, work_reg_3, 02);
+            }
+            work_reg_2 = _mm512_xor_si512(work_reg_0, work_reg_2);
+            work_reg_3 = _mm512_xor_si512(work_reg_1, work_reg_3);
+
+            // Second layer:
+            if (!(kTrivial & kTrivial01))
+                MULADD_GFNI_512(work_reg_0, work_reg_1, 01);
+            work_reg_1 = _mm512_xor_si512(work_reg_0, work_reg_1);
+
+            STORE_512(kStream, work0, work_reg_0);
+            STORE_512(kStream, work1, work_reg_1);
+
+            if (!(kTrivial & kTrivial23))
+                MULADD_GFNI_512(work_reg_2, work_reg_3, 23);
+            work_reg_3 = _mm512_xor_si512(work_reg_2, work_reg_3);
+
+            STORE_512(kStream, work2, work_reg_2);
+            STORE_512(kStream, work3, work_reg_3);
+
+            work0++, work1++, work2++, work3++;
+
+            piece_bytes -= 64;
+        } while (piece_bytes > 0);
+    }
+
+    if (kStream)
+        _mm_sfence();
+}
+
+#endif // TRY_AVX512 && TRY_GFNI
+
+#if defined(TRY_GFNI)
+
+template<unsigned kTrivial, bool kStream = false>
+static TARGET_GFNI void FFT_DIT4_gfni(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    MUL_TABLES_GFNI_256(01, log_m01);
+    MUL_TABLES_GFNI_256(23, log_m23);
+    MUL_TABLES_GFNI_256(02, log_m02);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
+
+        M256 * RESTRICT work0 = reinterpret_cast<M256 *>(work[i]);
+        M256 * RESTRICT work1 = reinterpret_cast<M256 *>(work[i + dist]);
+        M256 * RESTRICT work2 = reinterpret_cast<M256 *>(work[i + dist * 2]);
+        M256 * RESTRICT work3 = reinterpret_cast<M256 *>(work[i + dist * 3]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            M256 work_reg_lo_0 = _mm256_loadu_si256(work0);
+            M256 work_reg_hi_0 = _mm256_loadu_si256(work0 + 1);
+            M256 work_reg_lo_1 = _mm256_loadu_si256(work1);
+            M256 work_reg_hi_1 = _mm256_loadu_si256(work1 + 1);
+            M256 work_reg_lo_2 = _mm256_loadu_si256(work2);
+            M256 work_reg_hi_2 = _mm256_loadu_si256(work2 + 1);
+            M256 work_reg_lo_3 = _mm256_loadu_si256(work3);
+            M256 work_reg_hi_3 = _mm256_loadu_si256(work3 + 1);
+
+            // First layer:
+            if (!(kTrivial & kTrivial02))
+            {
+                MULADD_GFNI_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_2, work_reg_hi_2, 02);
+                MULADD_GFNI_256(work_reg_lo_1, work_reg_hi_1, work_reg_lo_3, work_reg_hi_3, 02);
+            }
+            work_reg_lo_2 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_2);
+            work_reg_hi_2 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_2);
+            work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_1, work_reg_lo_3);
+            work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_1, work_reg_hi_3);
+
+            // Second layer:
+            if (!(kTrivial & kTrivial01))
+                MULADD_GFNI_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_1, work_reg_hi_1, 01);
+            work_reg_lo_1 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_1);
+            work_reg_hi_1 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_1);
+
+            STORE_256(kStream, work0, work_reg_lo_0);
+            STORE_256(kStream, work0 + 1, work_reg_hi_0);
+            STORE_256(kStream, work1, work_reg_lo_1);
+            STORE_256(kStream, work1 + 1, work_reg_hi_1);
+
+            if (!(kTrivial & kTrivial23))
+                MULADD_GFNI_256(work_reg_lo_2, work_reg_hi_2, work_reg_lo_3, work_reg_hi_3, 23);
+            work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_2, work_reg_lo_3);
+            work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_2, work_reg_hi_3);
+
+            STORE_256(kStream, work2, work_reg_lo_2);
+            STORE_256(kStream, work2 + 1, work_reg_hi_2);
+            STORE_256(kStream, work3, work_reg_lo_3);
+            STORE_256(kStream, work3 + 1, work_reg_hi_3);
+
+            work0 += 2, work1 += 2, work2 += 2, work3 += 2;
+
+            piece_bytes -= 64;
+        } while (piece_bytes > 0);
+    }
+
+    if (kStream)
+        _mm_sfence();
+}
+
+#endif // TRY_GFNI
+
+#if defined(TRY_AVX512)
+
+template<unsigned kTrivial, bool kStream = false>
+static TARGET_AVX512 void FFT_DIT4_avx512(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    // All three tables stay resident in the 32 zmm registers
+    MUL_TABLES_512(01, log_m01);
+    MUL_TABLES_512(23, log_m23);
+    MUL_TABLES_512(02, log_m02);
+
+    const M512 clr_mask = _mm512_set1_epi8(0x0f);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
+
+        M512 * RESTRICT work0 = reinterpret_cast<M512 *>(work[i]);
+        M512 * RESTRICT work1 = reinterpret_cast<M512 *>(work[i + dist]);
+        M512 * RESTRICT work2 = reinterpret_cast<M512 *>(work[i + dist * 2]);
+        M512 * RESTRICT work3 = reinterpret_cast<M512 *>(work[i + dist * 3]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            M512 work_reg_0 = _mm512_loadu_si512(work0);
+            M512 work_reg_1 = _mm512_loadu_si512(work1);
+            M512 work_reg_2 = _mm512_loadu_si512(work2);
+            M512 work_reg_3 = _mm512_loadu_si512(work3);
+
+            // First layer:
+            if (!(kTrivial & kTrivial02))
+            {
+                MULADD_512(work_reg_0, work_reg_2, 02);
+                MULADD_512(work_reg_1, work_reg_3, 02);
+            }
+            work_reg_2 = _mm512_xor_si512(work_reg_0, work_reg_2);
+            work_reg_3 = _mm512_xor_si512(work_reg_1, work_reg_3);
+
+            // Second layer:
+            if (!(kTrivial & kTrivial01))
+                MULADD_512(work_reg_0, work_reg_1, 01);
+            work_reg_1 = _mm512_xor_si512(work_reg_0, work_reg_1);
+
+            STORE_512(kStream, work0, work_reg_0);
+            STORE_512(kStream, work1, work_reg_1);
+
+            if (!(kTrivial & kTrivial23))
+                MULADD_512(work_reg_2, work_reg_3, 23);
+            work_reg_3 = _mm512_xor_si512(work_reg_2, work_reg_3);
+
+            STORE_512(kStream, work2, work_reg_2);
+            STORE_512(kStream, work3, work_reg_3);
+
+            work0++, work1++, work2++, work3++;
+
+            piece_bytes -= 64;
+        } while (piece_bytes > 0);
+    }
+
+    if (kStream)
+        _mm_sfence();
+}
+
+#endif // TRY_AVX512
+
+#if defined(TRY_AVX2)
+
+template<unsigned kTrivial, bool kStream = false>
+static TARGET_AVX2 void FFT_DIT4_avx2(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    MUL_TABLES_256(01, log_m01);
+    MUL_TABLES_256(23, log_m23);
+    MUL_TABLES_256(02, log_m02);
+
+    const M256 clr_mask = _mm256_set1_epi8(0x0f);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
+
+        M256 * RESTRICT work0 = reinterpret_cast<M256 *>(work[i]);
+        M256 * RESTRICT work1 = reinterpret_cast<M256 *>(work[i + dist]);
+        M256 * RESTRICT work2 = reinterpret_cast<M256 *>(work[i + dist * 2]);
+        M256 * RESTRICT work3 = reinterpret_cast<M256 *>(work[i + dist * 3]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            M256 work_reg_lo_0 = _mm256_loadu_si256(work0);
+            M256 work_reg_hi_0 = _mm256_loadu_si256(work0 + 1);
+            M256 work_reg_lo_1 = _mm256_loadu_si256(work1);
+            M256 work_reg_hi_1 = _mm256_loadu_si256(work1 + 1);
+            M256 work_reg_lo_2 = _mm256_loadu_si256(work2);
+            M256 work_reg_hi_2 = _mm256_loadu_si256(work2 + 1);
+            M256 work_reg_lo_3 = _mm256_loadu_si256(work3);
+            M256 work_reg_hi_3 = _mm256_loadu_si256(work3 + 1);
+
+            // First layer:
+            if (!(kTrivial & kTrivial02))
+            {
+                MULADD_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_2, work_reg_hi_2, 02);
+                MULADD_256(work_reg_lo_1, work_reg_hi_1, work_reg_lo_3, work_reg_hi_3, 02);
+            }
+            work_reg_lo_2 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_2);
+            work_reg_hi_2 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_2);
+            work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_1, work_reg_lo_3);
+            work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_1, work_reg_hi_3);
+
+            // Second layer:
+            if (!(kTrivial & kTrivial01))
+                MULADD_256(work_reg_lo_0, work_reg_hi_0, work_reg_lo_1, work_reg_hi_1, 01);
+            work_reg_lo_1 = _mm256_xor_si256(work_reg_lo_0, work_reg_lo_1);
+            work_reg_hi_1 = _mm256_xor_si256(work_reg_hi_0, work_reg_hi_1);
+
+            STORE_256(kStream, work0, work_reg_lo_0);
+            STORE_256(kStream, work0 + 1, work_reg_hi_0);
+            STORE_256(kStream, work1, work_reg_lo_1);
+            STORE_256(kStream, work1 + 1, work_reg_hi_1);
+
+            if (!(kTrivial & kTrivial23))
+                MULADD_256(work_reg_lo_2, work_reg_hi_2, work_reg_lo_3, work_reg_hi_3, 23);
+            work_reg_lo_3 = _mm256_xor_si256(work_reg_lo_2, work_reg_lo_3);
+            work_reg_hi_3 = _mm256_xor_si256(work_reg_hi_2, work_reg_hi_3);
+
+            STORE_256(kStream, work2, work_reg_lo_2);
+            STORE_256(kStream, work2 + 1, work_reg_hi_2);
+            STORE_256(kStream, work3, work_reg_lo_3);
+            STORE_256(kStream, work3 + 1, work_reg_hi_3);
+
+            work0 += 2, work1 += 2, work2 += 2, work3 += 2;
+
+            piece_bytes -= 64;
+        } while (piece_bytes > 0);
+    }
+
+    if (kStream)
+        _mm_sfence();
+}
+
+#endif // TRY_AVX2
+
+template<unsigned kTrivial>
+static TARGET_SSSE3 void FFT_DIT4_ssse3(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    MUL_TABLES_128(01, log_m01);
+    MUL_TABLES_128(23, log_m23);
+    MUL_TABLES_128(02, log_m02);
+
+    const M128 clr_mask = _mm_set1_epi8(0x0f);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
+
+        M128 * RESTRICT work0 = reinterpret_cast<M128 *>(work[i]);
+        M128 * RESTRICT work1 = reinterpret_cast<M128 *>(work[i + dist]);
+        M128 * RESTRICT work2 = reinterpret_cast<M128 *>(work[i + dist * 2]);
+        M128 * RESTRICT work3 = reinterpret_cast<M128 *>(work[i + dist * 3]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            for (unsigned i = 0; i < 2; ++i)
+            {
+                M128 work_reg_lo_0 = _mm_loadu_si128(work0);
+                M128 work_reg_hi_0 = _mm_loadu_si128(work0 + 2);
+                M128 work_reg_lo_1 = _mm_loadu_si128(work1);
+                M128 work_reg_hi_1 = _mm_loadu_si128(work1 + 2);
+                M128 work_reg_lo_2 = _mm_loadu_si128(work2);
+                M128 work_reg_hi_2 = _mm_loadu_si128(work2 + 2);
+                M128 work_reg_lo_3 = _mm_loadu_si128(work3);
+                M128 work_reg_hi_3 = _mm_loadu_si128(work3 + 2);
+
+                // First layer:
+                if (!(kTrivial & kTrivial02))
+                {
+                    MULADD_128(work_reg_lo_0, work_reg_hi_0, work_reg_lo_2, work_reg_hi_2, 02);
+                    MULADD_128(work_reg_lo_1, work_reg_hi_1, work_reg_lo_3, work_reg_hi_3, 02);
+                }
+                work_reg_lo_2 = _mm_xor_si128(work_reg_lo_0, work_reg_lo_2);
+                work_reg_hi_2 = _mm_xor_si128(work_reg_hi_0, work_reg_hi_2);
+                work_reg_lo_3 = _mm_xor_si128(work_reg_lo_1, work_reg_lo_3);
+                work_reg_hi_3 = _mm_xor_si128(work_reg_hi_1, work_reg_hi_3);
+
+                // Second layer:
+                if (!(kTrivial & kTrivial01))
+                    MULADD_128(work_reg_lo_0, work_reg_hi_0, work_reg_lo_1, work_reg_hi_1, 01);
+                work_reg_lo_1 = _mm_xor_si128(work_reg_lo_0, work_reg_lo_1);
+                work_reg_hi_1 = _mm_xor_si128(work_reg_hi_0, work_reg_hi_1);
+
+                _mm_storeu_si128(work0, work_reg_lo_0);
+                _mm_storeu_si128(work0 + 2, work_reg_hi_0);
+                _mm_storeu_si128(work1, work_reg_lo_1);
+                _mm_storeu_si128(work1 + 2, work_reg_hi_1);
+
+                if (!(kTrivial & kTrivial23))
+                    MULADD_128(work_reg_lo_2, work_reg_hi_2, work_reg_lo_3, work_reg_hi_3, 23);
+                work_reg_lo_3 = _mm_xor_si128(work_reg_lo_2, work_reg_lo_3);
+                work_reg_hi_3 = _mm_xor_si128(work_reg_hi_2, work_reg_hi_3);
+
+                _mm_storeu_si128(work2, work_reg_lo_2);
+                _mm_storeu_si128(work2 + 2, work_reg_hi_2);
+                _mm_storeu_si128(work3, work_reg_lo_3);
+                _mm_storeu_si128(work3 + 2, work_reg_hi_3);
+
+                work0++, work1++, work2++, work3++;
+            }
+
+            work0 += 2, work1 += 2, work2 += 2, work3 += 2;
+            piece_bytes -= 64;
+        } while (piece_bytes > 0);
+    }
+}
+
+#endif // INTERLEAVE_BUTTERFLY4_OPT
+
+static void FFT_DIT4_ref(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
+
+        // First layer:
+        if (log_m02 == kModulus)
+        {
+            xor_mem(work[i + dist * 2], work[i], bytes);
+            xor_mem(work[i + dist * 3], work[i + dist], bytes);
+        }
+        else
+        {
+            FFT_DIT2(work[i], work[i + dist * 2], log_m02, bytes);
+            FFT_DIT2(work[i + dist], work[i + dist * 3], log_m02, bytes);
+        }
+
+        // Second layer:
+        if (log_m01 == kModulus)
+            xor_mem(work[i + dist], work[i], bytes);
+        else
+            FFT_DIT2(work[i], work[i + dist], log_m01, bytes);
+
+        if (log_m23 == kModulus)
+            xor_mem(work[i + dist * 3], work[i + dist * 2], bytes);
+        else
+            FFT_DIT2(work[i + dist * 2], work[i + dist * 3], log_m23, bytes);
+    }
+}
+
+
+// 8-way butterfly: Three layers over pieces {0, dist, ..., dist * 7} in
+// registers.  Left null when no SIMD version exists, in which case the layer
+// loops stick to 4-way butterflies rather than composing this from them.
+// Covers the same span of count pieces as IFFT_DIT8()
+static void (*FFT_DIT8)(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m45,
+    const ffe_t log_m67,
+    const ffe_t log_m02,
+    const ffe_t log_m46,
+    const ffe_t log_m04);
+
+// FFT_DIT8() writing with streaming stores, for the last layers of the encoder.
+// Null whenever FFT_DIT8 is
+static void (*FFT_DIT8_stream)(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m45,
+    const ffe_t log_m67,
+    const ffe_t log_m02,
+    const ffe_t log_m46,
+    const ffe_t log_m04);
+
+#ifdef INTERLEAVE_BUTTERFLY8_OPT
+
+#if defined(TRY_AVX512) && defined(TRY_GFNI)
+
+template<bool kStream = false>
+static TARGET_AVX512_GFNI void FFT_DIT8_avx512_gfni(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m45,
+    const ffe_t log_m67,
+    const ffe_t log_m02,
+    const ffe_t log_m46,
+    const ffe_t log_m04)
+{
+    MUL_TABLES_GFNI_512(01, log_m01);
+    MUL_TABLES_GFNI_512(23, log_m23);
+    MUL_TABLES_GFNI_512(45, log_m45);
+    MUL_TABLES_GFNI_512(67, log_m67);
+    MUL_TABLES_GFNI_512(02, log_m02);
+    MUL_TABLES_GFNI_512(46, log_m46);
+    MUL_TABLES_GFNI_512(04, log_m04);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 8);
+#endif // PREFETCH_NEXT_OPT
+
+        M512 * RESTRICT work0 = reinterpret_cast<M512 *>(work[i]);
+        M512 * RESTRICT work1 = reinterpret_cast<M512 *>(work[i + dist]);
+        M512 * RESTRICT work2 = reinterpret_cast<M512 *>(work[i + dist * 2]);
+        M512 * RESTRICT work3 = reinterpret_cast<M512 *>(work[i + dist * 3]);
+        M512 * RESTRICT work4 = reinterpret_cast<M512 *>(work[i + dist * 4]);
+        M512 * RESTRICT work5 = reinterpret_cast<M512 *>(work[i + dist * 5]);
+        M512 * RESTRICT work6 = reinterpret_cast<M512 *>(work[i + dist * 6]);
+        M512 * RESTRICT work7 = reinterpret_cast<M512 *>(work[i + dist * 7]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            M512 work_reg_0 = _mm512_loadu_si512(work0);
+            M512 work_reg_1 = _mm512_loadu_si512(work1);
+            M512 work_reg_2 = _mm512_loadu_si512(work2);
+            M512 work_reg_3 = _mm512_loadu_si512(work3);
+            M512 work_reg_4 = _mm512_loadu_si512(work4);
+            M512 work_reg_5 = _mm512_loadu_si512(work5);
+            M512 work_reg_6 = _mm512_loadu_si512(work6);
+            M512 work_reg_7 = _mm512_loadu_si512(work7);
+
+            // First layer:
+            if (log_m04 != kModulus)
+            {
+                MULADD_GFNI_512(work_reg_0, work_reg_4, 04);
+                MULADD_GFNI_512(work_reg_1, work_reg_5, 04);
+                MULADD_GFNI_512(work_reg_2, work_reg_6, 04);
+                MULADD_GFNI_512(work_reg_3, work_reg_7, 04);
+            }
+            work_reg_4 = _mm512_xor_si512(work_reg_0, work_reg_4);
+            work_reg_5 = _mm512_xor_si512(work_reg_1, work_reg_5);
+            work_reg_6 = _mm512_xor_si512(work_reg_2, work_reg_6);
+            work_reg_7 = _mm512_xor_si512(work_reg_3, work_reg_7);
+
+            // Second layer:
+            if (log_m02 != kModulus)
+            {
+                MULADD_GFNI_512(work_reg_0, work_reg_2, 02);
+                MULADD_GFNI_512(work_reg_1, work_reg_3, 02);
+            }
+            work_reg_2 = _mm512_xor_si512(work_reg_0, work_reg_2);
+            work_reg_3 = _mm512_xor_si512(work_reg_1, work_reg_3);
+            if (log_m46 != kModulus)
+            {
+                MULADD_GFNI_512(work_reg_4, work_reg_6, 46);
+                MULADD_GFNI_512(work_reg_5, work_reg_7, 46);
+            }
+            work_reg_6 = _mm512_xor_si512(work_reg_4, work_reg_6);
+            work_reg_7 = _mm512_xor_si512(work_reg_5, work_reg_7);
+
+            // Third layer:
+            if (log_m01 != kModulus)
+                MULADD_GFNI_512(work_reg_0, work_reg_1, 01);
+            work_reg_1 = _mm512_xor_si512(work_reg_0, work_reg_1);
+            if (log_m23 != kModulus)
+                MULADD_GFNI_512(work_reg_2, work_reg_3, 23);
+            work_reg_3 = _mm512_xor_si512(work_reg_2, work_reg_3);
+            if (log_m45 != kModulus)
+                MULADD_GFNI_512(work_reg_4, work_reg_5, 45);
+            work_reg_5 = _mm512_xor_si512(work_reg_4, work_reg_5);
+            if (log_m67 != kModulus)
+                MULADD_GFNI_512(work_reg_6, work_reg_7, 67);
+            work_reg_7 = _mm512_xor_si512(work_reg_6, work_reg_7);
+
+            STORE_512(kStream, work0, work_reg_0);
+            STORE_512(kStream, work1, work_reg_1);
+            STORE_512(kStream, work2, work_reg_2);
+            STORE_512(kStream, work3, work_reg_3);
+            STORE_512(kStream, work4, work_reg_4);
+            STORE_512(kStream, work5, work_reg_5);
+            STORE_512(kStream, work6, work_reg_6);
+            STORE_512(kStream, work7, work_reg_7);
+
+            work0++, work1++, work2++, work3++, work4++, work5++, work6++, work7++;
+
+            piece_bytes -= 64;
+        } while (piece_bytes > 0);
+    }
+
+    if (kStream)
+        _mm_sfence();
+}
+
+#endif // TRY_AVX512 && TRY_GFNI
+
+#if defined(TRY_AVX512)
+
+template<bool kStream = false>
+static TARGET_AVX512 void FFT_DIT8_avx512(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m45,
+    const ffe_t log_m67,
+    const ffe_t log_m02,
+    const ffe_t log_m46,
+    const ffe_t log_m04)
+{
+    // The seven tables do not all fit in the 32 zmm registers, so some are reloaded from L1
+    MUL_TABLES_512(01, log_m01);
+    MUL_TABLES_512(23, log_m23);
+    MUL_TABLES_512(45, log_m45);
+    MUL_TABLES_512(67, log_m67);
+    MUL_TABLES_512(02, log_m02);
+    MUL_TABLES_512(46, log_m46);
+    MUL_TABLES_512(04, log_m04);
+
+    const M512 clr_mask = _mm512_set1_epi8(0x0f);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 8);
+#endif // PREFETCH_NEXT_OPT
+
+        M512 * RESTRICT work0 = reinterpret_cast<M512 *>(work[i]);
+        M512 * RESTRICT work1 = reinterpret_cast<M512 *>(work[i + dist]);
+        M512 * RESTRICT work2 = reinterpret_cast<M512 *>(work[i + dist * 2]);
+        M512 * RESTRICT work3 = reinterpret_cast<M512 *>(work[i + dist * 3]);
+        M512 * RESTRICT work4 = reinterpret_cast<M512 *>(work[i + dist * 4]);
+        M512 * RESTRICT work5 = reinterpret_cast<M512 *>(work[i + dist * 5]);
+        M512 * RESTRICT work6 = reinterpret_cast<M512 *>(work[i + dist * 6]);
+        M512 * RESTRICT work7 = reinterpret_cast<M512 *>(work[i + dist * 7]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            M512 work_reg_0 = _mm512_loadu_si512(work0);
+            M512 work_reg_1 = _mm512_loadu_si512(work1);
+            M512 work_reg_2 = _mm512_loadu_si512(work2);
+            M512 work_reg_3 = _mm512_loadu_si512(work3);
+            M512 work_reg_4 = _mm512_loadu_si512(work4);
+            M512 work_reg_5 = _mm512_loadu_si512(work5);
+            M512 work_reg_6 = _mm512_loadu_si512(work6);
+            M512 work_reg_7 = _mm512_loadu_si512(work7);
+
+            // First layer:
+            if (log_m04 != kModulus)
+            {
+                MULADD_512(work_reg_0, work_reg_4, 04);
+                MULADD_512(work_reg_1, work_reg_5, 04);
+                MULADD_512(work_reg_2, work_reg_6, 04);
+                MULADD_512(work_reg_3, work_reg_7, 04);
+            }
+            work_reg_4 = _mm512_xor_si512(work_reg_0, work_reg_4);
+            work_reg_5 = _mm512_xor_si512(work_reg_1, work_reg_5);
+            work_reg_6 = _mm512_xor_si512(work_reg_2, work_reg_6);
+            work_reg_7 = _mm512_xor_si512(work_reg_3, work_reg_7);
+
+            // Second layer:
+            if (log_m02 != kModulus)
+            {
+                MULADD_512(work_reg_0, work_reg_2, 02);
+                MULADD_512(work_reg_1, work_reg_3, 02);
+            }
+            work_reg_2 = _mm512_xor_si512(work_reg_0, work_reg_2);
+            work_reg_3 = _mm512_xor_si512(work_reg_1, work_reg_3);
+            if (log_m46 != kModulus)
+            {
+                MULADD_512(work_reg_4, work_reg_6, 46);
+                MULADD_512(work_reg_5, work_reg_7, 46);
+            }
+            work_reg_6 = _mm512_xor_si512(work_reg_4, work_reg_6);
+            work_reg_7 = _mm512_xor_si512(work_reg_5, work_reg_7);
+
+            // Third layer:
+            if (log_m01 != kModulus)
+                MULADD_512(work_reg_0, work_reg_1, 01);
+            work_reg_1 = _mm512_xor_si512(work_reg_0, work_reg_1);
+            if (log_m23 != kModulus)
+                MULADD_512(work_reg_2, work_reg_3, 23);
+            work_reg_3 = _mm512_xor_si512(work_reg_2, work_reg_3);
+            if (log_m45 != kModulus)
+                MULADD_512(work_reg_4, work_reg_5, 45);
+            work_reg_5 = _mm512_xor_si512(work_reg_4, work_reg_5);
+            if (log_m67 != kModulus)
+                MULADD_512(work_reg_6, work_reg_7, 67);
+            work_reg_7 = _mm512_xor_si512(work_reg_6, work_reg_7);
+
+            STORE_512(kStream, work0, work_reg_0);
+            STORE_512(kStream, work1, work_reg_1);
+            STORE_512(kStream, work2, work_reg_2);
+            STORE_512(kStream, work3, work_reg_3);
+            STORE_512(kStream, work4, work_reg_4);
+            STORE_512(kStream, work5, work_reg_5);
+            STORE_512(kStream, work6, work_reg_6);
+            STORE_512(kStream, work7, work_reg_7);
+
+            work0++, work1++, work2++, work3++, work4++, work5++, work6++, work7++;
+
+            piece_bytes -= 64;
+        } while (piece_bytes > 0);
+    }
+
+    if (kStream)
+        _mm_sfence();
+}
+
+#endif // TRY_AVX512
+
+#endif // INTERLEAVE_BUTTERFLY8_OPT
+
+
+// In-place FFT for encoder and decoder.  stream_output writes the last layer
+// with streaming stores
+static void FFT_DIT(
+    const uint64_t bytes,
+    void** work,
+    const unsigned m_truncated,
+    const unsigned m,
+    const ffe_t* skewLUT,
+    bool stream_output)
+{
+    unsigned dist8 = m;
+
+#ifdef INTERLEAVE_BUTTERFLY8_OPT
+    // Decimation in time: Unroll 3 layers at a time while 8-way butterflies
+    // are available, leaving the remaining layers to the loop below
+    for (unsigned dist = dist8 >> 3; FFT_DIT8 && dist != 0; dist8 = dist, dist >>= 3)
+    {
+        // No layers are left after dist = 1
+        const auto fft_dit8 = (stream_output && dist == 1) ? FFT_DIT8_stream : FFT_DIT8;
+
+        // For each set of dist*8 elements:
+        ParallelForSpans((m_truncated + dist8 - 1) / dist8, dist8, dist, [&](unsigned r, unsigned i_begin, unsigned count) {
+            const unsigned i_end = r + dist;
+            const ffe_t log_m01 = skewLUT[i_end - 1];
+            const ffe_t log_m02 = skewLUT[i_end + dist - 1];
+            const ffe_t log_m23 = skewLUT[i_end + dist * 2 - 1];
+            const ffe_t log_m04 = skewLUT[i_end + dist * 3 - 1];
+            const ffe_t log_m45 = skewLUT[i_end + dist * 4 - 1];
+            const ffe_t log_m46 = skewLUT[i_end + dist * 5 - 1];
+            const ffe_t log_m67 = skewLUT[i_end + dist * 6 - 1];
+
+            // For each set of dist elements in this chunk:
+            fft_dit8(
+                bytes,
+                work + i_begin,
+                dist,
+                count,
+                log_m01,
+                log_m23,
+                log_m45,
+                log_m67,
+                log_m02,
+                log_m46,
+                log_m04);
+        });
+    }
+#endif // INTERLEAVE_BUTTERFLY8_OPT
+
+    // Decimation in time: Unroll 2 layers at a time
+    unsigned dist4 = dist8, dist = dist8 >> 2;
+    for (; dist != 0; dist4 = dist, dist >>= 2)
+    {
+        const auto fft_dit4 = (stream_output && dist == 1) ? FFT_DIT4_stream : FFT_DIT4;
+
+        // For each set of dist*4 elements:
+        ParallelForSpans((m_truncated + dist4 - 1) / dist4, dist4, dist, [&](unsigned r, unsigned i_begin, unsigned count) {
+            const unsigned i_end = r + dist;
+            const ffe_t log_m01 = skewLUT[i_end - 1];
+            const ffe_t log_m02 = skewLUT[i_end + dist - 1];
+            const ffe_t log_m23 = skewLUT[i_end + dist * 2 - 1];
+            const unsigned trivial = TrivialSkews4(log_m01, log_m23, log_m02);
+
+            // For each set of dist elements in this chunk:
+            fft_dit4[trivial](
+                bytes,
+                work + i_begin,
+                dist,
+                count,
+                log_m01,
+                log_m23,
+                log_m02);
+        });
+    }
+
+    // If there is one layer left:
+    if (dist4 == 2)
+    {
+        const auto fft_dit2 = stream_output ? FFT_DIT2_stream : FFT_DIT2;
+
+        ParallelFor((m_truncated + 1) / 2, [&](unsigned group) {
+            const unsigned r = group * 2;
+
+#ifdef PREFETCH_NEXT_OPT
+            if (r + 2 < m_truncated)
+                PrefetchButterfly(work + r + 2, 1, 2);
+#endif // PREFETCH_NEXT_OPT
+
+            const ffe_t log_m = skewLUT[r];
+
+            if (log_m == kModulus)
+                xor_mem(work[r + 1], work[r], bytes);
+            else
+            {
+                fft_dit2(
+                    work[r],
+                    work[r + 1],
+                    log_m,
+                    bytes);
+            }
+        });
+    }
+}
+
+
+//------------------------------------------------------------------------------
+// Reed-Solomon Encode
+
+// Runs the whole encoder on one byte range of every piece
+static void EncodeSlice(
+    uint64_t buffer_bytes,
+    unsigned original_count,
+    unsigned recovery_count,
+    unsigned m,
+    const void* const * data,
+    void** work,
+    bool stream_output)
+{
+    // work <- IFFT(data, m, m)
+
+    const ffe_t* skewLUT = FFTSkew + m;
+
+    IFFT_DIT_Encoder(
+        buffer_bytes,
+        data,
+        original_count < m ? original_count : m,
+        work,
+        nullptr, // No xor output
+        m,
+        skewLUT);
+
+    const unsigned last_count = original_count % m;
+    if (m >= original_count)
+        goto skip_body;
+
+    // For sets of m data pieces:
+    for (unsigned i = m; i + m <= original_count; i += m)
+    {
+        data += m;
+        skewLUT += m;
+
+        // work <- work xor IFFT(data + i, m, m + i)
+
+        IFFT_DIT_Encoder(
+            buffer_bytes,
+            data, // data source
+            m,
+            work + m, // temporary workspace
+            work, // xor destination
+            m,
+            skewLUT);
+    }
+
+    // Handle final partial set of m pieces:
+    if (last_count != 0)
+    {
+        data += m;
+        skewLUT += m;
+
+        // work <- work xor IFFT(data + i, m, m + i)
+
+        IFFT_DIT_Encoder(
+            buffer_bytes,
+            data, // data source
+            last_count,
+            work + m, // temporary workspace
+            work, // xor destination
+            m,
+            skewLUT);
+    }
+
+skip_body:
+
+    // work <- FFT(work, m, 0)
+    FFT_DIT(
+        buffer_bytes,
+        work,
+        recovery_count,
+        m,
+        FFTSkew,
+        stream_output);
+}
+
+// Runs the encoder on bytes [begin, end) of every piece, one slice at a time
+static void EncodeColumns(
+    uint64_t begin,
+    uint64_t end,
+    unsigned original_count,
+    unsigned recovery_count,
+    unsigned m,
+    const void* const * data,
+    void** work,
+    bool stream_output)
+{
+    // The work buffers are revisited by every group of m data pieces
+    const uint64_t slice_bytes = GetSliceBytes(end - begin, m * 2);
+
+    if (begin == 0 && slice_bytes >= end)
+    {
+        EncodeSlice(end, original_count, recovery_count, m, data, work, stream_output);
+        return;
+    }
+
+    SlicePointers data_slices(data, original_count);
+    SlicePointers work_slices(work, m * 2);
+
+    for (uint64_t offset = begin; offset < end; offset += slice_bytes)
+    {
+        const uint64_t remaining = end - offset;
+
+        EncodeSlice(
+            remaining < slice_bytes ? remaining : slice_bytes,
+            original_count,
+            recovery_count,
+            m,
+            data_slices.Offset(offset),
+            work_slices.Offset(offset),
+            stream_output);
+    }
+}
+
+void ReedSolomonEncode(
+    uint64_t buffer_bytes,
+    unsigned original_count,
+    unsigned recovery_count,
+    unsigned m,
+    const void* const * data,
+    void** work)
+{
+    // The recovery pieces are not read again after the last FFT layer, which
+    // also writes the padding up to m
+    const bool stream_output = UseStreamingStores(
+        buffer_bytes * (original_count + recovery_count),
+        work,
+        m);
+
+    const unsigned workers = GetColumnWorkers(buffer_bytes);
+
+    if (workers <= 1)
+    {
+        EncodeColumns(0, buffer_bytes, original_count, recovery_count, m, data, work, stream_output);
+        return;
+    }
+
+    // Each worker runs the whole transform on its own columns
+    ParallelFor(workers, [&](unsigned i) {
+        uint64_t begin, end;
+        GetColumnRange(buffer_bytes, workers, i, begin, end);
+
+        EncodeColumns(begin, end, original_count, recovery_count, m, data, work, stream_output);
+    });
+}
+
+
+//------------------------------------------------------------------------------
+// ErrorBitfield
+
+#ifdef ERROR_BITFIELD_OPT
+
+// Used in decoding to decide which final FFT operations to perform
+class ErrorBitfield
+{
+    static const unsigned kWordMips = 5;
+    static const unsigned kWords = kOrder / 64;
+    uint64_t Words[kWordMips][kWords];
+
+    static const unsigned kBigMips = 6;
+    static const unsigned kBigWords = (kWords + 63) / 64;
+    uint64_t BigWords[kBigMips][kBigWords];
+
+    static const unsigned kBiggestMips = 4;
+    uint64_t BiggestWords[kBiggestMips];
+
+public:
+    // Prepare() fills in the other mip levels from the first one
+    FORCE_INLINE void Clear()
+    {
+        memset(Words[0], 0, sizeof(Words[0]));
+    }
+
+    FORCE_INLINE void Set(unsigned i)
+    {
+        Words[0][i / 64] |= (uint64_t)1 << (i % 64);
+    }
+
+    void Prepare();
+
+    FORCE_INLINE bool IsNeeded(unsigned mip_level, unsigned bit) const
+    {
+        if (mip_level >= 16)
+            return true;
+        if (mip_level >= 12)
+        {
+            bit /= 4096;
+            return 0 != (BiggestWords[mip_level - 12] & ((uint64_t)1 << bit));
+        }
+        if (mip_level >= 6)
+        {
+            bit /= 64;
+            return 0 != (BigWords[mip_level - 6][bit / 64] & ((uint64_t)1 << (bit % 64)));
+        }
+        return 0 != (Words[mip_level - 1][bit / 64] & ((uint64_t)1 << (bit % 64)));
+    }
+};
+
+static const uint64_t kHiMasks[5] = {
+    0xAAAAAAAAAAAAAAAAULL,
+    0xCCCCCCCCCCCCCCCCULL,
+    0xF0F0F0F0F0F0F0F0ULL,
+    0xFF00FF00FF00FF00ULL,
+    0xFFFF0000FFFF0000ULL,
+};
+
+void ErrorBitfield::Prepare()
+{
+    // First mip level is for final layer of FFT: pairs of data
+    for (unsigned i = 0; i < kWords; ++i)
+    {
+        uint64_t w_i = Words[0][i];
+        const uint64_t hi2lo0 = w_i | ((w_i & kHiMasks[0]) >> 1);
+        const uint64_t lo2hi0 = ((w_i & (kHiMasks[0] >> 1)) << 1);
+        Words[0][i] = w_i = hi2lo0 | lo2hi0;
+
+        for (unsigned j = 1, bits = 2; j < kWordMips; ++j, bits <<= 1)
+        {
+            const uint64_t hi2lo_j = w_i | ((w_i & kHiMasks[j]) >> bits);
+            const uint64_t lo2hi_j = ((w_i & (kHiMasks[j] >> bits)) << bits);
+            Words[j][i] = w_i = hi2lo_j | lo2hi_j;
+        }
+    }
+
+    for (unsigned i = 0; i < kBigWords; ++i)
+    {
+        uint64_t w_i = 0;
+        uint64_t bit = 1;
+        const uint64_t* src = &Words[kWordMips - 1][i * 64];
+        for (unsigned j = 0; j < 64; ++j, bit <<= 1)
+        {
+            const uint64_t w = src[j];
+            w_i |= (w | (w >> 32) | (w << 32)) & bit;
+        }
+        BigWords[0][i] = w_i;
+
+        for (unsigned j = 1, bits = 1; j < kBigMips; ++j, bits <<= 1)
+        {
+            const uint64_t hi2lo_j = w_i | ((w_i & kHiMasks[j - 1]) >> bits);
+            const uint64_t lo2hi_j = ((w_i & (kHiMasks[j - 1] >> bits)) << bits);
+            BigWords[j][i] = w_i = hi2lo_j | lo2hi_j;
+        }
+    }
+
+    uint64_t w_i = 0;
+    uint64_t bit = 1;
+    const uint64_t* src = &BigWords[kBigMips - 1][0];
+    for (unsigned j = 0; j < kBigWords; ++j, bit <<= 1)
+    {
+        const uint64_t w = src[j];
+        w_i |= (w | (w >> 32) | (w << 32)) & bit;
+    }
+    BiggestWords[0] = w_i;
+
+    for (unsigned j = 1, bits = 1; j < kBiggestMips; ++j, bits <<= 1)
+    {
+        const uint64_t hi2lo_j = w_i | ((w_i & kHiMasks[j - 1]) >> bits);
+        const uint64_t lo2hi_j = ((w_i & (kHiMasks[j - 1] >> bits)) << bits);
+        BiggestWords[j] = w_i = hi2lo_j | lo2hi_j;
+    }
+}
+
+
+static void FFT_DIT_ErrorBits(
+    const uint64_t bytes,
+    void** work,
+    const unsigned n_truncated,
+    const unsigned n,
+    const ffe_t* skewLUT,
+    const ErrorBitfield& error_bits)
+{
+    unsigned mip_level = LastNonzeroBit32(n);
+
+    unsigned dist8 = n;
+
+#ifdef INTERLEAVE_BUTTERFLY8_OPT
+    // Decimation in time: Unroll 3 layers at a time while 8-way butterflies
+    // are available, leaving the remaining layers to the loop below
+    for (unsigned dist = dist8 >> 3; FFT_DIT8 && dist != 0; dist8 = dist, dist >>= 3, mip_level -= 3)
+    {
+        // For each set of dist*8 elements:
+        ParallelForSpans((n_truncated + dist8 - 1) / dist8, dist8, dist, [&](unsigned r, unsigned i_begin, unsigned count) {
+            if (!error_bits.IsNeeded(mip_level, r))
+                return;
+
+            const unsigned i_end = r + dist;
+            const ffe_t log_m01 = skewLUT[i_end - 1];
+            const ffe_t log_m02 = skewLUT[i_end + dist - 1];
+            const ffe_t log_m23 = skewLUT[i_end + dist * 2 - 1];
+            const ffe_t log_m04 = skewLUT[i_end + dist * 3 - 1];
+            const ffe_t log_m45 = skewLUT[i_end + dist * 4 - 1];
+            const ffe_t log_m46 = skewLUT[i_end + dist * 5 - 1];
+            const ffe_t log_m67 = skewLUT[i_end + dist * 6 - 1];
+
+            // For each set of dist elements in this chunk:
+            FFT_DIT8(
+                bytes,
+                work + i_begin,
+                dist,
+                count,
+                log_m01,
+                log_m23,
+                log_m45,
+                log_m67,
+                log_m02,
+                log_m46,
+                log_m04);
+        });
+    }
+#endif // INTERLEAVE_BUTTERFLY8_OPT
+
+    // Decimation in time: Unroll 2 layers at a time
+    unsigned dist4 = dist8, dist = dist8 >> 2;
+    for (; dist != 0; dist4 = dist, dist >>= 2, mip_level -=2)
+    {
+        // For each set of dist*4 elements:
+        ParallelForSpans((n_truncated + dist4 - 1) / dist4, dist4, dist, [&](unsigned r, unsigned i_begin, unsigned count) {
+            if (!error_bits.IsNeeded(mip_level, r))
+                return;
+
+            const unsigned i_end = r + dist;
+            const ffe_t log_m01 = skewLUT[i_end - 1];
+            const ffe_t log_m02 = skewLUT[i_end + dist - 1];
+            const ffe_t log_m23 = skewLUT[i_end + dist * 2 - 1];
+            const unsigned trivial = TrivialSkews4(log_m01, log_m23, log_m02);
+
+            // For each set of dist elements in this chunk:
+            FFT_DIT4[trivial](
+                bytes,
+                work + i_begin,
+                dist,
+                count,
+                log_m01,
+                log_m23,
+                log_m02);
+        });
+    }
+
+    // If there is one layer left:
+    if (dist4 == 2)
+    {
+        ParallelFor((n_truncated + 1) / 2, [&](unsigned group) {
+            const unsigned r = group * 2;
+
+            if (!error_bits.IsNeeded(mip_level, r))
+                return;
+
+#ifdef PREFETCH_NEXT_OPT
+            if (r + 2 < n_truncated)
+                PrefetchButterfly(work + r + 2, 1, 2);
+#endif // PREFETCH_NEXT_OPT
+
+            const ffe_t log_m = skewLUT[r];
+
+            if (log_m == kModulus)
+                xor_mem(work[r + 1], work[r], bytes);
             else
             {
                 FFT_DIT2(
@@ -1358,411 +4803,1117 @@ static void FFT_DIT(
                     log_m,
                     bytes);
             }
+        });
+    }
+}
+
+#endif // ERROR_BITFIELD_OPT
+
+
+//------------------------------------------------------------------------------
+// Reed-Solomon Decode
+
+// Error locator polynomial evaluated for one erasure pattern.
+// Every field is overwritten by EvaluateErrorLocator()
+struct ErrorLocator
+{
+    ffe_t Locations[kOrder];
+#ifdef ERROR_BITFIELD_OPT
+    ErrorBitfield Bits;
+#endif // ERROR_BITFIELD_OPT
+};
+
+ErrorLocator* CreateErrorLocator()
+{
+    return new ErrorLocator;
+}
+
+void FreeErrorLocator(ErrorLocator* locator)
+{
+    delete locator;
+}
+
+// Recently evaluated error locators
+static ErasureCache<ErrorLocator> LocatorCache;
+
+void SetErrorLocatorCacheSize(unsigned entries)
+{
+    LocatorCache.SetCapacity(entries);
+}
+
+static void EvaluateErrorLocator(
+    unsigned original_count,
+    unsigned recovery_count,
+    unsigned m,
+    const void* const * const original,
+    const void* const * const recovery,
+    ErrorLocator& locator)
+{
+    // Fill in error locations
+
+    ffe_t* error_locations = locator.Locations;
+
+#ifdef ERROR_BITFIELD_OPT
+    locator.Bits.Clear();
+#endif // ERROR_BITFIELD_OPT
+
+    for (unsigned i = 0; i < recovery_count; ++i)
+        error_locations[i] = recovery[i] ? 0 : 1;
+    for (unsigned i = recovery_count; i < m; ++i)
+        error_locations[i] = 1;
+    for (unsigned i = 0; i < original_count; ++i)
+    {
+        if (original[i])
+            error_locations[i + m] = 0;
+        else
+        {
+            error_locations[i + m] = 1;
+#ifdef ERROR_BITFIELD_OPT
+            locator.Bits.Set(i + m);
+#endif // ERROR_BITFIELD_OPT
         }
     }
+    memset(
+        error_locations + m + original_count,
+        0,
+        (kOrder - m - original_count) * sizeof(ffe_t));
+
+#ifdef ERROR_BITFIELD_OPT
+    locator.Bits.Prepare();
+#endif // ERROR_BITFIELD_OPT
+
+    // Evaluate error locator polynomial
+
+    FWHT(error_locations, kOrder, m + original_count);
+
+    MulModElements(error_locations, LogWalsh, kOrder);
+
+    FWHT(error_locations, kOrder, kOrder);
 }
 
+// Runs the decoder on one byte range of every piece
+static void DecodeSlice(
+    uint64_t buffer_bytes,
+    unsigned original_count,
+    unsigned recovery_count,
+    unsigned m,
+    unsigned n,
+    const void* const * const original,
+    const void* const * const recovery,
+    void** work,
+    const ErrorLocator& locator,
+    bool stream_output)
+{
+    const ffe_t* error_locations = locator.Locations;
+
+    // work <- recovery data
+
+    ParallelFor(recovery_count, [&](unsigned i) {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < recovery_count)
+            PrefetchPiece(recovery[i + 1]);
+#endif // PREFETCH_NEXT_OPT
+        if (recovery[i])
+            mul_mem(work[i], recovery[i], error_locations[i], buffer_bytes);
+        else
+            memset(work[i], 0, buffer_bytes);
+    });
+    ParallelFor(m - recovery_count, [&](unsigned i) {
+        memset(work[recovery_count + i], 0, buffer_bytes);
+    });
+
+    // work <- original data
+
+    ParallelFor(original_count, [&](unsigned i) {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < original_count)
+            PrefetchPiece(original[i + 1]);
+#endif // PREFETCH_NEXT_OPT
+        if (original[i])
+            mul_mem(work[m + i], original[i], error_locations[m + i], buffer_bytes);
+        else
+            memset(work[m + i], 0, buffer_bytes);
+    });
+    ParallelFor(n - (m + original_count), [&](unsigned i) {
+        memset(work[m + original_count + i], 0, buffer_bytes);
+    });
+
+    // work <- IFFT(work, n, 0)
+
+    IFFT_DIT_Decoder(
+        buffer_bytes,
+        m + original_count,
+        work,
+        n,
+        FFTSkew);
+
+    // work <- FormalDerivative(work, n)
+
+    for (unsigned i = 1; i < n; ++i)
+    {
+        const unsigned width = ((i ^ (i - 1)) + 1) >> 1;
+
+        if (width < 8)
+        {
+            VectorXOR(
+                buffer_bytes,
+                width,
+                work + i - width,
+                work + i);
+        }
+        else
+        {
+            VectorXOR_Threads(
+                buffer_bytes,
+                width,
+                work + i - width,
+                work + i);
+        }
+    }
+
+    // work <- FFT(work, n, 0) truncated to m + original_count
+
+    const unsigned output_count = m + original_count;
+
+#ifdef ERROR_BITFIELD_OPT
+    FFT_DIT_ErrorBits(buffer_bytes, work, output_count, n, FFTSkew, locator.Bits);
+#else
+    FFT_DIT(buffer_bytes, work, output_count, n, FFTSkew, false);
+#endif
+
+    // Reveal erasures
+
+    const auto reveal_mul = stream_output ? mul_mem_stream : mul_mem;
+
+    for (unsigned i = 0; i < original_count; ++i)
+    {
+        if (original[i])
+            continue;
+
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < original_count && !original[i + 1])
+            PrefetchPiece(work[i + 1 + m]);
+#endif // PREFETCH_NEXT_OPT
 
-//------------------------------------------------------------------------------
-// Reed-Solomon Encode
+        reveal_mul(work[i], work[i + m], kModulus - error_locations[i + m], buffer_bytes);
+    }
+}
 
-void ReedSolomonEncode(
-    uint64_t buffer_bytes,
+// Runs the decoder on bytes [begin, end) of every piece, one slice at a time
+static void DecodeColumns(
+    uint64_t begin,
+    uint64_t end,
     unsigned original_count,
     unsigned recovery_count,
     unsigned m,
-    const void* const * data,
-    void** work)
+    unsigned n,
+    const void* const * const original,
+    const void* const * const recovery,
+    void** work,
+    const ErrorLocator& locator,
+    bool stream_output)
 {
-    // work <- IFFT(data, m, m)
-
-    const ffe_t* skewLUT = FFTSkew + m - 1;
+    const uint64_t slice_bytes = GetSliceBytes(end - begin, n);
 
-    IFFT_DIT_Encoder(
-        buffer_bytes,
-        data,
-        original_count < m ? original_count : m,
-        work,
-        nullptr, // No xor output
-        m,
-        skewLUT);
+    if (begin == 0 && slice_bytes >= end)
+    {
+        DecodeSlice(end, original_count, recovery_count, m, n, original, recovery, work, locator, stream_output);
+        return;
+    }
 
-    const unsigned last_count = original_count % m;
-    if (m >= original_count)
-        goto skip_body;
+    SlicePointers original_slices(original, original_count);
+    SlicePointers recovery_slices(recovery, recovery_count);
+    SlicePointers work_slices(work, n);
 
-    // For sets of m data pieces:
-    for (unsigned i = m; i + m <= original_count; i += m)
+    for (uint64_t offset = begin; offset < end; offset += slice_bytes)
     {
-        data += m;
-        skewLUT += m;
+        const uint64_t remaining = end - offset;
 
-        // work <- work xor IFFT(data + i, m, m + i)
-
-        IFFT_DIT_Encoder(
-            buffer_bytes,
-            data, // data source
-            m,
-            work + m, // temporary workspace
-            work, // xor destination
+        DecodeSlice(
+            remaining < slice_bytes ? remaining : slice_bytes,
+            original_count,
+            recovery_count,
             m,
-            skewLUT);
+            n,
+            original_slices.Offset(offset),
+            recovery_slices.Offset(offset),
+            work_slices.Offset(offset),
+            locator,
+            stream_output);
     }
+}
 
-    // Handle final partial set of m pieces:
-    if (last_count != 0)
+// Returns the error locator for the erasure pattern, from the cache or
+// evaluated into scratch, which may be null.  cached keeps a cache entry or
+// a temporary locator alive while in use
+static const ErrorLocator* AcquireErrorLocator(
+    unsigned original_count,
+    unsigned recovery_count,
+    unsigned m,
+    const void* const * const original,
+    const void* const * const recovery,
+    ErrorLocator* scratch,
+    std::shared_ptr<const ErrorLocator>& cached)
+{
+    if (!LocatorCache.IsEnabled())
     {
-        data += m;
-        skewLUT += m;
+        if (scratch)
+        {
+            EvaluateErrorLocator(original_count, recovery_count, m, original, recovery, *scratch);
+            return scratch;
+        }
 
-        // work <- work xor IFFT(data + i, m, m + i)
+        // Without a decoder context, evaluate into a temporary on the heap
+        // rather than reserving a whole locator on the stack of every call
+        std::shared_ptr<ErrorLocator> temp = std::make_shared<ErrorLocator>();
+        EvaluateErrorLocator(original_count, recovery_count, m, original, recovery, *temp);
+        cached = temp;
+        return temp.get();
+    }
 
-        IFFT_DIT_Encoder(
-            buffer_bytes,
-            data, // data source
-            last_count,
-            work + m, // temporary workspace
-            work, // xor destination
-            m,
-            skewLUT);
+    ErasureKey key;
+    key.Initialize(m, original_count, recovery_count, original, recovery);
+
+    cached = LocatorCache.Find(key);
+    if (!cached)
+    {
+        std::shared_ptr<ErrorLocator> fresh = std::make_shared<ErrorLocator>();
+        EvaluateErrorLocator(original_count, recovery_count, m, original, recovery, *fresh);
+        LocatorCache.Insert(key, fresh);
+        cached = fresh;
     }
+    return cached.get();
+}
 
-skip_body:
+void ReedSolomonDecode(
+    uint64_t buffer_bytes,
+    unsigned original_count,
+    unsigned recovery_count,
+    unsigned m, // NextPow2(recovery_count)
+    unsigned n, // NextPow2(m + original_count) = work_count
+    const void* const * const original, // original_count entries
+    const void* const * const recovery, // recovery_count entries
+    void** work, // n entries
+    ErrorLocator* locator)
+{
+    std::shared_ptr<const ErrorLocator> cached;
 
-    // work <- FFT(work, m, 0)
-    FFT_DIT(
-        buffer_bytes,
+    const ErrorLocator* evaluated = AcquireErrorLocator(
+        original_count,
+        recovery_count,
+        m,
+        original,
+        recovery,
+        locator,
+        cached);
+
+    // The revealed pieces are not read again by the decoder
+    const bool stream_output = UseStreamingStores(
+        buffer_bytes * (original_count + recovery_count),
         work,
+        original_count);
+
+    const unsigned workers = GetColumnWorkers(buffer_bytes);
+
+    if (workers <= 1)
+    {
+        DecodeColumns(0, buffer_bytes, original_count, recovery_count, m, n, original, recovery, work, *evaluated, stream_output);
+        return;
+    }
+
+    // Each worker runs the whole transform on its own columns
+    ParallelFor(workers, [&](unsigned i) {
+        uint64_t begin, end;
+        GetColumnRange(buffer_bytes, workers, i, begin, end);
+
+        DecodeColumns(begin, end, original_count, recovery_count, m, n, original, recovery, work, *evaluated, stream_output);
+    });
+}
+
+void ReedSolomonDecodeBatch(
+    uint64_t buffer_bytes,
+    unsigned original_count,
+    unsigned recovery_count,
+    unsigned m, // NextPow2(recovery_count)
+    unsigned n, // NextPow2(m + original_count) = work_count
+    unsigned stripe_count,
+    const void* const * const * original, // stripe_count arrays
+    const void* const * const * recovery, // stripe_count arrays
+    void** const * work, // stripe_count arrays
+    ErrorLocator* locator)
+{
+    // All stripes share the erasure pattern of the first one
+    std::shared_ptr<const ErrorLocator> cached;
+
+    const ErrorLocator* evaluated = AcquireErrorLocator(
+        original_count,
         recovery_count,
         m,
-        FFTSkew - 1);
+        original[0],
+        recovery[0],
+        locator,
+        cached);
+
+    // Stream the revealed pieces only if every stripe allows it
+    bool stream_output = true;
+    for (unsigned stripe = 0; stream_output && stripe < stripe_count; ++stripe)
+    {
+        stream_output = UseStreamingStores(
+            buffer_bytes * (original_count + recovery_count) * stripe_count,
+            work[stripe],
+            original_count);
+    }
+
+    // Schedule threads over (stripe, slice) tiles
+    const uint64_t slice_bytes = GetBatchSliceBytes(buffer_bytes, n);
+    const unsigned slice_count = static_cast<unsigned>((buffer_bytes + slice_bytes - 1) / slice_bytes);
+
+    ParallelFor(stripe_count * slice_count, [&](unsigned tile) {
+        const unsigned stripe = tile / slice_count;
+        const uint64_t offset = (tile % slice_count) * slice_bytes;
+        const uint64_t remaining = buffer_bytes - offset;
+
+        SlicePointers original_slice(original[stripe], original_count);
+        SlicePointers recovery_slice(recovery[stripe], recovery_count);
+        SlicePointers work_slice(work[stripe], n);
+
+        DecodeSlice(
+            remaining < slice_bytes ? remaining : slice_bytes,
+            original_count,
+            recovery_count,
+            m,
+            n,
+            original_slice.Offset(offset),
+            recovery_slice.Offset(offset),
+            work_slice.Offset(offset),
+            *evaluated,
+            stream_output);
+    });
 }
 
 
 //------------------------------------------------------------------------------
-// ErrorBitfield
+// Bitsliced Layout (Experimental)
 
-#ifdef ERROR_BITFIELD_OPT
+#if defined(TRY_AVX2)
 
-// Used in decoding to decide which final FFT operations to perform
-class ErrorBitfield
+/*
+    Multiplying by a constant is linear over GF(2), so out bit i of a product
+    is the XOR of the input bits j where the constant's 16x16 bit matrix has
+    M[i][j] = 1.  With each bit stored in its own plane, a whole plane of 256
+    symbols is multiplied with XORs only.
+
+    The matrix rows for every log_m are kept as 16-bit masks.  Inside a block,
+    the 16 XOR combinations of each group of 4 input planes are built once,
+    so each output plane is then the XOR of four of them.  That is 44 + 48
+    XORs per 256 symbols whatever the constant, with no shuffles.
+*/
+
+// Matrix row masks: Row[log_m * kBits + i] bit j = M[i][j]
+static std::vector<uint16_t> BitsliceRows;
+
+// Returns the row masks for log_m
+static FORCE_INLINE const uint16_t* GetBitsliceRows(ffe_t log_m)
 {
-    static const unsigned kWordMips = 5;
-    static const unsigned kWords = kOrder / 64;
-    uint64_t Words[kWordMips][kWords] = {};
+    return &BitsliceRows[(size_t)log_m * kBits];
+}
 
-    static const unsigned kBigMips = 6;
-    static const unsigned kBigWords = (kWords + 63) / 64;
-    uint64_t BigWords[kBigMips][kBigWords] = {};
+// prod[] = in[] * M for one block of 16 planes
+static TARGET_AVX2 FORCE_INLINE void BitsliceMulBlock(
+    const M256* in,
+    const uint16_t* rows,
+    M256* prod)
+{
+    M256 combos[4][16];
 
-    static const unsigned kBiggestMips = 4;
-    uint64_t BiggestWords[kBiggestMips] = {};
+    for (unsigned g = 0; g < 4; ++g)
+    {
+        combos[g][0] = _mm256_setzero_si256();
+        for (unsigned k = 0, bit = 1; k < 4; ++k, bit <<= 1)
+        {
+            combos[g][bit] = _mm256_loadu_si256(in + g * 4 + k);
+            for (unsigned t = 1; t < bit; ++t)
+                combos[g][bit | t] = _mm256_xor_si256(combos[g][bit], combos[g][t]);
+        }
+    }
 
-public:
-    FORCE_INLINE void Set(unsigned i)
+    for (unsigned i = 0; i < kBits; ++i)
+    {
+        const unsigned row = rows[i];
+        prod[i] = _mm256_xor_si256(
+            _mm256_xor_si256(combos[0][row & 15], combos[1][(row >> 4) & 15]),
+            _mm256_xor_si256(combos[2][(row >> 8) & 15], combos[3][row >> 12]));
+    }
+}
+
+TARGET_AVX2 void BitsliceFromAltmap(
+    void * RESTRICT out, const void * RESTRICT in,
+    uint64_t bytes)
+{
+    uint32_t * RESTRICT out32 = reinterpret_cast<uint32_t *>(out);
+    const uint8_t * RESTRICT in8 = reinterpret_cast<const uint8_t *>(in);
+
+    do
+    {
+        // Each 64-byte ALTMAP block fills one 32-bit word of every plane
+        for (unsigned q = 0; q < 8; ++q, in8 += 64)
+        {
+            M256 lo = _mm256_loadu_si256(reinterpret_cast<const M256 *>(in8));
+            M256 hi = _mm256_loadu_si256(reinterpret_cast<const M256 *>(in8 + 32));
+
+            // Peel off the high bit of every byte, then shift the next one up
+            for (int b = 7; b >= 0; --b)
+            {
+                out32[b * 8 + q] = static_cast<uint32_t>(_mm256_movemask_epi8(lo));
+                out32[(b + 8) * 8 + q] = static_cast<uint32_t>(_mm256_movemask_epi8(hi));
+                lo = _mm256_add_epi8(lo, lo);
+                hi = _mm256_add_epi8(hi, hi);
+            }
+        }
+        out32 += kBitsliceBlockBytes / 4;
+
+        bytes -= kBitsliceBlockBytes;
+    } while (bytes > 0);
+}
+
+// Spreads the 32 bits of w to 0x00/0xff bytes
+static TARGET_AVX2 FORCE_INLINE M256 BitsToBytes(uint32_t w)
+{
+    const M256 spread = _mm256_setr_epi8(
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+        2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const M256 select = _mm256_set1_epi64x(0x8040201008040201ULL);
+
+    const M256 v = _mm256_shuffle_epi8(_mm256_set1_epi32(static_cast<int>(w)), spread);
+    return _mm256_cmpeq_epi8(_mm256_and_si256(v, select), select);
+}
+
+TARGET_AVX2 void BitsliceToAltmap(
+    void * RESTRICT out, const void * RESTRICT in,
+    uint64_t bytes)
+{
+    uint8_t * RESTRICT out8 = reinterpret_cast<uint8_t *>(out);
+    const uint32_t * RESTRICT in32 = reinterpret_cast<const uint32_t *>(in);
+
+    do
+    {
+        for (unsigned q = 0; q < 8; ++q, out8 += 64)
+        {
+            M256 lo = _mm256_setzero_si256();
+            M256 hi = _mm256_setzero_si256();
+
+            for (unsigned b = 0; b < 8; ++b)
+            {
+                const M256 bit = _mm256_set1_epi8(static_cast<char>(1 << b));
+                lo = _mm256_or_si256(lo, _mm256_and_si256(BitsToBytes(in32[b * 8 + q]), bit));
+                hi = _mm256_or_si256(hi, _mm256_and_si256(BitsToBytes(in32[(b + 8) * 8 + q]), bit));
+            }
+
+            _mm256_storeu_si256(reinterpret_cast<M256 *>(out8), lo);
+            _mm256_storeu_si256(reinterpret_cast<M256 *>(out8 + 32), hi);
+        }
+        in32 += kBitsliceBlockBytes / 4;
+
+        bytes -= kBitsliceBlockBytes;
+    } while (bytes > 0);
+}
+
+static TARGET_AVX2 void BitsliceMul_avx2(
+    void * RESTRICT x, const void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    const uint16_t* rows = GetBitsliceRows(log_m);
+
+    M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
+    const M256 * RESTRICT y32 = reinterpret_cast<const M256 *>(y);
+
+    do
+    {
+        M256 prod[kBits];
+        BitsliceMulBlock(y32, rows, prod);
+        for (unsigned i = 0; i < kBits; ++i)
+            _mm256_storeu_si256(x32 + i, prod[i]);
+        x32 += kBits, y32 += kBits;
+
+        bytes -= kBitsliceBlockBytes;
+    } while (bytes > 0);
+}
+
+static TARGET_AVX2 void BitsliceMulAdd_avx2(
+    void * RESTRICT x, const void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    const uint16_t* rows = GetBitsliceRows(log_m);
+
+    M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
+    const M256 * RESTRICT y32 = reinterpret_cast<const M256 *>(y);
+
+    do
+    {
+        M256 prod[kBits];
+        BitsliceMulBlock(y32, rows, prod);
+        for (unsigned i = 0; i < kBits; ++i)
+            _mm256_storeu_si256(x32 + i, _mm256_xor_si256(_mm256_loadu_si256(x32 + i), prod[i]));
+        x32 += kBits, y32 += kBits;
+
+        bytes -= kBitsliceBlockBytes;
+    } while (bytes > 0);
+}
+
+static TARGET_AVX2 void BitsliceFFT_DIT2_avx2(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    const uint16_t* rows = GetBitsliceRows(log_m);
+
+    M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
+    M256 * RESTRICT y32 = reinterpret_cast<M256 *>(y);
+
+    do
+    {
+        M256 prod[kBits];
+        BitsliceMulBlock(y32, rows, prod);
+        for (unsigned i = 0; i < kBits; ++i)
+        {
+            const M256 x_data = _mm256_xor_si256(_mm256_loadu_si256(x32 + i), prod[i]);
+            _mm256_storeu_si256(x32 + i, x_data);
+            _mm256_storeu_si256(y32 + i, _mm256_xor_si256(_mm256_loadu_si256(y32 + i), x_data));
+        }
+        x32 += kBits, y32 += kBits;
+
+        bytes -= kBitsliceBlockBytes;
+    } while (bytes > 0);
+}
+
+static TARGET_AVX2 void BitsliceIFFT_DIT2_avx2(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    const uint16_t* rows = GetBitsliceRows(log_m);
+
+    M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
+    M256 * RESTRICT y32 = reinterpret_cast<M256 *>(y);
+
+    do
+    {
+        M256 y_data[kBits];
+        for (unsigned i = 0; i < kBits; ++i)
+        {
+            y_data[i] = _mm256_xor_si256(_mm256_loadu_si256(y32 + i), _mm256_loadu_si256(x32 + i));
+            _mm256_storeu_si256(y32 + i, y_data[i]);
+        }
+
+        M256 prod[kBits];
+        BitsliceMulBlock(y_data, rows, prod);
+        for (unsigned i = 0; i < kBits; ++i)
+            _mm256_storeu_si256(x32 + i, _mm256_xor_si256(_mm256_loadu_si256(x32 + i), prod[i]));
+        x32 += kBits, y32 += kBits;
+
+        bytes -= kBitsliceBlockBytes;
+    } while (bytes > 0);
+}
+
+void BitsliceMul(
+    void * RESTRICT x, const void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    BitsliceMul_avx2(x, y, log_m, bytes);
+}
+
+void BitsliceMulAdd(
+    void * RESTRICT x, const void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    BitsliceMulAdd_avx2(x, y, log_m, bytes);
+}
+
+void BitsliceFFT_DIT2(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    BitsliceFFT_DIT2_avx2(x, y, log_m, bytes);
+}
+
+void BitsliceIFFT_DIT2(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    BitsliceIFFT_DIT2_avx2(x, y, log_m, bytes);
+}
+
+void AltmapMul(
+    void * RESTRICT x, const void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    mul_mem(x, y, log_m, bytes);
+}
+
+void AltmapFFT_DIT2(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    FFT_DIT2(x, y, log_m, bytes);
+}
+
+void AltmapIFFT_DIT2(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    IFFT_DIT2(x, y, log_m, bytes);
+}
+
+#endif // TRY_AVX2
+
+
+//------------------------------------------------------------------------------
+// API
+
+// Use the table-free carry-less multiply kernels
+static bool UseCarrylessMultiply = false;
+
+// Points the versions of a 4-way butterfly for every set of trivial skews at
+// the specializations of a kernel template, or all at one plain kernel
+#define SELECT_DIT4(name, kernel) \
+    name[0] = kernel<0>, name[1] = kernel<1>, name[2] = kernel<2>, name[3] = kernel<3>, \
+    name[4] = kernel<4>, name[5] = kernel<5>, name[6] = kernel<6>, name[7] = kernel<7>
+#define SELECT_DIT4_STREAM(name, kernel) \
+    name[0] = kernel<0, true>, name[1] = kernel<1, true>, name[2] = kernel<2, true>, name[3] = kernel<3, true>, \
+    name[4] = kernel<4, true>, name[5] = kernel<5, true>, name[6] = kernel<6, true>, name[7] = kernel<7, true>
+#define SELECT_DIT4_ALL(name, kernel) \
+    for (unsigned trivial = 0; trivial < 8; ++trivial) \
+        name[trivial] = kernel
+
+// Points the field kernels at the widest versions the CPU supports.
+// InitializeCPUArch() must have run first
+static void SelectKernels()
+{
+    FWHT_Block = FWHT_Block_ref;
+    FWHT_Span4 = FWHT_Span4_ref;
+    FWHT_Span2 = FWHT_Span2_ref;
+    MulModElements = MulModElements_ref;
+    mul_mem = mul_mem_ref;
+    mul_mem_stream = mul_mem_ref;
+    IFFT_DIT2 = IFFT_DIT2_ref;
+    SELECT_DIT4_ALL(IFFT_DIT4, IFFT_DIT4_ref);
+    IFFT_DIT2_xor = IFFT_DIT2_xor_ref;
+    SELECT_DIT4_ALL(IFFT_DIT4_xor, IFFT_DIT4_xor_ref);
+    FFT_DIT2 = FFT_DIT2_ref;
+    FFT_DIT2_stream = FFT_DIT2_ref;
+    SELECT_DIT4_ALL(FFT_DIT4, FFT_DIT4_ref);
+    SELECT_DIT4_ALL(FFT_DIT4_stream, FFT_DIT4_ref);
+    IFFT_DIT8 = nullptr;
+    FFT_DIT8 = nullptr;
+    FFT_DIT8_stream = nullptr;
+
+    if (CpuHasSSSE3)
     {
-        Words[0][i / 64] |= (uint64_t)1 << (i % 64);
+        FWHT_Block = FWHT_Block_ssse3;
+        FWHT_Span4 = FWHT_Span4_ssse3;
+        FWHT_Span2 = FWHT_Span2_ssse3;
+        MulModElements = MulModElements_ssse3;
+        mul_mem = mul_mem_ssse3;
+        mul_mem_stream = mul_mem_ssse3;
+        IFFT_DIT2 = IFFT_DIT2_ssse3;
+        IFFT_DIT2_xor = IFFT_DIT2_xor_ssse3;
+        FFT_DIT2 = FFT_DIT2_ssse3;
+        FFT_DIT2_stream = FFT_DIT2_ssse3;
+#ifdef INTERLEAVE_BUTTERFLY4_OPT
+        SELECT_DIT4(IFFT_DIT4, IFFT_DIT4_ssse3);
+        SELECT_DIT4(IFFT_DIT4_xor, IFFT_DIT4_xor_ssse3);
+        SELECT_DIT4(FFT_DIT4, FFT_DIT4_ssse3);
+        SELECT_DIT4(FFT_DIT4_stream, FFT_DIT4_ssse3);
+#endif // INTERLEAVE_BUTTERFLY4_OPT
     }
 
-    void Prepare();
-
-    FORCE_INLINE bool IsNeeded(unsigned mip_level, unsigned bit) const
+#if defined(TRY_AVX2)
+    if (CpuHasAVX2)
     {
-        if (mip_level >= 16)
-            return true;
-        if (mip_level >= 12)
-        {
-            bit /= 4096;
-            return 0 != (BiggestWords[mip_level - 12] & ((uint64_t)1 << bit));
-        }
-        if (mip_level >= 6)
-        {
-            bit /= 64;
-            return 0 != (BigWords[mip_level - 6][bit / 64] & ((uint64_t)1 << (bit % 64)));
-        }
-        return 0 != (Words[mip_level - 1][bit / 64] & ((uint64_t)1 << (bit % 64)));
+        FWHT_Block = FWHT_Block_avx2;
+        FWHT_Span4 = FWHT_Span4_avx2;
+        FWHT_Span2 = FWHT_Span2_avx2;
+        MulModElements = MulModElements_avx2;
+        mul_mem = mul_mem_avx2;
+        mul_mem_stream = mul_mem_avx2<true>;
+        IFFT_DIT2 = IFFT_DIT2_avx2;
+        IFFT_DIT2_xor = IFFT_DIT2_xor_avx2;
+        FFT_DIT2 = FFT_DIT2_avx2;
+        FFT_DIT2_stream = FFT_DIT2_avx2<true>;
+#ifdef INTERLEAVE_BUTTERFLY4_OPT
+        SELECT_DIT4(IFFT_DIT4, IFFT_DIT4_avx2);
+        SELECT_DIT4(IFFT_DIT4_xor, IFFT_DIT4_xor_avx2);
+        SELECT_DIT4(FFT_DIT4, FFT_DIT4_avx2);
+        SELECT_DIT4_STREAM(FFT_DIT4_stream, FFT_DIT4_avx2);
+#endif // INTERLEAVE_BUTTERFLY4_OPT
     }
-};
-
-static const uint64_t kHiMasks[5] = {
-    0xAAAAAAAAAAAAAAAAULL,
-    0xCCCCCCCCCCCCCCCCULL,
-    0xF0F0F0F0F0F0F0F0ULL,
-    0xFF00FF00FF00FF00ULL,
-    0xFFFF0000FFFF0000ULL,
-};
+#endif // TRY_AVX2
 
-void ErrorBitfield::Prepare()
-{
-    // First mip level is for final layer of FFT: pairs of data
-    for (unsigned i = 0; i < kWords; ++i)
+#if defined(TRY_AVX512)
+    if (CpuHasAVX512)
     {
-        uint64_t w_i = Words[0][i];
-        const uint64_t hi2lo0 = w_i | ((w_i & kHiMasks[0]) >> 1);
-        const uint64_t lo2hi0 = ((w_i & (kHiMasks[0] >> 1)) << 1);
-        Words[0][i] = w_i = hi2lo0 | lo2hi0;
-
-        for (unsigned j = 1, bits = 2; j < kWordMips; ++j, bits <<= 1)
-        {
-            const uint64_t hi2lo_j = w_i | ((w_i & kHiMasks[j]) >> bits);
-            const uint64_t lo2hi_j = ((w_i & (kHiMasks[j] >> bits)) << bits);
-            Words[j][i] = w_i = hi2lo_j | lo2hi_j;
-        }
+        mul_mem = mul_mem_avx512;
+        mul_mem_stream = mul_mem_avx512<true>;
+        IFFT_DIT2 = IFFT_DIT2_avx512;
+        IFFT_DIT2_xor = IFFT_DIT2_xor_avx512;
+        FFT_DIT2 = FFT_DIT2_avx512;
+        FFT_DIT2_stream = FFT_DIT2_avx512<true>;
+#ifdef INTERLEAVE_BUTTERFLY4_OPT
+        SELECT_DIT4(IFFT_DIT4, IFFT_DIT4_avx512);
+        SELECT_DIT4(IFFT_DIT4_xor, IFFT_DIT4_xor_avx512);
+        SELECT_DIT4(FFT_DIT4, FFT_DIT4_avx512);
+        SELECT_DIT4_STREAM(FFT_DIT4_stream, FFT_DIT4_avx512);
+#endif // INTERLEAVE_BUTTERFLY4_OPT
+#ifdef INTERLEAVE_BUTTERFLY8_OPT
+        IFFT_DIT8 = IFFT_DIT8_avx512;
+        FFT_DIT8 = FFT_DIT8_avx512;
+        FFT_DIT8_stream = FFT_DIT8_avx512<true>;
+#endif // INTERLEAVE_BUTTERFLY8_OPT
     }
+#endif // TRY_AVX512
 
-    for (unsigned i = 0; i < kBigWords; ++i)
+#if defined(TRY_GFNI)
+    if (CpuHasGFNI)
     {
-        uint64_t w_i = 0;
-        uint64_t bit = 1;
-        const uint64_t* src = &Words[kWordMips - 1][i * 64];
-        for (unsigned j = 0; j < 64; ++j, bit <<= 1)
-        {
-            const uint64_t w = src[j];
-            w_i |= (w | (w >> 32) | (w << 32)) & bit;
-        }
-        BigWords[0][i] = w_i;
-
-        for (unsigned j = 1, bits = 1; j < kBigMips; ++j, bits <<= 1)
-        {
-            const uint64_t hi2lo_j = w_i | ((w_i & kHiMasks[j - 1]) >> bits);
-            const uint64_t lo2hi_j = ((w_i & (kHiMasks[j - 1] >> bits)) << bits);
-            BigWords[j][i] = w_i = hi2lo_j | lo2hi_j;
-        }
+        mul_mem = mul_mem_gfni;
+        mul_mem_stream = mul_mem_gfni<true>;
+        IFFT_DIT2 = IFFT_DIT2_gfni;
+        IFFT_DIT2_xor = IFFT_DIT2_xor_gfni;
+        FFT_DIT2 = FFT_DIT2_gfni;
+        FFT_DIT2_stream = FFT_DIT2_gfni<true>;
+#ifdef INTERLEAVE_BUTTERFLY4_OPT
+        SELECT_DIT4(IFFT_DIT4, IFFT_DIT4_gfni);
+        SELECT_DIT4(IFFT_DIT4_xor, IFFT_DIT4_xor_gfni);
+        SELECT_DIT4(FFT_DIT4, FFT_DIT4_gfni);
+        SELECT_DIT4_STREAM(FFT_DIT4_stream, FFT_DIT4_gfni);
+#endif // INTERLEAVE_BUTTERFLY4_OPT
     }
 
-    uint64_t w_i = 0;
-    uint64_t bit = 1;
-    const uint64_t* src = &BigWords[kBigMips - 1][0];
-    for (unsigned j = 0; j < kBigWords; ++j, bit <<= 1)
+#if defined(TRY_AVX512)
+    if (CpuHasGFNI && CpuHasAVX512)
     {
-        const uint64_t w = src[j];
-        w_i |= (w | (w >> 32) | (w << 32)) & bit;
+        mul_mem = mul_mem_avx512_gfni;
+        mul_mem_stream = mul_mem_avx512_gfni<true>;
+        IFFT_DIT2 = IFFT_DIT2_avx512_gfni;
+        IFFT_DIT2_xor = IFFT_DIT2_xor_avx512_gfni;
+        FFT_DIT2 = FFT_DIT2_avx512_gfni;
+        FFT_DIT2_stream = FFT_DIT2_avx512_gfni<true>;
+#ifdef INTERLEAVE_BUTTERFLY4_OPT
+        SELECT_DIT4(IFFT_DIT4, IFFT_DIT4_avx512_gfni);
+        SELECT_DIT4(IFFT_DIT4_xor, IFFT_DIT4_xor_avx512_gfni);
+        SELECT_DIT4(FFT_DIT4, FFT_DIT4_avx512_gfni);
+        SELECT_DIT4_STREAM(FFT_DIT4_stream, FFT_DIT4_avx512_gfni);
+#endif // INTERLEAVE_BUTTERFLY4_OPT
+#ifdef INTERLEAVE_BUTTERFLY8_OPT
+        IFFT_DIT8 = IFFT_DIT8_avx512_gfni;
+        FFT_DIT8 = FFT_DIT8_avx512_gfni;
+        FFT_DIT8_stream = FFT_DIT8_avx512_gfni<true>;
+#endif // INTERLEAVE_BUTTERFLY8_OPT
     }
-    BiggestWords[0] = w_i;
+#endif // TRY_AVX512
+#endif // TRY_GFNI
 
-    for (unsigned j = 1, bits = 1; j < kBiggestMips; ++j, bits <<= 1)
+#if defined(TRY_CLMUL)
+    // Low memory mode: DIT4 falls back to pairs of DIT2 calls
+    if (UseCarrylessMultiply)
     {
-        const uint64_t hi2lo_j = w_i | ((w_i & kHiMasks[j - 1]) >> bits);
-        const uint64_t lo2hi_j = ((w_i & (kHiMasks[j - 1] >> bits)) << bits);
-        BiggestWords[j] = w_i = hi2lo_j | lo2hi_j;
+        IFFT_DIT8 = nullptr;
+        FFT_DIT8 = nullptr;
+        FFT_DIT8_stream = nullptr;
+        mul_mem = mul_mem_clmul;
+        mul_mem_stream = mul_mem_clmul;
+        IFFT_DIT2 = IFFT_DIT2_clmul;
+        IFFT_DIT2_xor = IFFT_DIT2_xor_clmul;
+        FFT_DIT2 = FFT_DIT2_clmul;
+        FFT_DIT2_stream = FFT_DIT2_clmul;
+        SELECT_DIT4_ALL(IFFT_DIT4, IFFT_DIT4_ref);
+        SELECT_DIT4_ALL(IFFT_DIT4_xor, IFFT_DIT4_xor_ref);
+        SELECT_DIT4_ALL(FFT_DIT4, FFT_DIT4_ref);
+        SELECT_DIT4_ALL(FFT_DIT4_stream, FFT_DIT4_ref);
     }
+#endif // TRY_CLMUL
 }
 
+static bool IsInitialized = false;
 
-static void FFT_DIT_ErrorBits(
-    const uint64_t bytes,
-    void** work,
-    const unsigned n_truncated,
-    const unsigned n,
-    const ffe_t* skewLUT,
-    const ErrorBitfield& error_bits)
+bool Initialize()
 {
-    unsigned mip_level = LastNonzeroBit32(n);
+    if (IsInitialized)
+        return true;
 
-    // Decimation in time: Unroll 2 layers at a time
-    unsigned dist4 = n, dist = n >> 2;
-    for (; dist != 0; dist4 = dist, dist >>= 2, mip_level -=2)
-    {
-        // For each set of dist*4 elements:
-#pragma omp parallel for
-        for (int r = 0; r < (int)n_truncated; r += dist4)
-        {
-            if (!error_bits.IsNeeded(mip_level, r))
-                continue;
+#if defined(TRY_CLMUL)
+    InitializeCarrylessTables();
+#endif // TRY_CLMUL
+    if (!UseCarrylessMultiply && !InitializeMultiplyTables())
+        return false;
+    SelectKernels();
 
-            const unsigned i_end = r + dist;
-            const ffe_t log_m01 = skewLUT[i_end];
-            const ffe_t log_m02 = skewLUT[i_end + dist];
-            const ffe_t log_m23 = skewLUT[i_end + dist * 2];
+    IsInitialized = true;
+    return true;
+}
 
-            // For each set of dist elements:
-#pragma omp parallel for
-            for (int i = r; i < (int)i_end; ++i)
-            {
-                FFT_DIT4(
-                    bytes,
-                    work + i,
-                    dist,
-                    log_m01,
-                    log_m23,
-                    log_m02);
-            }
-        }
-    }
+bool SetCarrylessMultiply(bool enabled)
+{
+#if defined(TRY_CLMUL)
+    if (enabled && !CpuHasCLMUL)
+        return false;
+#else
+    if (enabled)
+        return false;
+#endif // TRY_CLMUL
 
-    // If there is one layer left:
-    if (dist4 == 2)
-    {
-#pragma omp parallel for
-        for (int r = 0; r < (int)n_truncated; r += 2)
-        {
-            if (!error_bits.IsNeeded(mip_level, r))
-                continue;
+    if (IsInitialized && !enabled && !InitializeMultiplyTables())
+        return false;
 
-            const ffe_t log_m = skewLUT[r + 1];
+    UseCarrylessMultiply = enabled;
 
-            if (log_m == kModulus)
-                xor_mem(work[r + 1], work[r], bytes);
-            else
-            {
-                FFT_DIT2(
-                    work[r],
-                    work[r + 1],
-                    log_m,
-                    bytes);
-            }
-        }
-    }
+    if (IsInitialized)
+        SelectKernels();
+    return true;
 }
 
-#endif // ERROR_BITFIELD_OPT
-
 
 //------------------------------------------------------------------------------
-// Reed-Solomon Decode
+// Table Image
 
-void ReedSolomonDecode(
-    uint64_t buffer_bytes,
-    unsigned original_count,
-    unsigned recovery_count,
-    unsigned m, // NextPow2(recovery_count)
-    unsigned n, // NextPow2(m + original_count) = work_count
-    const void* const * const original, // original_count entries
-    const void* const * const recovery, // recovery_count entries
-    void** work) // n entries
+/*
+    A table image holds the multiply tables built by Initialize() so that
+    other processes can map them read-only instead of computing them:
+
+        Header, padded to kTableImageAlign bytes
+        Multiply tables of Header.Layout at Header.MultiplyOffset
+
+    The tables start on a page boundary, so they keep the alignment of
+    LargeAllocation.  They depend on the instruction set, so an image is
+    only loaded on CPUs that select the same layout.  The logarithm and FFT
+    tables are compiled in and are not part of the image.
+*/
+
+// "RSCODEC" and 0x10 for GF(2^16), read as a little-endian integer
+static const uint64_t kTableImageMagic = 0x104345444f435352ULL;
+
+// Increment when any table or the file format changes
+static const uint32_t kTableImageVersion = 2;
+
+static const uint64_t kTableImageAlign = 4096;
+
+struct TableImageHeader
 {
-    // Fill in error locations
+    uint64_t Magic;
+    uint32_t Version;
+    uint32_t Layout;            // MultiplyTableLayout
+    uint64_t MultiplyOffset;    // Bytes from the start of the file
+    uint64_t MultiplyBytes;
+    uint64_t ImageBytes;
+    uint64_t Checksum;          // Of all bytes after the header padding
+};
 
-#ifdef ERROR_BITFIELD_OPT
-    ErrorBitfield error_bits;
-#endif // ERROR_BITFIELD_OPT
+static uint64_t TableImageRoundUp(uint64_t bytes)
+{
+    return (bytes + kTableImageAlign - 1) & ~(kTableImageAlign - 1);
+}
 
-    ffe_t error_locations[kOrder] = {};
-    for (unsigned i = 0; i < recovery_count; ++i)
-        if (!recovery[i])
-            error_locations[i] = 1;
-    for (unsigned i = recovery_count; i < m; ++i)
-        error_locations[i] = 1;
-    for (unsigned i = 0; i < original_count; ++i)
+// Returns the multiply tables of the given layout, or null if the build has
+// no such tables.  Sets bytes to their size
+static const void* MultiplyTableData(uint32_t layout, uint64_t& bytes)
+{
+    switch (layout)
+    {
+    case LayoutProduct16:
+        bytes = sizeof(Product16Table) * kOrder;
+        return Multiply16LUT;
+    case Layout128:
+        bytes = sizeof(Multiply128LUT_t) * kOrder;
+        return Multiply128LUT;
+#if defined(TRY_GFNI)
+    case LayoutAffine:
+        bytes = sizeof(Multiply16Affine_t) * kOrder;
+        return Multiply16Affine;
+#endif // TRY_GFNI
+    default:
+        break;
+    }
+    bytes = 0;
+    return nullptr;
+}
+
+// 64-bit checksum of bytes, a multiple of 32.  Four independent lanes keep it
+// at about a millisecond per 16 MB of image
+static uint64_t TableImageChecksum(const uint8_t* data, uint64_t bytes)
+{
+    static const uint64_t kPrime = 0x100000001b3ULL;
+    uint64_t lanes[4] = {
+        0xcbf29ce484222325ULL, 0x84222325cbf29ce4ULL,
+        0x9e3779b97f4a7c15ULL, 0x7f4a7c159e3779b9ULL
+    };
+
+    for (uint64_t i = 0; i < bytes; i += 32)
     {
-        if (!original[i])
+        for (unsigned j = 0; j < 4; ++j)
         {
-            error_locations[i + m] = 1;
-#ifdef ERROR_BITFIELD_OPT
-            error_bits.Set(i + m);
-#endif // ERROR_BITFIELD_OPT
+            uint64_t word;
+            memcpy(&word, data + i + j * 8, 8);
+            lanes[j] = (lanes[j] ^ word) * kPrime;
+            lanes[j] ^= lanes[j] >> 32;
         }
     }
 
-#ifdef ERROR_BITFIELD_OPT
-    error_bits.Prepare();
-#endif // ERROR_BITFIELD_OPT
+    uint64_t checksum = bytes;
+    for (unsigned j = 0; j < 4; ++j)
+        checksum = (checksum ^ lanes[j]) * kPrime;
+    return checksum;
+}
 
-    // Evaluate error locator polynomial
+bool SaveTableImage(const char* path)
+{
+    if (!IsInitialized || !path)
+        return false;
 
-    FWHT(error_locations, kOrder, m + original_count);
+    TableImageHeader header;
+    memset(&header, 0, sizeof(header));
+    header.Magic = kTableImageMagic;
+    header.Version = kTableImageVersion;
+    header.Layout = LayoutNone;
+
+    const void* multiply_data = nullptr;
+    if (MultiplyTablesReady)
+    {
+        header.Layout = SelectMultiplyTableLayout();
+        multiply_data = MultiplyTableData(header.Layout, header.MultiplyBytes);
+        if (!multiply_data)
+            header.Layout = LayoutNone;
+    }
 
-#pragma omp parallel for
-    for (int i = 0; i < (int)kOrder; ++i)
-        error_locations[i] = ((unsigned)error_locations[i] * (unsigned)LogWalsh[i]) % kModulus;
+    header.MultiplyOffset = kTableImageAlign;
+    header.ImageBytes = TableImageRoundUp(header.MultiplyOffset + header.MultiplyBytes);
 
-    FWHT(error_locations, kOrder, kOrder);
+    std::vector<uint8_t> image(static_cast<size_t>(header.ImageBytes), 0);
+    if (multiply_data)
+        memcpy(&image[header.MultiplyOffset], multiply_data, header.MultiplyBytes);
 
-    // work <- recovery data
+    header.Checksum = TableImageChecksum(image.data() + kTableImageAlign, header.ImageBytes - kTableImageAlign);
+    memcpy(&image[0], &header, sizeof(header));
 
-#pragma omp parallel for
-    for (int i = 0; i < (int)recovery_count; ++i)
+    // Write a temporary file and rename it over the image, so processes that
+    // already map the old image keep reading a complete file
+    const std::string temp_path = std::string(path) + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "wb");
+    if (!file)
+        return false;
+    const bool written = fwrite(image.data(), 1, image.size(), file) == image.size();
+    if (fclose(file) != 0 || !written)
     {
-        if (recovery[i])
-            mul_mem(work[i], recovery[i], error_locations[i], buffer_bytes);
-        else
-            memset(work[i], 0, buffer_bytes);
+        remove(temp_path.c_str());
+        return false;
     }
-#pragma omp parallel for
-    for (int i = recovery_count; i < (int)m; ++i)
-        memset(work[i], 0, buffer_bytes);
-
-    // work <- original data
-
-#pragma omp parallel for
-    for (int i = 0; i < (int)original_count; ++i)
+#ifdef _WIN32
+    remove(path);
+#endif // _WIN32
+    if (rename(temp_path.c_str(), path) != 0)
     {
-        if (original[i])
-            mul_mem(work[m + i], original[i], error_locations[m + i], buffer_bytes);
-        else
-            memset(work[m + i], 0, buffer_bytes);
+        remove(temp_path.c_str());
+        return false;
     }
-#pragma omp parallel for
-    for (int i = m + original_count; i < (int)n; ++i)
-        memset(work[i], 0, buffer_bytes);
+    return true;
+}
 
-    // work <- IFFT(work, n, 0)
+bool LoadTableImage(const char* path)
+{
+    if (IsInitialized || !path)
+        return false;
 
-    IFFT_DIT_Decoder(
-        buffer_bytes,
-        m + original_count,
-        work,
-        n,
-        FFTSkew - 1);
+    // Stays mapped for the life of the process
+    static MappedFile Image;
+    if (!Image.Open(path))
+        return false;
 
-    // work <- FormalDerivative(work, n)
+    TableImageHeader header;
+    bool valid = Image.Bytes >= kTableImageAlign;
+    if (valid)
+    {
+        memcpy(&header, Image.Data, sizeof(header));
+        valid = header.Magic == kTableImageMagic &&
+            header.Version == kTableImageVersion &&
+            header.ImageBytes == Image.Bytes &&
+            header.MultiplyOffset == kTableImageAlign &&
+            header.MultiplyOffset + header.MultiplyBytes <= header.ImageBytes;
+    }
 
-    for (unsigned i = 1; i < n; ++i)
+    // Unless the carry-less multiply needs none, the image must hold the
+    // multiply tables for this instruction set.  An image saved with the
+    // carry-less backend has none, and would leave them to be built here
+    uint64_t expected_bytes = 0;
+    const bool use_tables = !UseCarrylessMultiply;
+    if (valid && use_tables)
     {
-        const unsigned width = ((i ^ (i - 1)) + 1) >> 1;
+        MultiplyTableData(header.Layout, expected_bytes);
+        valid = header.Layout == static_cast<uint32_t>(SelectMultiplyTableLayout()) &&
+            expected_bytes != 0 && expected_bytes == header.MultiplyBytes;
+    }
 
-        if (width < 8)
-        {
-            VectorXOR(
-                buffer_bytes,
-                width,
-                work + i - width,
-                work + i);
-        }
-        else
+    if (!valid ||
+        header.Checksum != TableImageChecksum(Image.Data + kTableImageAlign, header.ImageBytes - kTableImageAlign))
+    {
+        Image.Close();
+        return false;
+    }
+
+    if (use_tables)
+    {
+        const void* tables = Image.Data + header.MultiplyOffset;
+        switch (header.Layout)
         {
-            VectorXOR_Threads(
-                buffer_bytes,
-                width,
-                work + i - width,
-                work + i);
+        case LayoutProduct16:
+            Multiply16LUT = reinterpret_cast<const Product16Table*>(tables);
+            break;
+        case Layout128:
+            Multiply128LUT = reinterpret_cast<const Multiply128LUT_t*>(tables);
+            break;
+#if defined(TRY_GFNI)
+        case LayoutAffine:
+            Multiply16Affine = reinterpret_cast<const Multiply16Affine_t*>(tables);
+            break;
+#endif // TRY_GFNI
+        default:
+            break;
         }
+        MultiplyTablesReady = true;
     }
 
-    // work <- FFT(work, n, 0) truncated to m + original_count
-
-    const unsigned output_count = m + original_count;
-
-#ifdef ERROR_BITFIELD_OPT
-    FFT_DIT_ErrorBits(buffer_bytes, work, output_count, n, FFTSkew - 1, error_bits);
-#else
-    FFT_DIT(buffer_bytes, work, output_count, n, FFTSkew - 1);
-#endif
-
-    // Reveal erasures
+#if defined(TRY_CLMUL)
+    InitializeCarrylessTables();
+#endif // TRY_CLMUL
+    if (!UseCarrylessMultiply && !InitializeMultiplyTables())
+        return false;
+    SelectKernels();
 
-    for (unsigned i = 0; i < original_count; ++i)
-        if (!original[i])
-            mul_mem(work[i], work[i + m], kModulus - error_locations[i + m], buffer_bytes);
+    IsInitialized = true;
+    return true;
 }
 
-
-//------------------------------------------------------------------------------
-// API
-
-static bool IsInitialized = false;
-
-bool Initialize()
+bool InitializeBitslice()
 {
-    if (IsInitialized)
+#if defined(TRY_AVX2)
+    if (!IsInitialized || !CpuHasAVX2)
+        return false;
+    if (!BitsliceRows.empty())
         return true;
 
-    InitializeLogarithmTables();
-    InitializeMultiplyTables();
-    FFTInitialize();
+    BitsliceRows.resize((size_t)kOrder * kBits);
 
-    IsInitialized = true;
+    // Column j of the matrix is the product of basis element j
+    for (unsigned log_m = 0; log_m < kOrder; ++log_m)
+    {
+        uint16_t* rows = &BitsliceRows[(size_t)log_m * kBits];
+        for (unsigned j = 0; j < kBits; ++j)
+        {
+            const ffe_t column = MultiplyLog(static_cast<ffe_t>(1 << j), static_cast<ffe_t>(log_m));
+            for (unsigned i = 0; i < kBits; ++i)
+                rows[i] |= ((column >> i) & 1) << j;
+        }
+    }
     return true;
+#else
+    return false;
+#endif // TRY_AVX2
 }
 
 
@@ -34,13 +34,39 @@ static const ffe_t kModulus = 65535;
 // LFSR Polynomial that generates the field elements
 static const unsigned kPolynomial = 0x1002D;
 
+// Basis used for generating logarithm tables
+static const ffe_t kCantorBasis[kBits] = {
+    0x0001, 0xACCA, 0x3C0E, 0x163E,
+    0xC582, 0xED2E, 0x914C, 0x4012,
+    0x6C98, 0x10D8, 0x6A72, 0xB900,
+    0xFDB8, 0xFB34, 0xFF38, 0x991E
+};
+
+// Using the Cantor basis here enables us to avoid a lot of extra calculations
+// when applying the formal derivative in decoding.
+
 
 //------------------------------------------------------------------------------
 // API
 
-// Returns false if the self-test fails
+// Returns false if the self-test fails or the tables cannot be allocated
 bool Initialize();
 
+// Switch between the multiply tables (default) and table-free carry-less
+// multiplication.  Enabling it before Initialize() skips building the tables.
+// Returns false if the CPU lacks PCLMULQDQ or SSE4.1, or if the tables cannot
+// be allocated
+bool SetCarrylessMultiply(bool enabled);
+
+// Writes the tables built by Initialize() to a versioned, checksummed image
+// file.  Returns false if not initialized or the file cannot be written
+bool SaveTableImage(const char* path);
+
+// Maps an image from SaveTableImage() read-only in place of Initialize().
+// Returns false if already initialized, or if the file is missing, corrupt,
+// from another version, or has multiply tables for another instruction set
+bool LoadTableImage(const char* path);
+
 void ReedSolomonEncode(
     uint64_t buffer_bytes,
     unsigned original_count,
@@ -49,6 +75,17 @@ void ReedSolomonEncode(
     const void* const * const data,
     void** work); // m * 2 elements
 
+// Error locator state for one erasure pattern.
+// Decoders can keep one around to avoid allocating one on each call
+struct ErrorLocator;
+
+ErrorLocator* CreateErrorLocator();
+void FreeErrorLocator(ErrorLocator* locator);
+
+// Set the number of error locators kept for repeated erasure patterns.
+// 0 disables the cache
+void SetErrorLocatorCacheSize(unsigned entries);
+
 void ReedSolomonDecode(
     uint64_t buffer_bytes,
     unsigned original_count,
@@ -57,7 +94,70 @@ void ReedSolomonDecode(
     unsigned n, // = NextPow2(m + original_count)
     const void* const * const original, // original_count elements
     const void* const * const recovery, // recovery_count elements
-    void** work); // n elements
+    void** work, // n elements
+    ErrorLocator* locator = nullptr); // Optional scratch space
+
+// Decodes stripe_count stripes that are missing the same pieces.
+// The error locator is evaluated once for all of them
+void ReedSolomonDecodeBatch(
+    uint64_t buffer_bytes,
+    unsigned original_count,
+    unsigned recovery_count,
+    unsigned m, // = NextPow2(recovery_count)
+    unsigned n, // = NextPow2(m + original_count)
+    unsigned stripe_count,
+    const void* const * const * original, // stripe_count arrays of original_count elements
+    const void* const * const * recovery, // stripe_count arrays of recovery_count elements
+    void** const * work, // stripe_count arrays of n elements
+    ErrorLocator* locator = nullptr); // Optional scratch space
+
+
+//------------------------------------------------------------------------------
+// Bitsliced Layout (Experimental)
+
+#if defined(TRY_AVX2)
+
+/*
+    The ALTMAP layout multiplies with PSHUFB table lookups.  The bitsliced
+    layout instead stores each block of 256 symbols as 16 bit-planes of 32
+    bytes, with plane b holding bit b of every symbol.  Multiplying by a
+    constant is then a fixed XOR network taken from the constant's 16x16 bit
+    matrix, with no table lookups.
+
+    This is not used by the encoder or decoder yet: The kernels below exist
+    so that the benchmark can compare the two layouts on large stripes.
+    Buffers must be a multiple of kBitsliceBlockBytes.
+*/
+
+// Bytes per block of 256 symbols
+static const unsigned kBitsliceBlockBytes = 512;
+
+// Builds the XOR networks for every log_m (2 MB).  Call after Initialize().
+// Returns false if the CPU lacks AVX2
+bool InitializeBitslice();
+
+// Converts between the ALTMAP and bitsliced layouts
+void BitsliceFromAltmap(void* out, const void* in, uint64_t bytes);
+void BitsliceToAltmap(void* out, const void* in, uint64_t bytes);
+
+// x[] = y[] * m
+void BitsliceMul(void* x, const void* y, ffe_t log_m, uint64_t bytes);
+
+// x[] ^= y[] * m
+void BitsliceMulAdd(void* x, const void* y, ffe_t log_m, uint64_t bytes);
+
+// x[] ^= y[] * m, y[] ^= x[]
+void BitsliceFFT_DIT2(void* x, void* y, ffe_t log_m, uint64_t bytes);
+
+// y[] ^= x[], x[] ^= y[] * m
+void BitsliceIFFT_DIT2(void* x, void* y, ffe_t log_m, uint64_t bytes);
+
+// The same operations on the ALTMAP layout with the selected table kernels
+void AltmapMul(void* x, const void* y, ffe_t log_m, uint64_t bytes);
+void AltmapFFT_DIT2(void* x, void* y, ffe_t log_m, uint64_t bytes);
+void AltmapIFFT_DIT2(void* x, void* y, ffe_t log_m, uint64_t bytes);
+
+#endif // TRY_AVX2
 
 
 }} // namespace codec::ff16
@@ -11,18 +11,6 @@
 namespace codec { namespace ff8 {
 
 
-//------------------------------------------------------------------------------
-// Datatypes and Constants
-
-// Basis used for generating logarithm tables
-static const ffe_t kCantorBasis[kBits] = {
-    1, 214, 152, 146, 86, 200, 88, 230
-};
-
-// Using the Cantor basis {2} here enables us to avoid a lot of extra calculations
-// when applying the formal derivative in decoding.
-
-
 //------------------------------------------------------------------------------
 // Field Operations
 
@@ -103,67 +91,11 @@ static void FWHT(ffe_t* data, const unsigned m, const unsigned m_truncated)
 
 
 //------------------------------------------------------------------------------
-// Logarithm Tables
-
-static ffe_t LogLUT[kOrder];
-static ffe_t ExpLUT[kOrder];
-
-
-// Returns a * Log(b)
-static ffe_t MultiplyLog(ffe_t a, ffe_t log_b)
-{
-    /*
-        Note that this operation is not a normal multiplication in a finite
-        field because the right operand is already a logarithm.  This is done
-        because it moves K table lookups from the Decode() method into the
-        initialization step that is less performance critical.  The LogWalsh[]
-        table below contains precalculated logarithms so it is easier to do
-        all the other multiplies in that form as well.
-    */
-    if (a == 0)
-        return 0;
-    return ExpLUT[AddMod(LogLUT[a], log_b)];
-}
-
-
-// Initialize LogLUT[], ExpLUT[]
-static void InitializeLogarithmTables()
-{
-    // LFSR table generation:
-
-    unsigned state = 1;
-    for (unsigned i = 0; i < kModulus; ++i)
-    {
-        ExpLUT[state] = static_cast<ffe_t>(i);
-        state <<= 1;
-        if (state >= kOrder)
-            state ^= kPolynomial;
-    }
-    ExpLUT[0] = kModulus;
-
-    // Conversion to Cantor basis {2}:
-
-    LogLUT[0] = 0;
-    for (unsigned i = 0; i < kBits; ++i)
-    {
-        const ffe_t basis = kCantorBasis[i];
-        const unsigned width = static_cast<unsigned>(1UL << i);
-
-        for (unsigned j = 0; j < width; ++j)
-            LogLUT[j + width] = LogLUT[j] ^ basis;
-    }
-
-    for (unsigned i = 0; i < kOrder; ++i)
-        LogLUT[i] = ExpLUT[LogLUT[i]];
+// Generated Tables
 
-    // Generate Exp table from Log table:
-
-    for (unsigned i = 0; i < kOrder; ++i)
-        ExpLUT[LogLUT[i]] = i;
-
-    // Note: Handles modulus wrap around with LUT
-    ExpLUT[kModulus] = ExpLUT[0];
-}
+// LogLUT[], ExpLUT[], FFTSkew[], LogWalsh[] and the multiply tables below are
+// generated at build time by TableGenerator.cpp
+#include "FF8Tables.h"
 
 
 //------------------------------------------------------------------------------
@@ -179,7 +111,7 @@ struct Multiply128LUT_t
     M128 Value[2];
 };
 
-static const Multiply128LUT_t* Multiply128LUT = nullptr;
+static const Multiply128LUT_t* Multiply128LUT = reinterpret_cast<const Multiply128LUT_t*>(Multiply128Bytes);
 
 // 128-bit x_reg ^= y_reg * log_m
 #define MULADD_128(x_reg, y_reg, table_lo, table_hi) { \
@@ -197,7 +129,7 @@ struct Multiply256LUT_t
     M256 Value[2];
 };
 
-static const Multiply256LUT_t* Multiply256LUT = nullptr;
+static const Multiply256LUT_t* Multiply256LUT = reinterpret_cast<const Multiply256LUT_t*>(Multiply256Bytes);
 
 // 256-bit x_reg ^= y_reg * log_m
 #define MULADD_256(x_reg, y_reg, table_lo, table_hi) { \
@@ -210,9 +142,23 @@ static const Multiply256LUT_t* Multiply256LUT = nullptr;
 
 #endif // TRY_AVX2
 
-// Stores the product of x * y at offset x + y * 256
+#if defined(TRY_GFNI)
+
+/*
+    Multiplying by a constant is linear over GF(2), so with GFNI it is a
+    single 8x8 bit-matrix transform (gf2p8affineqb) instead of two nibble
+    lookups.  Byte 7 - i of each matrix holds row i: the bits j for which
+    bit i of the product (1 << j) * m is set.  Multiply8Affine[] is generated.
+*/
+
+// 256-bit x_reg ^= y_reg * log_m
+#define MULADD_GFNI_256(x_reg, y_reg, matrix) { \
+                x_reg = _mm256_xor_si256(x_reg, _mm256_gf2p8affine_epi64_epi8(y_reg, matrix, 0)); }
+
+#endif // TRY_GFNI
+
+// Multiply8LUT[] stores the product of x * y at offset x + y * 256
 // Repeated accesses from the same y value are faster
-static const ffe_t* Multiply8LUT = nullptr;
 
 
 // Reference version of muladd: x[] ^= y[] * log_m
@@ -308,149 +254,120 @@ static FORCE_INLINE void RefMul(
 #endif
 }
 
-static void InitializeMultiplyTables()
-{
-    // If we cannot use the PSHUFB instruction, generate Multiply8LUT:
-    if (!CpuHasSSSE3)
-    {
-        Multiply8LUT = new ffe_t[256 * 256];
-
-        // For each left-multiplicand:
-        for (unsigned x = 0; x < 256; ++x)
-        {
-            ffe_t* lut = (ffe_t*)Multiply8LUT + x;
+static void (*mul_mem)(
+    void * RESTRICT x, const void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes);
 
-            if (x == 0)
-            {
-                for (unsigned log_y = 0; log_y < 256; ++log_y, lut += 256)
-                    *lut = 0;
-            }
-            else
-            {
-                const ffe_t log_x = LogLUT[x];
+// mul_mem() writing x[] with streaming stores where the CPU has them
+static void (*mul_mem_stream)(
+    void * RESTRICT x, const void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes);
 
-                for (unsigned log_y = 0; log_y < 256; ++log_y, lut += 256)
-                {
-                    const ffe_t prod = ExpLUT[AddMod(log_x, log_y)];
-                    *lut = prod;
-                }
-            }
-        }
+#if defined(TRY_GFNI)
 
-        return;
-    }
+template<bool kStream = false>
+static TARGET_GFNI void mul_mem_gfni(
+    void * RESTRICT x, const void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    const M256 matrix_y = _mm256_set1_epi64x(Multiply8Affine[log_m]);
 
-#ifdef TRY_AVX2
-    if (CpuHasAVX2)
-        Multiply256LUT = reinterpret_cast<const Multiply256LUT_t*>(SIMDSafeAllocate(sizeof(Multiply256LUT_t) * kOrder));
-    else
-#endif // TRY_AVX2
-        Multiply128LUT = reinterpret_cast<const Multiply128LUT_t*>(SIMDSafeAllocate(sizeof(Multiply128LUT_t) * kOrder));
+    M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
+    const M256 * RESTRICT y32 = reinterpret_cast<const M256 *>(y);
 
-    // For each value we could multiply by:
-    for (unsigned log_m = 0; log_m < kOrder; ++log_m)
+    do
     {
-        // For each 4 bits of the finite field width in bits:
-        for (unsigned i = 0, shift = 0; i < 2; ++i, shift += 4)
-        {
-            // Construct 16 entry LUT for PSHUFB
-            uint8_t lut[16];
-            for (ffe_t x = 0; x < 16; ++x)
-                lut[x] = MultiplyLog(x << shift, static_cast<ffe_t>(log_m));
+        const M256 data_0 = _mm256_loadu_si256(y32);
+        const M256 data_1 = _mm256_loadu_si256(y32 + 1);
+        STORE_256(kStream, x32, _mm256_gf2p8affine_epi64_epi8(data_0, matrix_y, 0));
+        STORE_256(kStream, x32 + 1, _mm256_gf2p8affine_epi64_epi8(data_1, matrix_y, 0));
+        y32 += 2, x32 += 2;
 
-            const M128 *v_ptr = reinterpret_cast<const M128 *>(&lut[0]);
-            const M128 value = _mm_loadu_si128(v_ptr);
-
-            // Store in 128-bit wide table
-#if defined(TRY_AVX2)
-            if (!CpuHasAVX2)
-#endif // TRY_AVX2
-                _mm_storeu_si128((M128*)&Multiply128LUT[log_m].Value[i], value);
+        bytes -= 64;
+    } while (bytes > 0);
 
-            // Store in 256-bit wide table
-#if defined(TRY_AVX2)
-            if (CpuHasAVX2)
-            {
-                _mm256_storeu_si256((M256*)&Multiply256LUT[log_m].Value[i],
-                    _mm256_broadcastsi128_si256(value));
-            }
-#endif // TRY_AVX2
-        }
-    }
+    if (kStream)
+        _mm_sfence();
 }
 
+#endif // TRY_GFNI
+
+#if defined(TRY_AVX2)
 
-static void mul_mem(
+template<bool kStream = false>
+static TARGET_AVX2 void mul_mem_avx2(
     void * RESTRICT x, const void * RESTRICT y,
     ffe_t log_m, uint64_t bytes)
 {
-#if defined(TRY_AVX2)
-    if (CpuHasAVX2)
-    {
-        const M256 table_lo_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[0]);
-        const M256 table_hi_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[1]);
+    const M256 table_lo_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[0]);
+    const M256 table_hi_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[1]);
 
-        const M256 clr_mask = _mm256_set1_epi8(0x0f);
+    const M256 clr_mask = _mm256_set1_epi8(0x0f);
 
-        M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
-        const M256 * RESTRICT y32 = reinterpret_cast<const M256 *>(y);
+    M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
+    const M256 * RESTRICT y32 = reinterpret_cast<const M256 *>(y);
 
-        do
-        {
+    do
+    {
 #define MUL_256(x_ptr, y_ptr) { \
-            M256 data = _mm256_loadu_si256(y_ptr); \
-            M256 lo = _mm256_and_si256(data, clr_mask); \
-            lo = _mm256_shuffle_epi8(table_lo_y, lo); \
-            M256 hi = _mm256_srli_epi64(data, 4); \
-            hi = _mm256_and_si256(hi, clr_mask); \
-            hi = _mm256_shuffle_epi8(table_hi_y, hi); \
-            _mm256_storeu_si256(x_ptr, _mm256_xor_si256(lo, hi)); }
+        M256 data = _mm256_loadu_si256(y_ptr); \
+        M256 lo = _mm256_and_si256(data, clr_mask); \
+        lo = _mm256_shuffle_epi8(table_lo_y, lo); \
+        M256 hi = _mm256_srli_epi64(data, 4); \
+        hi = _mm256_and_si256(hi, clr_mask); \
+        hi = _mm256_shuffle_epi8(table_hi_y, hi); \
+        STORE_256(kStream, x_ptr, _mm256_xor_si256(lo, hi)); }
+
+        MUL_256(x32 + 1, y32 + 1);
+        MUL_256(x32, y32);
+        y32 += 2, x32 += 2;
 
-            MUL_256(x32 + 1, y32 + 1);
-            MUL_256(x32, y32);
-            y32 += 2, x32 += 2;
+        bytes -= 64;
+    } while (bytes > 0);
 
-            bytes -= 64;
-        } while (bytes > 0);
+    if (kStream)
+        _mm_sfence();
+}
 
-        return;
-    }
 #endif // TRY_AVX2
 
-    if (CpuHasSSSE3)
-    {
-        const M128 table_lo_y = _mm_loadu_si128(&Multiply128LUT[log_m].Value[0]);
-        const M128 table_hi_y = _mm_loadu_si128(&Multiply128LUT[log_m].Value[1]);
+static TARGET_SSSE3 void mul_mem_ssse3(
+    void * RESTRICT x, const void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    const M128 table_lo_y = _mm_loadu_si128(&Multiply128LUT[log_m].Value[0]);
+    const M128 table_hi_y = _mm_loadu_si128(&Multiply128LUT[log_m].Value[1]);
 
-        const M128 clr_mask = _mm_set1_epi8(0x0f);
+    const M128 clr_mask = _mm_set1_epi8(0x0f);
 
-        M128 * RESTRICT x16 = reinterpret_cast<M128 *>(x);
-        const M128 * RESTRICT y16 = reinterpret_cast<const M128 *>(y);
+    M128 * RESTRICT x16 = reinterpret_cast<M128 *>(x);
+    const M128 * RESTRICT y16 = reinterpret_cast<const M128 *>(y);
 
-        do
-        {
+    do
+    {
 #define MUL_128(x_ptr, y_ptr) { \
-                M128 data = _mm_loadu_si128(y_ptr); \
-                M128 lo = _mm_and_si128(data, clr_mask); \
-                lo = _mm_shuffle_epi8(table_lo_y, lo); \
-                M128 hi = _mm_srli_epi64(data, 4); \
-                hi = _mm_and_si128(hi, clr_mask); \
-                hi = _mm_shuffle_epi8(table_hi_y, hi); \
-                _mm_storeu_si128(x_ptr, _mm_xor_si128(lo, hi)); }
-
-            MUL_128(x16 + 3, y16 + 3);
-            MUL_128(x16 + 2, y16 + 2);
-            MUL_128(x16 + 1, y16 + 1);
-            MUL_128(x16, y16);
-            x16 += 4, y16 += 4;
+            M128 data = _mm_loadu_si128(y_ptr); \
+            M128 lo = _mm_and_si128(data, clr_mask); \
+            lo = _mm_shuffle_epi8(table_lo_y, lo); \
+            M128 hi = _mm_srli_epi64(data, 4); \
+            hi = _mm_and_si128(hi, clr_mask); \
+            hi = _mm_shuffle_epi8(table_hi_y, hi); \
+            _mm_storeu_si128(x_ptr, _mm_xor_si128(lo, hi)); }
+
+        MUL_128(x16 + 3, y16 + 3);
+        MUL_128(x16 + 2, y16 + 2);
+        MUL_128(x16 + 1, y16 + 1);
+        MUL_128(x16, y16);
+        x16 += 4, y16 += 4;
 
-            bytes -= 64;
-        } while (bytes > 0);
-
-        return;
-    }
+        bytes -= 64;
+    } while (bytes > 0);
+}
 
-    // Reference version:
+static void mul_mem_ref(
+    void * RESTRICT x, const void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
     RefMul(x, y, log_m, bytes);
 }
 
@@ -458,56 +375,10 @@ static void mul_mem(
 //------------------------------------------------------------------------------
 // FFT
 
-// Twisted factors used in FFT
-static ffe_t FFTSkew[kModulus];
-
-// Factors used in the evaluation of the error locator polynomial
-static ffe_t LogWalsh[kOrder];
-
-
-static void FFTInitialize()
-{
-    ffe_t temp[kBits - 1];
-
-    // Generate FFT skew vector {1}:
-
-    for (unsigned i = 1; i < kBits; ++i)
-        temp[i - 1] = static_cast<ffe_t>(1UL << i);
-
-    for (unsigned m = 0; m < (kBits - 1); ++m)
-    {
-        const unsigned step = 1UL << (m + 1);
-
-        FFTSkew[(1UL << m) - 1] = 0;
-
-        for (unsigned i = m; i < (kBits - 1); ++i)
-        {
-            const unsigned s = (1UL << (i + 1));
-
-            for (unsigned j = (1UL << m) - 1; j < s; j += step)
-                FFTSkew[j + s] = FFTSkew[j] ^ temp[i];
-        }
-
-        temp[m] = kModulus - LogLUT[MultiplyLog(temp[m], LogLUT[temp[m] ^ 1])];
-
-        for (unsigned i = m + 1; i < (kBits - 1); ++i)
-        {
-            const ffe_t sum = AddMod(LogLUT[temp[i] ^ 1], temp[m]);
-            temp[i] = MultiplyLog(temp[i], sum);
-        }
-    }
-
-    for (unsigned i = 0; i < kModulus; ++i)
-        FFTSkew[i] = LogLUT[FFTSkew[i]];
-
-    // Precalculate FWHT(Log[i]):
-
-    for (unsigned i = 0; i < kOrder; ++i)
-        LogWalsh[i] = LogLUT[i];
-    LogWalsh[0] = 0;
-
-    FWHT(LogWalsh, kOrder, kOrder);
-}
+// FFTSkew[] holds the twisted factors used in FFT, and LogWalsh[] the factors
+// used in the evaluation of the error locator polynomial.  The FFT routines
+// read the factor for index i from skewLUT[i - 1], so the decoder can pass
+// FFTSkew itself instead of a pointer before the start of the table
 
 /*
     Decimation in time IFFT:
@@ -564,108 +435,251 @@ static void FFTInitialize()
 */
 
 // 2-way butterfly
-static void IFFT_DIT2(
+static void (*IFFT_DIT2)(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes);
+
+#if defined(TRY_GFNI)
+
+static TARGET_GFNI void IFFT_DIT2_gfni(
     void * RESTRICT x, void * RESTRICT y,
     ffe_t log_m, uint64_t bytes)
 {
-#if defined(TRY_AVX2)
-    if (CpuHasAVX2)
+    const M256 matrix_y = _mm256_set1_epi64x(Multiply8Affine[log_m]);
+
+    M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
+    M256 * RESTRICT y32 = reinterpret_cast<M256 *>(y);
+
+    do
     {
-        const M256 table_lo_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[0]);
-        const M256 table_hi_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[1]);
+#define IFFTB_GFNI_256(x_ptr, y_ptr) { \
+        M256 x_data = _mm256_loadu_si256(x_ptr); \
+        M256 y_data = _mm256_loadu_si256(y_ptr); \
+        y_data = _mm256_xor_si256(y_data, x_data); \
+        _mm256_storeu_si256(y_ptr, y_data); \
+        MULADD_GFNI_256(x_data, y_data, matrix_y); \
+        _mm256_storeu_si256(x_ptr, x_data); }
+
+        IFFTB_GFNI_256(x32 + 1, y32 + 1);
+        IFFTB_GFNI_256(x32, y32);
+        y32 += 2, x32 += 2;
+
+        bytes -= 64;
+    } while (bytes > 0);
+}
 
-        const M256 clr_mask = _mm256_set1_epi8(0x0f);
+#endif // TRY_GFNI
 
-        M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
-        M256 * RESTRICT y32 = reinterpret_cast<M256 *>(y);
+#if defined(TRY_AVX2)
 
-        do
-        {
+static TARGET_AVX2 void IFFT_DIT2_avx2(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    const M256 table_lo_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[0]);
+    const M256 table_hi_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[1]);
+
+    const M256 clr_mask = _mm256_set1_epi8(0x0f);
+
+    M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
+    M256 * RESTRICT y32 = reinterpret_cast<M256 *>(y);
+
+    do
+    {
 #define IFFTB_256(x_ptr, y_ptr) { \
-            M256 x_data = _mm256_loadu_si256(x_ptr); \
-            M256 y_data = _mm256_loadu_si256(y_ptr); \
-            y_data = _mm256_xor_si256(y_data, x_data); \
-            _mm256_storeu_si256(y_ptr, y_data); \
-            MULADD_256(x_data, y_data, table_lo_y, table_hi_y); \
-            _mm256_storeu_si256(x_ptr, x_data); }
+        M256 x_data = _mm256_loadu_si256(x_ptr); \
+        M256 y_data = _mm256_loadu_si256(y_ptr); \
+        y_data = _mm256_xor_si256(y_data, x_data); \
+        _mm256_storeu_si256(y_ptr, y_data); \
+        MULADD_256(x_data, y_data, table_lo_y, table_hi_y); \
+        _mm256_storeu_si256(x_ptr, x_data); }
 
-            IFFTB_256(x32 + 1, y32 + 1);
-            IFFTB_256(x32, y32);
-            y32 += 2, x32 += 2;
+        IFFTB_256(x32 + 1, y32 + 1);
+        IFFTB_256(x32, y32);
+        y32 += 2, x32 += 2;
 
-            bytes -= 64;
-        } while (bytes > 0);
+        bytes -= 64;
+    } while (bytes > 0);
+}
 
-        return;
-    }
 #endif // TRY_AVX2
 
-    if (CpuHasSSSE3)
-    {
-        const M128 table_lo_y = _mm_loadu_si128(&Multiply128LUT[log_m].Value[0]);
-        const M128 table_hi_y = _mm_loadu_si128(&Multiply128LUT[log_m].Value[1]);
+static TARGET_SSSE3 void IFFT_DIT2_ssse3(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    const M128 table_lo_y = _mm_loadu_si128(&Multiply128LUT[log_m].Value[0]);
+    const M128 table_hi_y = _mm_loadu_si128(&Multiply128LUT[log_m].Value[1]);
 
-        const M128 clr_mask = _mm_set1_epi8(0x0f);
+    const M128 clr_mask = _mm_set1_epi8(0x0f);
 
-        M128 * RESTRICT x16 = reinterpret_cast<M128 *>(x);
-        M128 * RESTRICT y16 = reinterpret_cast<M128 *>(y);
+    M128 * RESTRICT x16 = reinterpret_cast<M128 *>(x);
+    M128 * RESTRICT y16 = reinterpret_cast<M128 *>(y);
 
-        do
-        {
+    do
+    {
 #define IFFTB_128(x_ptr, y_ptr) { \
-            M128 x_data = _mm_loadu_si128(x_ptr); \
-            M128 y_data = _mm_loadu_si128(y_ptr); \
-            y_data = _mm_xor_si128(y_data, x_data); \
-            _mm_storeu_si128(y_ptr, y_data); \
-            MULADD_128(x_data, y_data, table_lo_y, table_hi_y); \
-            _mm_storeu_si128(x_ptr, x_data); }
-
-            IFFTB_128(x16 + 3, y16 + 3);
-            IFFTB_128(x16 + 2, y16 + 2);
-            IFFTB_128(x16 + 1, y16 + 1);
-            IFFTB_128(x16, y16);
-            x16 += 4, y16 += 4;
-
-            bytes -= 64;
-        } while (bytes > 0);
+        M128 x_data = _mm_loadu_si128(x_ptr); \
+        M128 y_data = _mm_loadu_si128(y_ptr); \
+        y_data = _mm_xor_si128(y_data, x_data); \
+        _mm_storeu_si128(y_ptr, y_data); \
+        MULADD_128(x_data, y_data, table_lo_y, table_hi_y); \
+        _mm_storeu_si128(x_ptr, x_data); }
+
+        IFFTB_128(x16 + 3, y16 + 3);
+        IFFTB_128(x16 + 2, y16 + 2);
+        IFFTB_128(x16 + 1, y16 + 1);
+        IFFTB_128(x16, y16);
+        x16 += 4, y16 += 4;
 
-        return;
-    }
+        bytes -= 64;
+    } while (bytes > 0);
+}
 
-    // Reference version:
+static void IFFT_DIT2_ref(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
     xor_mem(y, x, bytes);
     RefMulAdd(x, y, log_m, bytes);
 }
 
 
-// 4-way butterfly
-static void IFFT_DIT4(
+// Bits set by TrivialSkews4() for skews of kModulus, which skip their multiply
+static const unsigned kTrivial01 = 1;
+static const unsigned kTrivial23 = 2;
+static const unsigned kTrivial02 = 4;
+
+// Returns the index of the 4-way butterfly version for these skews.  The
+// versions are specialized at compile time so the byte loops do not test
+// the skews, and versions with no multiplies load no tables
+static FORCE_INLINE unsigned TrivialSkews4(
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    return (log_m01 == kModulus ? kTrivial01 : 0) |
+        (log_m23 == kModulus ? kTrivial23 : 0) |
+        (log_m02 == kModulus ? kTrivial02 : 0);
+}
+
+// 4-way butterfly over pieces {i, i + dist, i + dist * 2, i + dist * 3} for
+// each i in [0, count), indexed by TrivialSkews4().  The skews are the same
+// across the span, so each kernel loads its multiply tables once per call
+static void (*IFFT_DIT4[8])(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02);
+
+#ifdef INTERLEAVE_BUTTERFLY4_OPT
+
+#if defined(TRY_GFNI)
+
+template<unsigned kTrivial>
+static TARGET_GFNI void IFFT_DIT4_gfni(
     uint64_t bytes,
     void** work,
     unsigned dist,
+    unsigned count,
     const ffe_t log_m01,
     const ffe_t log_m23,
     const ffe_t log_m02)
 {
-#ifdef INTERLEAVE_BUTTERFLY4_OPT
+    const M256 m01 = _mm256_set1_epi64x(Multiply8Affine[log_m01]);
+    const M256 m23 = _mm256_set1_epi64x(Multiply8Affine[log_m23]);
+    const M256 m02 = _mm256_set1_epi64x(Multiply8Affine[log_m02]);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
+
+        M256 * RESTRICT work0 = reinterpret_cast<M256 *>(work[i]);
+        M256 * RESTRICT work1 = reinterpret_cast<M256 *>(work[i + dist]);
+        M256 * RESTRICT work2 = reinterpret_cast<M256 *>(work[i + dist * 2]);
+        M256 * RESTRICT work3 = reinterpret_cast<M256 *>(work[i + dist * 3]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            // First layer:
+            M256 work0_reg = _mm256_loadu_si256(work0);
+            M256 work1_reg = _mm256_loadu_si256(work1);
+
+            work1_reg = _mm256_xor_si256(work0_reg, work1_reg);
+            if (!(kTrivial & kTrivial01))
+                MULADD_GFNI_256(work0_reg, work1_reg, m01);
+
+            M256 work2_reg = _mm256_loadu_si256(work2);
+            M256 work3_reg = _mm256_loadu_si256(work3);
+
+            work3_reg = _mm256_xor_si256(work2_reg, work3_reg);
+            if (!(kTrivial & kTrivial23))
+                MULADD_GFNI_256(work2_reg, work3_reg, m23);
+
+            // Second layer:
+            work2_reg = _mm256_xor_si256(work0_reg, work2_reg);
+            work3_reg = _mm256_xor_si256(work1_reg, work3_reg);
+            if (!(kTrivial & kTrivial02))
+            {
+                MULADD_GFNI_256(work0_reg, work2_reg, m02);
+                MULADD_GFNI_256(work1_reg, work3_reg, m02);
+            }
+
+            _mm256_storeu_si256(work0, work0_reg);
+            _mm256_storeu_si256(work1, work1_reg);
+            _mm256_storeu_si256(work2, work2_reg);
+            _mm256_storeu_si256(work3, work3_reg);
+            work0++, work1++, work2++, work3++;
+
+            piece_bytes -= 32;
+        } while (piece_bytes > 0);
+    }
+}
+
+#endif // TRY_GFNI
 
 #if defined(TRY_AVX2)
 
-    if (CpuHasAVX2)
+template<unsigned kTrivial>
+static TARGET_AVX2 void IFFT_DIT4_avx2(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    const M256 t01_lo = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[0]);
+    const M256 t01_hi = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[1]);
+    const M256 t23_lo = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[0]);
+    const M256 t23_hi = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[1]);
+    const M256 t02_lo = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[0]);
+    const M256 t02_hi = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[1]);
+
+    const M256 clr_mask = _mm256_set1_epi8(0x0f);
+
+    for (unsigned i = 0; i < count; ++i)
     {
-        const M256 t01_lo = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[0]);
-        const M256 t01_hi = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[1]);
-        const M256 t23_lo = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[0]);
-        const M256 t23_hi = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[1]);
-        const M256 t02_lo = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[0]);
-        const M256 t02_hi = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[1]);
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
 
-        const M256 clr_mask = _mm256_set1_epi8(0x0f);
+        M256 * RESTRICT work0 = reinterpret_cast<M256 *>(work[i]);
+        M256 * RESTRICT work1 = reinterpret_cast<M256 *>(work[i + dist]);
+        M256 * RESTRICT work2 = reinterpret_cast<M256 *>(work[i + dist * 2]);
+        M256 * RESTRICT work3 = reinterpret_cast<M256 *>(work[i + dist * 3]);
 
-        M256 * RESTRICT work0 = reinterpret_cast<M256 *>(work[0]);
-        M256 * RESTRICT work1 = reinterpret_cast<M256 *>(work[dist]);
-        M256 * RESTRICT work2 = reinterpret_cast<M256 *>(work[dist * 2]);
-        M256 * RESTRICT work3 = reinterpret_cast<M256 *>(work[dist * 3]);
+        uint64_t piece_bytes = bytes;
 
         do
         {
@@ -674,20 +688,20 @@ static void IFFT_DIT4(
             M256 work1_reg = _mm256_loadu_si256(work1);
 
             work1_reg = _mm256_xor_si256(work0_reg, work1_reg);
-            if (log_m01 != kModulus)
+            if (!(kTrivial & kTrivial01))
                 MULADD_256(work0_reg, work1_reg, t01_lo, t01_hi);
 
             M256 work2_reg = _mm256_loadu_si256(work2);
             M256 work3_reg = _mm256_loadu_si256(work3);
 
             work3_reg = _mm256_xor_si256(work2_reg, work3_reg);
-            if (log_m23 != kModulus)
+            if (!(kTrivial & kTrivial23))
                 MULADD_256(work2_reg, work3_reg, t23_lo, t23_hi);
 
             // Second layer:
             work2_reg = _mm256_xor_si256(work0_reg, work2_reg);
             work3_reg = _mm256_xor_si256(work1_reg, work3_reg);
-            if (log_m02 != kModulus)
+            if (!(kTrivial & kTrivial02))
             {
                 MULADD_256(work0_reg, work2_reg, t02_lo, t02_hi);
                 MULADD_256(work1_reg, work3_reg, t02_lo, t02_hi);
@@ -699,29 +713,45 @@ static void IFFT_DIT4(
             _mm256_storeu_si256(work3, work3_reg);
             work0++, work1++, work2++, work3++;
 
-            bytes -= 32;
-        } while (bytes > 0);
-
-        return;
+            piece_bytes -= 32;
+        } while (piece_bytes > 0);
     }
+}
 
 #endif // TRY_AVX2
 
-    if (CpuHasSSSE3)
+template<unsigned kTrivial>
+static TARGET_SSSE3 void IFFT_DIT4_ssse3(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    const M128 t01_lo = _mm_loadu_si128(&Multiply128LUT[log_m01].Value[0]);
+    const M128 t01_hi = _mm_loadu_si128(&Multiply128LUT[log_m01].Value[1]);
+    const M128 t23_lo = _mm_loadu_si128(&Multiply128LUT[log_m23].Value[0]);
+    const M128 t23_hi = _mm_loadu_si128(&Multiply128LUT[log_m23].Value[1]);
+    const M128 t02_lo = _mm_loadu_si128(&Multiply128LUT[log_m02].Value[0]);
+    const M128 t02_hi = _mm_loadu_si128(&Multiply128LUT[log_m02].Value[1]);
+
+    const M128 clr_mask = _mm_set1_epi8(0x0f);
+
+    for (unsigned i = 0; i < count; ++i)
     {
-        const M128 t01_lo = _mm_loadu_si128(&Multiply128LUT[log_m01].Value[0]);
-        const M128 t01_hi = _mm_loadu_si128(&Multiply128LUT[log_m01].Value[1]);
-        const M128 t23_lo = _mm_loadu_si128(&Multiply128LUT[log_m23].Value[0]);
-        const M128 t23_hi = _mm_loadu_si128(&Multiply128LUT[log_m23].Value[1]);
-        const M128 t02_lo = _mm_loadu_si128(&Multiply128LUT[log_m02].Value[0]);
-        const M128 t02_hi = _mm_loadu_si128(&Multiply128LUT[log_m02].Value[1]);
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
 
-        const M128 clr_mask = _mm_set1_epi8(0x0f);
+        M128 * RESTRICT work0 = reinterpret_cast<M128 *>(work[i]);
+        M128 * RESTRICT work1 = reinterpret_cast<M128 *>(work[i + dist]);
+        M128 * RESTRICT work2 = reinterpret_cast<M128 *>(work[i + dist * 2]);
+        M128 * RESTRICT work3 = reinterpret_cast<M128 *>(work[i + dist * 3]);
 
-        M128 * RESTRICT work0 = reinterpret_cast<M128 *>(work[0]);
-        M128 * RESTRICT work1 = reinterpret_cast<M128 *>(work[dist]);
-        M128 * RESTRICT work2 = reinterpret_cast<M128 *>(work[dist * 2]);
-        M128 * RESTRICT work3 = reinterpret_cast<M128 *>(work[dist * 3]);
+        uint64_t piece_bytes = bytes;
 
         do
         {
@@ -730,20 +760,20 @@ static void IFFT_DIT4(
             M128 work1_reg = _mm_loadu_si128(work1);
 
             work1_reg = _mm_xor_si128(work0_reg, work1_reg);
-            if (log_m01 != kModulus)
+            if (!(kTrivial & kTrivial01))
                 MULADD_128(work0_reg, work1_reg, t01_lo, t01_hi);
 
             M128 work2_reg = _mm_loadu_si128(work2);
             M128 work3_reg = _mm_loadu_si128(work3);
 
             work3_reg = _mm_xor_si128(work2_reg, work3_reg);
-            if (log_m23 != kModulus)
+            if (!(kTrivial & kTrivial23))
                 MULADD_128(work2_reg, work3_reg, t23_lo, t23_hi);
 
             // Second layer:
             work2_reg = _mm_xor_si128(work0_reg, work2_reg);
             work3_reg = _mm_xor_si128(work1_reg, work3_reg);
-            if (log_m02 != kModulus)
+            if (!(kTrivial & kTrivial02))
             {
                 MULADD_128(work0_reg, work2_reg, t02_lo, t02_hi);
                 MULADD_128(work1_reg, work3_reg, t02_lo, t02_hi);
@@ -755,122 +785,443 @@ static void IFFT_DIT4(
             _mm_storeu_si128(work3, work3_reg);
             work0++, work1++, work2++, work3++;
 
-            bytes -= 16;
-        } while (bytes > 0);
-
-        return;
+            piece_bytes -= 16;
+        } while (piece_bytes > 0);
     }
+}
 
 #endif // INTERLEAVE_BUTTERFLY4_OPT
 
-    // First layer:
-    if (log_m01 == kModulus)
-        xor_mem(work[dist], work[0], bytes);
-    else
-        IFFT_DIT2(work[0], work[dist], log_m01, bytes);
-
-    if (log_m23 == kModulus)
-        xor_mem(work[dist * 3], work[dist * 2], bytes);
-    else
-        IFFT_DIT2(work[dist * 2], work[dist * 3], log_m23, bytes);
-
-    // Second layer:
-    if (log_m02 == kModulus)
+static void IFFT_DIT4_ref(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    for (unsigned i = 0; i < count; ++i)
     {
-        xor_mem(work[dist * 2], work[0], bytes);
-        xor_mem(work[dist * 3], work[dist], bytes);
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
+
+        // First layer:
+        if (log_m01 == kModulus)
+            xor_mem(work[i + dist], work[i], bytes);
+        else
+            IFFT_DIT2(work[i], work[i + dist], log_m01, bytes);
+
+        if (log_m23 == kModulus)
+            xor_mem(work[i + dist * 3], work[i + dist * 2], bytes);
+        else
+            IFFT_DIT2(work[i + dist * 2], work[i + dist * 3], log_m23, bytes);
+
+        // Second layer:
+        if (log_m02 == kModulus)
+        {
+            xor_mem(work[i + dist * 2], work[i], bytes);
+            xor_mem(work[i + dist * 3], work[i + dist], bytes);
+        }
+        else
+        {
+            IFFT_DIT2(work[i], work[i + dist * 2], log_m02, bytes);
+            IFFT_DIT2(work[i + dist], work[i + dist * 3], log_m02, bytes);
+        }
     }
-    else
+}
+
+
+// 8-way butterfly: Three layers over pieces {0, dist, ..., dist * 7} in
+// registers.  Left null when no SIMD version exists, in which case the layer
+// loops stick to 4-way butterflies rather than composing this from them.
+// Runs count butterflies starting at pieces 0 to count - 1 with one set of
+// multiply tables
+static void (*IFFT_DIT8)(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m45,
+    const ffe_t log_m67,
+    const ffe_t log_m02,
+    const ffe_t log_m46,
+    const ffe_t log_m04);
+
+#ifdef INTERLEAVE_BUTTERFLY8_OPT
+
+#if defined(TRY_GFNI)
+
+static TARGET_GFNI void IFFT_DIT8_gfni(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m45,
+    const ffe_t log_m67,
+    const ffe_t log_m02,
+    const ffe_t log_m46,
+    const ffe_t log_m04)
+{
+    const M256 m01 = _mm256_set1_epi64x(Multiply8Affine[log_m01]);
+    const M256 m23 = _mm256_set1_epi64x(Multiply8Affine[log_m23]);
+    const M256 m45 = _mm256_set1_epi64x(Multiply8Affine[log_m45]);
+    const M256 m67 = _mm256_set1_epi64x(Multiply8Affine[log_m67]);
+    const M256 m02 = _mm256_set1_epi64x(Multiply8Affine[log_m02]);
+    const M256 m46 = _mm256_set1_epi64x(Multiply8Affine[log_m46]);
+    const M256 m04 = _mm256_set1_epi64x(Multiply8Affine[log_m04]);
+
+    for (unsigned i = 0; i < count; ++i)
     {
-        IFFT_DIT2(work[0], work[dist * 2], log_m02, bytes);
-        IFFT_DIT2(work[dist], work[dist * 3], log_m02, bytes);
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 8);
+#endif // PREFETCH_NEXT_OPT
+
+        M256 * RESTRICT work0 = reinterpret_cast<M256 *>(work[i]);
+        M256 * RESTRICT work1 = reinterpret_cast<M256 *>(work[i + dist]);
+        M256 * RESTRICT work2 = reinterpret_cast<M256 *>(work[i + dist * 2]);
+        M256 * RESTRICT work3 = reinterpret_cast<M256 *>(work[i + dist * 3]);
+        M256 * RESTRICT work4 = reinterpret_cast<M256 *>(work[i + dist * 4]);
+        M256 * RESTRICT work5 = reinterpret_cast<M256 *>(work[i + dist * 5]);
+        M256 * RESTRICT work6 = reinterpret_cast<M256 *>(work[i + dist * 6]);
+        M256 * RESTRICT work7 = reinterpret_cast<M256 *>(work[i + dist * 7]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            M256 work_reg_0 = _mm256_loadu_si256(work0);
+            M256 work_reg_1 = _mm256_loadu_si256(work1);
+            M256 work_reg_2 = _mm256_loadu_si256(work2);
+            M256 work_reg_3 = _mm256_loadu_si256(work3);
+            M256 work_reg_4 = _mm256_loadu_si256(work4);
+            M256 work_reg_5 = _mm256_loadu_si256(work5);
+            M256 work_reg_6 = _mm256_loadu_si256(work6);
+            M256 work_reg_7 = _mm256_loadu_si256(work7);
+
+            // First layer:
+            work_reg_1 = _mm256_xor_si256(work_reg_0, work_reg_1);
+            if (log_m01 != kModulus)
+                MULADD_GFNI_256(work_reg_0, work_reg_1, m01);
+            work_reg_3 = _mm256_xor_si256(work_reg_2, work_reg_3);
+            if (log_m23 != kModulus)
+                MULADD_GFNI_256(work_reg_2, work_reg_3, m23);
+            work_reg_5 = _mm256_xor_si256(work_reg_4, work_reg_5);
+            if (log_m45 != kModulus)
+                MULADD_GFNI_256(work_reg_4, work_reg_5, m45);
+            work_reg_7 = _mm256_xor_si256(work_reg_6, work_reg_7);
+            if (log_m67 != kModulus)
+                MULADD_GFNI_256(work_reg_6, work_reg_7, m67);
+
+            // Second layer:
+            work_reg_2 = _mm256_xor_si256(work_reg_0, work_reg_2);
+            work_reg_3 = _mm256_xor_si256(work_reg_1, work_reg_3);
+            if (log_m02 != kModulus)
+            {
+                MULADD_GFNI_256(work_reg_0, work_reg_2, m02);
+                MULADD_GFNI_256(work_reg_1, work_reg_3, m02);
+            }
+            work_reg_6 = _mm256_xor_si256(work_reg_4, work_reg_6);
+            work_reg_7 = _mm256_xor_si256(work_reg_5, work_reg_7);
+            if (log_m46 != kModulus)
+            {
+                MULADD_GFNI_256(work_reg_4, work_reg_6, m46);
+                MULADD_GFNI_256(work_reg_5, work_reg_7, m46);
+            }
+
+            // Third layer:
+            work_reg_4 = _mm256_xor_si256(work_reg_0, work_reg_4);
+            work_reg_5 = _mm256_xor_si256(work_reg_1, work_reg_5);
+            work_reg_6 = _mm256_xor_si256(work_reg_2, work_reg_6);
+            work_reg_7 = _mm256_xor_si256(work_reg_3, work_reg_7);
+            if (log_m04 != kModulus)
+            {
+                MULADD_GFNI_256(work_reg_0, work_reg_4, m04);
+                MULADD_GFNI_256(work_reg_1, work_reg_5, m04);
+                MULADD_GFNI_256(work_reg_2, work_reg_6, m04);
+                MULADD_GFNI_256(work_reg_3, work_reg_7, m04);
+            }
+
+            _mm256_storeu_si256(work0, work_reg_0);
+            _mm256_storeu_si256(work1, work_reg_1);
+            _mm256_storeu_si256(work2, work_reg_2);
+            _mm256_storeu_si256(work3, work_reg_3);
+            _mm256_storeu_si256(work4, work_reg_4);
+            _mm256_storeu_si256(work5, work_reg_5);
+            _mm256_storeu_si256(work6, work_reg_6);
+            _mm256_storeu_si256(work7, work_reg_7);
+
+            work0++, work1++, work2++, work3++, work4++, work5++, work6++, work7++;
+
+            piece_bytes -= 32;
+        } while (piece_bytes > 0);
+    }
+}
+
+#endif // TRY_GFNI
+
+#if defined(TRY_AVX2)
+
+static TARGET_AVX2 void IFFT_DIT8_avx2(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m45,
+    const ffe_t log_m67,
+    const ffe_t log_m02,
+    const ffe_t log_m46,
+    const ffe_t log_m04)
+{
+    // The fourteen table registers do not all fit alongside the data, so some are reloaded from L1
+    const M256 t01_lo = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[0]);
+    const M256 t01_hi = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[1]);
+    const M256 t23_lo = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[0]);
+    const M256 t23_hi = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[1]);
+    const M256 t45_lo = _mm256_loadu_si256(&Multiply256LUT[log_m45].Value[0]);
+    const M256 t45_hi = _mm256_loadu_si256(&Multiply256LUT[log_m45].Value[1]);
+    const M256 t67_lo = _mm256_loadu_si256(&Multiply256LUT[log_m67].Value[0]);
+    const M256 t67_hi = _mm256_loadu_si256(&Multiply256LUT[log_m67].Value[1]);
+    const M256 t02_lo = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[0]);
+    const M256 t02_hi = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[1]);
+    const M256 t46_lo = _mm256_loadu_si256(&Multiply256LUT[log_m46].Value[0]);
+    const M256 t46_hi = _mm256_loadu_si256(&Multiply256LUT[log_m46].Value[1]);
+    const M256 t04_lo = _mm256_loadu_si256(&Multiply256LUT[log_m04].Value[0]);
+    const M256 t04_hi = _mm256_loadu_si256(&Multiply256LUT[log_m04].Value[1]);
+
+    const M256 clr_mask = _mm256_set1_epi8(0x0f);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 8);
+#endif // PREFETCH_NEXT_OPT
+
+        M256 * RESTRICT work0 = reinterpret_cast<M256 *>(work[i]);
+        M256 * RESTRICT work1 = reinterpret_cast<M256 *>(work[i + dist]);
+        M256 * RESTRICT work2 = reinterpret_cast<M256 *>(work[i + dist * 2]);
+        M256 * RESTRICT work3 = reinterpret_cast<M256 *>(work[i + dist * 3]);
+        M256 * RESTRICT work4 = reinterpret_cast<M256 *>(work[i + dist * 4]);
+        M256 * RESTRICT work5 = reinterpret_cast<M256 *>(work[i + dist * 5]);
+        M256 * RESTRICT work6 = reinterpret_cast<M256 *>(work[i + dist * 6]);
+        M256 * RESTRICT work7 = reinterpret_cast<M256 *>(work[i + dist * 7]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            M256 work_reg_0 = _mm256_loadu_si256(work0);
+            M256 work_reg_1 = _mm256_loadu_si256(work1);
+            M256 work_reg_2 = _mm256_loadu_si256(work2);
+            M256 work_reg_3 = _mm256_loadu_si256(work3);
+            M256 work_reg_4 = _mm256_loadu_si256(work4);
+            M256 work_reg_5 = _mm256_loadu_si256(work5);
+            M256 work_reg_6 = _mm256_loadu_si256(work6);
+            M256 work_reg_7 = _mm256_loadu_si256(work7);
+
+            // First layer:
+            work_reg_1 = _mm256_xor_si256(work_reg_0, work_reg_1);
+            if (log_m01 != kModulus)
+                MULADD_256(work_reg_0, work_reg_1, t01_lo, t01_hi);
+            work_reg_3 = _mm256_xor_si256(work_reg_2, work_reg_3);
+            if (log_m23 != kModulus)
+                MULADD_256(work_reg_2, work_reg_3, t23_lo, t23_hi);
+            work_reg_5 = _mm256_xor_si256(work_reg_4, work_reg_5);
+            if (log_m45 != kModulus)
+                MULADD_256(work_reg_4, work_reg_5, t45_lo, t45_hi);
+            work_reg_7 = _mm256_xor_si256(work_reg_6, work_reg_7);
+            if (log_m67 != kModulus)
+                MULADD_256(work_reg_6, work_reg_7, t67_lo, t67_hi);
+
+            // Second layer:
+            work_reg_2 = _mm256_xor_si256(work_reg_0, work_reg_2);
+            work_reg_3 = _mm256_xor_si256(work_reg_1, work_reg_3);
+            if (log_m02 != kModulus)
+            {
+                MULADD_256(work_reg_0, work_reg_2, t02_lo, t02_hi);
+                MULADD_256(work_reg_1, work_reg_3, t02_lo, t02_hi);
+            }
+            work_reg_6 = _mm256_xor_si256(work_reg_4, work_reg_6);
+            work_reg_7 = _mm256_xor_si256(work_reg_5, work_reg_7);
+            if (log_m46 != kModulus)
+            {
+                MULADD_256(work_reg_4, work_reg_6, t46_lo, t46_hi);
+                MULADD_256(work_reg_5, work_reg_7, t46_lo, t46_hi);
+            }
+
+            // Third layer:
+            work_reg_4 = _mm256_xor_si256(work_reg_0, work_reg_4);
+            work_reg_5 = _mm256_xor_si256(work_reg_1, work_reg_5);
+            work_reg_6 = _mm256_xor_si256(work_reg_2, work_reg_6);
+            work_reg_7 = _mm256_xor_si256(work_reg_3, work_reg_7);
+            if (log_m04 != kModulus)
+            {
+                MULADD_256(work_reg_0, work_reg_4, t04_lo, t04_hi);
+                MULADD_256(work_reg_1, work_reg_5, t04_lo, t04_hi);
+                MULADD_256(work_reg_2, work_reg_6, t04_lo, t04_hi);
+                MULADD_256(work_reg_3, work_reg_7, t04_lo, t04_hi);
+            }
+
+            _mm256_storeu_si256(work0, work_reg_0);
+            _mm256_storeu_si256(work1, work_reg_1);
+            _mm256_storeu_si256(work2, work_reg_2);
+            _mm256_storeu_si256(work3, work_reg_3);
+            _mm256_storeu_si256(work4, work_reg_4);
+            _mm256_storeu_si256(work5, work_reg_5);
+            _mm256_storeu_si256(work6, work_reg_6);
+            _mm256_storeu_si256(work7, work_reg_7);
+
+            work0++, work1++, work2++, work3++, work4++, work5++, work6++, work7++;
+
+            piece_bytes -= 32;
+        } while (piece_bytes > 0);
     }
 }
 
+#endif // TRY_AVX2
+
+#endif // INTERLEAVE_BUTTERFLY8_OPT
+
 
 // {x_out, y_out} ^= IFFT_DIT2( {x_in, y_in} )
-static void IFFT_DIT2_xor(
+static void (*IFFT_DIT2_xor)(
+    void * RESTRICT x_in, void * RESTRICT y_in,
+    void * RESTRICT x_out, void * RESTRICT y_out,
+    const ffe_t log_m, uint64_t bytes);
+
+#if defined(TRY_GFNI)
+
+static TARGET_GFNI void IFFT_DIT2_xor_gfni(
     void * RESTRICT x_in, void * RESTRICT y_in,
     void * RESTRICT x_out, void * RESTRICT y_out,
     const ffe_t log_m, uint64_t bytes)
 {
-#if defined(TRY_AVX2)
-    if (CpuHasAVX2)
+    const M256 matrix_y = _mm256_set1_epi64x(Multiply8Affine[log_m]);
+
+    const M256 * RESTRICT x32_in = reinterpret_cast<const M256 *>(x_in);
+    const M256 * RESTRICT y32_in = reinterpret_cast<const M256 *>(y_in);
+    M256 * RESTRICT x32_out = reinterpret_cast<M256 *>(x_out);
+    M256 * RESTRICT y32_out = reinterpret_cast<M256 *>(y_out);
+
+    do
     {
-        const M256 table_lo_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[0]);
-        const M256 table_hi_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[1]);
+#define IFFTB_GFNI_256_XOR(x_ptr_in, y_ptr_in, x_ptr_out, y_ptr_out) { \
+        M256 x_data_out = _mm256_loadu_si256(x_ptr_out); \
+        M256 y_data_out = _mm256_loadu_si256(y_ptr_out); \
+        M256 x_data_in = _mm256_loadu_si256(x_ptr_in); \
+        M256 y_data_in = _mm256_loadu_si256(y_ptr_in); \
+        y_data_in = _mm256_xor_si256(y_data_in, x_data_in); \
+        y_data_out = _mm256_xor_si256(y_data_out, y_data_in); \
+        _mm256_storeu_si256(y_ptr_out, y_data_out); \
+        MULADD_GFNI_256(x_data_in, y_data_in, matrix_y); \
+        x_data_out = _mm256_xor_si256(x_data_out, x_data_in); \
+        _mm256_storeu_si256(x_ptr_out, x_data_out); }
+
+        IFFTB_GFNI_256_XOR(x32_in + 1, y32_in + 1, x32_out + 1, y32_out + 1);
+        IFFTB_GFNI_256_XOR(x32_in, y32_in, x32_out, y32_out);
+        y32_in += 2, x32_in += 2, y32_out += 2, x32_out += 2;
 
-        const M256 clr_mask = _mm256_set1_epi8(0x0f);
+        bytes -= 64;
+    } while (bytes > 0);
+}
 
-        const M256 * RESTRICT x32_in = reinterpret_cast<const M256 *>(x_in);
-        const M256 * RESTRICT y32_in = reinterpret_cast<const M256 *>(y_in);
-        M256 * RESTRICT x32_out = reinterpret_cast<M256 *>(x_out);
-        M256 * RESTRICT y32_out = reinterpret_cast<M256 *>(y_out);
+#endif // TRY_GFNI
 
-        do
-        {
+#if defined(TRY_AVX2)
+
+static TARGET_AVX2 void IFFT_DIT2_xor_avx2(
+    void * RESTRICT x_in, void * RESTRICT y_in,
+    void * RESTRICT x_out, void * RESTRICT y_out,
+    const ffe_t log_m, uint64_t bytes)
+{
+    const M256 table_lo_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[0]);
+    const M256 table_hi_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[1]);
+
+    const M256 clr_mask = _mm256_set1_epi8(0x0f);
+
+    const M256 * RESTRICT x32_in = reinterpret_cast<const M256 *>(x_in);
+    const M256 * RESTRICT y32_in = reinterpret_cast<const M256 *>(y_in);
+    M256 * RESTRICT x32_out = reinterpret_cast<M256 *>(x_out);
+    M256 * RESTRICT y32_out = reinterpret_cast<M256 *>(y_out);
+
+    do
+    {
 #define IFFTB_256_XOR(x_ptr_in, y_ptr_in, x_ptr_out, y_ptr_out) { \
-            M256 x_data_out = _mm256_loadu_si256(x_ptr_out); \
-            M256 y_data_out = _mm256_loadu_si256(y_ptr_out); \
-            M256 x_data_in = _mm256_loadu_si256(x_ptr_in); \
-            M256 y_data_in = _mm256_loadu_si256(y_ptr_in); \
-            y_data_in = _mm256_xor_si256(y_data_in, x_data_in); \
-            y_data_out = _mm256_xor_si256(y_data_out, y_data_in); \
-            _mm256_storeu_si256(y_ptr_out, y_data_out); \
-            MULADD_256(x_data_in, y_data_in, table_lo_y, table_hi_y); \
-            x_data_out = _mm256_xor_si256(x_data_out, x_data_in); \
-            _mm256_storeu_si256(x_ptr_out, x_data_out); }
-
-            IFFTB_256_XOR(x32_in + 1, y32_in + 1, x32_out + 1, y32_out + 1);
-            IFFTB_256_XOR(x32_in, y32_in, x32_out, y32_out);
-            y32_in += 2, x32_in += 2, y32_out += 2, x32_out += 2;
-
-            bytes -= 64;
-        } while (bytes > 0);
+        M256 x_data_out = _mm256_loadu_si256(x_ptr_out); \
+        M256 y_data_out = _mm256_loadu_si256(y_ptr_out); \
+        M256 x_data_in = _mm256_loadu_si256(x_ptr_in); \
+        M256 y_data_in = _mm256_loadu_si256(y_ptr_in); \
+        y_data_in = _mm256_xor_si256(y_data_in, x_data_in); \
+        y_data_out = _mm256_xor_si256(y_data_out, y_data_in); \
+        _mm256_storeu_si256(y_ptr_out, y_data_out); \
+        MULADD_256(x_data_in, y_data_in, table_lo_y, table_hi_y); \
+        x_data_out = _mm256_xor_si256(x_data_out, x_data_in); \
+        _mm256_storeu_si256(x_ptr_out, x_data_out); }
+
+        IFFTB_256_XOR(x32_in + 1, y32_in + 1, x32_out + 1, y32_out + 1);
+        IFFTB_256_XOR(x32_in, y32_in, x32_out, y32_out);
+        y32_in += 2, x32_in += 2, y32_out += 2, x32_out += 2;
+
+        bytes -= 64;
+    } while (bytes > 0);
+}
 
-        return;
-    }
 #endif // TRY_AVX2
 
-    if (CpuHasSSSE3)
-    {
-        const M128 table_lo_y = _mm_loadu_si128(&Multiply128LUT[log_m].Value[0]);
-        const M128 table_hi_y = _mm_loadu_si128(&Multiply128LUT[log_m].Value[1]);
+static TARGET_SSSE3 void IFFT_DIT2_xor_ssse3(
+    void * RESTRICT x_in, void * RESTRICT y_in,
+    void * RESTRICT x_out, void * RESTRICT y_out,
+    const ffe_t log_m, uint64_t bytes)
+{
+    const M128 table_lo_y = _mm_loadu_si128(&Multiply128LUT[log_m].Value[0]);
+    const M128 table_hi_y = _mm_loadu_si128(&Multiply128LUT[log_m].Value[1]);
 
-        const M128 clr_mask = _mm_set1_epi8(0x0f);
+    const M128 clr_mask = _mm_set1_epi8(0x0f);
 
-        const M128 * RESTRICT x16_in = reinterpret_cast<const M128 *>(x_in);
-        const M128 * RESTRICT y16_in = reinterpret_cast<const M128 *>(y_in);
-        M128 * RESTRICT x16_out = reinterpret_cast<M128 *>(x_out);
-        M128 * RESTRICT y16_out = reinterpret_cast<M128 *>(y_out);
+    const M128 * RESTRICT x16_in = reinterpret_cast<const M128 *>(x_in);
+    const M128 * RESTRICT y16_in = reinterpret_cast<const M128 *>(y_in);
+    M128 * RESTRICT x16_out = reinterpret_cast<M128 *>(x_out);
+    M128 * RESTRICT y16_out = reinterpret_cast<M128 *>(y_out);
 
-        do
-        {
+    do
+    {
 #define IFFTB_128_XOR(x_ptr_in, y_ptr_in, x_ptr_out, y_ptr_out) { \
-            M128 x_data_out = _mm_loadu_si128(x_ptr_out); \
-            M128 y_data_out = _mm_loadu_si128(y_ptr_out); \
-            M128 x_data_in = _mm_loadu_si128(x_ptr_in); \
-            M128 y_data_in = _mm_loadu_si128(y_ptr_in); \
-            y_data_in = _mm_xor_si128(y_data_in, x_data_in); \
-            y_data_out = _mm_xor_si128(y_data_out, y_data_in); \
-            _mm_storeu_si128(y_ptr_out, y_data_out); \
-            MULADD_128(x_data_in, y_data_in, table_lo_y, table_hi_y); \
-            x_data_out = _mm_xor_si128(x_data_out, x_data_in); \
-            _mm_storeu_si128(x_ptr_out, x_data_out); }
-
-            IFFTB_128_XOR(x16_in + 3, y16_in + 3, x16_out + 3, y16_out + 3);
-            IFFTB_128_XOR(x16_in + 2, y16_in + 2, x16_out + 2, y16_out + 2);
-            IFFTB_128_XOR(x16_in + 1, y16_in + 1, x16_out + 1, y16_out + 1);
-            IFFTB_128_XOR(x16_in, y16_in, x16_out, y16_out);
-            y16_in += 4, x16_in += 4, y16_out += 4, x16_out += 4;
-
-            bytes -= 64;
-        } while (bytes > 0);
+        M128 x_data_out = _mm_loadu_si128(x_ptr_out); \
+        M128 y_data_out = _mm_loadu_si128(y_ptr_out); \
+        M128 x_data_in = _mm_loadu_si128(x_ptr_in); \
+        M128 y_data_in = _mm_loadu_si128(y_ptr_in); \
+        y_data_in = _mm_xor_si128(y_data_in, x_data_in); \
+        y_data_out = _mm_xor_si128(y_data_out, y_data_in); \
+        _mm_storeu_si128(y_ptr_out, y_data_out); \
+        MULADD_128(x_data_in, y_data_in, table_lo_y, table_hi_y); \
+        x_data_out = _mm_xor_si128(x_data_out, x_data_in); \
+        _mm_storeu_si128(x_ptr_out, x_data_out); }
+
+        IFFTB_128_XOR(x16_in + 3, y16_in + 3, x16_out + 3, y16_out + 3);
+        IFFTB_128_XOR(x16_in + 2, y16_in + 2, x16_out + 2, y16_out + 2);
+        IFFTB_128_XOR(x16_in + 1, y16_in + 1, x16_out + 1, y16_out + 1);
+        IFFTB_128_XOR(x16_in, y16_in, x16_out, y16_out);
+        y16_in += 4, x16_in += 4, y16_out += 4, x16_out += 4;
 
-        return;
-    }
+        bytes -= 64;
+    } while (bytes > 0);
+}
 
-    // Reference version:
+static void IFFT_DIT2_xor_ref(
+    void * RESTRICT x_in, void * RESTRICT y_in,
+    void * RESTRICT x_out, void * RESTRICT y_out,
+    const ffe_t log_m, uint64_t bytes)
+{
     xor_mem(y_in, x_in, bytes);
     RefMulAdd(x_in, y_in, log_m, bytes);
     xor_mem(y_out, y_in, bytes);
@@ -878,39 +1229,145 @@ static void IFFT_DIT2_xor(
 }
 
 
-// xor_result ^= IFFT_DIT4(work)
-static void IFFT_DIT4_xor(
+// xor_result ^= IFFT_DIT4(work) over the same span, indexed by TrivialSkews4()
+static void (*IFFT_DIT4_xor[8])(
     uint64_t bytes,
     void** work_in,
     void** xor_out,
     unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02);
+
+#ifdef INTERLEAVE_BUTTERFLY4_OPT
+
+#if defined(TRY_GFNI)
+
+template<unsigned kTrivial>
+static TARGET_GFNI void IFFT_DIT4_xor_gfni(
+    uint64_t bytes,
+    void** work_in,
+    void** xor_out,
+    unsigned dist,
+    unsigned count,
     const ffe_t log_m01,
     const ffe_t log_m23,
     const ffe_t log_m02)
 {
-#ifdef INTERLEAVE_BUTTERFLY4_OPT
+    const M256 m01 = _mm256_set1_epi64x(Multiply8Affine[log_m01]);
+    const M256 m23 = _mm256_set1_epi64x(Multiply8Affine[log_m23]);
+    const M256 m02 = _mm256_set1_epi64x(Multiply8Affine[log_m02]);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+        {
+            PrefetchButterfly(work_in + i + 1, dist, 4);
+            PrefetchButterfly(xor_out + i + 1, dist, 4);
+        }
+#endif // PREFETCH_NEXT_OPT
+
+        const M256 * RESTRICT work0 = reinterpret_cast<const M256 *>(work_in[i]);
+        const M256 * RESTRICT work1 = reinterpret_cast<const M256 *>(work_in[i + dist]);
+        const M256 * RESTRICT work2 = reinterpret_cast<const M256 *>(work_in[i + dist * 2]);
+        const M256 * RESTRICT work3 = reinterpret_cast<const M256 *>(work_in[i + dist * 3]);
+        M256 * RESTRICT xor0 = reinterpret_cast<M256 *>(xor_out[i]);
+        M256 * RESTRICT xor1 = reinterpret_cast<M256 *>(xor_out[i + dist]);
+        M256 * RESTRICT xor2 = reinterpret_cast<M256 *>(xor_out[i + dist * 2]);
+        M256 * RESTRICT xor3 = reinterpret_cast<M256 *>(xor_out[i + dist * 3]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            // First layer:
+            M256 work0_reg = _mm256_loadu_si256(work0);
+            M256 work1_reg = _mm256_loadu_si256(work1);
+            work0++, work1++;
+
+            work1_reg = _mm256_xor_si256(work0_reg, work1_reg);
+            if (!(kTrivial & kTrivial01))
+                MULADD_GFNI_256(work0_reg, work1_reg, m01);
+
+            M256 work2_reg = _mm256_loadu_si256(work2);
+            M256 work3_reg = _mm256_loadu_si256(work3);
+            work2++, work3++;
+
+            work3_reg = _mm256_xor_si256(work2_reg, work3_reg);
+            if (!(kTrivial & kTrivial23))
+                MULADD_GFNI_256(work2_reg, work3_reg, m23);
+
+            // Second layer:
+            work2_reg = _mm256_xor_si256(work0_reg, work2_reg);
+            work3_reg = _mm256_xor_si256(work1_reg, work3_reg);
+            if (!(kTrivial & kTrivial02))
+            {
+                MULADD_GFNI_256(work0_reg, work2_reg, m02);
+                MULADD_GFNI_256(work1_reg, work3_reg, m02);
+            }
+
+            work0_reg = _mm256_xor_si256(work0_reg, _mm256_loadu_si256(xor0));
+            work1_reg = _mm256_xor_si256(work1_reg, _mm256_loadu_si256(xor1));
+            work2_reg = _mm256_xor_si256(work2_reg, _mm256_loadu_si256(xor2));
+            work3_reg = _mm256_xor_si256(work3_reg, _mm256_loadu_si256(xor3));
+
+            _mm256_storeu_si256(xor0, work0_reg);
+            _mm256_storeu_si256(xor1, work1_reg);
+            _mm256_storeu_si256(xor2, work2_reg);
+            _mm256_storeu_si256(xor3, work3_reg);
+            xor0++, xor1++, xor2++, xor3++;
+
+            piece_bytes -= 32;
+        } while (piece_bytes > 0);
+    }
+}
+
+#endif // TRY_GFNI
 
 #if defined(TRY_AVX2)
 
-    if (CpuHasAVX2)
+template<unsigned kTrivial>
+static TARGET_AVX2 void IFFT_DIT4_xor_avx2(
+    uint64_t bytes,
+    void** work_in,
+    void** xor_out,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    const M256 t01_lo = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[0]);
+    const M256 t01_hi = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[1]);
+    const M256 t23_lo = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[0]);
+    const M256 t23_hi = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[1]);
+    const M256 t02_lo = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[0]);
+    const M256 t02_hi = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[1]);
+
+    const M256 clr_mask = _mm256_set1_epi8(0x0f);
+
+    for (unsigned i = 0; i < count; ++i)
     {
-        const M256 t01_lo = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[0]);
-        const M256 t01_hi = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[1]);
-        const M256 t23_lo = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[0]);
-        const M256 t23_hi = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[1]);
-        const M256 t02_lo = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[0]);
-        const M256 t02_hi = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[1]);
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+        {
+            PrefetchButterfly(work_in + i + 1, dist, 4);
+            PrefetchButterfly(xor_out + i + 1, dist, 4);
+        }
+#endif // PREFETCH_NEXT_OPT
 
-        const M256 clr_mask = _mm256_set1_epi8(0x0f);
+        const M256 * RESTRICT work0 = reinterpret_cast<const M256 *>(work_in[i]);
+        const M256 * RESTRICT work1 = reinterpret_cast<const M256 *>(work_in[i + dist]);
+        const M256 * RESTRICT work2 = reinterpret_cast<const M256 *>(work_in[i + dist * 2]);
+        const M256 * RESTRICT work3 = reinterpret_cast<const M256 *>(work_in[i + dist * 3]);
+        M256 * RESTRICT xor0 = reinterpret_cast<M256 *>(xor_out[i]);
+        M256 * RESTRICT xor1 = reinterpret_cast<M256 *>(xor_out[i + dist]);
+        M256 * RESTRICT xor2 = reinterpret_cast<M256 *>(xor_out[i + dist * 2]);
+        M256 * RESTRICT xor3 = reinterpret_cast<M256 *>(xor_out[i + dist * 3]);
 
-        const M256 * RESTRICT work0 = reinterpret_cast<const M256 *>(work_in[0]);
-        const M256 * RESTRICT work1 = reinterpret_cast<const M256 *>(work_in[dist]);
-        const M256 * RESTRICT work2 = reinterpret_cast<const M256 *>(work_in[dist * 2]);
-        const M256 * RESTRICT work3 = reinterpret_cast<const M256 *>(work_in[dist * 3]);
-        M256 * RESTRICT xor0 = reinterpret_cast<M256 *>(xor_out[0]);
-        M256 * RESTRICT xor1 = reinterpret_cast<M256 *>(xor_out[dist]);
-        M256 * RESTRICT xor2 = reinterpret_cast<M256 *>(xor_out[dist * 2]);
-        M256 * RESTRICT xor3 = reinterpret_cast<M256 *>(xor_out[dist * 3]);
+        uint64_t piece_bytes = bytes;
 
         do
         {
@@ -920,7 +1377,7 @@ static void IFFT_DIT4_xor(
             work0++, work1++;
 
             work1_reg = _mm256_xor_si256(work0_reg, work1_reg);
-            if (log_m01 != kModulus)
+            if (!(kTrivial & kTrivial01))
                 MULADD_256(work0_reg, work1_reg, t01_lo, t01_hi);
 
             M256 work2_reg = _mm256_loadu_si256(work2);
@@ -928,13 +1385,13 @@ static void IFFT_DIT4_xor(
             work2++, work3++;
 
             work3_reg = _mm256_xor_si256(work2_reg, work3_reg);
-            if (log_m23 != kModulus)
+            if (!(kTrivial & kTrivial23))
                 MULADD_256(work2_reg, work3_reg, t23_lo, t23_hi);
 
             // Second layer:
             work2_reg = _mm256_xor_si256(work0_reg, work2_reg);
             work3_reg = _mm256_xor_si256(work1_reg, work3_reg);
-            if (log_m02 != kModulus)
+            if (!(kTrivial & kTrivial02))
             {
                 MULADD_256(work0_reg, work2_reg, t02_lo, t02_hi);
                 MULADD_256(work1_reg, work3_reg, t02_lo, t02_hi);
@@ -951,33 +1408,53 @@ static void IFFT_DIT4_xor(
             _mm256_storeu_si256(xor3, work3_reg);
             xor0++, xor1++, xor2++, xor3++;
 
-            bytes -= 32;
-        } while (bytes > 0);
-
-        return;
+            piece_bytes -= 32;
+        } while (piece_bytes > 0);
     }
+}
 
 #endif // TRY_AVX2
 
-    if (CpuHasSSSE3)
+template<unsigned kTrivial>
+static TARGET_SSSE3 void IFFT_DIT4_xor_ssse3(
+    uint64_t bytes,
+    void** work_in,
+    void** xor_out,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    const M128 t01_lo = _mm_loadu_si128(&Multiply128LUT[log_m01].Value[0]);
+    const M128 t01_hi = _mm_loadu_si128(&Multiply128LUT[log_m01].Value[1]);
+    const M128 t23_lo = _mm_loadu_si128(&Multiply128LUT[log_m23].Value[0]);
+    const M128 t23_hi = _mm_loadu_si128(&Multiply128LUT[log_m23].Value[1]);
+    const M128 t02_lo = _mm_loadu_si128(&Multiply128LUT[log_m02].Value[0]);
+    const M128 t02_hi = _mm_loadu_si128(&Multiply128LUT[log_m02].Value[1]);
+
+    const M128 clr_mask = _mm_set1_epi8(0x0f);
+
+    for (unsigned i = 0; i < count; ++i)
     {
-        const M128 t01_lo = _mm_loadu_si128(&Multiply128LUT[log_m01].Value[0]);
-        const M128 t01_hi = _mm_loadu_si128(&Multiply128LUT[log_m01].Value[1]);
-        const M128 t23_lo = _mm_loadu_si128(&Multiply128LUT[log_m23].Value[0]);
-        const M128 t23_hi = _mm_loadu_si128(&Multiply128LUT[log_m23].Value[1]);
-        const M128 t02_lo = _mm_loadu_si128(&Multiply128LUT[log_m02].Value[0]);
-        const M128 t02_hi = _mm_loadu_si128(&Multiply128LUT[log_m02].Value[1]);
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+        {
+            PrefetchButterfly(work_in + i + 1, dist, 4);
+            PrefetchButterfly(xor_out + i + 1, dist, 4);
+        }
+#endif // PREFETCH_NEXT_OPT
 
-        const M128 clr_mask = _mm_set1_epi8(0x0f);
+        const M128 * RESTRICT work0 = reinterpret_cast<const M128 *>(work_in[i]);
+        const M128 * RESTRICT work1 = reinterpret_cast<const M128 *>(work_in[i + dist]);
+        const M128 * RESTRICT work2 = reinterpret_cast<const M128 *>(work_in[i + dist * 2]);
+        const M128 * RESTRICT work3 = reinterpret_cast<const M128 *>(work_in[i + dist * 3]);
+        M128 * RESTRICT xor0 = reinterpret_cast<M128 *>(xor_out[i]);
+        M128 * RESTRICT xor1 = reinterpret_cast<M128 *>(xor_out[i + dist]);
+        M128 * RESTRICT xor2 = reinterpret_cast<M128 *>(xor_out[i + dist * 2]);
+        M128 * RESTRICT xor3 = reinterpret_cast<M128 *>(xor_out[i + dist * 3]);
 
-        const M128 * RESTRICT work0 = reinterpret_cast<const M128 *>(work_in[0]);
-        const M128 * RESTRICT work1 = reinterpret_cast<const M128 *>(work_in[dist]);
-        const M128 * RESTRICT work2 = reinterpret_cast<const M128 *>(work_in[dist * 2]);
-        const M128 * RESTRICT work3 = reinterpret_cast<const M128 *>(work_in[dist * 3]);
-        M128 * RESTRICT xor0 = reinterpret_cast<M128 *>(xor_out[0]);
-        M128 * RESTRICT xor1 = reinterpret_cast<M128 *>(xor_out[dist]);
-        M128 * RESTRICT xor2 = reinterpret_cast<M128 *>(xor_out[dist * 2]);
-        M128 * RESTRICT xor3 = reinterpret_cast<M128 *>(xor_out[dist * 3]);
+        uint64_t piece_bytes = bytes;
 
         do
         {
@@ -987,7 +1464,7 @@ static void IFFT_DIT4_xor(
             work0++, work1++;
 
             work1_reg = _mm_xor_si128(work0_reg, work1_reg);
-            if (log_m01 != kModulus)
+            if (!(kTrivial & kTrivial01))
                 MULADD_128(work0_reg, work1_reg, t01_lo, t01_hi);
 
             M128 work2_reg = _mm_loadu_si128(work2);
@@ -995,13 +1472,13 @@ static void IFFT_DIT4_xor(
             work2++, work3++;
 
             work3_reg = _mm_xor_si128(work2_reg, work3_reg);
-            if (log_m23 != kModulus)
+            if (!(kTrivial & kTrivial23))
                 MULADD_128(work2_reg, work3_reg, t23_lo, t23_hi);
 
             // Second layer:
             work2_reg = _mm_xor_si128(work0_reg, work2_reg);
             work3_reg = _mm_xor_si128(work1_reg, work3_reg);
-            if (log_m02 != kModulus)
+            if (!(kTrivial & kTrivial02))
             {
                 MULADD_128(work0_reg, work2_reg, t02_lo, t02_hi);
                 MULADD_128(work1_reg, work3_reg, t02_lo, t02_hi);
@@ -1018,41 +1495,61 @@ static void IFFT_DIT4_xor(
             _mm_storeu_si128(xor3, work3_reg);
             xor0++, xor1++, xor2++, xor3++;
 
-            bytes -= 16;
-        } while (bytes > 0);
-
-        return;
+            piece_bytes -= 16;
+        } while (piece_bytes > 0);
     }
+}
 
 #endif // INTERLEAVE_BUTTERFLY4_OPT
 
-    // First layer:
-    if (log_m01 == kModulus)
-        xor_mem(work_in[dist], work_in[0], bytes);
-    else
-        IFFT_DIT2(work_in[0], work_in[dist], log_m01, bytes);
+static void IFFT_DIT4_xor_ref(
+    uint64_t bytes,
+    void** work_in,
+    void** xor_out,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+        {
+            PrefetchButterfly(work_in + i + 1, dist, 4);
+            PrefetchButterfly(xor_out + i + 1, dist, 4);
+        }
+#endif // PREFETCH_NEXT_OPT
+
+        // First layer:
+        if (log_m01 == kModulus)
+            xor_mem(work_in[i + dist], work_in[i], bytes);
+        else
+            IFFT_DIT2(work_in[i], work_in[i + dist], log_m01, bytes);
 
-    if (log_m23 == kModulus)
-        xor_mem(work_in[dist * 3], work_in[dist * 2], bytes);
-    else
-        IFFT_DIT2(work_in[dist * 2], work_in[dist * 3], log_m23, bytes);
+        if (log_m23 == kModulus)
+            xor_mem(work_in[i + dist * 3], work_in[i + dist * 2], bytes);
+        else
+            IFFT_DIT2(work_in[i + dist * 2], work_in[i + dist * 3], log_m23, bytes);
 
-    // Second layer:
-    if (log_m02 == kModulus)
-    {
-        xor_mem(work_in[dist * 2], work_in[0], bytes);
-        xor_mem(work_in[dist * 3], work_in[dist], bytes);
-    }
-    else
-    {
-        IFFT_DIT2(work_in[0], work_in[dist * 2], log_m02, bytes);
-        IFFT_DIT2(work_in[dist], work_in[dist * 3], log_m02, bytes);
-    }
+        // Second layer:
+        if (log_m02 == kModulus)
+        {
+            xor_mem(work_in[i + dist * 2], work_in[i], bytes);
+            xor_mem(work_in[i + dist * 3], work_in[i + dist], bytes);
+        }
+        else
+        {
+            IFFT_DIT2(work_in[i], work_in[i + dist * 2], log_m02, bytes);
+            IFFT_DIT2(work_in[i + dist], work_in[i + dist * 3], log_m02, bytes);
+        }
 
-    xor_mem(xor_out[0], work_in[0], bytes);
-    xor_mem(xor_out[dist], work_in[dist], bytes);
-    xor_mem(xor_out[dist * 2], work_in[dist * 2], bytes);
-    xor_mem(xor_out[dist * 3], work_in[dist * 3], bytes);
+        xor_mem(xor_out[i], work_in[i], bytes);
+        xor_mem(xor_out[i + dist], work_in[i + dist], bytes);
+        xor_mem(xor_out[i + dist * 2], work_in[i + dist * 2], bytes);
+        xor_mem(xor_out[i + dist * 3], work_in[i + dist * 3], bytes);
+    }
 }
 
 
@@ -1078,46 +1575,81 @@ static void IFFT_DIT_Encoder(
     // found that it only provides about 5% performance boost, which is not
     // worth the extra complexity.
 
+    unsigned dist = 1;
+
+#ifdef INTERLEAVE_BUTTERFLY8_OPT
+    // Decimation in time: Unroll 3 layers at a time while 8-way butterflies
+    // are available, leaving the remaining layers to the loop below.  The
+    // final layers are left to the 4-way or 2-way xor butterflies, which also
+    // accumulate into xor_result
+    for (unsigned dist8 = 8; IFFT_DIT8 && dist8 <= m && !(xor_result && dist8 == m); dist = dist8, dist8 <<= 3)
+    {
+        // For each set of dist*8 elements:
+        for (unsigned r = 0; r < m_truncated; r += dist8)
+        {
+            const unsigned i_end = r + dist;
+            const ffe_t log_m01 = skewLUT[i_end - 1];
+            const ffe_t log_m02 = skewLUT[i_end + dist - 1];
+            const ffe_t log_m23 = skewLUT[i_end + dist * 2 - 1];
+            const ffe_t log_m04 = skewLUT[i_end + dist * 3 - 1];
+            const ffe_t log_m45 = skewLUT[i_end + dist * 4 - 1];
+            const ffe_t log_m46 = skewLUT[i_end + dist * 5 - 1];
+            const ffe_t log_m67 = skewLUT[i_end + dist * 6 - 1];
+
+            // For each set of dist elements:
+            IFFT_DIT8(
+                bytes,
+                work + r,
+                dist,
+                dist,
+                log_m01,
+                log_m23,
+                log_m45,
+                log_m67,
+                log_m02,
+                log_m46,
+                log_m04);
+        }
+    }
+#endif // INTERLEAVE_BUTTERFLY8_OPT
+
     // Decimation in time: Unroll 2 layers at a time
-    unsigned dist = 1, dist4 = 4;
+    unsigned dist4 = dist * 4;
     for (; dist4 <= m; dist = dist4, dist4 <<= 2)
     {
         // For each set of dist*4 elements:
         for (unsigned r = 0; r < m_truncated; r += dist4)
         {
             const unsigned i_end = r + dist;
-            const ffe_t log_m01 = skewLUT[i_end];
-            const ffe_t log_m02 = skewLUT[i_end + dist];
-            const ffe_t log_m23 = skewLUT[i_end + dist * 2];
+            const ffe_t log_m01 = skewLUT[i_end - 1];
+            const ffe_t log_m02 = skewLUT[i_end + dist - 1];
+            const ffe_t log_m23 = skewLUT[i_end + dist * 2 - 1];
+            const unsigned trivial = TrivialSkews4(log_m01, log_m23, log_m02);
 
             if (dist4 == m && xor_result)
             {
                 // For each set of dist elements:
-                for (unsigned i = r; i < i_end; ++i)
-                {
-                    IFFT_DIT4_xor(
-                        bytes,
-                        work + i,
-                        xor_result + i,
-                        dist,
-                        log_m01,
-                        log_m23,
-                        log_m02);
-                }
+                IFFT_DIT4_xor[trivial](
+                    bytes,
+                    work + r,
+                    xor_result + r,
+                    dist,
+                    dist,
+                    log_m01,
+                    log_m23,
+                    log_m02);
             }
             else
             {
                 // For each set of dist elements:
-                for (unsigned i = r; i < i_end; ++i)
-                {
-                    IFFT_DIT4(
-                        bytes,
-                        work + i,
-                        dist,
-                        log_m01,
-                        log_m23,
-                        log_m02);
-                }
+                IFFT_DIT4[trivial](
+                    bytes,
+                    work + r,
+                    dist,
+                    dist,
+                    log_m01,
+                    log_m23,
+                    log_m02);
             }
         }
 
@@ -1132,7 +1664,7 @@ static void IFFT_DIT_Encoder(
         // Assuming that dist = m / 2
         DEBUG_ASSERT(dist * 2 == m);
 
-        const ffe_t log_m = skewLUT[dist];
+        const ffe_t log_m = skewLUT[dist - 1];
 
         if (xor_result)
         {
@@ -1145,6 +1677,13 @@ static void IFFT_DIT_Encoder(
             {
                 for (unsigned i = 0; i < dist; ++i)
                 {
+#ifdef PREFETCH_NEXT_OPT
+                    if (i + 1 < dist)
+                    {
+                        PrefetchButterfly(work + i + 1, dist, 2);
+                        PrefetchButterfly(xor_result + i + 1, dist, 2);
+                    }
+#endif // PREFETCH_NEXT_OPT
                     IFFT_DIT2_xor(
                         work[i],
                         work[i + dist],
@@ -1163,6 +1702,10 @@ static void IFFT_DIT_Encoder(
             {
                 for (unsigned i = 0; i < dist; ++i)
                 {
+#ifdef PREFETCH_NEXT_OPT
+                    if (i + 1 < dist)
+                        PrefetchButterfly(work + i + 1, dist, 2);
+#endif // PREFETCH_NEXT_OPT
                     IFFT_DIT2(
                         work[i],
                         work[i + dist],
@@ -1183,29 +1726,64 @@ static void IFFT_DIT_Decoder(
     const unsigned m,
     const ffe_t* skewLUT)
 {
+    unsigned dist = 1;
+
+#ifdef INTERLEAVE_BUTTERFLY8_OPT
+    // Decimation in time: Unroll 3 layers at a time while 8-way butterflies
+    // are available, leaving the remaining layers to the loop below
+    for (unsigned dist8 = 8; IFFT_DIT8 && dist8 <= m; dist = dist8, dist8 <<= 3)
+    {
+        // For each set of dist*8 elements:
+        for (unsigned r = 0; r < m_truncated; r += dist8)
+        {
+            const unsigned i_end = r + dist;
+            const ffe_t log_m01 = skewLUT[i_end - 1];
+            const ffe_t log_m02 = skewLUT[i_end + dist - 1];
+            const ffe_t log_m23 = skewLUT[i_end + dist * 2 - 1];
+            const ffe_t log_m04 = skewLUT[i_end + dist * 3 - 1];
+            const ffe_t log_m45 = skewLUT[i_end + dist * 4 - 1];
+            const ffe_t log_m46 = skewLUT[i_end + dist * 5 - 1];
+            const ffe_t log_m67 = skewLUT[i_end + dist * 6 - 1];
+
+            // For each set of dist elements:
+            IFFT_DIT8(
+                bytes,
+                work + r,
+                dist,
+                dist,
+                log_m01,
+                log_m23,
+                log_m45,
+                log_m67,
+                log_m02,
+                log_m46,
+                log_m04);
+        }
+    }
+#endif // INTERLEAVE_BUTTERFLY8_OPT
+
     // Decimation in time: Unroll 2 layers at a time
-    unsigned dist = 1, dist4 = 4;
+    unsigned dist4 = dist * 4;
     for (; dist4 <= m; dist = dist4, dist4 <<= 2)
     {
         // For each set of dist*4 elements:
         for (unsigned r = 0; r < m_truncated; r += dist4)
         {
             const unsigned i_end = r + dist;
-            const ffe_t log_m01 = skewLUT[i_end];
-            const ffe_t log_m02 = skewLUT[i_end + dist];
-            const ffe_t log_m23 = skewLUT[i_end + dist * 2];
+            const ffe_t log_m01 = skewLUT[i_end - 1];
+            const ffe_t log_m02 = skewLUT[i_end + dist - 1];
+            const ffe_t log_m23 = skewLUT[i_end + dist * 2 - 1];
+            const unsigned trivial = TrivialSkews4(log_m01, log_m23, log_m02);
 
             // For each set of dist elements:
-            for (unsigned i = r; i < i_end; ++i)
-            {
-                IFFT_DIT4(
-                    bytes,
-                    work + i,
-                    dist,
-                    log_m01,
-                    log_m23,
-                    log_m02);
-            }
+            IFFT_DIT4[trivial](
+                bytes,
+                work + r,
+                dist,
+                dist,
+                log_m01,
+                log_m23,
+                log_m02);
         }
     }
 
@@ -1215,7 +1793,7 @@ static void IFFT_DIT_Decoder(
         // Assuming that dist = m / 2
         DEBUG_ASSERT(dist * 2 == m);
 
-        const ffe_t log_m = skewLUT[dist];
+        const ffe_t log_m = skewLUT[dist - 1];
 
         if (log_m == kModulus)
             VectorXOR(bytes, dist, work + dist, work);
@@ -1223,6 +1801,10 @@ static void IFFT_DIT_Decoder(
         {
             for (unsigned i = 0; i < dist; ++i)
             {
+#ifdef PREFETCH_NEXT_OPT
+                if (i + 1 < dist)
+                    PrefetchButterfly(work + i + 1, dist, 2);
+#endif // PREFETCH_NEXT_OPT
                 IFFT_DIT2(
                     work[i],
                     work[i + dist],
@@ -1288,107 +1870,259 @@ static void IFFT_DIT_Decoder(
 */
 
 // 2-way butterfly
-static void FFT_DIT2(
+static void (*FFT_DIT2)(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes);
+
+// FFT_DIT2() writing with streaming stores, for the last layer of the encoder
+static void (*FFT_DIT2_stream)(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes);
+
+#if defined(TRY_GFNI)
+
+template<bool kStream = false>
+static TARGET_GFNI void FFT_DIT2_gfni(
     void * RESTRICT x, void * RESTRICT y,
     ffe_t log_m, uint64_t bytes)
 {
-#if defined(TRY_AVX2)
-    if (CpuHasAVX2)
+    const M256 matrix_y = _mm256_set1_epi64x(Multiply8Affine[log_m]);
+
+    M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
+    M256 * RESTRICT y32 = reinterpret_cast<M256 *>(y);
+
+    do
     {
-        const M256 table_lo_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[0]);
-        const M256 table_hi_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[1]);
+#define FFTB_GFNI_256(x_ptr, y_ptr) { \
+        M256 y_data = _mm256_loadu_si256(y_ptr); \
+        M256 x_data = _mm256_loadu_si256(x_ptr); \
+        MULADD_GFNI_256(x_data, y_data, matrix_y); \
+        y_data = _mm256_xor_si256(y_data, x_data); \
+        STORE_256(kStream, x_ptr, x_data); \
+        STORE_256(kStream, y_ptr, y_data); }
+
+        FFTB_GFNI_256(x32 + 1, y32 + 1);
+        FFTB_GFNI_256(x32, y32);
+        y32 += 2, x32 += 2;
 
-        const M256 clr_mask = _mm256_set1_epi8(0x0f);
+        bytes -= 64;
+    } while (bytes > 0);
 
-        M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
-        M256 * RESTRICT y32 = reinterpret_cast<M256 *>(y);
+    if (kStream)
+        _mm_sfence();
+}
 
-        do
-        {
+#endif // TRY_GFNI
+
+#if defined(TRY_AVX2)
+
+template<bool kStream = false>
+static TARGET_AVX2 void FFT_DIT2_avx2(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    const M256 table_lo_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[0]);
+    const M256 table_hi_y = _mm256_loadu_si256(&Multiply256LUT[log_m].Value[1]);
+
+    const M256 clr_mask = _mm256_set1_epi8(0x0f);
+
+    M256 * RESTRICT x32 = reinterpret_cast<M256 *>(x);
+    M256 * RESTRICT y32 = reinterpret_cast<M256 *>(y);
+
+    do
+    {
 #define FFTB_256(x_ptr, y_ptr) { \
-            M256 y_data = _mm256_loadu_si256(y_ptr); \
-            M256 x_data = _mm256_loadu_si256(x_ptr); \
-            MULADD_256(x_data, y_data, table_lo_y, table_hi_y); \
-            y_data = _mm256_xor_si256(y_data, x_data); \
-            _mm256_storeu_si256(x_ptr, x_data); \
-            _mm256_storeu_si256(y_ptr, y_data); }
+        M256 y_data = _mm256_loadu_si256(y_ptr); \
+        M256 x_data = _mm256_loadu_si256(x_ptr); \
+        MULADD_256(x_data, y_data, table_lo_y, table_hi_y); \
+        y_data = _mm256_xor_si256(y_data, x_data); \
+        STORE_256(kStream, x_ptr, x_data); \
+        STORE_256(kStream, y_ptr, y_data); }
 
-            FFTB_256(x32 + 1, y32 + 1);
-            FFTB_256(x32, y32);
-            y32 += 2, x32 += 2;
+        FFTB_256(x32 + 1, y32 + 1);
+        FFTB_256(x32, y32);
+        y32 += 2, x32 += 2;
 
-            bytes -= 64;
-        } while (bytes > 0);
+        bytes -= 64;
+    } while (bytes > 0);
+
+    if (kStream)
+        _mm_sfence();
+}
 
-        return;
-    }
 #endif // TRY_AVX2
 
-    if (CpuHasSSSE3)
-    {
-        const M128 table_lo_y = _mm_loadu_si128(&Multiply128LUT[log_m].Value[0]);
-        const M128 table_hi_y = _mm_loadu_si128(&Multiply128LUT[log_m].Value[1]);
+static TARGET_SSSE3 void FFT_DIT2_ssse3(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
+    const M128 table_lo_y = _mm_loadu_si128(&Multiply128LUT[log_m].Value[0]);
+    const M128 table_hi_y = _mm_loadu_si128(&Multiply128LUT[log_m].Value[1]);
 
-        const M128 clr_mask = _mm_set1_epi8(0x0f);
+    const M128 clr_mask = _mm_set1_epi8(0x0f);
 
-        M128 * RESTRICT x16 = reinterpret_cast<M128 *>(x);
-        M128 * RESTRICT y16 = reinterpret_cast<M128 *>(y);
+    M128 * RESTRICT x16 = reinterpret_cast<M128 *>(x);
+    M128 * RESTRICT y16 = reinterpret_cast<M128 *>(y);
 
-        do
-        {
+    do
+    {
 #define FFTB_128(x_ptr, y_ptr) { \
-            M128 y_data = _mm_loadu_si128(y_ptr); \
-            M128 x_data = _mm_loadu_si128(x_ptr); \
-            MULADD_128(x_data, y_data, table_lo_y, table_hi_y); \
-            y_data = _mm_xor_si128(y_data, x_data); \
-            _mm_storeu_si128(x_ptr, x_data); \
-            _mm_storeu_si128(y_ptr, y_data); }
-
-            FFTB_128(x16 + 3, y16 + 3);
-            FFTB_128(x16 + 2, y16 + 2);
-            FFTB_128(x16 + 1, y16 + 1);
-            FFTB_128(x16, y16);
-            x16 += 4, y16 += 4;
-
-            bytes -= 64;
-        } while (bytes > 0);
+        M128 y_data = _mm_loadu_si128(y_ptr); \
+        M128 x_data = _mm_loadu_si128(x_ptr); \
+        MULADD_128(x_data, y_data, table_lo_y, table_hi_y); \
+        y_data = _mm_xor_si128(y_data, x_data); \
+        _mm_storeu_si128(x_ptr, x_data); \
+        _mm_storeu_si128(y_ptr, y_data); }
+
+        FFTB_128(x16 + 3, y16 + 3);
+        FFTB_128(x16 + 2, y16 + 2);
+        FFTB_128(x16 + 1, y16 + 1);
+        FFTB_128(x16, y16);
+        x16 += 4, y16 += 4;
 
-        return;
-    }
+        bytes -= 64;
+    } while (bytes > 0);
+}
 
-    // Reference version:
+static void FFT_DIT2_ref(
+    void * RESTRICT x, void * RESTRICT y,
+    ffe_t log_m, uint64_t bytes)
+{
     RefMulAdd(x, y, log_m, bytes);
     xor_mem(y, x, bytes);
 }
 
 
-// 4-way butterfly
-static void FFT_DIT4(
+// 4-way butterfly over the same span of count pieces as IFFT_DIT4(), indexed
+// by TrivialSkews4()
+static void (*FFT_DIT4[8])(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02);
+
+// FFT_DIT4() writing with streaming stores, for the last layer of the encoder
+static void (*FFT_DIT4_stream[8])(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02);
+
+#ifdef INTERLEAVE_BUTTERFLY4_OPT
+
+#if defined(TRY_GFNI)
+
+template<unsigned kTrivial, bool kStream = false>
+static TARGET_GFNI void FFT_DIT4_gfni(
     uint64_t bytes,
     void** work,
     unsigned dist,
+    unsigned count,
     const ffe_t log_m01,
     const ffe_t log_m23,
     const ffe_t log_m02)
 {
-#ifdef INTERLEAVE_BUTTERFLY4_OPT
+    const M256 m01 = _mm256_set1_epi64x(Multiply8Affine[log_m01]);
+    const M256 m23 = _mm256_set1_epi64x(Multiply8Affine[log_m23]);
+    const M256 m02 = _mm256_set1_epi64x(Multiply8Affine[log_m02]);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
+
+        M256 * RESTRICT work0 = reinterpret_cast<M256 *>(work[i]);
+        M256 * RESTRICT work1 = reinterpret_cast<M256 *>(work[i + dist]);
+        M256 * RESTRICT work2 = reinterpret_cast<M256 *>(work[i + dist * 2]);
+        M256 * RESTRICT work3 = reinterpret_cast<M256 *>(work[i + dist * 3]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            M256 work0_reg = _mm256_loadu_si256(work0);
+            M256 work2_reg = _mm256_loadu_si256(work2);
+            M256 work1_reg = _mm256_loadu_si256(work1);
+            M256 work3_reg = _mm256_loadu_si256(work3);
+
+            // First layer:
+            if (!(kTrivial & kTrivial02))
+            {
+                MULADD_GFNI_256(work0_reg, work2_reg, m02);
+                MULADD_GFNI_256(work1_reg, work3_reg, m02);
+            }
+            work2_reg = _mm256_xor_si256(work0_reg, work2_reg);
+            work3_reg = _mm256_xor_si256(work1_reg, work3_reg);
+
+            // Second layer:
+            if (!(kTrivial & kTrivial01))
+                MULADD_GFNI_256(work0_reg, work1_reg, m01);
+            work1_reg = _mm256_xor_si256(work0_reg, work1_reg);
+
+            STORE_256(kStream, work0, work0_reg);
+            STORE_256(kStream, work1, work1_reg);
+            work0++, work1++;
+
+            if (!(kTrivial & kTrivial23))
+                MULADD_GFNI_256(work2_reg, work3_reg, m23);
+            work3_reg = _mm256_xor_si256(work2_reg, work3_reg);
+
+            STORE_256(kStream, work2, work2_reg);
+            STORE_256(kStream, work3, work3_reg);
+            work2++, work3++;
+
+            piece_bytes -= 32;
+        } while (piece_bytes > 0);
+    }
+
+    if (kStream)
+        _mm_sfence();
+}
+
+#endif // TRY_GFNI
 
 #if defined(TRY_AVX2)
-    if (CpuHasAVX2)
+
+template<unsigned kTrivial, bool kStream = false>
+static TARGET_AVX2 void FFT_DIT4_avx2(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    const M256 t01_lo = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[0]);
+    const M256 t01_hi = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[1]);
+    const M256 t23_lo = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[0]);
+    const M256 t23_hi = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[1]);
+    const M256 t02_lo = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[0]);
+    const M256 t02_hi = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[1]);
+
+    const M256 clr_mask = _mm256_set1_epi8(0x0f);
+
+    for (unsigned i = 0; i < count; ++i)
     {
-        const M256 t01_lo = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[0]);
-        const M256 t01_hi = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[1]);
-        const M256 t23_lo = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[0]);
-        const M256 t23_hi = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[1]);
-        const M256 t02_lo = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[0]);
-        const M256 t02_hi = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[1]);
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
 
-        const M256 clr_mask = _mm256_set1_epi8(0x0f);
+        M256 * RESTRICT work0 = reinterpret_cast<M256 *>(work[i]);
+        M256 * RESTRICT work1 = reinterpret_cast<M256 *>(work[i + dist]);
+        M256 * RESTRICT work2 = reinterpret_cast<M256 *>(work[i + dist * 2]);
+        M256 * RESTRICT work3 = reinterpret_cast<M256 *>(work[i + dist * 3]);
 
-        M256 * RESTRICT work0 = reinterpret_cast<M256 *>(work[0]);
-        M256 * RESTRICT work1 = reinterpret_cast<M256 *>(work[dist]);
-        M256 * RESTRICT work2 = reinterpret_cast<M256 *>(work[dist * 2]);
-        M256 * RESTRICT work3 = reinterpret_cast<M256 *>(work[dist * 3]);
+        uint64_t piece_bytes = bytes;
 
         do
         {
@@ -1398,7 +2132,7 @@ static void FFT_DIT4(
             M256 work3_reg = _mm256_loadu_si256(work3);
 
             // First layer:
-            if (log_m02 != kModulus)
+            if (!(kTrivial & kTrivial02))
             {
                 MULADD_256(work0_reg, work2_reg, t02_lo, t02_hi);
                 MULADD_256(work1_reg, work3_reg, t02_lo, t02_hi);
@@ -1407,157 +2141,523 @@ static void FFT_DIT4(
             work3_reg = _mm256_xor_si256(work1_reg, work3_reg);
 
             // Second layer:
-            if (log_m01 != kModulus)
+            if (!(kTrivial & kTrivial01))
                 MULADD_256(work0_reg, work1_reg, t01_lo, t01_hi);
             work1_reg = _mm256_xor_si256(work0_reg, work1_reg);
 
-            _mm256_storeu_si256(work0, work0_reg);
-            _mm256_storeu_si256(work1, work1_reg);
+            STORE_256(kStream, work0, work0_reg);
+            STORE_256(kStream, work1, work1_reg);
             work0++, work1++;
 
-            if (log_m23 != kModulus)
+            if (!(kTrivial & kTrivial23))
                 MULADD_256(work2_reg, work3_reg, t23_lo, t23_hi);
             work3_reg = _mm256_xor_si256(work2_reg, work3_reg);
 
-            _mm256_storeu_si256(work2, work2_reg);
-            _mm256_storeu_si256(work3, work3_reg);
+            STORE_256(kStream, work2, work2_reg);
+            STORE_256(kStream, work3, work3_reg);
             work2++, work3++;
 
-            bytes -= 32;
-        } while (bytes > 0);
+            piece_bytes -= 32;
+        } while (piece_bytes > 0);
+    }
 
-        return;
+    if (kStream)
+        _mm_sfence();
+}
+
+#endif // TRY_AVX2
+
+template<unsigned kTrivial>
+static TARGET_SSSE3 void FFT_DIT4_ssse3(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    const M128 t01_lo = _mm_loadu_si128(&Multiply128LUT[log_m01].Value[0]);
+    const M128 t01_hi = _mm_loadu_si128(&Multiply128LUT[log_m01].Value[1]);
+    const M128 t23_lo = _mm_loadu_si128(&Multiply128LUT[log_m23].Value[0]);
+    const M128 t23_hi = _mm_loadu_si128(&Multiply128LUT[log_m23].Value[1]);
+    const M128 t02_lo = _mm_loadu_si128(&Multiply128LUT[log_m02].Value[0]);
+    const M128 t02_hi = _mm_loadu_si128(&Multiply128LUT[log_m02].Value[1]);
+
+    const M128 clr_mask = _mm_set1_epi8(0x0f);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
+
+        M128 * RESTRICT work0 = reinterpret_cast<M128 *>(work[i]);
+        M128 * RESTRICT work1 = reinterpret_cast<M128 *>(work[i + dist]);
+        M128 * RESTRICT work2 = reinterpret_cast<M128 *>(work[i + dist * 2]);
+        M128 * RESTRICT work3 = reinterpret_cast<M128 *>(work[i + dist * 3]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            M128 work0_reg = _mm_loadu_si128(work0);
+            M128 work2_reg = _mm_loadu_si128(work2);
+            M128 work1_reg = _mm_loadu_si128(work1);
+            M128 work3_reg = _mm_loadu_si128(work3);
+
+            // First layer:
+            if (!(kTrivial & kTrivial02))
+            {
+                MULADD_128(work0_reg, work2_reg, t02_lo, t02_hi);
+                MULADD_128(work1_reg, work3_reg, t02_lo, t02_hi);
+            }
+            work2_reg = _mm_xor_si128(work0_reg, work2_reg);
+            work3_reg = _mm_xor_si128(work1_reg, work3_reg);
+
+            // Second layer:
+            if (!(kTrivial & kTrivial01))
+                MULADD_128(work0_reg, work1_reg, t01_lo, t01_hi);
+            work1_reg = _mm_xor_si128(work0_reg, work1_reg);
+
+            _mm_storeu_si128(work0, work0_reg);
+            _mm_storeu_si128(work1, work1_reg);
+            work0++, work1++;
+
+            if (!(kTrivial & kTrivial23))
+                MULADD_128(work2_reg, work3_reg, t23_lo, t23_hi);
+            work3_reg = _mm_xor_si128(work2_reg, work3_reg);
+
+            _mm_storeu_si128(work2, work2_reg);
+            _mm_storeu_si128(work3, work3_reg);
+            work2++, work3++;
+
+            piece_bytes -= 16;
+        } while (piece_bytes > 0);
+    }
+}
+
+#endif // INTERLEAVE_BUTTERFLY4_OPT
+
+static void FFT_DIT4_ref(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m02)
+{
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 4);
+#endif // PREFETCH_NEXT_OPT
+
+        // First layer:
+        if (log_m02 == kModulus)
+        {
+            xor_mem(work[i + dist * 2], work[i], bytes);
+            xor_mem(work[i + dist * 3], work[i + dist], bytes);
+        }
+        else
+        {
+            FFT_DIT2(work[i], work[i + dist * 2], log_m02, bytes);
+            FFT_DIT2(work[i + dist], work[i + dist * 3], log_m02, bytes);
+        }
+
+        // Second layer:
+        if (log_m01 == kModulus)
+            xor_mem(work[i + dist], work[i], bytes);
+        else
+            FFT_DIT2(work[i], work[i + dist], log_m01, bytes);
+
+        if (log_m23 == kModulus)
+            xor_mem(work[i + dist * 3], work[i + dist * 2], bytes);
+        else
+            FFT_DIT2(work[i + dist * 2], work[i + dist * 3], log_m23, bytes);
+    }
+}
+
+
+// 8-way butterfly: Three layers over pieces {0, dist, ..., dist * 7} in
+// registers.  Left null when no SIMD version exists, in which case the layer
+// loops stick to 4-way butterflies rather than composing this from them.
+// Covers the same span of count pieces as IFFT_DIT8()
+static void (*FFT_DIT8)(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m45,
+    const ffe_t log_m67,
+    const ffe_t log_m02,
+    const ffe_t log_m46,
+    const ffe_t log_m04);
+
+// FFT_DIT8() writing with streaming stores, for the last layers of the encoder.
+// Null whenever FFT_DIT8 is
+static void (*FFT_DIT8_stream)(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m45,
+    const ffe_t log_m67,
+    const ffe_t log_m02,
+    const ffe_t log_m46,
+    const ffe_t log_m04);
+
+#ifdef INTERLEAVE_BUTTERFLY8_OPT
+
+#if defined(TRY_GFNI)
+
+template<bool kStream = false>
+static TARGET_GFNI void FFT_DIT8_gfni(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m45,
+    const ffe_t log_m67,
+    const ffe_t log_m02,
+    const ffe_t log_m46,
+    const ffe_t log_m04)
+{
+    const M256 m01 = _mm256_set1_epi64x(Multiply8Affine[log_m01]);
+    const M256 m23 = _mm256_set1_epi64x(Multiply8Affine[log_m23]);
+    const M256 m45 = _mm256_set1_epi64x(Multiply8Affine[log_m45]);
+    const M256 m67 = _mm256_set1_epi64x(Multiply8Affine[log_m67]);
+    const M256 m02 = _mm256_set1_epi64x(Multiply8Affine[log_m02]);
+    const M256 m46 = _mm256_set1_epi64x(Multiply8Affine[log_m46]);
+    const M256 m04 = _mm256_set1_epi64x(Multiply8Affine[log_m04]);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 8);
+#endif // PREFETCH_NEXT_OPT
+
+        M256 * RESTRICT work0 = reinterpret_cast<M256 *>(work[i]);
+        M256 * RESTRICT work1 = reinterpret_cast<M256 *>(work[i + dist]);
+        M256 * RESTRICT work2 = reinterpret_cast<M256 *>(work[i + dist * 2]);
+        M256 * RESTRICT work3 = reinterpret_cast<M256 *>(work[i + dist * 3]);
+        M256 * RESTRICT work4 = reinterpret_cast<M256 *>(work[i + dist * 4]);
+        M256 * RESTRICT work5 = reinterpret_cast<M256 *>(work[i + dist * 5]);
+        M256 * RESTRICT work6 = reinterpret_cast<M256 *>(work[i + dist * 6]);
+        M256 * RESTRICT work7 = reinterpret_cast<M256 *>(work[i + dist * 7]);
+
+        uint64_t piece_bytes = bytes;
+
+        do
+        {
+            M256 work_reg_0 = _mm256_loadu_si256(work0);
+            M256 work_reg_1 = _mm256_loadu_si256(work1);
+            M256 work_reg_2 = _mm256_loadu_si256(work2);
+            M256 work_reg_3 = _mm256_loadu_si256(work3);
+            M256 work_reg_4 = _mm256_loadu_si256(work4);
+            M256 work_reg_5 = _mm256_loadu_si256(work5);
+            M256 work_reg_6 = _mm256_loadu_si256(work6);
+            M256 work_reg_7 = _mm256_loadu_si256(work7);
+
+            // First layer:
+            if (log_m04 != kModulus)
+            {
+                MULADD_GFNI_256(work_reg_0, work_reg_4, m04);
+                MULADD_GFNI_256(work_reg_1, work_reg_5, m04);
+                MULADD_GFNI_256(work_reg_2, work_reg_6, m04);
+                MULADD_GFNI_256(work_reg_3, work_reg_7, m04);
+            }
+            work_reg_4 = _mm256_xor_si256(work_reg_0, work_reg_4);
+            work_reg_5 = _mm256_xor_si256(work_reg_1, work_reg_5);
+            work_reg_6 = _mm256_xor_si256(work_reg_2, work_reg_6);
+            work_reg_7 = _mm256_xor_si256(work_reg_3, work_reg_7);
+
+            // Second layer:
+            if (log_m02 != kModulus)
+            {
+                MULADD_GFNI_256(work_reg_0, work_reg_2, m02);
+                MULADD_GFNI_256(work_reg_1, work_reg_3, m02);
+            }
+            work_reg_2 = _mm256_xor_si256(work_reg_0, work_reg_2);
+            work_reg_3 = _mm256_xor_si256(work_reg_1, work_reg_3);
+            if (log_m46 != kModulus)
+            {
+                MULADD_GFNI_256(work_reg_4, work_reg_6, m46);
+                MULADD_GFNI_256(work_reg_5, work_reg_7, m46);
+            }
+            work_reg_6 = _mm256_xor_si256(work_reg_4, work_reg_6);
+            work_reg_7 = _mm256_xor_si256(work_reg_5, work_reg_7);
+
+            // Third layer:
+            if (log_m01 != kModulus)
+                MULADD_GFNI_256(work_reg_0, work_reg_1, m01);
+            work_reg_1 = _mm256_xor_si256(work_reg_0, work_reg_1);
+            if (log_m23 != kModulus)
+                MULADD_GFNI_256(work_reg_2, work_reg_3, m23);
+            work_reg_3 = _mm256_xor_si256(work_reg_2, work_reg_3);
+            if (log_m45 != kModulus)
+                MULADD_GFNI_256(work_reg_4, work_reg_5, m45);
+            work_reg_5 = _mm256_xor_si256(work_reg_4, work_reg_5);
+            if (log_m67 != kModulus)
+                MULADD_GFNI_256(work_reg_6, work_reg_7, m67);
+            work_reg_7 = _mm256_xor_si256(work_reg_6, work_reg_7);
+
+            STORE_256(kStream, work0, work_reg_0);
+            STORE_256(kStream, work1, work_reg_1);
+            STORE_256(kStream, work2, work_reg_2);
+            STORE_256(kStream, work3, work_reg_3);
+            STORE_256(kStream, work4, work_reg_4);
+            STORE_256(kStream, work5, work_reg_5);
+            STORE_256(kStream, work6, work_reg_6);
+            STORE_256(kStream, work7, work_reg_7);
+
+            work0++, work1++, work2++, work3++, work4++, work5++, work6++, work7++;
+
+            piece_bytes -= 32;
+        } while (piece_bytes > 0);
     }
-#endif // TRY_AVX2
 
-    if (CpuHasSSSE3)
-    {
-        const M128 t01_lo = _mm_loadu_si128(&Multiply128LUT[log_m01].Value[0]);
-        const M128 t01_hi = _mm_loadu_si128(&Multiply128LUT[log_m01].Value[1]);
-        const M128 t23_lo = _mm_loadu_si128(&Multiply128LUT[log_m23].Value[0]);
-        const M128 t23_hi = _mm_loadu_si128(&Multiply128LUT[log_m23].Value[1]);
-        const M128 t02_lo = _mm_loadu_si128(&Multiply128LUT[log_m02].Value[0]);
-        const M128 t02_hi = _mm_loadu_si128(&Multiply128LUT[log_m02].Value[1]);
+    if (kStream)
+        _mm_sfence();
+}
+
+#endif // TRY_GFNI
 
-        const M128 clr_mask = _mm_set1_epi8(0x0f);
+#if defined(TRY_AVX2)
 
-        M128 * RESTRICT work0 = reinterpret_cast<M128 *>(work[0]);
-        M128 * RESTRICT work1 = reinterpret_cast<M128 *>(work[dist]);
-        M128 * RESTRICT work2 = reinterpret_cast<M128 *>(work[dist * 2]);
-        M128 * RESTRICT work3 = reinterpret_cast<M128 *>(work[dist * 3]);
+template<bool kStream = false>
+static TARGET_AVX2 void FFT_DIT8_avx2(
+    uint64_t bytes,
+    void** work,
+    unsigned dist,
+    unsigned count,
+    const ffe_t log_m01,
+    const ffe_t log_m23,
+    const ffe_t log_m45,
+    const ffe_t log_m67,
+    const ffe_t log_m02,
+    const ffe_t log_m46,
+    const ffe_t log_m04)
+{
+    // The fourteen table registers do not all fit alongside the data, so some are reloaded from L1
+    const M256 t01_lo = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[0]);
+    const M256 t01_hi = _mm256_loadu_si256(&Multiply256LUT[log_m01].Value[1]);
+    const M256 t23_lo = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[0]);
+    const M256 t23_hi = _mm256_loadu_si256(&Multiply256LUT[log_m23].Value[1]);
+    const M256 t45_lo = _mm256_loadu_si256(&Multiply256LUT[log_m45].Value[0]);
+    const M256 t45_hi = _mm256_loadu_si256(&Multiply256LUT[log_m45].Value[1]);
+    const M256 t67_lo = _mm256_loadu_si256(&Multiply256LUT[log_m67].Value[0]);
+    const M256 t67_hi = _mm256_loadu_si256(&Multiply256LUT[log_m67].Value[1]);
+    const M256 t02_lo = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[0]);
+    const M256 t02_hi = _mm256_loadu_si256(&Multiply256LUT[log_m02].Value[1]);
+    const M256 t46_lo = _mm256_loadu_si256(&Multiply256LUT[log_m46].Value[0]);
+    const M256 t46_hi = _mm256_loadu_si256(&Multiply256LUT[log_m46].Value[1]);
+    const M256 t04_lo = _mm256_loadu_si256(&Multiply256LUT[log_m04].Value[0]);
+    const M256 t04_hi = _mm256_loadu_si256(&Multiply256LUT[log_m04].Value[1]);
+
+    const M256 clr_mask = _mm256_set1_epi8(0x0f);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < count)
+            PrefetchButterfly(work + i + 1, dist, 8);
+#endif // PREFETCH_NEXT_OPT
+
+        M256 * RESTRICT work0 = reinterpret_cast<M256 *>(work[i]);
+        M256 * RESTRICT work1 = reinterpret_cast<M256 *>(work[i + dist]);
+        M256 * RESTRICT work2 = reinterpret_cast<M256 *>(work[i + dist * 2]);
+        M256 * RESTRICT work3 = reinterpret_cast<M256 *>(work[i + dist * 3]);
+        M256 * RESTRICT work4 = reinterpret_cast<M256 *>(work[i + dist * 4]);
+        M256 * RESTRICT work5 = reinterpret_cast<M256 *>(work[i + dist * 5]);
+        M256 * RESTRICT work6 = reinterpret_cast<M256 *>(work[i + dist * 6]);
+        M256 * RESTRICT work7 = reinterpret_cast<M256 *>(work[i + dist * 7]);
+
+        uint64_t piece_bytes = bytes;
 
         do
         {
-            M128 work0_reg = _mm_loadu_si128(work0);
-            M128 work2_reg = _mm_loadu_si128(work2);
-            M128 work1_reg = _mm_loadu_si128(work1);
-            M128 work3_reg = _mm_loadu_si128(work3);
+            M256 work_reg_0 = _mm256_loadu_si256(work0);
+            M256 work_reg_1 = _mm256_loadu_si256(work1);
+            M256 work_reg_2 = _mm256_loadu_si256(work2);
+            M256 work_reg_3 = _mm256_loadu_si256(work3);
+            M256 work_reg_4 = _mm256_loadu_si256(work4);
+            M256 work_reg_5 = _mm256_loadu_si256(work5);
+            M256 work_reg_6 = _mm256_loadu_si256(work6);
+            M256 work_reg_7 = _mm256_loadu_si256(work7);
 
             // First layer:
-            if (log_m02 != kModulus)
+            if (log_m04 != kModulus)
             {
-                MULADD_128(work0_reg, work2_reg, t02_lo, t02_hi);
-                MULADD_128(work1_reg, work3_reg, t02_lo, t02_hi);
+                MULADD_256(work_reg_0, work_reg_4, t04_lo, t04_hi);
+                MULADD_256(work_reg_1, work_reg_5, t04_lo, t04_hi);
+                MULADD_256(work_reg_2, work_reg_6, t04_lo, t04_hi);
+                MULADD_256(work_reg_3, work_reg_7, t04_lo, t04_hi);
             }
-            work2_reg = _mm_xor_si128(work0_reg, work2_reg);
-            work3_reg = _mm_xor_si128(work1_reg, work3_reg);
+            work_reg_4 = _mm256_xor_si256(work_reg_0, work_reg_4);
+            work_reg_5 = _mm256_xor_si256(work_reg_1, work_reg_5);
+            work_reg_6 = _mm256_xor_si256(work_reg_2, work_reg_6);
+            work_reg_7 = _mm256_xor_si256(work_reg_3, work_reg_7);
 
             // Second layer:
-            if (log_m01 != kModulus)
-                MULADD_128(work0_reg, work1_reg, t01_lo, t01_hi);
-            work1_reg = _mm_xor_si128(work0_reg, work1_reg);
-
-            _mm_storeu_si128(work0, work0_reg);
-            _mm_storeu_si128(work1, work1_reg);
-            work0++, work1++;
+            if (log_m02 != kModulus)
+            {
+                MULADD_256(work_reg_0, work_reg_2, t02_lo, t02_hi);
+                MULADD_256(work_reg_1, work_reg_3, t02_lo, t02_hi);
+            }
+            work_reg_2 = _mm256_xor_si256(work_reg_0, work_reg_2);
+            work_reg_3 = _mm256_xor_si256(work_reg_1, work_reg_3);
+            if (log_m46 != kModulus)
+            {
+                MULADD_256(work_reg_4, work_reg_6, t46_lo, t46_hi);
+                MULADD_256(work_reg_5, work_reg_7, t46_lo, t46_hi);
+            }
+            work_reg_6 = _mm256_xor_si256(work_reg_4, work_reg_6);
+            work_reg_7 = _mm256_xor_si256(work_reg_5, work_reg_7);
 
+            // Third layer:
+            if (log_m01 != kModulus)
+                MULADD_256(work_reg_0, work_reg_1, t01_lo, t01_hi);
+            work_reg_1 = _mm256_xor_si256(work_reg_0, work_reg_1);
             if (log_m23 != kModulus)
-                MULADD_128(work2_reg, work3_reg, t23_lo, t23_hi);
-            work3_reg = _mm_xor_si128(work2_reg, work3_reg);
-
-            _mm_storeu_si128(work2, work2_reg);
-            _mm_storeu_si128(work3, work3_reg);
-            work2++, work3++;
-
-            bytes -= 16;
-        } while (bytes > 0);
-
-        return;
+                MULADD_256(work_reg_2, work_reg_3, t23_lo, t23_hi);
+            work_reg_3 = _mm256_xor_si256(work_reg_2, work_reg_3);
+            if (log_m45 != kModulus)
+                MULADD_256(work_reg_4, work_reg_5, t45_lo, t45_hi);
+            work_reg_5 = _mm256_xor_si256(work_reg_4, work_reg_5);
+            if (log_m67 != kModulus)
+                MULADD_256(work_reg_6, work_reg_7, t67_lo, t67_hi);
+            work_reg_7 = _mm256_xor_si256(work_reg_6, work_reg_7);
+
+            STORE_256(kStream, work0, work_reg_0);
+            STORE_256(kStream, work1, work_reg_1);
+            STORE_256(kStream, work2, work_reg_2);
+            STORE_256(kStream, work3, work_reg_3);
+            STORE_256(kStream, work4, work_reg_4);
+            STORE_256(kStream, work5, work_reg_5);
+            STORE_256(kStream, work6, work_reg_6);
+            STORE_256(kStream, work7, work_reg_7);
+
+            work0++, work1++, work2++, work3++, work4++, work5++, work6++, work7++;
+
+            piece_bytes -= 32;
+        } while (piece_bytes > 0);
     }
 
-#endif // INTERLEAVE_BUTTERFLY4_OPT
-
-    // First layer:
-    if (log_m02 == kModulus)
-    {
-        xor_mem(work[dist * 2], work[0], bytes);
-        xor_mem(work[dist * 3], work[dist], bytes);
-    }
-    else
-    {
-        FFT_DIT2(work[0], work[dist * 2], log_m02, bytes);
-        FFT_DIT2(work[dist], work[dist * 3], log_m02, bytes);
-    }
+    if (kStream)
+        _mm_sfence();
+}
 
-    // Second layer:
-    if (log_m01 == kModulus)
-        xor_mem(work[dist], work[0], bytes);
-    else
-        FFT_DIT2(work[0], work[dist], log_m01, bytes);
+#endif // TRY_AVX2
 
-    if (log_m23 == kModulus)
-        xor_mem(work[dist * 3], work[dist * 2], bytes);
-    else
-        FFT_DIT2(work[dist * 2], work[dist * 3], log_m23, bytes);
-}
+#endif // INTERLEAVE_BUTTERFLY8_OPT
 
 
-// In-place FFT for encoder and decoder
+// In-place FFT for encoder and decoder.  stream_output writes the last layer
+// with streaming stores
 static void FFT_DIT(
     const uint64_t bytes,
     void** work,
     const unsigned m_truncated,
     const unsigned m,
-    const ffe_t* skewLUT)
+    const ffe_t* skewLUT,
+    bool stream_output)
 {
+    unsigned dist8 = m;
+
+#ifdef INTERLEAVE_BUTTERFLY8_OPT
+    // Decimation in time: Unroll 3 layers at a time while 8-way butterflies
+    // are available, leaving the remaining layers to the loop below
+    for (unsigned dist = dist8 >> 3; FFT_DIT8 && dist != 0; dist8 = dist, dist >>= 3)
+    {
+        // No layers are left after dist = 1
+        const auto fft_dit8 = (stream_output && dist == 1) ? FFT_DIT8_stream : FFT_DIT8;
+
+        // For each set of dist*8 elements:
+        for (unsigned r = 0; r < m_truncated; r += dist8)
+        {
+            const unsigned i_end = r + dist;
+            const ffe_t log_m01 = skewLUT[i_end - 1];
+            const ffe_t log_m02 = skewLUT[i_end + dist - 1];
+            const ffe_t log_m23 = skewLUT[i_end + dist * 2 - 1];
+            const ffe_t log_m04 = skewLUT[i_end + dist * 3 - 1];
+            const ffe_t log_m45 = skewLUT[i_end + dist * 4 - 1];
+            const ffe_t log_m46 = skewLUT[i_end + dist * 5 - 1];
+            const ffe_t log_m67 = skewLUT[i_end + dist * 6 - 1];
+
+            // For each set of dist elements:
+            fft_dit8(
+                bytes,
+                work + r,
+                dist,
+                dist,
+                log_m01,
+                log_m23,
+                log_m45,
+                log_m67,
+                log_m02,
+                log_m46,
+                log_m04);
+        }
+    }
+#endif // INTERLEAVE_BUTTERFLY8_OPT
+
     // Decimation in time: Unroll 2 layers at a time
-    unsigned dist4 = m, dist = m >> 2;
+    unsigned dist4 = dist8, dist = dist8 >> 2;
     for (; dist != 0; dist4 = dist, dist >>= 2)
     {
+        const auto fft_dit4 = (stream_output && dist == 1) ? FFT_DIT4_stream : FFT_DIT4;
+
         // For each set of dist*4 elements:
         for (unsigned r = 0; r < m_truncated; r += dist4)
         {
             const unsigned i_end = r + dist;
-            const ffe_t log_m01 = skewLUT[i_end];
-            const ffe_t log_m02 = skewLUT[i_end + dist];
-            const ffe_t log_m23 = skewLUT[i_end + dist * 2];
+            const ffe_t log_m01 = skewLUT[i_end - 1];
+            const ffe_t log_m02 = skewLUT[i_end + dist - 1];
+            const ffe_t log_m23 = skewLUT[i_end + dist * 2 - 1];
+            const unsigned trivial = TrivialSkews4(log_m01, log_m23, log_m02);
 
             // For each set of dist elements:
-            for (unsigned i = r; i < i_end; ++i)
-            {
-                FFT_DIT4(
-                    bytes,
-                    work + i,
-                    dist,
-                    log_m01,
-                    log_m23,
-                    log_m02);
-            }
+            fft_dit4[trivial](
+                bytes,
+                work + r,
+                dist,
+                dist,
+                log_m01,
+                log_m23,
+                log_m02);
         }
     }
 
     // If there is one layer left:
     if (dist4 == 2)
     {
+        const auto fft_dit2 = stream_output ? FFT_DIT2_stream : FFT_DIT2;
+
         for (unsigned r = 0; r < m_truncated; r += 2)
         {
-            const ffe_t log_m = skewLUT[r + 1];
+#ifdef PREFETCH_NEXT_OPT
+            if (r + 2 < m_truncated)
+                PrefetchButterfly(work + r + 2, 1, 2);
+#endif // PREFETCH_NEXT_OPT
+
+            const ffe_t log_m = skewLUT[r];
 
             if (log_m == kModulus)
                 xor_mem(work[r + 1], work[r], bytes);
             else
             {
-                FFT_DIT2(
+                fft_dit2(
                     work[r],
                     work[r + 1],
                     log_m,
@@ -1571,17 +2671,19 @@ static void FFT_DIT(
 //------------------------------------------------------------------------------
 // Reed-Solomon Encode
 
-void ReedSolomonEncode(
+// Runs the whole encoder on one byte range of every piece
+static void EncodeSlice(
     uint64_t buffer_bytes,
     unsigned original_count,
     unsigned recovery_count,
     unsigned m,
     const void* const* data,
-    void** work)
+    void** work,
+    bool stream_output)
 {
     // work <- IFFT(data, m, m)
 
-    const ffe_t* skewLUT = FFTSkew + m - 1;
+    const ffe_t* skewLUT = FFTSkew + m;
 
     IFFT_DIT_Encoder(
         buffer_bytes,
@@ -1640,7 +2742,78 @@ skip_body:
         work,
         recovery_count,
         m,
-        FFTSkew - 1);
+        FFTSkew,
+        stream_output);
+}
+
+// Runs the encoder on bytes [begin, end) of every piece, one slice at a time
+static void EncodeColumns(
+    uint64_t begin,
+    uint64_t end,
+    unsigned original_count,
+    unsigned recovery_count,
+    unsigned m,
+    const void* const* data,
+    void** work,
+    bool stream_output)
+{
+    // The work buffers are revisited by every group of m data pieces
+    const uint64_t slice_bytes = GetSliceBytes(end - begin, m * 2);
+
+    if (begin == 0 && slice_bytes >= end)
+    {
+        EncodeSlice(end, original_count, recovery_count, m, data, work, stream_output);
+        return;
+    }
+
+    SlicePointers data_slices(data, original_count);
+    SlicePointers work_slices(work, m * 2);
+
+    for (uint64_t offset = begin; offset < end; offset += slice_bytes)
+    {
+        const uint64_t remaining = end - offset;
+
+        EncodeSlice(
+            remaining < slice_bytes ? remaining : slice_bytes,
+            original_count,
+            recovery_count,
+            m,
+            data_slices.Offset(offset),
+            work_slices.Offset(offset),
+            stream_output);
+    }
+}
+
+void ReedSolomonEncode(
+    uint64_t buffer_bytes,
+    unsigned original_count,
+    unsigned recovery_count,
+    unsigned m,
+    const void* const* data,
+    void** work)
+{
+    // The recovery pieces are not read again after the last FFT layer, which
+    // also writes the padding up to m
+    const bool stream_output = UseStreamingStores(
+        buffer_bytes * (original_count + recovery_count),
+        work,
+        m);
+
+    const unsigned workers = GetColumnWorkers(buffer_bytes);
+
+    if (workers <= 1)
+    {
+        EncodeColumns(0, buffer_bytes, original_count, recovery_count, m, data, work, stream_output);
+        return;
+    }
+
+    // Each worker runs the whole transform on its own columns
+    ParallelFor(workers, [&](unsigned i) {
+        uint64_t begin, end;
+        GetColumnRange(buffer_bytes, workers, i, begin, end);
+
+        EncodeColumns(begin, end, original_count, recovery_count, m, data, work, stream_output);
+    });
 }
 
 
@@ -1653,9 +2826,15 @@ skip_body:
 class ErrorBitfield
 {
     static const unsigned kWords = kOrder / 64;
-    uint64_t Words[7][kWords] = {};
+    uint64_t Words[7][kWords];
 
 public:
+    // Prepare() fills in the other mip levels from the first one
+    FORCE_INLINE void Clear()
+    {
+        memset(Words[0], 0, sizeof(Words[0]));
+    }
+
     FORCE_INLINE void Set(unsigned i)
     {
         Words[0][i / 64] |= (uint64_t)1 << (i % 64);
@@ -1720,8 +2899,47 @@ static void FFT_DIT_ErrorBits(
 {
     unsigned mip_level = LastNonzeroBit32(n);
 
+    unsigned dist8 = n;
+
+#ifdef INTERLEAVE_BUTTERFLY8_OPT
+    // Decimation in time: Unroll 3 layers at a time while 8-way butterflies
+    // are available, leaving the remaining layers to the loop below
+    for (unsigned dist = dist8 >> 3; FFT_DIT8 && dist != 0; dist8 = dist, dist >>= 3, mip_level -= 3)
+    {
+        // For each set of dist*8 elements:
+        for (unsigned r = 0; r < n_truncated; r += dist8)
+        {
+            if (!error_bits.IsNeeded(mip_level, r))
+                continue;
+
+            const unsigned i_end = r + dist;
+            const ffe_t log_m01 = skewLUT[i_end - 1];
+            const ffe_t log_m02 = skewLUT[i_end + dist - 1];
+            const ffe_t log_m23 = skewLUT[i_end + dist * 2 - 1];
+            const ffe_t log_m04 = skewLUT[i_end + dist * 3 - 1];
+            const ffe_t log_m45 = skewLUT[i_end + dist * 4 - 1];
+            const ffe_t log_m46 = skewLUT[i_end + dist * 5 - 1];
+            const ffe_t log_m67 = skewLUT[i_end + dist * 6 - 1];
+
+            // For each set of dist elements:
+            FFT_DIT8(
+                bytes,
+                work + r,
+                dist,
+                dist,
+                log_m01,
+                log_m23,
+                log_m45,
+                log_m67,
+                log_m02,
+                log_m46,
+                log_m04);
+        }
+    }
+#endif // INTERLEAVE_BUTTERFLY8_OPT
+
     // Decimation in time: Unroll 2 layers at a time
-    unsigned dist4 = n, dist = n >> 2;
+    unsigned dist4 = dist8, dist = dist8 >> 2;
     for (; dist != 0; dist4 = dist, dist >>= 2, mip_level -=2)
     {
         // For each set of dist*4 elements:
@@ -1730,21 +2948,20 @@ static void FFT_DIT_ErrorBits(
             if (!error_bits.IsNeeded(mip_level, r))
                 continue;
 
-            const ffe_t log_m01 = skewLUT[r + dist];
-            const ffe_t log_m23 = skewLUT[r + dist * 3];
-            const ffe_t log_m02 = skewLUT[r + dist * 2];
+            const ffe_t log_m01 = skewLUT[r + dist - 1];
+            const ffe_t log_m23 = skewLUT[r + dist * 3 - 1];
+            const ffe_t log_m02 = skewLUT[r + dist * 2 - 1];
+            const unsigned trivial = TrivialSkews4(log_m01, log_m23, log_m02);
 
             // For each set of dist elements:
-            for (unsigned i = r; i < r + dist; ++i)
-            {
-                FFT_DIT4(
-                    bytes,
-                    work + i,
-                    dist,
-                    log_m01,
-                    log_m23,
-                    log_m02);
-            }
+            FFT_DIT4[trivial](
+                bytes,
+                work + r,
+                dist,
+                dist,
+                log_m01,
+                log_m23,
+                log_m02);
         }
     }
 
@@ -1756,7 +2973,12 @@ static void FFT_DIT_ErrorBits(
             if (!error_bits.IsNeeded(mip_level, r))
                 continue;
 
-            const ffe_t log_m = skewLUT[r + 1];
+#ifdef PREFETCH_NEXT_OPT
+            if (r + 2 < n_truncated)
+                PrefetchButterfly(work + r + 2, 1, 2);
+#endif // PREFETCH_NEXT_OPT
+
+            const ffe_t log_m = skewLUT[r];
 
             if (log_m == kModulus)
                 xor_mem(work[r + 1], work[r], bytes);
@@ -1778,41 +3000,65 @@ static void FFT_DIT_ErrorBits(
 //------------------------------------------------------------------------------
 // Reed-Solomon Decode
 
-void ReedSolomonDecode(
-    uint64_t buffer_bytes,
+// Error locator polynomial evaluated for one erasure pattern.
+// Every field is overwritten by EvaluateErrorLocator()
+struct ErrorLocator
+{
+    ffe_t Locations[kOrder];
+#ifdef ERROR_BITFIELD_OPT
+    ErrorBitfield Bits;
+#endif // ERROR_BITFIELD_OPT
+};
+
+ErrorLocator* CreateErrorLocator()
+{
+    return new ErrorLocator;
+}
+
+void FreeErrorLocator(ErrorLocator* locator)
+{
+    delete locator;
+}
+
+static void EvaluateErrorLocator(
     unsigned original_count,
     unsigned recovery_count,
-    unsigned m, // NextPow2(recovery_count)
-    unsigned n, // NextPow2(m + original_count) = work_count
-    const void* const * const original, // original_count entries
-    const void* const * const recovery, // recovery_count entries
-    void** work) // n entries
+    unsigned m,
+    const void* const * const original,
+    const void* const * const recovery,
+    ErrorLocator& locator)
 {
     // Fill in error locations
 
+    ffe_t* error_locations = locator.Locations;
+
 #ifdef ERROR_BITFIELD_OPT
-    ErrorBitfield error_bits;
+    locator.Bits.Clear();
 #endif // ERROR_BITFIELD_OPT
 
-    ffe_t error_locations[kOrder] = {};
     for (unsigned i = 0; i < recovery_count; ++i)
-        if (!recovery[i])
-            error_locations[i] = 1;
+        error_locations[i] = recovery[i] ? 0 : 1;
     for (unsigned i = recovery_count; i < m; ++i)
         error_locations[i] = 1;
     for (unsigned i = 0; i < original_count; ++i)
     {
-        if (!original[i])
+        if (original[i])
+            error_locations[i + m] = 0;
+        else
         {
             error_locations[i + m] = 1;
 #ifdef ERROR_BITFIELD_OPT
-            error_bits.Set(i + m);
+            locator.Bits.Set(i + m);
 #endif // ERROR_BITFIELD_OPT
         }
     }
+    memset(
+        error_locations + m + original_count,
+        0,
+        (kOrder - m - original_count) * sizeof(ffe_t));
 
 #ifdef ERROR_BITFIELD_OPT
-    error_bits.Prepare();
+    locator.Bits.Prepare();
 #endif // ERROR_BITFIELD_OPT
 
     // Evaluate error locator polynomial
@@ -1823,11 +3069,31 @@ void ReedSolomonDecode(
         error_locations[i] = ((unsigned)error_locations[i] * (unsigned)LogWalsh[i]) % kModulus;
 
     FWHT(error_locations, kOrder, kOrder);
+}
+
+// Runs the decoder on one byte range of every piece
+static void DecodeSlice(
+    uint64_t buffer_bytes,
+    unsigned original_count,
+    unsigned recovery_count,
+    unsigned m,
+    unsigned n,
+    const void* const * const original,
+    const void* const * const recovery,
+    void** work,
+    const ErrorLocator& locator,
+    bool stream_output)
+{
+    const ffe_t* error_locations = locator.Locations;
 
     // work <- recovery data
 
     for (unsigned i = 0; i < recovery_count; ++i)
     {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < recovery_count)
+            PrefetchPiece(recovery[i + 1]);
+#endif // PREFETCH_NEXT_OPT
         if (recovery[i])
             mul_mem(work[i], recovery[i], error_locations[i], buffer_bytes);
         else
@@ -1840,6 +3106,10 @@ void ReedSolomonDecode(
 
     for (unsigned i = 0; i < original_count; ++i)
     {
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < original_count)
+            PrefetchPiece(original[i + 1]);
+#endif // PREFETCH_NEXT_OPT
         if (original[i])
             mul_mem(work[m + i], original[i], error_locations[m + i], buffer_bytes);
         else
@@ -1855,7 +3125,7 @@ void ReedSolomonDecode(
         m + original_count,
         work,
         n,
-        FFTSkew - 1);
+        FFTSkew);
 
     // work <- FormalDerivative(work, n)
 
@@ -1875,22 +3145,276 @@ void ReedSolomonDecode(
     const unsigned output_count = m + original_count;
 
 #ifdef ERROR_BITFIELD_OPT
-    FFT_DIT_ErrorBits(buffer_bytes, work, output_count, n, FFTSkew - 1, error_bits);
+    FFT_DIT_ErrorBits(buffer_bytes, work, output_count, n, FFTSkew, locator.Bits);
 #else
-    FFT_DIT(buffer_bytes, work, output_count, n, FFTSkew - 1);
+    FFT_DIT(buffer_bytes, work, output_count, n, FFTSkew, false);
 #endif
 
     // Reveal erasures
 
+    const auto reveal_mul = stream_output ? mul_mem_stream : mul_mem;
+
     for (unsigned i = 0; i < original_count; ++i)
-        if (!original[i])
-            mul_mem(work[i], work[i + m], kModulus - error_locations[i + m], buffer_bytes);
+    {
+        if (original[i])
+            continue;
+
+#ifdef PREFETCH_NEXT_OPT
+        if (i + 1 < original_count && !original[i + 1])
+            PrefetchPiece(work[i + 1 + m]);
+#endif // PREFETCH_NEXT_OPT
+
+        reveal_mul(work[i], work[i + m], kModulus - error_locations[i + m], buffer_bytes);
+    }
+}
+
+// Runs the decoder on bytes [begin, end) of every piece, one slice at a time
+static void DecodeColumns(
+    uint64_t begin,
+    uint64_t end,
+    unsigned original_count,
+    unsigned recovery_count,
+    unsigned m,
+    unsigned n,
+    const void* const * const original,
+    const void* const * const recovery,
+    void** work,
+    const ErrorLocator& locator,
+    bool stream_output)
+{
+    const uint64_t slice_bytes = GetSliceBytes(end - begin, n);
+
+    if (begin == 0 && slice_bytes >= end)
+    {
+        DecodeSlice(end, original_count, recovery_count, m, n, original, recovery, work, locator, stream_output);
+        return;
+    }
+
+    SlicePointers original_slices(original, original_count);
+    SlicePointers recovery_slices(recovery, recovery_count);
+    SlicePointers work_slices(work, n);
+
+    for (uint64_t offset = begin; offset < end; offset += slice_bytes)
+    {
+        const uint64_t remaining = end - offset;
+
+        DecodeSlice(
+            remaining < slice_bytes ? remaining : slice_bytes,
+            original_count,
+            recovery_count,
+            m,
+            n,
+            original_slices.Offset(offset),
+            recovery_slices.Offset(offset),
+            work_slices.Offset(offset),
+            locator,
+            stream_output);
+    }
+}
+
+void ReedSolomonDecode(
+    uint64_t buffer_bytes,
+    unsigned original_count,
+    unsigned recovery_count,
+    unsigned m, // NextPow2(recovery_count)
+    unsigned n, // NextPow2(m + original_count) = work_count
+    const void* const * const original, // original_count entries
+    const void* const * const recovery, // recovery_count entries
+    void** work, // n entries
+    ErrorLocator* locator)
+{
+    // Without a decoder context, use a temporary on the heap rather than
+    // reserving a whole locator on the stack of every call
+    std::unique_ptr<ErrorLocator> temp_locator;
+    if (!locator)
+    {
+        temp_locator.reset(new ErrorLocator);
+        locator = temp_locator.get();
+    }
+
+    EvaluateErrorLocator(original_count, recovery_count, m, original, recovery, *locator);
+
+    // The revealed pieces are not read again by the decoder
+    const bool stream_output = UseStreamingStores(
+        buffer_bytes * (original_count + recovery_count),
+        work,
+        original_count);
+
+    const unsigned workers = GetColumnWorkers(buffer_bytes);
+
+    if (workers <= 1)
+    {
+        DecodeColumns(0, buffer_bytes, original_count, recovery_count, m, n, original, recovery, work, *locator, stream_output);
+        return;
+    }
+
+    // Each worker runs the whole transform on its own columns
+    ParallelFor(workers, [&](unsigned i) {
+        uint64_t begin, end;
+        GetColumnRange(buffer_bytes, workers, i, begin, end);
+
+        DecodeColumns(begin, end, original_count, recovery_count, m, n, original, recovery, work, *locator, stream_output);
+    });
+}
+
+void ReedSolomonDecodeBatch(
+    uint64_t buffer_bytes,
+    unsigned original_count,
+    unsigned recovery_count,
+    unsigned m, // NextPow2(recovery_count)
+    unsigned n, // NextPow2(m + original_count) = work_count
+    unsigned stripe_count,
+    const void* const * const * original, // stripe_count arrays
+    const void* const * const * recovery, // stripe_count arrays
+    void** const * work, // stripe_count arrays
+    ErrorLocator* locator)
+{
+    // All stripes share the erasure pattern of the first one
+    // Without a decoder context, use a temporary on the heap rather than
+    // reserving a whole locator on the stack of every call
+    std::unique_ptr<ErrorLocator> temp_locator;
+    if (!locator)
+    {
+        temp_locator.reset(new ErrorLocator);
+        locator = temp_locator.get();
+    }
+
+    EvaluateErrorLocator(original_count, recovery_count, m, original[0], recovery[0], *locator);
+
+    // Stream the revealed pieces only if every stripe allows it
+    bool stream_output = true;
+    for (unsigned stripe = 0; stream_output && stripe < stripe_count; ++stripe)
+    {
+        stream_output = UseStreamingStores(
+            buffer_bytes * (original_count + recovery_count) * stripe_count,
+            work[stripe],
+            original_count);
+    }
+
+    // Schedule threads over (stripe, slice) tiles
+    const uint64_t slice_bytes = GetBatchSliceBytes(buffer_bytes, n);
+    const unsigned slice_count = static_cast<unsigned>((buffer_bytes + slice_bytes - 1) / slice_bytes);
+
+    ParallelFor(stripe_count * slice_count, [&](unsigned tile) {
+        const unsigned stripe = tile / slice_count;
+        const uint64_t offset = (tile % slice_count) * slice_bytes;
+        const uint64_t remaining = buffer_bytes - offset;
+
+        SlicePointers original_slice(original[stripe], original_count);
+        SlicePointers recovery_slice(recovery[stripe], recovery_count);
+        SlicePointers work_slice(work[stripe], n);
+
+        DecodeSlice(
+            remaining < slice_bytes ? remaining : slice_bytes,
+            original_count,
+            recovery_count,
+            m,
+            n,
+            original_slice.Offset(offset),
+            recovery_slice.Offset(offset),
+            work_slice.Offset(offset),
+            *locator,
+            stream_output);
+    });
 }
 
 
 //------------------------------------------------------------------------------
 // API
 
+// Points the versions of a 4-way butterfly for every set of trivial skews at
+// the specializations of a kernel template, or all at one plain kernel
+#define SELECT_DIT4(name, kernel) \
+    name[0] = kernel<0>, name[1] = kernel<1>, name[2] = kernel<2>, name[3] = kernel<3>, \
+    name[4] = kernel<4>, name[5] = kernel<5>, name[6] = kernel<6>, name[7] = kernel<7>
+#define SELECT_DIT4_STREAM(name, kernel) \
+    name[0] = kernel<0, true>, name[1] = kernel<1, true>, name[2] = kernel<2, true>, name[3] = kernel<3, true>, \
+    name[4] = kernel<4, true>, name[5] = kernel<5, true>, name[6] = kernel<6, true>, name[7] = kernel<7, true>
+#define SELECT_DIT4_ALL(name, kernel) \
+    for (unsigned trivial = 0; trivial < 8; ++trivial) \
+        name[trivial] = kernel
+
+// Points the field kernels at the widest versions the CPU supports.
+// InitializeCPUArch() must have run first
+static void SelectKernels()
+{
+    mul_mem = mul_mem_ref;
+    mul_mem_stream = mul_mem_ref;
+    IFFT_DIT2 = IFFT_DIT2_ref;
+    SELECT_DIT4_ALL(IFFT_DIT4, IFFT_DIT4_ref);
+    IFFT_DIT2_xor = IFFT_DIT2_xor_ref;
+    SELECT_DIT4_ALL(IFFT_DIT4_xor, IFFT_DIT4_xor_ref);
+    FFT_DIT2 = FFT_DIT2_ref;
+    FFT_DIT2_stream = FFT_DIT2_ref;
+    SELECT_DIT4_ALL(FFT_DIT4, FFT_DIT4_ref);
+    SELECT_DIT4_ALL(FFT_DIT4_stream, FFT_DIT4_ref);
+    IFFT_DIT8 = nullptr;
+    FFT_DIT8 = nullptr;
+    FFT_DIT8_stream = nullptr;
+
+    if (CpuHasSSSE3)
+    {
+        mul_mem = mul_mem_ssse3;
+        mul_mem_stream = mul_mem_ssse3;
+        IFFT_DIT2 = IFFT_DIT2_ssse3;
+        IFFT_DIT2_xor = IFFT_DIT2_xor_ssse3;
+        FFT_DIT2 = FFT_DIT2_ssse3;
+        FFT_DIT2_stream = FFT_DIT2_ssse3;
+#ifdef INTERLEAVE_BUTTERFLY4_OPT
+        SELECT_DIT4(IFFT_DIT4, IFFT_DIT4_ssse3);
+        SELECT_DIT4(IFFT_DIT4_xor, IFFT_DIT4_xor_ssse3);
+        SELECT_DIT4(FFT_DIT4, FFT_DIT4_ssse3);
+        SELECT_DIT4(FFT_DIT4_stream, FFT_DIT4_ssse3);
+#endif // INTERLEAVE_BUTTERFLY4_OPT
+    }
+
+#if defined(TRY_AVX2)
+    if (CpuHasAVX2)
+    {
+        mul_mem = mul_mem_avx2;
+        mul_mem_stream = mul_mem_avx2<true>;
+        IFFT_DIT2 = IFFT_DIT2_avx2;
+        IFFT_DIT2_xor = IFFT_DIT2_xor_avx2;
+        FFT_DIT2 = FFT_DIT2_avx2;
+        FFT_DIT2_stream = FFT_DIT2_avx2<true>;
+#ifdef INTERLEAVE_BUTTERFLY4_OPT
+        SELECT_DIT4(IFFT_DIT4, IFFT_DIT4_avx2);
+        SELECT_DIT4(IFFT_DIT4_xor, IFFT_DIT4_xor_avx2);
+        SELECT_DIT4(FFT_DIT4, FFT_DIT4_avx2);
+        SELECT_DIT4_STREAM(FFT_DIT4_stream, FFT_DIT4_avx2);
+#endif // INTERLEAVE_BUTTERFLY4_OPT
+#ifdef INTERLEAVE_BUTTERFLY8_OPT
+        IFFT_DIT8 = IFFT_DIT8_avx2;
+        FFT_DIT8 = FFT_DIT8_avx2;
+        FFT_DIT8_stream = FFT_DIT8_avx2<true>;
+#endif // INTERLEAVE_BUTTERFLY8_OPT
+    }
+#endif // TRY_AVX2
+
+#if defined(TRY_GFNI)
+    if (CpuHasGFNI)
+    {
+        mul_mem = mul_mem_gfni;
+        mul_mem_stream = mul_mem_gfni<true>;
+        IFFT_DIT2 = IFFT_DIT2_gfni;
+        IFFT_DIT2_xor = IFFT_DIT2_xor_gfni;
+        FFT_DIT2 = FFT_DIT2_gfni;
+        FFT_DIT2_stream = FFT_DIT2_gfni<true>;
+#ifdef INTERLEAVE_BUTTERFLY4_OPT
+        SELECT_DIT4(IFFT_DIT4, IFFT_DIT4_gfni);
+        SELECT_DIT4(IFFT_DIT4_xor, IFFT_DIT4_xor_gfni);
+        SELECT_DIT4(FFT_DIT4, FFT_DIT4_gfni);
+        SELECT_DIT4_STREAM(FFT_DIT4_stream, FFT_DIT4_gfni);
+#endif // INTERLEAVE_BUTTERFLY4_OPT
+#ifdef INTERLEAVE_BUTTERFLY8_OPT
+        IFFT_DIT8 = IFFT_DIT8_gfni;
+        FFT_DIT8 = FFT_DIT8_gfni;
+        FFT_DIT8_stream = FFT_DIT8_gfni<true>;
+#endif // INTERLEAVE_BUTTERFLY8_OPT
+    }
+#endif // TRY_GFNI
+}
+
 static bool IsInitialized = false;
 
 bool Initialize()
@@ -1898,9 +3422,7 @@ bool Initialize()
     if (IsInitialized)
         return true;
 
-    InitializeLogarithmTables();
-    InitializeMultiplyTables();
-    FFTInitialize();
+    SelectKernels();
 
     IsInitialized = true;
     return true;
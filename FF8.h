@@ -34,6 +34,14 @@ static const ffe_t kModulus = 255;
 // LFSR Polynomial that generates the field elements
 static const unsigned kPolynomial = 0x11D;
 
+// Basis used for generating logarithm tables
+static const ffe_t kCantorBasis[kBits] = {
+    1, 214, 152, 146, 86, 200, 88, 230
+};
+
+// Using the Cantor basis {2} here enables us to avoid a lot of extra calculations
+// when applying the formal derivative in decoding.
+
 
 //------------------------------------------------------------------------------
 // API
@@ -49,6 +57,13 @@ void ReedSolomonEncode(
     const void* const * const data,
     void** work); // m * 2 elements
 
+// Error locator state for one erasure pattern.
+// Decoders can keep one around to avoid allocating one on each call
+struct ErrorLocator;
+
+ErrorLocator* CreateErrorLocator();
+void FreeErrorLocator(ErrorLocator* locator);
+
 void ReedSolomonDecode(
     uint64_t buffer_bytes,
     unsigned original_count,
@@ -57,7 +72,22 @@ void ReedSolomonDecode(
     unsigned n, // = NextPow2(m + original_count)
     const void* const * const original, // original_count elements
     const void* const * const recovery, // recovery_count elements
-    void** work); // n elements
+    void** work, // n elements
+    ErrorLocator* locator = nullptr); // Optional scratch space
+
+// Decodes stripe_count stripes that are missing the same pieces.
+// The error locator is evaluated once for all of them
+void ReedSolomonDecodeBatch(
+    uint64_t buffer_bytes,
+    unsigned original_count,
+    unsigned recovery_count,
+    unsigned m, // = NextPow2(recovery_count)
+    unsigned n, // = NextPow2(m + original_count)
+    unsigned stripe_count,
+    const void* const * const * original, // stripe_count arrays of original_count elements
+    const void* const * const * recovery, // stripe_count arrays of recovery_count elements
+    void** const * work, // stripe_count arrays of n elements
+    ErrorLocator* locator = nullptr); // Optional scratch space
 
 
 }} // namespace codec::ff8
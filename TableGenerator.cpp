@@ -0,0 +1,346 @@
+/*
+    Build-time generator for the finite field tables
+
+    The logarithm, FFT skew and LogWalsh tables of both fields and the GF(2^8)
+    multiply tables only depend on the constants in FF8.h and FF16.h, so they
+    are computed here once per build and compiled into the library as const
+    data.  The GF(2^16) multiply tables depend on the instruction set and are
+    built at runtime by FF16.cpp.
+
+    Usage: table_generator <FF8Tables.h> <FF16Tables.h>
+*/
+
+#include "FF8.h"
+#include "FF16.h"
+
+#include <stdio.h>
+#include <vector>
+
+
+//------------------------------------------------------------------------------
+// Field Tables
+
+// LogLUT[], ExpLUT[], FFTSkew[] and LogWalsh[] for one field, computed the
+// same way as the library did at runtime
+template<typename ffe_t, unsigned kBits, unsigned kPolynomial>
+class FieldTables
+{
+public:
+    static const unsigned kOrder = 1u << kBits;
+    static const unsigned kModulus = kOrder - 1;
+
+    std::vector<ffe_t> LogLUT, ExpLUT, FFTSkew, LogWalsh;
+
+    explicit FieldTables(const ffe_t* cantor_basis)
+        : LogLUT(kOrder)
+        , ExpLUT(kOrder)
+        , FFTSkew(kModulus)
+        , LogWalsh(kOrder)
+    {
+        InitializeLogarithmTables(cantor_basis);
+        FFTInitialize();
+    }
+
+    // z = x + y (mod kModulus)
+    static ffe_t AddMod(const ffe_t a, const ffe_t b)
+    {
+        const unsigned sum = static_cast<unsigned>(a) + b;
+
+        // Partial reduction step, allowing for kModulus to be returned
+        return static_cast<ffe_t>(sum + (sum >> kBits));
+    }
+
+    // z = x - y (mod kModulus)
+    static ffe_t SubMod(const ffe_t a, const ffe_t b)
+    {
+        const unsigned dif = static_cast<unsigned>(a) - b;
+
+        // Partial reduction step, allowing for kModulus to be returned
+        return static_cast<ffe_t>(dif + (dif >> kBits));
+    }
+
+    // Returns a * Log(b)
+    ffe_t MultiplyLog(ffe_t a, ffe_t log_b) const
+    {
+        if (a == 0)
+            return 0;
+        return ExpLUT[AddMod(LogLUT[a], log_b)];
+    }
+
+protected:
+    void InitializeLogarithmTables(const ffe_t* cantor_basis)
+    {
+        // LFSR table generation:
+
+        unsigned state = 1;
+        for (unsigned i = 0; i < kModulus; ++i)
+        {
+            ExpLUT[state] = static_cast<ffe_t>(i);
+            state <<= 1;
+            if (state >= kOrder)
+                state ^= kPolynomial;
+        }
+        ExpLUT[0] = kModulus;
+
+        // Conversion to Cantor basis:
+
+        LogLUT[0] = 0;
+        for (unsigned i = 0; i < kBits; ++i)
+        {
+            const ffe_t basis = cantor_basis[i];
+            const unsigned width = static_cast<unsigned>(1UL << i);
+
+            for (unsigned j = 0; j < width; ++j)
+                LogLUT[j + width] = LogLUT[j] ^ basis;
+        }
+
+        for (unsigned i = 0; i < kOrder; ++i)
+            LogLUT[i] = ExpLUT[LogLUT[i]];
+
+        // Generate Exp table from Log table:
+
+        for (unsigned i = 0; i < kOrder; ++i)
+            ExpLUT[LogLUT[i]] = static_cast<ffe_t>(i);
+
+        // Note: Handles modulus wrap around with LUT
+        ExpLUT[kModulus] = ExpLUT[0];
+    }
+
+    void FFTInitialize()
+    {
+        ffe_t temp[kBits - 1];
+
+        // Generate FFT skew vector {1}:
+
+        for (unsigned i = 1; i < kBits; ++i)
+            temp[i - 1] = static_cast<ffe_t>(1UL << i);
+
+        for (unsigned m = 0; m < (kBits - 1); ++m)
+        {
+            const unsigned step = 1UL << (m + 1);
+
+            FFTSkew[(1UL << m) - 1] = 0;
+
+            for (unsigned i = m; i < (kBits - 1); ++i)
+            {
+                const unsigned s = (1UL << (i + 1));
+
+                for (unsigned j = (1UL << m) - 1; j < s; j += step)
+                    FFTSkew[j + s] = FFTSkew[j] ^ temp[i];
+            }
+
+            temp[m] = static_cast<ffe_t>(kModulus - LogLUT[MultiplyLog(temp[m], LogLUT[temp[m] ^ 1])]);
+
+            for (unsigned i = m + 1; i < (kBits - 1); ++i)
+            {
+                const ffe_t sum = AddMod(LogLUT[temp[i] ^ 1], temp[m]);
+                temp[i] = MultiplyLog(temp[i], sum);
+            }
+        }
+
+        for (unsigned i = 0; i < kModulus; ++i)
+            FFTSkew[i] = LogLUT[FFTSkew[i]];
+
+        // Precalculate FWHT(Log[i]):
+
+        for (unsigned i = 0; i < kOrder; ++i)
+            LogWalsh[i] = LogLUT[i];
+        LogWalsh[0] = 0;
+
+        FWHT(LogWalsh.data());
+    }
+
+    // Decimation in time FWHT (mod kModulus) over all kOrder elements
+    static void FWHT(ffe_t* data)
+    {
+        unsigned dist = 1, dist4 = 4;
+        for (; dist4 <= kOrder; dist = dist4, dist4 <<= 2)
+        {
+            for (unsigned r = 0; r < kOrder; r += dist4)
+            {
+                for (unsigned i = r; i < r + dist; ++i)
+                {
+                    ffe_t* t = data + i;
+                    ffe_t t0 = t[0], t1 = t[dist], t2 = t[dist * 2], t3 = t[dist * 3];
+                    FWHT_2(t0, t1);
+                    FWHT_2(t2, t3);
+                    FWHT_2(t0, t2);
+                    FWHT_2(t1, t3);
+                    t[0] = t0, t[dist] = t1, t[dist * 2] = t2, t[dist * 3] = t3;
+                }
+            }
+        }
+
+        if (dist < kOrder)
+            for (unsigned i = 0; i < dist; ++i)
+                FWHT_2(data[i], data[i + dist]);
+    }
+
+    // {a, b} = {a + b, a - b} (Mod Q)
+    static void FWHT_2(ffe_t& a, ffe_t& b)
+    {
+        const ffe_t sum = AddMod(a, b);
+        const ffe_t dif = SubMod(a, b);
+        a = sum;
+        b = dif;
+    }
+};
+
+
+//------------------------------------------------------------------------------
+// Output
+
+static void WriteHeader(FILE* file, const char* field)
+{
+    fprintf(file,
+        "// Generated by table_generator from the constants in %s.h: Do not edit.\n"
+        "// Included by %s.cpp inside its namespace\n\n", field, field);
+}
+
+template<typename T>
+static void WriteArray(FILE* file, const char* declaration, const T* data, size_t count)
+{
+    static const unsigned kPerLine = 16;
+
+    // 64-bit values need a suffix to stay unsigned
+    const char* suffix = sizeof(T) > 4 ? "ull" : "";
+
+    fprintf(file, "%s = {\n", declaration);
+    for (size_t i = 0; i < count; ++i)
+    {
+        fprintf(file, "%s%llu%s,", i % kPerLine == 0 ? "    " : " ", (unsigned long long)data[i], suffix);
+        if (i % kPerLine == kPerLine - 1 || i == count - 1)
+            fputc('\n', file);
+    }
+    fprintf(file, "};\n\n");
+}
+
+template<class Tables>
+static void WriteFieldTables(FILE* file, const Tables& tables)
+{
+    WriteArray(file, "static const ffe_t LogLUT[kOrder]", tables.LogLUT.data(), tables.LogLUT.size());
+    WriteArray(file, "static const ffe_t ExpLUT[kOrder]", tables.ExpLUT.data(), tables.ExpLUT.size());
+    WriteArray(file, "static const ffe_t FFTSkew[kModulus]", tables.FFTSkew.data(), tables.FFTSkew.size());
+    WriteArray(file, "static const ffe_t LogWalsh[kOrder]", tables.LogWalsh.data(), tables.LogWalsh.size());
+}
+
+
+//------------------------------------------------------------------------------
+// GF(2^8)
+
+typedef FieldTables<codec::ff8::ffe_t, codec::ff8::kBits, codec::ff8::kPolynomial> FF8Tables;
+
+static bool WriteFF8(const char* path)
+{
+    using namespace codec::ff8;
+
+    FILE* file = fopen(path, "w");
+    if (!file)
+        return false;
+
+    const FF8Tables tables(kCantorBasis);
+
+    WriteHeader(file, "FF8");
+    WriteFieldTables(file, tables);
+
+    // Multiply8LUT[x + log_y * 256] = x * y, used without PSHUFB
+    std::vector<ffe_t> products(kOrder * kOrder);
+    for (unsigned x = 1; x < kOrder; ++x)
+    {
+        const ffe_t log_x = tables.LogLUT[x];
+        for (unsigned log_y = 0; log_y < kOrder; ++log_y)
+            products[x + log_y * kOrder] = tables.ExpLUT[FF8Tables::AddMod(log_x, static_cast<ffe_t>(log_y))];
+    }
+    WriteArray(file, "static const ffe_t Multiply8LUT[kOrder * kOrder]", products.data(), products.size());
+
+    // PSHUFB tables for the low and high nibble of each log_m, once for 128-bit
+    // kernels and repeated in each lane for 256-bit kernels
+    std::vector<uint8_t> lut128(kOrder * 32), lut256(kOrder * 64);
+    for (unsigned log_m = 0; log_m < kOrder; ++log_m)
+    {
+        for (unsigned i = 0, shift = 0; i < 2; ++i, shift += 4)
+        {
+            for (unsigned x = 0; x < 16; ++x)
+            {
+                const uint8_t prod = tables.MultiplyLog(static_cast<ffe_t>(x << shift), static_cast<ffe_t>(log_m));
+                lut128[log_m * 32 + i * 16 + x] = prod;
+                lut256[log_m * 64 + i * 32 + x] = prod;
+                lut256[log_m * 64 + i * 32 + 16 + x] = prod;
+            }
+        }
+    }
+    WriteArray(file, "ALIGNED static const uint8_t Multiply128Bytes[kOrder * 32]", lut128.data(), lut128.size());
+    fprintf(file, "#if defined(TRY_AVX2)\n\n");
+    WriteArray(file, "ALIGNED static const uint8_t Multiply256Bytes[kOrder * 64]", lut256.data(), lut256.size());
+    fprintf(file, "#endif // TRY_AVX2\n\n");
+
+    // GFNI matrices: Byte 7 - i holds row i, the bits j for which bit i of the
+    // product (1 << j) * m is set
+    std::vector<uint64_t> affine(kOrder);
+    for (unsigned log_m = 0; log_m < kOrder; ++log_m)
+    {
+        uint64_t matrix = 0;
+        for (unsigned j = 0; j < 8; ++j)
+        {
+            const ffe_t prod = tables.MultiplyLog(static_cast<ffe_t>(1 << j), static_cast<ffe_t>(log_m));
+            for (unsigned i = 0; i < 8; ++i)
+                if (prod & (1 << i))
+                    matrix |= (uint64_t)1 << ((7 - i) * 8 + j);
+        }
+        affine[log_m] = matrix;
+    }
+    fprintf(file, "#if defined(TRY_GFNI)\n\n");
+    WriteArray(file, "static const uint64_t Multiply8Affine[kOrder]", affine.data(), affine.size());
+    fprintf(file, "#endif // TRY_GFNI\n");
+
+    return fclose(file) == 0;
+}
+
+
+//------------------------------------------------------------------------------
+// GF(2^16)
+
+typedef FieldTables<codec::ff16::ffe_t, codec::ff16::kBits, codec::ff16::kPolynomial> FF16Tables;
+
+static bool WriteFF16(const char* path)
+{
+    using namespace codec::ff16;
+
+    FILE* file = fopen(path, "w");
+    if (!file)
+        return false;
+
+    const FF16Tables tables(kCantorBasis);
+
+    WriteHeader(file, "FF16");
+    WriteFieldTables(file, tables);
+
+    return fclose(file) == 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Entrypoint
+
+int main(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: %s <FF8Tables.h> <FF16Tables.h>\n", argv[0]);
+        return 1;
+    }
+
+    if (!WriteFF8(argv[1]))
+    {
+        fprintf(stderr, "Failed to write %s\n", argv[1]);
+        return 1;
+    }
+
+    if (!WriteFF16(argv[2]))
+    {
+        fprintf(stderr, "Failed to write %s\n", argv[2]);
+        return 1;
+    }
+
+    return 0;
+}
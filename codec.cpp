@@ -8,7 +8,10 @@
     #include "FF16.h"
 #endif // HAS_FF16
 
+#include <stdlib.h>
 #include <string.h>
+#include <thread>
+#include <vector>
 
 extern "C" {
 
@@ -18,23 +21,53 @@ extern "C" {
 
 static bool m_Initialized = false;
 
-EXPORT int init_(int version)
-{
-    if (version != VERSION)
-        return InvalidInput;
-
-    codec::InitializeCPUArch();
+/*
+    Each field builds its tables the first time a call needs it, so processes
+    that only use one field never pay for the other.  The flag is checked
+    without the lock once the field is ready.
+*/
 
 #ifdef HAS_FF8
-    if (!codec::ff8::Initialize())
-        return Platform;
+static std::atomic<bool> m_FF8Ready(false);
+static std::mutex m_FF8Lock;
+
+static bool EnsureFF8()
+{
+    if (m_FF8Ready.load(std::memory_order_acquire))
+        return true;
+
+    std::lock_guard<std::mutex> locker(m_FF8Lock);
+    if (!m_FF8Ready.load(std::memory_order_relaxed) && codec::ff8::Initialize())
+        m_FF8Ready.store(true, std::memory_order_release);
+    return m_FF8Ready.load(std::memory_order_relaxed);
+}
 #endif // HAS_FF8
 
 #ifdef HAS_FF16
-    if (!codec::ff16::Initialize())
-        return Platform;
+static std::atomic<bool> m_FF16Ready(false);
+static std::mutex m_FF16Lock;
+
+static bool EnsureFF16()
+{
+    if (m_FF16Ready.load(std::memory_order_acquire))
+        return true;
+
+    std::lock_guard<std::mutex> locker(m_FF16Lock);
+    if (!m_FF16Ready.load(std::memory_order_relaxed) && codec::ff16::Initialize())
+        m_FF16Ready.store(true, std::memory_order_release);
+    return m_FF16Ready.load(std::memory_order_relaxed);
+}
 #endif // HAS_FF16
 
+EXPORT int init_(int version)
+{
+    if (version != VERSION)
+        return InvalidInput;
+
+    codec::InitializeCPUArch();
+
+    if (!codec::IsWorkerPoolStarted())
+        codec::StartWorkerPool(0, nullptr);
 
     m_Initialized = true;
     return Success;
@@ -60,6 +93,218 @@ EXPORT const char* result_string(Result result)
 }
 
 
+//------------------------------------------------------------------------------
+// Warm-up API
+
+static bool WarmupNow(unsigned fields)
+{
+#ifdef HAS_FF8
+    if ((fields & WarmupFF8) && !EnsureFF8())
+        return false;
+#else
+    if (fields & WarmupFF8)
+        return false;
+#endif // HAS_FF8
+
+#ifdef HAS_FF16
+    if ((fields & WarmupFF16) && !EnsureFF16())
+        return false;
+#else
+    if (fields & WarmupFF16)
+        return false;
+#endif // HAS_FF16
+
+    return true;
+}
+
+/*
+    Background warm-up threads stay joinable and are joined at exit.  They
+    build the tables on the static worker pool, so they must finish before it
+    is destroyed: Handlers registered with atexit() run before the destructors
+    of static objects that were constructed before the registration.
+*/
+static std::mutex m_WarmupLock;
+static std::vector<std::thread> m_WarmupThreads;
+static bool m_WarmupJoinRegistered = false;
+
+static void JoinWarmupThreads()
+{
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> locker(m_WarmupLock);
+        threads.swap(m_WarmupThreads);
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+EXPORT Result codec_warmup(
+    unsigned fields,                          // WarmupFields flags
+    int background)                           // Nonzero to return before the tables are built
+{
+    if (fields == 0 || (fields & ~static_cast<unsigned>(WarmupAll)) != 0)
+        return InvalidInput;
+
+    if (!m_Initialized)
+        return CallInitialize;
+
+    if (background)
+    {
+        std::lock_guard<std::mutex> locker(m_WarmupLock);
+        if (!m_WarmupJoinRegistered)
+        {
+            if (atexit(JoinWarmupThreads) != 0)
+                return Platform;
+            m_WarmupJoinRegistered = true;
+        }
+
+        m_WarmupThreads.emplace_back(WarmupNow, fields);
+        return Success;
+    }
+
+    return WarmupNow(fields) ? Success : Platform;
+}
+
+
+EXPORT Result codec_save_tables(
+    const char* path)                         // Image file to write
+{
+    if (!path)
+        return InvalidInput;
+
+    if (!m_Initialized)
+        return CallInitialize;
+
+#ifdef HAS_FF16
+    if (!EnsureFF16())
+        return Platform;
+
+    std::lock_guard<std::mutex> locker(m_FF16Lock);
+    if (!codec::ff16::SaveTableImage(path))
+        return InvalidInput;
+
+    return Success;
+#else
+    return Platform;
+#endif // HAS_FF16
+}
+
+EXPORT Result codec_load_tables(
+    const char* path)                         // Image file to map
+{
+    if (!path)
+        return InvalidInput;
+
+    if (!m_Initialized)
+        return CallInitialize;
+
+#ifdef HAS_FF16
+    std::lock_guard<std::mutex> locker(m_FF16Lock);
+    if (m_FF16Ready.load(std::memory_order_relaxed) || !codec::ff16::LoadTableImage(path))
+        return InvalidInput;
+
+    m_FF16Ready.store(true, std::memory_order_release);
+    return Success;
+#else
+    return Platform;
+#endif // HAS_FF16
+}
+
+
+//------------------------------------------------------------------------------
+// Threading API
+
+EXPORT Result codec_init_threads(
+    unsigned thread_count,                    // Threads including the caller, or 0 for all
+    const unsigned* cpu_affinity)             // Optional CPU index per worker
+{
+    if (thread_count == 0 && cpu_affinity)
+        return InvalidInput;
+
+    if (!codec::StartWorkerPool(thread_count, cpu_affinity))
+        return Platform;
+
+    return Success;
+}
+
+
+//------------------------------------------------------------------------------
+// Execution API
+
+EXPORT Result codec_set_execution_mode(
+    ExecutionMode mode,                       // Execution mode
+    uint64_t slice_bytes)                     // Bytes per slice, or 0 to choose automatically
+{
+    if (slice_bytes % 64 != 0)
+        return InvalidSize;
+
+    switch (mode)
+    {
+    case ExecuteLayers:
+    case ExecuteSlices:
+    case ExecuteColumns:
+        break;
+    default:
+        return InvalidInput;
+    }
+
+    codec::SetExecutionMode(mode, slice_bytes);
+    return Success;
+}
+
+EXPORT Result codec_set_ff16_multiply(
+    FF16Multiply multiply)                    // Multiply backend
+{
+    if (multiply != FF16MultiplyTables && multiply != FF16MultiplyCarryless)
+        return InvalidInput;
+
+#ifdef HAS_FF16
+    // CPU flags are needed to check support before codec_init()
+    if (!m_Initialized)
+        codec::InitializeCPUArch();
+
+    // Wait for a warm-up in progress, which reads the selected backend
+    std::lock_guard<std::mutex> locker(m_FF16Lock);
+    if (!codec::ff16::SetCarrylessMultiply(multiply == FF16MultiplyCarryless))
+        return Platform;
+#else
+    if (multiply != FF16MultiplyTables)
+        return Platform;
+#endif // HAS_FF16
+
+    return Success;
+}
+
+EXPORT Result codec_set_streaming_stores(
+    StreamingStores mode)                     // Streaming store mode
+{
+    switch (mode)
+    {
+    case StreamAuto:
+    case StreamNever:
+    case StreamAlways:
+        break;
+    default:
+        return InvalidInput;
+    }
+
+    codec::SetStreamingStores(mode);
+    return Success;
+}
+
+EXPORT Result codec_set_prefetch(
+    int enabled)                              // Non-zero to prefetch
+{
+#ifdef PREFETCH_NEXT_OPT
+    codec::PrefetchNextEnabled = (enabled != 0);
+    return Success;
+#else
+    return enabled ? Platform : Success;
+#endif // PREFETCH_NEXT_OPT
+}
+
+
 //------------------------------------------------------------------------------
 // Encoder API
 
@@ -92,13 +337,15 @@ static void EncodeM1(
     summer.Finalize(buffer_bytes);
 }
 
-EXPORT Result encode(
-    uint64_t buffer_bytes,                    // Number of bytes in each data buffer
-    unsigned original_count,                  // Number of original_data[] buffer pointers
-    unsigned recovery_count,                  // Number of recovery_data[] buffer pointers
-    unsigned work_count,                      // Number of work_data[] buffer pointers, from codec_encode_work_count()
-    const void* const * const original_data,  // Array of pointers to original data buffers
-    void** work_data)                         // Array of work buffers
+// Returns the error encode() would report for these parameters before doing
+// any work, or Success
+static Result ValidateEncode(
+    uint64_t buffer_bytes,
+    unsigned original_count,
+    unsigned recovery_count,
+    unsigned work_count,
+    const void* const * const original_data,
+    void** work_data)
 {
     if (buffer_bytes <= 0 || buffer_bytes % 64 != 0)
         return InvalidSize;
@@ -112,6 +359,44 @@ EXPORT Result encode(
     if (!m_Initialized)
         return CallInitialize;
 
+    if (original_count == 1 || recovery_count == 1)
+        return Success;
+
+    const unsigned m = codec::NextPow2(recovery_count);
+    const unsigned n = codec::NextPow2(m + original_count);
+
+    if (work_count != m * 2)
+        return InvalidCounts;
+
+#if defined(HAS_FF16)
+    if (n > codec::ff16::kOrder)
+        return TooMuchData;
+#elif defined(HAS_FF8)
+    if (n > codec::ff8::kOrder)
+        return TooMuchData;
+#endif
+
+    return Success;
+}
+
+EXPORT Result encode(
+    uint64_t buffer_bytes,                    // Number of bytes in each data buffer
+    unsigned original_count,                  // Number of original_data[] buffer pointers
+    unsigned recovery_count,                  // Number of recovery_data[] buffer pointers
+    unsigned work_count,                      // Number of work_data[] buffer pointers, from codec_encode_work_count()
+    const void* const * const original_data,  // Array of pointers to original data buffers
+    void** work_data)                         // Array of work buffers
+{
+    const Result valid = ValidateEncode(
+        buffer_bytes,
+        original_count,
+        recovery_count,
+        work_count,
+        original_data,
+        work_data);
+    if (valid != Success)
+        return valid;
+
     // Handle k = 1 case
     if (original_count == 1)
     {
@@ -134,12 +419,12 @@ EXPORT Result encode(
     const unsigned m = codec::NextPow2(recovery_count);
     const unsigned n = codec::NextPow2(m + original_count);
 
-    if (work_count != m * 2)
-        return InvalidCounts;
-
 #ifdef HAS_FF8
     if (n <= codec::ff8::kOrder)
     {
+        if (!EnsureFF8())
+            return Platform;
+
         codec::ff8::ReedSolomonEncode(
             buffer_bytes,
             original_count,
@@ -153,6 +438,9 @@ EXPORT Result encode(
 #ifdef HAS_FF16
     if (n <= codec::ff16::kOrder)
     {
+        if (!EnsureFF16())
+            return Platform;
+
         codec::ff16::ReedSolomonEncode(
             buffer_bytes,
             original_count,
@@ -169,6 +457,62 @@ EXPORT Result encode(
 }
 
 
+EXPORT Result encode_batch(
+    unsigned stripe_count,                    // Number of stripes
+    const EncodeStripe* stripes)              // Array of stripe_count stripes
+{
+    if (stripe_count <= 0 || !stripes)
+        return InvalidInput;
+
+    // Reject the whole batch before any stripe is encoded
+    for (unsigned i = 0; i < stripe_count; ++i)
+    {
+        const EncodeStripe& stripe = stripes[i];
+
+        const Result result = ValidateEncode(
+            stripe.BufferBytes,
+            stripe.OriginalCount,
+            stripe.RecoveryCount,
+            stripe.WorkCount,
+            stripe.OriginalData,
+            stripe.WorkData);
+        if (result != Success)
+            return result;
+    }
+
+    // Each thread encodes whole stripes, so the parallel loops inside the
+    // encoder run inline on that thread.  Failures are packed as
+    // (stripe index << 32 | result) so the smallest value is the error from
+    // the lowest stripe index, whichever thread finishes first
+    std::atomic<uint64_t> first_error(UINT64_MAX);
+
+    codec::ParallelFor(stripe_count, [&](unsigned i) {
+        const EncodeStripe& stripe = stripes[i];
+
+        const Result result = encode(
+            stripe.BufferBytes,
+            stripe.OriginalCount,
+            stripe.RecoveryCount,
+            stripe.WorkCount,
+            stripe.OriginalData,
+            stripe.WorkData);
+
+        if (result != Success)
+        {
+            const uint64_t error = ((uint64_t)i << 32) | (uint32_t)result;
+            uint64_t expected = first_error.load();
+            while (error < expected && !first_error.compare_exchange_weak(expected, error))
+                ;
+        }
+    });
+
+    const uint64_t error = first_error.load();
+    if (error == UINT64_MAX)
+        return Success;
+    return static_cast<Result>((int32_t)(uint32_t)error);
+}
+
+
 //------------------------------------------------------------------------------
 // Decoder API
 
@@ -202,14 +546,26 @@ static void DecodeM1(
     summer.Finalize(buffer_bytes);
 }
 
-EXPORT Result decode(
-    uint64_t buffer_bytes,                    // Number of bytes in each data buffer
-    unsigned original_count,                  // Number of original_data[] buffer pointers
-    unsigned recovery_count,                  // Number of recovery_data[] buffer pointers
-    unsigned work_count,                      // Number of buffer pointers in work_data[]
-    const void* const * const original_data,  // Array of original data buffers
-    const void* const * const recovery_data,  // Array of recovery data buffers
-    void** work_data)                         // Array of work data buffers
+// Reusable error locator scratch space for each field
+struct DecoderScratch
+{
+#ifdef HAS_FF8
+    codec::ff8::ErrorLocator* Locator8 = nullptr;
+#endif // HAS_FF8
+#ifdef HAS_FF16
+    codec::ff16::ErrorLocator* Locator16 = nullptr;
+#endif // HAS_FF16
+};
+
+static Result Decode(
+    uint64_t buffer_bytes,
+    unsigned original_count,
+    unsigned recovery_count,
+    unsigned work_count,
+    const void* const * const original_data,
+    const void* const * const recovery_data,
+    void** work_data,
+    const DecoderScratch* scratch)
 {
     if (buffer_bytes <= 0 || buffer_bytes % 64 != 0)
         return InvalidSize;
@@ -283,6 +639,9 @@ EXPORT Result decode(
 #ifdef HAS_FF8
     if (n <= codec::ff8::kOrder)
     {
+        if (!EnsureFF8())
+            return Platform;
+
         codec::ff8::ReedSolomonDecode(
             buffer_bytes,
             original_count,
@@ -291,13 +650,17 @@ EXPORT Result decode(
             n,
             original_data,
             recovery_data,
-            work_data);
+            work_data,
+            scratch ? scratch->Locator8 : nullptr);
     }
     else
 #endif // HAS_FF8
 #ifdef HAS_FF16
     if (n <= codec::ff16::kOrder)
     {
+        if (!EnsureFF16())
+            return Platform;
+
         codec::ff16::ReedSolomonDecode(
             buffer_bytes,
             original_count,
@@ -306,6 +669,145 @@ EXPORT Result decode(
             n,
             original_data,
             recovery_data,
+            work_data,
+            scratch ? scratch->Locator16 : nullptr);
+    }
+    else
+#endif // HAS_FF16
+        return TooMuchData;
+
+    return Success;
+}
+
+EXPORT Result decode(
+    uint64_t buffer_bytes,                    // Number of bytes in each data buffer
+    unsigned original_count,                  // Number of original_data[] buffer pointers
+    unsigned recovery_count,                  // Number of recovery_data[] buffer pointers
+    unsigned work_count,                      // Number of buffer pointers in work_data[]
+    const void* const * const original_data,  // Array of original data buffers
+    const void* const * const recovery_data,  // Array of recovery data buffers
+    void** work_data)                         // Array of work data buffers
+{
+    return Decode(
+        buffer_bytes,
+        original_count,
+        recovery_count,
+        work_count,
+        original_data,
+        recovery_data,
+        work_data,
+        nullptr);
+}
+
+
+EXPORT Result decode_batch(
+    uint64_t buffer_bytes,                    // Number of bytes in each data buffer
+    unsigned original_count,                  // Number of original_data[] buffer pointers per stripe
+    unsigned recovery_count,                  // Number of recovery_data[] buffer pointers per stripe
+    unsigned work_count,                      // Number of buffer pointers in work_data[] per stripe
+    unsigned stripe_count,                    // Number of stripes
+    const void* const * const * original_data,// Array of original data buffer arrays
+    const void* const * const * recovery_data,// Array of recovery data buffer arrays
+    void** const * work_data)                 // Array of work data buffer arrays
+{
+    if (stripe_count <= 0 || !original_data || !recovery_data || !work_data)
+        return InvalidInput;
+
+    for (unsigned stripe = 0; stripe < stripe_count; ++stripe)
+        if (!original_data[stripe] || !recovery_data[stripe] || !work_data[stripe])
+            return InvalidInput;
+
+    // Every stripe must be missing the same pieces as the first one
+    for (unsigned stripe = 1; stripe < stripe_count; ++stripe)
+    {
+        for (unsigned i = 0; i < original_count; ++i)
+            if (!original_data[stripe][i] != !original_data[0][i])
+                return InvalidInput;
+        for (unsigned i = 0; i < recovery_count; ++i)
+            if (!recovery_data[stripe][i] != !recovery_data[0][i])
+                return InvalidInput;
+    }
+
+    // Validate using the first stripe, and handle the special cases
+    unsigned original_loss_count = 0;
+    for (unsigned i = 0; i < original_count; ++i)
+        if (!original_data[0][i])
+            ++original_loss_count;
+
+    if (original_count <= 1 || recovery_count <= 1 || original_loss_count == 0)
+    {
+        for (unsigned stripe = 0; stripe < stripe_count; ++stripe)
+        {
+            const Result result = decode(
+                buffer_bytes,
+                original_count,
+                recovery_count,
+                work_count,
+                original_data[stripe],
+                recovery_data[stripe],
+                work_data[stripe]);
+            if (result != Success)
+                return result;
+        }
+        return Success;
+    }
+
+    if (buffer_bytes <= 0 || buffer_bytes % 64 != 0)
+        return InvalidSize;
+
+    if (recovery_count > original_count)
+        return InvalidCounts;
+
+    if (!m_Initialized)
+        return CallInitialize;
+
+    unsigned recovery_got_count = 0;
+    for (unsigned i = 0; i < recovery_count; ++i)
+        if (recovery_data[0][i])
+            ++recovery_got_count;
+    if (recovery_got_count < original_loss_count)
+        return NeedMoreData;
+
+    const unsigned m = codec::NextPow2(recovery_count);
+    const unsigned n = codec::NextPow2(m + original_count);
+
+    if (work_count != n)
+        return InvalidCounts;
+
+#ifdef HAS_FF8
+    if (n <= codec::ff8::kOrder)
+    {
+        if (!EnsureFF8())
+            return Platform;
+
+        codec::ff8::ReedSolomonDecodeBatch(
+            buffer_bytes,
+            original_count,
+            recovery_count,
+            m,
+            n,
+            stripe_count,
+            original_data,
+            recovery_data,
+            work_data);
+    }
+    else
+#endif // HAS_FF8
+#ifdef HAS_FF16
+    if (n <= codec::ff16::kOrder)
+    {
+        if (!EnsureFF16())
+            return Platform;
+
+        codec::ff16::ReedSolomonDecodeBatch(
+            buffer_bytes,
+            original_count,
+            recovery_count,
+            m,
+            n,
+            stripe_count,
+            original_data,
+            recovery_data,
             work_data);
     }
     else
@@ -315,5 +817,257 @@ EXPORT Result decode(
     return Success;
 }
 
+EXPORT Result codec_set_locator_cache(
+    unsigned entries)                         // Maximum cached loss patterns
+{
+#ifdef HAS_FF16
+    codec::ff16::SetErrorLocatorCacheSize(entries);
+#else
+    (void)entries;
+#endif // HAS_FF16
+    return Success;
+}
+
+
+//------------------------------------------------------------------------------
+// Context API
+
+// Returns the distance between buffers carved out of one allocation.  When
+// buffer_bytes is a multiple of the page size, the same offset in every buffer
+// maps to the same cache sets, and huge pages make the physical addresses
+// line up as well.  A cache line of padding spreads them out
+static uint64_t WorkBufferStride(uint64_t buffer_bytes)
+{
+    return (buffer_bytes % 4096 == 0) ? buffer_bytes + 64 : buffer_bytes;
+}
+
+// Work buffers for one stripe shape, carved out of a single allocation that
+// is backed by huge pages where available
+struct WorkArena
+{
+    codec::LargeAllocation Memory;
+    std::vector<void*> Buffers;
+
+    bool Initialize(uint64_t buffer_bytes, unsigned work_count)
+    {
+        const uint64_t stride = WorkBufferStride(buffer_bytes);
+        if (!Memory.Allocate(stride * work_count))
+            return false;
+
+        Buffers.resize(work_count);
+        for (unsigned i = 0; i < work_count; ++i)
+            Buffers[i] = Memory.Data + stride * i;
+        return true;
+    }
+};
+
+// Returns true if encode() and decode() accept this stripe shape
+static bool IsValidShape(
+    uint64_t buffer_bytes,
+    unsigned original_count,
+    unsigned recovery_count)
+{
+    if (buffer_bytes <= 0 || buffer_bytes % 64 != 0)
+        return false;
+    if (recovery_count <= 0 || recovery_count > original_count)
+        return false;
+    return codec_decode_work_count(original_count, recovery_count) <= 65536;
+}
+
+struct CodecEncoderT
+{
+    uint64_t BufferBytes = 0;
+    unsigned OriginalCount = 0;
+    unsigned RecoveryCount = 0;
+    WorkArena Work;
+};
+
+struct CodecDecoderT
+{
+    uint64_t BufferBytes = 0;
+    unsigned OriginalCount = 0;
+    unsigned RecoveryCount = 0;
+    WorkArena Work;
+    DecoderScratch Scratch;
+
+    ~CodecDecoderT()
+    {
+#ifdef HAS_FF8
+        codec::ff8::FreeErrorLocator(Scratch.Locator8);
+#endif // HAS_FF8
+#ifdef HAS_FF16
+        codec::ff16::FreeErrorLocator(Scratch.Locator16);
+#endif // HAS_FF16
+    }
+};
+
+EXPORT CodecEncoder* codec_encoder_create(
+    uint64_t buffer_bytes,                    // Number of bytes in each data buffer
+    unsigned original_count,                  // Number of original data buffers
+    unsigned recovery_count)                  // Number of recovery data buffers
+{
+    if (!m_Initialized || !IsValidShape(buffer_bytes, original_count, recovery_count))
+        return nullptr;
+
+    const unsigned work_count = codec_encode_work_count(original_count, recovery_count);
+    if (work_count == 0)
+        return nullptr;
+
+    CodecEncoder* encoder = new CodecEncoder;
+    encoder->BufferBytes = buffer_bytes;
+    encoder->OriginalCount = original_count;
+    encoder->RecoveryCount = recovery_count;
+
+    if (!encoder->Work.Initialize(buffer_bytes, work_count))
+    {
+        delete encoder;
+        return nullptr;
+    }
+
+    return encoder;
+}
+
+EXPORT void codec_encoder_free(CodecEncoder* encoder)
+{
+    delete encoder;
+}
+
+EXPORT Result codec_encoder_encode(
+    CodecEncoder* encoder,                    // Encoder from codec_encoder_create()
+    const void* const * const original_data)  // Array of pointers to original data buffers
+{
+    if (!encoder)
+        return InvalidInput;
+
+    return encode(
+        encoder->BufferBytes,
+        encoder->OriginalCount,
+        encoder->RecoveryCount,
+        static_cast<unsigned>(encoder->Work.Buffers.size()),
+        original_data,
+        encoder->Work.Buffers.data());
+}
+
+EXPORT void** codec_encoder_recovery_data(CodecEncoder* encoder)
+{
+    if (!encoder)
+        return nullptr;
+    return encoder->Work.Buffers.data();
+}
+
+EXPORT CodecDecoder* codec_decoder_create(
+    uint64_t buffer_bytes,                    // Number of bytes in each data buffer
+    unsigned original_count,                  // Number of original data buffers
+    unsigned recovery_count)                  // Number of recovery data buffers
+{
+    if (!m_Initialized || !IsValidShape(buffer_bytes, original_count, recovery_count))
+        return nullptr;
+
+    const unsigned work_count = codec_decode_work_count(original_count, recovery_count);
+    if (work_count == 0)
+        return nullptr;
+
+    CodecDecoder* decoder = new CodecDecoder;
+    decoder->BufferBytes = buffer_bytes;
+    decoder->OriginalCount = original_count;
+    decoder->RecoveryCount = recovery_count;
+
+    if (!decoder->Work.Initialize(buffer_bytes, work_count))
+    {
+        delete decoder;
+        return nullptr;
+    }
+
+    // Allocate error locator scratch for the field that will be used
+    if (original_count > 1 && recovery_count > 1)
+    {
+#ifdef HAS_FF8
+        if (work_count <= codec::ff8::kOrder)
+            decoder->Scratch.Locator8 = codec::ff8::CreateErrorLocator();
+        else
+#endif // HAS_FF8
+#ifdef HAS_FF16
+        if (work_count <= codec::ff16::kOrder)
+            decoder->Scratch.Locator16 = codec::ff16::CreateErrorLocator();
+#endif // HAS_FF16
+    }
+
+    return decoder;
+}
+
+EXPORT void codec_decoder_free(CodecDecoder* decoder)
+{
+    delete decoder;
+}
+
+EXPORT Result codec_decoder_decode(
+    CodecDecoder* decoder,                    // Decoder from codec_decoder_create()
+    const void* const * const original_data,  // Array of original data buffers
+    const void* const * const recovery_data)  // Array of recovery data buffers
+{
+    if (!decoder)
+        return InvalidInput;
+
+    return Decode(
+        decoder->BufferBytes,
+        decoder->OriginalCount,
+        decoder->RecoveryCount,
+        static_cast<unsigned>(decoder->Work.Buffers.size()),
+        original_data,
+        recovery_data,
+        decoder->Work.Buffers.data(),
+        &decoder->Scratch);
+}
+
+EXPORT void** codec_decoder_recovered_data(CodecDecoder* decoder)
+{
+    if (!decoder)
+        return nullptr;
+    return decoder->Work.Buffers.data();
+}
+
+
+//------------------------------------------------------------------------------
+// Slab API
+
+struct CodecSlabT
+{
+    WorkArena Work;
+};
+
+EXPORT CodecSlab* codec_slab_create(
+    uint64_t buffer_bytes,                    // Number of bytes in each buffer
+    unsigned buffer_count)                    // Number of buffers
+{
+    if (buffer_bytes <= 0 || buffer_bytes % 64 != 0 || buffer_count <= 0)
+        return nullptr;
+
+    CodecSlab* slab = new CodecSlab;
+    if (!slab->Work.Initialize(buffer_bytes, buffer_count))
+    {
+        delete slab;
+        return nullptr;
+    }
+
+    return slab;
+}
+
+EXPORT void codec_slab_free(CodecSlab* slab)
+{
+    delete slab;
+}
+
+EXPORT void** codec_slab_buffers(CodecSlab* slab)
+{
+    if (!slab)
+        return nullptr;
+    return slab->Work.Buffers.data();
+}
+
+EXPORT int codec_slab_huge_pages(CodecSlab* slab)
+{
+    return (slab && slab->Work.Memory.HugePages) ? 1 : 0;
+}
+
 
 } // extern "C"
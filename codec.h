@@ -38,6 +38,10 @@ extern "C" {
     Perform static initialization for the library, verifying that the platform
     is supported.
 
+    The tables for each finite field are not built here: The first call that
+    needs a field builds them, which is thread-safe.  Call codec_warmup() to
+    build them ahead of time instead.
+
     Returns 0 on success and other values on failure.
 */
 
@@ -66,6 +70,248 @@ typedef enum ResultT
 EXPORT const char* result_string(Result result);
 
 
+//------------------------------------------------------------------------------
+// Warm-up API
+
+// Finite fields to warm up, as flags
+typedef enum WarmupFieldsT
+{
+    WarmupFF8         =  1, // GF(2^8), used for up to 256 pieces in total
+    WarmupFF16        =  2, // GF(2^16), used for more than 256 pieces in total
+    WarmupAll         =  3, // Both fields
+} WarmupFields;
+
+/*
+    codec_warmup()
+
+    Build the tables for the given fields now, so that the first encode() or
+    decode() that needs them does not pay for it.  The GF(2^16) tables take
+    the most time.
+
+    If background is nonzero, the tables are built on a new thread and this
+    returns right away.  Calls that need a field while it is being built wait
+    for it to finish.  If the process exits first, exit() waits for the
+    thread before the library is torn down.
+
+    Call it after codec_init().  It is thread-safe.
+
+    Returns Success on success, or once the background thread is started.
+    Returns Platform if a field is not built into the library, or if its
+    tables cannot be allocated.
+    Returns InvalidInput if fields is 0 or has unknown flags.
+*/
+EXPORT Result codec_warmup(
+    unsigned fields,                          // WarmupFields flags
+    int background);                          // Nonzero to return before the tables are built
+
+
+/*
+    codec_save_tables()
+
+    Write the GF(2^16) multiply tables for this CPU to a table image file at
+    path, building them first if needed.  The image holds the tables of the
+    selected backend and instruction set, with a format version and a
+    checksum.  The other field tables are compiled into the library.
+
+    The file is written next to path and then renamed over it, so processes
+    that map an older image are not disturbed.
+
+    Call it after codec_init().  It is thread-safe.
+
+    Returns Success on success.
+    Returns InvalidInput if path is null or the file cannot be written.
+    Returns Platform if GF(2^16) is not built into the library.
+*/
+EXPORT Result codec_save_tables(
+    const char* path);                        // Image file to write
+
+/*
+    codec_load_tables()
+
+    Map a table image written by codec_save_tables() read-only, in place of
+    building the GF(2^16) tables.  Startup then pages the image in instead of
+    computing it, and all processes that map the same file share its pages.
+
+    The image is rejected if its checksum or version does not match, or if
+    its multiply tables are for another instruction set than this CPU
+    selects.  Images without multiply tables (saved with the carry-less
+    backend) are only accepted when the carry-less backend is selected.
+
+    Call it after codec_init() and before any call that uses GF(2^16), as
+    codec_warmup() would.  It is thread-safe.
+
+    Returns Success on success.
+    Returns InvalidInput if path is null, the image cannot be used, or the
+    tables were already built.  Later calls build the tables as usual.
+    Returns Platform if GF(2^16) is not built into the library.
+*/
+EXPORT Result codec_load_tables(
+    const char* path);                        // Image file to map
+
+
+//------------------------------------------------------------------------------
+// Threading API
+
+/*
+    codec_init_threads()
+
+    Start the worker pool that runs the parallel loops in encode() and decode().
+    Call it after codec_init(), or before to avoid starting the default pool.
+
+    If this is not called, codec_init() starts one thread per hardware thread.
+
+    The thread calling encode() or decode() also runs tasks, so thread_count
+    includes the caller and thread_count - 1 workers are started.  Pass
+    thread_count = 0 for one thread per hardware thread, or 1 to run on the
+    calling thread only.
+
+    If cpu_affinity is not null, it must hold thread_count - 1 CPU indices,
+    and worker i is pinned to CPU cpu_affinity[i] where the platform allows it.
+
+    This is not thread-safe: Call it before any encode() or decode() calls are
+    in flight.
+
+    Returns Success on success.
+    Returns InvalidInput if cpu_affinity is provided with thread_count = 0.
+*/
+EXPORT Result codec_init_threads(
+    unsigned thread_count,                    // Threads including the caller, or 0 for all
+    const unsigned* cpu_affinity);            // Optional CPU index per worker
+
+
+//------------------------------------------------------------------------------
+// Execution API
+
+// Execution modes
+typedef enum ExecutionModeT
+{
+    ExecuteLayers     =  0, // Each transform layer sweeps all bytes of every piece
+    ExecuteSlices     =  1, // Whole transform runs on one cache-sized byte slice at a time
+    ExecuteColumns    =  2, // Each thread runs ExecuteSlices on its own byte range
+} ExecutionMode;
+
+/*
+    codec_set_execution_mode()
+
+    Select how encode() and decode() walk through the data buffers.
+
+    In ExecuteLayers mode (the default), each layer of the transforms reads and
+    writes every byte of every piece before the next layer starts.
+
+    In ExecuteSlices mode, the multiply-in, IFFT, formal derivative, FFT and
+    reveal steps all run on one slice of slice_bytes of every piece before
+    moving on to the next slice.  This keeps the working set in L2 cache for
+    stripes with many large pieces.  Pass slice_bytes = 0 to pick the slice
+    size from the L2 cache size and the number of pieces.
+
+    In ExecuteColumns mode, the bytes of every piece are split into one
+    64-byte aligned range per thread, and each thread runs the whole transform
+    on its range as in ExecuteSlices mode.  There are no barriers between the
+    threads until the call completes.
+
+    This is not thread-safe: Call it before any encode() or decode() calls are
+    in flight.
+
+    Returns Success on success.
+    Returns InvalidSize if slice_bytes is not a multiple of 64.
+    Returns InvalidInput if the mode is unknown.
+*/
+EXPORT Result codec_set_execution_mode(
+    ExecutionMode mode,                       // Execution mode
+    uint64_t slice_bytes);                    // Bytes per slice, or 0 to choose automatically
+
+// GF(2^16) multiply backends
+typedef enum FF16MultiplyT
+{
+    FF16MultiplyTables    =  0, // Per-element PSHUFB tables (8 MB)
+    FF16MultiplyCarryless =  1, // PCLMULQDQ with Barrett reduction, no tables
+} FF16Multiply;
+
+/*
+    codec_set_ff16_multiply()
+
+    Select how the GF(2^16) field multiplies data, which is used when there
+    are more than 256 pieces in total.
+
+    FF16MultiplyTables (the default) precomputes a PSHUFB table for every
+    field element.  This is the fastest option but takes 8 MB of memory (2 MB
+    of bit matrices on CPUs with GFNI) and most of the time to set up the
+    field.
+
+    FF16MultiplyCarryless converts each symbol to the polynomial basis and
+    multiplies it with PCLMULQDQ, reducing modulo the field polynomial with
+    Barrett reduction.  It needs no tables, so it suits short-lived or
+    memory-limited processes, but encodes and decodes more slowly.  Call it
+    before the first call that uses the field so that the tables are never
+    built.
+
+    This is not thread-safe: Call it before any encode() or decode() calls are
+    in flight.
+
+    Returns Success on success.
+    Returns Platform if the CPU does not support the backend, or if the
+    tables cannot be allocated.
+    Returns InvalidInput if the backend is unknown.
+*/
+EXPORT Result codec_set_ff16_multiply(
+    FF16Multiply multiply);                   // Multiply backend
+
+// Streaming store modes
+typedef enum StreamingStoresT
+{
+    StreamAuto        =  0, // Stream outputs of stripes larger than the last-level cache
+    StreamNever       =  1, // Always write outputs through the cache
+    StreamAlways      =  2, // Always stream outputs
+} StreamingStores;
+
+/*
+    codec_set_streaming_stores()
+
+    Select whether the last step of encode() and decode() writes its outputs
+    with non-temporal stores that bypass the cache.  Those outputs are never
+    read again by the codec, so for stripes much larger than the last-level
+    cache this saves memory bandwidth for the inputs that are still needed.
+    It is slower when the caller reads the outputs right after the call.
+
+    In StreamAuto mode (the default), outputs are streamed when the stripe
+    is larger than the last-level cache.
+
+    Streaming stores are only used with AVX2 or wider kernels, and only when
+    every output buffer is aligned to 64 bytes.  Other calls fall back to
+    regular stores.
+
+    This is not thread-safe: Call it before any encode() or decode() calls are
+    in flight.
+
+    Returns Success on success.
+    Returns InvalidInput if the mode is unknown.
+*/
+EXPORT Result codec_set_streaming_stores(
+    StreamingStores mode);                    // Streaming store mode
+
+/*
+    codec_set_prefetch()
+
+    Select whether the FFT and decoder loops prefetch the leading bytes of
+    each piece of the next butterfly while the current one runs.  Each piece
+    is a separate buffer, so this starts a memory stream before the hardware
+    prefetchers would pick it up.
+
+    Off by default: Where it has been measured, the gain was within
+    run-to-run noise.  Pass "prefetch" to the benchmark to compare on the
+    target machine.
+
+    This is not thread-safe: Call it before any encode() or decode() calls are
+    in flight.
+
+    Returns Success on success.
+    Returns Platform if enabled and the library was built without
+    PREFETCH_NEXT_OPT.
+*/
+EXPORT Result codec_set_prefetch(
+    int enabled);                             // Non-zero to prefetch
+
+
 //------------------------------------------------------------------------------
 // Encoder API
 
@@ -125,6 +371,39 @@ EXPORT Result encode(
     void** work_data);                        // Array of work buffers
 
 
+// One stripe for encode_batch().  Fields match the encode() parameters
+typedef struct EncodeStripeT
+{
+    uint64_t BufferBytes;                     // Number of bytes in each data buffer
+    unsigned OriginalCount;                   // Number of OriginalData[] buffer pointers
+    unsigned RecoveryCount;                   // Number of recovery data buffers to produce
+    unsigned WorkCount;                       // Number of WorkData[] buffer pointers, from codec_encode_work_count()
+    const void* const * OriginalData;         // Array of pointers to original data buffers
+    void** WorkData;                          // Array of work buffers
+} EncodeStripe;
+
+/*
+    encode_batch()
+
+    Generate recovery data for many independent stripes.
+
+    Each stripe is encoded as by encode(), and the stripes may have different
+    shapes.  Whole stripes are spread across the worker threads instead of
+    splitting each stripe across threads, which suits large numbers of small
+    stripes where per-call threading overhead would dominate.
+
+    Every stripe is checked before any is encoded, so a batch with an invalid
+    stripe leaves all of the work buffers untouched.
+
+    Returns Success if every stripe was encoded.
+    * The first set of RecoveryCount buffers in each WorkData will be the result.
+    Returns the error for the lowest-index failed stripe otherwise.
+*/
+EXPORT Result encode_batch(
+    unsigned stripe_count,                    // Number of stripes
+    const EncodeStripe* stripes);             // Array of stripe_count stripes
+
+
 //------------------------------------------------------------------------------
 // Decoder API
 
@@ -173,6 +452,187 @@ EXPORT Result decode(
     void** work_data);                        // Array of work data buffers
 
 
+/*
+    decode_batch()
+
+    Decode many stripes that are missing the same pieces, as when rebuilding
+    a failed device.
+
+    stripe_count:   Number of stripes.
+    original_data:  Array of stripe_count original_data[] arrays.
+    recovery_data:  Array of stripe_count recovery_data[] arrays.
+    work_data:      Array of stripe_count work_data[] arrays.
+
+    The other parameters are the same as for decode(), and each stripe's
+    arrays are laid out as for decode().
+
+    Every stripe must have NULL original/recovery data at the same indices.
+    The error locator is evaluated once and shared by all stripes, and the
+    threads are scheduled over (stripe, byte slice) tiles.
+
+    Returns Success on success.
+    Returns InvalidInput if the stripes are missing different pieces.
+    Returns other values on errors.
+*/
+EXPORT Result decode_batch(
+    uint64_t buffer_bytes,                    // Number of bytes in each data buffer
+    unsigned original_count,                  // Number of original_data[] buffer pointers per stripe
+    unsigned recovery_count,                  // Number of recovery_data[] buffer pointers per stripe
+    unsigned work_count,                      // Number of buffer pointers in work_data[] per stripe
+    unsigned stripe_count,                    // Number of stripes
+    const void* const * const * original_data,// Array of original data buffer arrays
+    const void* const * const * recovery_data,// Array of recovery data buffer arrays
+    void** const * work_data);                // Array of work data buffer arrays
+
+/*
+    codec_set_locator_cache()
+
+    Set how many error locators decode() keeps for repeated loss patterns.
+
+    Decoding with more than 256 pieces evaluates an error locator polynomial
+    for the set of lost pieces, which has a fixed cost whatever the buffer
+    size.  When many stripes in a row are missing the same pieces, as when a
+    device fails, the cache lets them share one evaluation.  Each entry takes
+    about 170 KB, and the least recently used entry is dropped when full.
+
+    Pass entries = 0 to disable the cache, which is the default.
+
+    Returns Success on success.
+*/
+EXPORT Result codec_set_locator_cache(
+    unsigned entries);                        // Maximum cached loss patterns
+
+
+//------------------------------------------------------------------------------
+// Context API
+//
+// Encoder and decoder contexts are bound to one stripe shape.  Each one owns
+// its work buffers in a single aligned allocation, and decoders also keep the
+// error locator scratch space, so repeated calls do not allocate memory or
+// use large stack buffers.
+//
+// A context can be used by one thread at a time.
+
+typedef struct CodecEncoderT CodecEncoder;
+typedef struct CodecDecoderT CodecDecoder;
+
+/*
+    codec_encoder_create()
+
+    Create an encoder for stripes of original_count buffers of buffer_bytes
+    each, producing recovery_count recovery buffers.
+
+    The parameters have the same limits as for encode().
+
+    Returns an encoder to pass to codec_encoder_encode().
+    Returns NULL if the input is invalid, codec_init() was not called, or out
+    of memory.
+*/
+EXPORT CodecEncoder* codec_encoder_create(
+    uint64_t buffer_bytes,                    // Number of bytes in each data buffer
+    unsigned original_count,                  // Number of original data buffers
+    unsigned recovery_count);                 // Number of recovery data buffers
+
+// Free an encoder from codec_encoder_create().  NULL is ignored
+EXPORT void codec_encoder_free(CodecEncoder* encoder);
+
+/*
+    codec_encoder_encode()
+
+    Generate recovery data into the encoder's work buffers.
+
+    Returns Success on success.
+    * The first recovery_count buffers of codec_encoder_recovery_data() will
+      be the result, until the next call.
+    Returns other values on errors.
+*/
+EXPORT Result codec_encoder_encode(
+    CodecEncoder* encoder,                    // Encoder from codec_encoder_create()
+    const void* const * const original_data); // Array of pointers to original data buffers
+
+// Returns the encoder's work buffers, holding the recovery data
+EXPORT void** codec_encoder_recovery_data(CodecEncoder* encoder);
+
+/*
+    codec_decoder_create()
+
+    Create a decoder for stripes of original_count original buffers and
+    recovery_count recovery buffers of buffer_bytes each.
+
+    The parameters have the same limits as for decode().
+
+    Returns a decoder to pass to codec_decoder_decode().
+    Returns NULL if the input is invalid, codec_init() was not called, or out
+    of memory.
+*/
+EXPORT CodecDecoder* codec_decoder_create(
+    uint64_t buffer_bytes,                    // Number of bytes in each data buffer
+    unsigned original_count,                  // Number of original data buffers
+    unsigned recovery_count);                 // Number of recovery data buffers
+
+// Free a decoder from codec_decoder_create().  NULL is ignored
+EXPORT void codec_decoder_free(CodecDecoder* decoder);
+
+/*
+    codec_decoder_decode()
+
+    Decode original data from recovery data into the decoder's work buffers.
+
+    Lost original/recovery data should be set to NULL, as for decode().
+
+    Returns Success on success.
+    * Lost original buffer i will be at codec_decoder_recovered_data()[i],
+      until the next call.
+    Returns other values on errors.
+*/
+EXPORT Result codec_decoder_decode(
+    CodecDecoder* decoder,                    // Decoder from codec_decoder_create()
+    const void* const * const original_data,  // Array of original data buffers
+    const void* const * const recovery_data); // Array of recovery data buffers
+
+// Returns the decoder's work buffers, holding the recovered data
+EXPORT void** codec_decoder_recovered_data(CodecDecoder* decoder);
+
+
+//------------------------------------------------------------------------------
+// Slab API
+//
+// A slab is one contiguous allocation split into equal buffers, for the
+// original data and work buffers passed to encode() and decode().  Large
+// slabs use explicit huge pages when the system has them reserved, and are
+// otherwise aligned and marked for transparent huge pages, so sweeps over
+// many buffers take fewer TLB misses than separate small allocations.
+//
+// The encoder and decoder contexts allocate their work buffers the same way.
+
+typedef struct CodecSlabT CodecSlab;
+
+/*
+    codec_slab_create()
+
+    Allocate buffer_count buffers of buffer_bytes each from one slab.
+    The buffers are zero-filled, and the first one starts on a page boundary.
+    Buffers of a multiple of 4096 bytes are 64 bytes apart, so that the same
+    offset in each buffer does not map to the same cache sets.
+
+    Returns a slab to pass to codec_slab_buffers().
+    Returns NULL if buffer_bytes is not a positive multiple of 64,
+    buffer_count is zero, or out of memory.
+*/
+EXPORT CodecSlab* codec_slab_create(
+    uint64_t buffer_bytes,                    // Number of bytes in each buffer
+    unsigned buffer_count);                   // Number of buffers
+
+// Free a slab from codec_slab_create(), including all its buffers.  NULL is ignored
+EXPORT void codec_slab_free(CodecSlab* slab);
+
+// Returns the slab's buffer_count buffer pointers
+EXPORT void** codec_slab_buffers(CodecSlab* slab);
+
+// Returns 1 if the slab is backed by explicit huge pages, or 0 otherwise
+EXPORT int codec_slab_huge_pages(CodecSlab* slab);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -7,6 +7,8 @@
 #include <vector>
 #include <iostream>
 #include <string>
+#include <string.h>
+#include <stdio.h>
 using namespace std;
 
 //#define TEST_DATA_ALL_SAME
@@ -99,6 +101,72 @@ static uint64_t GetTimeUsec()
 }
 
 
+//------------------------------------------------------------------------------
+// LLC Misses
+
+/*
+    Counts last-level cache read misses with a Linux perf event, so that
+    changes to the multiply table layout show up next to the throughput.
+    The counter is opened before codec_init() with inherit set, so the worker
+    pool threads created afterwards are counted too.  Where perf events are
+    unavailable (other OS, a VM without a PMU, perf_event_paranoid) only the
+    throughput is reported
+*/
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif // __linux__
+
+class LLCMissCounter
+{
+public:
+    bool Open()
+    {
+#if defined(__linux__)
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_LL |
+            (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.inherit = 1;
+
+        FD = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if (FD < 0)
+        {
+            // Fall back to the generic cache-miss event
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            FD = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+#endif // __linux__
+        return Available();
+    }
+    bool Available() const
+    {
+        return FD >= 0;
+    }
+    uint64_t Read() const
+    {
+        uint64_t count = 0;
+#if defined(__linux__)
+        if (FD >= 0 && ::read(FD, &count, sizeof(count)) != (ssize_t)sizeof(count))
+            count = 0;
+#endif // __linux__
+        return count;
+    }
+
+    int FD = -1;
+};
+
+static LLCMissCounter LLCMisses;
+
+
 //------------------------------------------------------------------------------
 // PCG PRNG
 // From http://www.pcg-random.org/
@@ -347,6 +415,49 @@ static void ShuffleDeck16(PCGRandom &prng, uint16_t * RESTRICT deck, uint32_t co
 //------------------------------------------------------------------------------
 // Benchmark
 
+// Drop loss_count random original pieces and recovery_count - loss_count
+// random recovery pieces by setting their pointers to null
+template<typename T>
+static void LoseRandomData(
+    PCGRandom& prng,
+    const TestParameters& params,
+    T* original_data,
+    T* recovery_data)
+{
+    std::vector<uint16_t> original_losses(params.original_count);
+    ShuffleDeck16(prng, &original_losses[0], params.original_count);
+
+    for (unsigned i = 0, count = params.loss_count; i < count; ++i)
+        original_data[original_losses[i]] = nullptr;
+
+    const unsigned recovery_loss_count = params.recovery_count - params.loss_count;
+
+    std::vector<uint16_t> recovery_losses(params.recovery_count);
+    ShuffleDeck16(prng, &recovery_losses[0], params.recovery_count);
+
+    for (unsigned i = 0, count = recovery_loss_count; i < count; ++i)
+        recovery_data[recovery_losses[i]] = nullptr;
+}
+
+// Returns true if every lost original piece was recovered intact
+template<typename T>
+static bool CheckRecoveredData(
+    const TestParameters& params,
+    const T* original_data,
+    void* const * recovered_data)
+{
+    for (unsigned i = 0; i < params.original_count; ++i)
+    {
+        if (!original_data[i] && !CheckPacket(recovered_data[i], params.buffer_bytes))
+        {
+            cout << "Error: Data was corrupted" << endl;
+            DEBUG_BREAK;
+            return false;
+        }
+    }
+    return true;
+}
+
 static bool Benchmark(const TestParameters& params)
 {
     const unsigned kTrials = params.original_count > 4000 ? kLargeTrialCount : kSmallTrialCount;
@@ -366,18 +477,45 @@ static bool Benchmark(const TestParameters& params)
 
     const uint64_t total_bytes = (uint64_t)params.buffer_bytes * params.original_count;
 
-    for (unsigned trial = 0; trial < kTrials; ++trial)
+    uint64_t encode_llc_misses = 0, decode_llc_misses = 0;
+
+    // Allocate memory:
+
+    // Each set of buffers is carved out of one slab, backed by huge pages
+    // where available, and reused by every trial like an application would
+    t_mem_alloc.BeginCall();
+    std::unique_ptr<CodecSlab, void (*)(CodecSlab*)> original_slab(
+        codec_slab_create(params.buffer_bytes, params.original_count), codec_slab_free);
+    std::unique_ptr<CodecSlab, void (*)(CodecSlab*)> encode_work_slab(
+        codec_slab_create(params.buffer_bytes, encode_work_count), codec_slab_free);
+    std::unique_ptr<CodecSlab, void (*)(CodecSlab*)> decode_work_slab(
+        codec_slab_create(params.buffer_bytes, decode_work_count), codec_slab_free);
+    t_mem_alloc.EndCall();
+
+    if (!original_slab || !encode_work_slab || !decode_work_slab)
     {
-        // Allocate memory:
+        cout << "Error: Out of memory" << endl;
+        return false;
+    }
+
+    void** original_buffers = codec_slab_buffers(original_slab.get());
+    void** encode_work_buffers = codec_slab_buffers(encode_work_slab.get());
+    void** decode_work_buffers = codec_slab_buffers(decode_work_slab.get());
 
-        t_mem_alloc.BeginCall();
+    for (unsigned trial = 0; trial < kTrials; ++trial)
+    {
+        // Lost buffers are dropped from these pointer arrays, not freed
         for (unsigned i = 0, count = params.original_count; i < count; ++i)
-            original_data[i] = codec::SIMDSafeAllocate(params.buffer_bytes);
+            original_data[i] = (uint8_t*)original_buffers[i];
         for (unsigned i = 0, count = encode_work_count; i < count; ++i)
-            codec_encode_work_data[i] = codec::SIMDSafeAllocate(params.buffer_bytes);
+            codec_encode_work_data[i] = (uint8_t*)encode_work_buffers[i];
         for (unsigned i = 0, count = decode_work_count; i < count; ++i)
-            codec_decode_work_data[i] = codec::SIMDSafeAllocate(params.buffer_bytes);
-        t_mem_alloc.EndCall();
+        {
+            codec_decode_work_data[i] = (uint8_t*)decode_work_buffers[i];
+
+            // Packets recovered by the last trial would still pass CheckPacket()
+            memset(codec_decode_work_data[i], 0, params.buffer_bytes);
+        }
 
         // Generate data:
 
@@ -389,6 +527,7 @@ static bool Benchmark(const TestParameters& params)
 
         // Encode:
 
+        const uint64_t encode_misses_before = LLCMisses.Read();
         t_encode.BeginCall();
         Result encodeResult = encode(
                 params.buffer_bytes,
@@ -399,6 +538,7 @@ static bool Benchmark(const TestParameters& params)
                 (void **) &codec_encode_work_data[0] // recovery data written here
         );
         t_encode.EndCall();
+        encode_llc_misses += LLCMisses.Read() - encode_misses_before;
 
         if (encodeResult != Success)
         {
@@ -412,34 +552,13 @@ static bool Benchmark(const TestParameters& params)
             return false;
         }
 
-        // Lose random original data:
+        // Lose random original and recovery data:
 
-        std::vector<uint16_t> original_losses(params.original_count);
-        ShuffleDeck16(prng, &original_losses[0], params.original_count);
-
-        for (unsigned i = 0, count = params.loss_count; i < count; ++i)
-        {
-            const unsigned loss_index = original_losses[i];
-            codec::SIMDSafeFree(original_data[loss_index]);
-            original_data[loss_index] = nullptr;
-        }
-
-        // Lose random recovery data:
-
-        const unsigned recovery_loss_count = params.recovery_count - params.loss_count;
-
-        std::vector<uint16_t> recovery_losses(params.recovery_count);
-        ShuffleDeck16(prng, &recovery_losses[0], params.recovery_count);
-
-        for (unsigned i = 0, count = recovery_loss_count; i < count; ++i)
-        {
-            const unsigned loss_index = recovery_losses[i];
-            codec::SIMDSafeFree(codec_encode_work_data[loss_index]);
-            codec_encode_work_data[loss_index] = nullptr;
-        }
+        LoseRandomData(prng, params, &original_data[0], &codec_encode_work_data[0]);
 
         // Decode:
 
+        const uint64_t decode_misses_before = LLCMisses.Read();
         t_decode.BeginCall();
         Result decodeResult = decode(
             params.buffer_bytes,
@@ -450,6 +569,7 @@ static bool Benchmark(const TestParameters& params)
             (void**)&codec_encode_work_data[0],
             (void**)&codec_decode_work_data[0]);
         t_decode.EndCall();
+        decode_llc_misses += LLCMisses.Read() - decode_misses_before;
 
         if (decodeResult != Success)
         {
@@ -458,36 +578,23 @@ static bool Benchmark(const TestParameters& params)
             return false;
         }
 
-        for (unsigned i = 0; i < params.original_count; ++i)
-        {
-            if (!original_data[i])
-            {
-                if (!CheckPacket(codec_decode_work_data[i], params.buffer_bytes))
-                {
-                    cout << "Error: Data was corrupted" << endl;
-                    DEBUG_BREAK;
-                    return false;
-                }
-            }
-        }
+        if (!CheckRecoveredData(params, &original_data[0], (void**)&codec_decode_work_data[0]))
+            return false;
+    }
 
-        // Free memory:
+    // Free memory:
 
-        t_mem_free.BeginCall();
-        for (unsigned i = 0, count = params.original_count; i < count; ++i)
-            codec::SIMDSafeFree(original_data[i]);
-        for (unsigned i = 0, count = encode_work_count; i < count; ++i)
-            codec::SIMDSafeFree(codec_encode_work_data[i]);
-        for (unsigned i = 0, count = decode_work_count; i < count; ++i)
-            codec::SIMDSafeFree(codec_decode_work_data[i]);
-        t_mem_free.EndCall();
-    }
+    t_mem_free.BeginCall();
+    original_slab.reset();
+    encode_work_slab.reset();
+    decode_work_slab.reset();
+    t_mem_free.EndCall();
 
 #if 0
-    t_mem_alloc.Print(kTrials);
+    t_mem_alloc.Print(1);
     t_encode.Print(kTrials);
     t_decode.Print(kTrials);
-    t_mem_free.Print(kTrials);
+    t_mem_free.Print(1);
 #endif
 
     float encode_input_MBPS = total_bytes / (float)(t_encode.MinCallUsec);
@@ -496,11 +603,662 @@ static bool Benchmark(const TestParameters& params)
     float decode_output_MBPS = params.buffer_bytes * (uint64_t)params.loss_count / (float)(t_decode.MinCallUsec);
 
     cout << "Encoder(" << total_bytes / 1000000.f << " MB in " << params.original_count << " pieces, " << params.loss_count << " losses): Input=" << encode_input_MBPS << " MB/s, Output=" << encode_output_MBPS << " MB/s" << endl;
-    cout << "Decoder(" << total_bytes / 1000000.f << " MB in " << params.original_count << " pieces, " << params.loss_count << " losses): Input=" << decode_input_MBPS << " MB/s, Output=" << decode_output_MBPS << " MB/s" << endl << endl;
+    cout << "Decoder(" << total_bytes / 1000000.f << " MB in " << params.original_count << " pieces, " << params.loss_count << " losses): Input=" << decode_input_MBPS << " MB/s, Output=" << decode_output_MBPS << " MB/s" << endl;
+
+    if (LLCMisses.Available())
+        cout << "LLC read misses per trial: Encoder=" << encode_llc_misses / kTrials << ", Decoder=" << decode_llc_misses / kTrials << endl;
+    cout << endl;
+
+    return true;
+}
+
+
+// Same as Benchmark() but through encoder and decoder contexts, created once
+// and reused by every trial
+static bool BenchmarkContext(const TestParameters& params)
+{
+    const unsigned kTrials = params.original_count > 4000 ? kLargeTrialCount : kSmallTrialCount;
+
+    std::vector<const void*> original_data(params.original_count);
+    std::vector<const void*> recovery_data(params.recovery_count);
+
+    const unsigned decode_work_count = codec_decode_work_count(params.original_count, params.recovery_count);
+
+    FunctionTimer t_encode("encoder_encode");
+    FunctionTimer t_decode("decoder_decode");
+
+    const uint64_t total_bytes = (uint64_t)params.buffer_bytes * params.original_count;
+
+    std::unique_ptr<CodecEncoder, void (*)(CodecEncoder*)> encoder(
+        codec_encoder_create(params.buffer_bytes, params.original_count, params.recovery_count), codec_encoder_free);
+    std::unique_ptr<CodecDecoder, void (*)(CodecDecoder*)> decoder(
+        codec_decoder_create(params.buffer_bytes, params.original_count, params.recovery_count), codec_decoder_free);
+    std::unique_ptr<CodecSlab, void (*)(CodecSlab*)> original_slab(
+        codec_slab_create(params.buffer_bytes, params.original_count), codec_slab_free);
+
+    if (!encoder || !decoder)
+    {
+        cout << "Skipping context test: Parameters are unsupported by the codec" << endl;
+        return true;
+    }
+    if (!original_slab)
+    {
+        cout << "Error: Out of memory" << endl;
+        return false;
+    }
+
+    void** original_buffers = codec_slab_buffers(original_slab.get());
+    void** recovered_data = codec_decoder_recovered_data(decoder.get());
+
+    for (unsigned trial = 0; trial < kTrials; ++trial)
+    {
+        for (unsigned i = 0, count = params.original_count; i < count; ++i)
+            original_data[i] = original_buffers[i];
+
+        // Packets recovered by the last trial would still pass CheckPacket()
+        for (unsigned i = 0, count = decode_work_count; i < count; ++i)
+            memset(recovered_data[i], 0, params.buffer_bytes);
+
+        // Generate data:
+
+        PCGRandom prng;
+        prng.Seed(params.seed, trial);
+
+        for (unsigned i = 0; i < params.original_count; ++i)
+            WriteRandomSelfCheckingPacket(prng, original_buffers[i], params.buffer_bytes);
+
+        // Encode:
+
+        t_encode.BeginCall();
+        Result encodeResult = codec_encoder_encode(encoder.get(), &original_data[0]);
+        t_encode.EndCall();
+
+        if (encodeResult != Success)
+        {
+            cout << "Error: Context encode failed with result=" << encodeResult << ": " << result_string(encodeResult) << endl;
+            DEBUG_BREAK;
+            return false;
+        }
+
+        void** encoded_data = codec_encoder_recovery_data(encoder.get());
+        for (unsigned i = 0, count = params.recovery_count; i < count; ++i)
+            recovery_data[i] = encoded_data[i];
+
+        // Lose random original and recovery data:
+
+        LoseRandomData(prng, params, &original_data[0], &recovery_data[0]);
+
+        // Decode:
+
+        t_decode.BeginCall();
+        Result decodeResult = codec_decoder_decode(decoder.get(), &original_data[0], &recovery_data[0]);
+        t_decode.EndCall();
+
+        if (decodeResult != Success)
+        {
+            cout << "Error: Context decode failed with result=" << decodeResult << ": " << result_string(decodeResult) << endl;
+            DEBUG_BREAK;
+            return false;
+        }
+
+        if (!CheckRecoveredData(params, &original_data[0], recovered_data))
+            return false;
+    }
+
+    float encode_input_MBPS = total_bytes / (float)(t_encode.MinCallUsec);
+    float decode_input_MBPS = total_bytes / (float)(t_decode.MinCallUsec);
+
+    cout << "Encoder context(" << total_bytes / 1000000.f << " MB in " << params.original_count << " pieces, " << params.loss_count << " losses): Input=" << encode_input_MBPS << " MB/s" << endl;
+    cout << "Decoder context(" << total_bytes / 1000000.f << " MB in " << params.original_count << " pieces, " << params.loss_count << " losses): Input=" << decode_input_MBPS << " MB/s" << endl;
+    cout << endl;
 
     return true;
 }
 
+// Encode stripe_count stripes with one encode() call per stripe and then with
+// one encode_batch() call, lose the same pieces from each and decode them with
+// one decode_batch() call, then with one decode() call per stripe.  Also
+// checks that invalid batches are rejected
+static bool BenchmarkBatch(const TestParameters& params, unsigned stripe_count)
+{
+    static const unsigned kBatchTrials = 4;
+
+    const unsigned encode_work_count = codec_encode_work_count(params.original_count, params.recovery_count);
+    const unsigned decode_work_count = codec_decode_work_count(params.original_count, params.recovery_count);
+
+    FunctionTimer t_encode_batch("encode_batch");
+    FunctionTimer t_encode_loop("encode");
+    FunctionTimer t_batch("decode_batch");
+    FunctionTimer t_loop("decode");
+
+    const uint64_t total_bytes = (uint64_t)params.buffer_bytes * params.original_count * stripe_count;
+
+    std::unique_ptr<CodecSlab, void (*)(CodecSlab*)> original_slab(
+        codec_slab_create(params.buffer_bytes, params.original_count * stripe_count), codec_slab_free);
+    std::unique_ptr<CodecSlab, void (*)(CodecSlab*)> encode_work_slab(
+        codec_slab_create(params.buffer_bytes, encode_work_count * stripe_count), codec_slab_free);
+    std::unique_ptr<CodecSlab, void (*)(CodecSlab*)> decode_work_slab(
+        codec_slab_create(params.buffer_bytes, decode_work_count * stripe_count), codec_slab_free);
+
+    if (!original_slab || !encode_work_slab || !decode_work_slab)
+    {
+        cout << "Error: Out of memory" << endl;
+        return false;
+    }
+
+    void** original_buffers = codec_slab_buffers(original_slab.get());
+    void** encode_work_buffers = codec_slab_buffers(encode_work_slab.get());
+    void** decode_work_buffers = codec_slab_buffers(decode_work_slab.get());
+
+    std::vector<std::vector<const void*>> original_data(stripe_count);
+    std::vector<std::vector<const void*>> recovery_data(stripe_count);
+    std::vector<std::vector<void*>> work_data(stripe_count);
+
+    std::vector<EncodeStripe> stripes(stripe_count);
+
+    // Generate data:
+
+    for (unsigned stripe = 0; stripe < stripe_count; ++stripe)
+    {
+        void** stripe_originals = original_buffers + stripe * params.original_count;
+        void** stripe_encode_work = encode_work_buffers + stripe * encode_work_count;
+
+        PCGRandom prng;
+        prng.Seed(params.seed, stripe);
+
+        for (unsigned i = 0; i < params.original_count; ++i)
+            WriteRandomSelfCheckingPacket(prng, stripe_originals[i], params.buffer_bytes);
+
+        stripes[stripe].BufferBytes = params.buffer_bytes;
+        stripes[stripe].OriginalCount = params.original_count;
+        stripes[stripe].RecoveryCount = params.recovery_count;
+        stripes[stripe].WorkCount = encode_work_count;
+        stripes[stripe].OriginalData = stripe_originals;
+        stripes[stripe].WorkData = stripe_encode_work;
+
+        original_data[stripe].assign(stripe_originals, stripe_originals + params.original_count);
+        recovery_data[stripe].assign(stripe_encode_work, stripe_encode_work + params.recovery_count);
+        work_data[stripe].assign(
+            decode_work_buffers + stripe * decode_work_count,
+            decode_work_buffers + (stripe + 1) * decode_work_count);
+    }
+
+    // Encode with encode() and then with encode_batch(), kBatchTrials times
+    // each.  The decoder below reads the recovery data from encode_batch(), so
+    // it checks that too
+
+    for (unsigned pass = 0; pass < 2 * kBatchTrials; ++pass)
+    {
+        for (unsigned i = 0, count = encode_work_count * stripe_count; i < count; ++i)
+            memset(encode_work_buffers[i], 0, params.buffer_bytes);
+
+        Result encodeResult = Success;
+
+        if (pass < kBatchTrials)
+        {
+            t_encode_loop.BeginCall();
+            for (unsigned stripe = 0; stripe < stripe_count && encodeResult == Success; ++stripe)
+            {
+                encodeResult = encode(
+                    params.buffer_bytes,
+                    params.original_count,
+                    params.recovery_count,
+                    encode_work_count,
+                    stripes[stripe].OriginalData,
+                    stripes[stripe].WorkData);
+            }
+            t_encode_loop.EndCall();
+        }
+        else
+        {
+            t_encode_batch.BeginCall();
+            encodeResult = encode_batch(stripe_count, &stripes[0]);
+            t_encode_batch.EndCall();
+        }
+
+        if (encodeResult != Success)
+        {
+            if (encodeResult == TooMuchData)
+            {
+                cout << "Skipping batch test: Parameters are unsupported by the codec" << endl;
+                return true;
+            }
+            cout << "Error: " << (pass < kBatchTrials ? "Encode" : "Batch encode") << " failed with result=" << encodeResult << ": " << result_string(encodeResult) << endl;
+            DEBUG_BREAK;
+            return false;
+        }
+    }
+
+    // Lose the same random original and recovery data from every stripe:
+
+    PCGRandom prng;
+    prng.Seed(params.seed, stripe_count);
+
+    LoseRandomData(prng, params, &original_data[0][0], &recovery_data[0][0]);
+
+    for (unsigned stripe = 1; stripe < stripe_count; ++stripe)
+    {
+        for (unsigned i = 0; i < params.original_count; ++i)
+            if (!original_data[0][i])
+                original_data[stripe][i] = nullptr;
+        for (unsigned i = 0; i < params.recovery_count; ++i)
+            if (!recovery_data[0][i])
+                recovery_data[stripe][i] = nullptr;
+    }
+
+    std::vector<const void* const*> original_arrays(stripe_count);
+    std::vector<const void* const*> recovery_arrays(stripe_count);
+    std::vector<void**> work_arrays(stripe_count);
+
+    for (unsigned stripe = 0; stripe < stripe_count; ++stripe)
+    {
+        original_arrays[stripe] = &original_data[stripe][0];
+        recovery_arrays[stripe] = &recovery_data[stripe][0];
+        work_arrays[stripe] = &work_data[stripe][0];
+    }
+
+    // Decode with decode_batch() and then with decode(), kBatchTrials times
+    // each, checking every stripe each time.  Packets recovered by an earlier
+    // pass would still pass CheckPacket(), so the work buffers are cleared
+
+    for (unsigned pass = 0; pass < 2 * kBatchTrials; ++pass)
+    {
+        for (unsigned i = 0, count = decode_work_count * stripe_count; i < count; ++i)
+            memset(decode_work_buffers[i], 0, params.buffer_bytes);
+
+        Result decodeResult = Success;
+
+        if (pass < kBatchTrials)
+        {
+            t_batch.BeginCall();
+            decodeResult = decode_batch(
+                params.buffer_bytes,
+                params.original_count,
+                params.recovery_count,
+                decode_work_count,
+                stripe_count,
+                &original_arrays[0],
+                &recovery_arrays[0],
+                &work_arrays[0]);
+            t_batch.EndCall();
+        }
+        else
+        {
+            t_loop.BeginCall();
+            for (unsigned stripe = 0; stripe < stripe_count && decodeResult == Success; ++stripe)
+            {
+                decodeResult = decode(
+                    params.buffer_bytes,
+                    params.original_count,
+                    params.recovery_count,
+                    decode_work_count,
+                    original_arrays[stripe],
+                    recovery_arrays[stripe],
+                    work_arrays[stripe]);
+            }
+            t_loop.EndCall();
+        }
+
+        if (decodeResult != Success)
+        {
+            cout << "Error: " << (pass < kBatchTrials ? "Batch decode" : "Decode") << " failed with result=" << decodeResult << ": " << result_string(decodeResult) << endl;
+            DEBUG_BREAK;
+            return false;
+        }
+
+        for (unsigned stripe = 0; stripe < stripe_count; ++stripe)
+            if (!CheckRecoveredData(params, original_arrays[stripe], work_arrays[stripe]))
+                return false;
+    }
+
+    // Flip whether the last stripe has the first lost original, or the first
+    // original if none were lost, so that it is missing different pieces:
+
+    if (stripe_count >= 2)
+    {
+        unsigned flip_index = 0;
+        while (flip_index < params.original_count - 1 && original_data[0][flip_index])
+            ++flip_index;
+
+        const unsigned last = stripe_count - 1;
+        original_data[last][flip_index] = original_data[last][flip_index] ? nullptr :
+            original_buffers[last * params.original_count + flip_index];
+
+        Result mismatchResult = decode_batch(
+            params.buffer_bytes,
+            params.original_count,
+            params.recovery_count,
+            decode_work_count,
+            stripe_count,
+            &original_arrays[0],
+            &recovery_arrays[0],
+            &work_arrays[0]);
+
+        if (mismatchResult != InvalidInput)
+        {
+            cout << "Error: Batch decode of mismatched stripes returned result=" << mismatchResult << ": " << result_string(mismatchResult) << endl;
+            DEBUG_BREAK;
+            return false;
+        }
+    }
+
+    // Break the first stripe and give the last one a bad size.  The batch must
+    // report the first stripe's error without encoding the valid ones:
+
+    if (stripe_count >= 3)
+    {
+        const unsigned last = stripe_count - 1;
+        memset(encode_work_buffers[encode_work_count], 0, params.buffer_bytes);
+
+        stripes[0].OriginalData = nullptr;
+        stripes[last].BufferBytes = params.buffer_bytes + 1;
+
+        Result invalidResult = encode_batch(stripe_count, &stripes[0]);
+
+        if (invalidResult != InvalidInput)
+        {
+            cout << "Error: Batch encode of invalid stripes returned result=" << invalidResult << ": " << result_string(invalidResult) << endl;
+            DEBUG_BREAK;
+            return false;
+        }
+
+        const uint8_t* untouched = (const uint8_t*)encode_work_buffers[encode_work_count];
+        for (unsigned i = 0; i < params.buffer_bytes; ++i)
+        {
+            if (untouched[i] != 0)
+            {
+                cout << "Error: Batch encode of invalid stripes wrote recovery data" << endl;
+                DEBUG_BREAK;
+                return false;
+            }
+        }
+    }
+
+    float encode_batch_input_MBPS = total_bytes / (float)(t_encode_batch.MinCallUsec);
+    float encode_loop_input_MBPS = total_bytes / (float)(t_encode_loop.MinCallUsec);
+    float batch_input_MBPS = total_bytes / (float)(t_batch.MinCallUsec);
+    float loop_input_MBPS = total_bytes / (float)(t_loop.MinCallUsec);
+
+    cout << "Encoder batch(" << total_bytes / 1000000.f << " MB in " << stripe_count << " stripes of " << params.original_count << " pieces): Input=" << encode_batch_input_MBPS << " MB/s" << endl;
+    cout << "Encoder loop(" << total_bytes / 1000000.f << " MB in " << stripe_count << " stripes of " << params.original_count << " pieces): Input=" << encode_loop_input_MBPS << " MB/s" << endl;
+    cout << "Decoder batch(" << total_bytes / 1000000.f << " MB in " << stripe_count << " stripes of " << params.original_count << " pieces, " << params.loss_count << " losses): Input=" << batch_input_MBPS << " MB/s" << endl;
+    cout << "Decoder loop(" << total_bytes / 1000000.f << " MB in " << stripe_count << " stripes of " << params.original_count << " pieces, " << params.loss_count << " losses): Input=" << loop_input_MBPS << " MB/s" << endl;
+    cout << endl;
+
+    return true;
+}
+
+
+#ifdef HAS_FF16
+
+//------------------------------------------------------------------------------
+// Table Images
+
+static bool ReadFile(const string& path, std::vector<uint8_t>& data)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    data.clear();
+    uint8_t buffer[65536];
+    size_t bytes;
+    while ((bytes = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + bytes);
+    fclose(file);
+    return !data.empty();
+}
+
+static bool WriteFile(const string& path, const std::vector<uint8_t>& data)
+{
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    const bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    return fclose(file) == 0 && written;
+}
+
+// Returns true if codec_load_tables() rejects the image data
+static bool CheckTableImageRejected(const string& path, const std::vector<uint8_t>& data, const char* what)
+{
+    if (!WriteFile(path, data))
+    {
+        cout << "Error: Cannot write " << path << endl;
+        return false;
+    }
+
+    const Result result = codec_load_tables(path.c_str());
+    remove(path.c_str());
+
+    if (result != InvalidInput)
+    {
+        cout << "Error: Loading a table image " << what << " returned result=" << result << ": " << result_string(result) << endl;
+        DEBUG_BREAK;
+        return false;
+    }
+    return true;
+}
+
+// Save the multiply tables to path after warm-up, and when the CPU supports
+// the carry-less backend an image without tables to path + ".clmul".  The
+// carry-less backend must be selected before codec_init()
+static bool SaveTableImages(const string& path, bool carryless)
+{
+    if (carryless)
+    {
+        const string clmul_path = path + ".clmul";
+        if (Success != codec_save_tables(clmul_path.c_str()) ||
+            Success != codec_set_ff16_multiply(FF16MultiplyTables))
+        {
+            cout << "Error: Cannot save table image " << clmul_path << endl;
+            return false;
+        }
+        cout << "Saved table image without multiply tables: " << clmul_path << endl;
+    }
+
+    FunctionTimer t_save("codec_save_tables");
+    t_save.BeginCall();
+    const Result result = codec_save_tables(path.c_str());
+    t_save.EndCall();
+
+    if (result != Success)
+    {
+        cout << "Error: Cannot save table image " << path << ": " << result_string(result) << endl;
+        return false;
+    }
+    t_save.Print(1);
+    cout << "Saved table image: " << path << endl;
+    return true;
+}
+
+// Before warm-up, check that codec_load_tables() rejects damaged copies of the
+// image at path and the image without multiply tables, then load the image
+static bool LoadTableImages(const string& path)
+{
+    std::vector<uint8_t> image;
+    if (!ReadFile(path, image))
+    {
+        cout << "Error: Cannot read table image " << path << ": Run the \"save\" mode first" << endl;
+        return false;
+    }
+
+    const string bad_path = path + ".bad";
+
+    std::vector<uint8_t> corrupted = image;
+    corrupted[corrupted.size() / 2] ^= 0x40;
+    if (!CheckTableImageRejected(bad_path, corrupted, "with a flipped bit"))
+        return false;
+
+    std::vector<uint8_t> truncated(image.begin(), image.begin() + image.size() / 2);
+    if (!CheckTableImageRejected(bad_path, truncated, "cut in half"))
+        return false;
+
+    std::vector<uint8_t> clmul_image;
+    if (ReadFile(path + ".clmul", clmul_image))
+    {
+        if (!CheckTableImageRejected(bad_path, clmul_image, "without multiply tables"))
+            return false;
+    }
+    else
+        cout << "No table image without multiply tables to check" << endl;
+
+    cout << "Damaged table images were rejected" << endl;
+
+    FunctionTimer t_load("codec_load_tables");
+    t_load.BeginCall();
+    const Result result = codec_load_tables(path.c_str());
+    t_load.EndCall();
+
+    if (result != Success)
+    {
+        cout << "Error: Loading table image " << path << " returned result=" << result << ": " << result_string(result) << endl;
+        DEBUG_BREAK;
+        return false;
+    }
+    t_load.Print(1);
+    return true;
+}
+
+#endif // HAS_FF16
+
+
+#if defined(HAS_FF16) && defined(TRY_AVX2)
+
+// Compares the bitsliced GF(2^16) kernels against the ALTMAP table kernels,
+// with one butterfly per pair of pieces in each pass as in an FFT layer
+static bool BenchmarkBitslice(const TestParameters& params)
+{
+    using namespace codec::ff16;
+
+    if (!InitializeBitslice())
+    {
+        cout << "Bitsliced layout is unsupported on this CPU" << endl;
+        return true;
+    }
+
+    const uint64_t block_bytes = kBitsliceBlockBytes;
+    const uint64_t piece_bytes = (params.buffer_bytes + block_bytes - 1) / block_bytes * block_bytes;
+    const unsigned piece_count = params.original_count < 2 ? 2 : params.original_count & ~1u;
+    const unsigned kPasses = 8;
+
+    std::vector<uint8_t*> altmap(piece_count), bitslice(piece_count);
+    std::vector<ffe_t> log_m(piece_count / 2);
+
+    PCGRandom prng;
+    prng.Seed(params.seed, 0);
+
+    for (unsigned i = 0; i < piece_count; ++i)
+    {
+        altmap[i] = codec::SIMDSafeAllocate(piece_bytes);
+        bitslice[i] = codec::SIMDSafeAllocate(piece_bytes);
+        for (uint64_t j = 0; j < piece_bytes; ++j)
+            altmap[i][j] = (uint8_t)prng.Next();
+        BitsliceFromAltmap(bitslice[i], altmap[i], piece_bytes);
+    }
+    for (unsigned i = 0; i < piece_count / 2; ++i)
+        log_m[i] = (ffe_t)(prng.Next() % kModulus);
+
+    // Check that both layouts agree after one pass of each kernel
+    {
+        uint8_t* check = codec::SIMDSafeAllocate(piece_bytes);
+        bool match = true;
+
+        AltmapMul(altmap[0], altmap[1], log_m[0], piece_bytes);
+        BitsliceMul(bitslice[0], bitslice[1], log_m[0], piece_bytes);
+        for (unsigned i = 0; i + 1 < piece_count; i += 2)
+        {
+            AltmapFFT_DIT2(altmap[i], altmap[i + 1], log_m[i / 2], piece_bytes);
+            BitsliceFFT_DIT2(bitslice[i], bitslice[i + 1], log_m[i / 2], piece_bytes);
+            AltmapIFFT_DIT2(altmap[i], altmap[i + 1], log_m[i / 2], piece_bytes);
+            BitsliceIFFT_DIT2(bitslice[i], bitslice[i + 1], log_m[i / 2], piece_bytes);
+        }
+        for (unsigned i = 0; i < piece_count && match; ++i)
+        {
+            BitsliceToAltmap(check, bitslice[i], piece_bytes);
+            match = memcmp(check, altmap[i], (size_t)piece_bytes) == 0;
+        }
+        codec::SIMDSafeFree(check);
+
+        if (!match)
+        {
+            cout << "Error: Bitsliced kernels disagree with the ALTMAP kernels" << endl;
+            return false;
+        }
+    }
+
+    FunctionTimer t_altmap_mul("AltmapMul"), t_bitslice_mul("BitsliceMul");
+    FunctionTimer t_altmap_fft("AltmapFFT_DIT2"), t_bitslice_fft("BitsliceFFT_DIT2");
+    FunctionTimer t_altmap_ifft("AltmapIFFT_DIT2"), t_bitslice_ifft("BitsliceIFFT_DIT2");
+    FunctionTimer t_bitslice_muladd("BitsliceMulAdd");
+    FunctionTimer t_convert("BitsliceFromAltmap");
+
+    for (unsigned pass = 0; pass < kPasses; ++pass)
+    {
+        t_altmap_mul.BeginCall();
+        for (unsigned i = 0; i + 1 < piece_count; i += 2)
+            AltmapMul(altmap[i], altmap[i + 1], log_m[i / 2], piece_bytes);
+        t_altmap_mul.EndCall();
+
+        t_bitslice_mul.BeginCall();
+        for (unsigned i = 0; i + 1 < piece_count; i += 2)
+            BitsliceMul(bitslice[i], bitslice[i + 1], log_m[i / 2], piece_bytes);
+        t_bitslice_mul.EndCall();
+
+        t_bitslice_muladd.BeginCall();
+        for (unsigned i = 0; i + 1 < piece_count; i += 2)
+            BitsliceMulAdd(bitslice[i], bitslice[i + 1], log_m[i / 2], piece_bytes);
+        t_bitslice_muladd.EndCall();
+
+        t_altmap_fft.BeginCall();
+        for (unsigned i = 0; i + 1 < piece_count; i += 2)
+            AltmapFFT_DIT2(altmap[i], altmap[i + 1], log_m[i / 2], piece_bytes);
+        t_altmap_fft.EndCall();
+
+        t_bitslice_fft.BeginCall();
+        for (unsigned i = 0; i + 1 < piece_count; i += 2)
+            BitsliceFFT_DIT2(bitslice[i], bitslice[i + 1], log_m[i / 2], piece_bytes);
+        t_bitslice_fft.EndCall();
+
+        t_altmap_ifft.BeginCall();
+        for (unsigned i = 0; i + 1 < piece_count; i += 2)
+            AltmapIFFT_DIT2(altmap[i], altmap[i + 1], log_m[i / 2], piece_bytes);
+        t_altmap_ifft.EndCall();
+
+        t_bitslice_ifft.BeginCall();
+        for (unsigned i = 0; i + 1 < piece_count; i += 2)
+            BitsliceIFFT_DIT2(bitslice[i], bitslice[i + 1], log_m[i / 2], piece_bytes);
+        t_bitslice_ifft.EndCall();
+
+        t_convert.BeginCall();
+        for (unsigned i = 0; i < piece_count; ++i)
+            BitsliceFromAltmap(bitslice[i], altmap[i], piece_bytes);
+        t_convert.EndCall();
+    }
+
+    const uint64_t total_bytes = piece_bytes * piece_count;
+    FunctionTimer* timers[] = {
+        &t_altmap_mul, &t_bitslice_mul, &t_bitslice_muladd,
+        &t_altmap_fft, &t_bitslice_fft,
+        &t_altmap_ifft, &t_bitslice_ifft,
+        &t_convert
+    };
+    for (FunctionTimer* timer : timers)
+    {
+        const double MBPS = total_bytes * (double)timer->Invokations / (timer->TotalUsec ? timer->TotalUsec : 1);
+        cout << timer->FunctionName << "(" << total_bytes / 1000000.f << " MB in " << piece_count << " pieces): " << MBPS << " MB/s" << endl;
+    }
+    cout << endl;
+
+    for (unsigned i = 0; i < piece_count; ++i)
+    {
+        codec::SIMDSafeFree(altmap[i]);
+        codec::SIMDSafeFree(bitslice[i]);
+    }
+
+    return true;
+}
+
+#endif // HAS_FF16 && TRY_AVX2
+
 
 //------------------------------------------------------------------------------
 // Entrypoint
@@ -509,6 +1267,49 @@ int main(int argc, char **argv)
 {
     SetCurrentThreadPriority();
 
+    // Pass "clmul" after the four counts to compare the GF(2^16) multiply
+    // backends: The carry-less backend starts first so codec_init() skips the
+    // multiply tables, then the tables are built and the same run repeats.
+    // Pass "bitslice" to compare the bitsliced and ALTMAP kernels instead.
+    // Pass "slices" or "columns" to run the same stripes in ExecuteLayers mode
+    // and then in ExecuteSlices or ExecuteColumns mode, checking the decoded
+    // data in both.
+    // Pass "save" and optionally a path to write a table image after warm-up,
+    // then "load" with the same path in a new process to check that damaged
+    // images are rejected and to run with the loaded tables.
+    // Pass "prefetch" to run the same stripes without and then with
+    // codec_set_prefetch().
+    // Pass "stream" to run the same stripes with codec_set_streaming_stores()
+    // set to StreamNever and then to StreamAlways.
+    // Pass "batch" and optionally a stripe count to encode many stripes through
+    // encode_batch() and encode(), then decode them with the same losses
+    // through decode_batch() and decode()
+    const bool compare_ff16_multiply = argc >= 6 && strcmp(argv[5], "clmul") == 0;
+    const bool compare_bitslice = argc >= 6 && strcmp(argv[5], "bitslice") == 0;
+    const bool compare_slices = argc >= 6 && strcmp(argv[5], "slices") == 0;
+    const bool compare_columns = argc >= 6 && strcmp(argv[5], "columns") == 0;
+    const bool compare_decode_batch = argc >= 6 && strcmp(argv[5], "batch") == 0;
+    const bool compare_prefetch = argc >= 6 && strcmp(argv[5], "prefetch") == 0;
+    const bool compare_stream = argc >= 6 && strcmp(argv[5], "stream") == 0;
+#ifdef HAS_FF16
+    const bool save_tables = argc >= 6 && strcmp(argv[5], "save") == 0;
+    const bool load_tables = argc >= 6 && strcmp(argv[5], "load") == 0;
+    const string table_path = argc >= 7 ? argv[6] : "rscodec_tables.bin";
+
+    // Save the image without multiply tables while the carry-less backend is
+    // selected, before it switches back to building them
+    const bool save_carryless = save_tables && Success == codec_set_ff16_multiply(FF16MultiplyCarryless);
+#endif // HAS_FF16
+
+    if (compare_ff16_multiply && Success != codec_set_ff16_multiply(FF16MultiplyCarryless))
+    {
+        cout << "Carry-less multiply is unsupported on this CPU" << endl;
+        return -1;
+    }
+
+    if (!LLCMisses.Open())
+        cout << "LLC miss counter unavailable: Reporting throughput only" << endl;
+
     FunctionTimer t_init("codec_init");
 
     t_init.BeginCall();
@@ -520,6 +1321,28 @@ int main(int argc, char **argv)
     t_init.EndCall();
     t_init.Print(1);
 
+#ifdef HAS_FF16
+    if (load_tables && !LoadTableImages(table_path))
+        return -1;
+#endif // HAS_FF16
+
+    // Build the field tables up front so the first trial does not include it
+    FunctionTimer t_warmup("codec_warmup");
+
+    t_warmup.BeginCall();
+    if (Success != codec_warmup(WarmupAll, 0))
+    {
+        cout << "Failed to warm up" << endl;
+        return -1;
+    }
+    t_warmup.EndCall();
+    t_warmup.Print(1);
+
+#ifdef HAS_FF16
+    if (save_tables && !SaveTableImages(table_path, save_carryless))
+        return -1;
+#endif // HAS_FF16
+
     TestParameters params;
     PCGRandom prng;
 
@@ -537,9 +1360,99 @@ int main(int argc, char **argv)
 
     cout << "Parameters: [original count=" << params.original_count << "] [recovery count=" << params.recovery_count << "] [buffer bytes=" << params.buffer_bytes << "] [loss count=" << params.loss_count << "] [random seed=" << params.seed << "]" << endl;
 
+#if defined(HAS_FF16) && defined(TRY_AVX2)
+    if (compare_bitslice)
+    {
+        BenchmarkBitslice(params);
+        goto Failed;
+    }
+#else
+    (void)compare_bitslice;
+#endif // HAS_FF16 && TRY_AVX2
+
+    if (compare_ff16_multiply)
+    {
+        cout << "FF16 multiply: carry-less" << endl;
+        if (!Benchmark(params))
+            goto Failed;
+
+        FunctionTimer t_tables("codec_set_ff16_multiply(tables)");
+        t_tables.BeginCall();
+        codec_set_ff16_multiply(FF16MultiplyTables);
+        t_tables.EndCall();
+        t_tables.Print(1);
+
+        cout << "FF16 multiply: tables" << endl;
+        Benchmark(params);
+        goto Failed;
+    }
+
+#ifdef HAS_FF16
+    if (save_tables || load_tables)
+    {
+        Benchmark(params);
+        goto Failed;
+    }
+#endif // HAS_FF16
+
+    if (compare_prefetch)
+    {
+        cout << "Prefetch: off" << endl;
+        if (!Benchmark(params))
+            goto Failed;
+
+        if (Success != codec_set_prefetch(1))
+        {
+            cout << "Prefetch is not built into this library" << endl;
+            goto Failed;
+        }
+
+        cout << "Prefetch: on" << endl;
+        Benchmark(params);
+        goto Failed;
+    }
+
+    if (compare_stream)
+    {
+        codec_set_streaming_stores(StreamNever);
+        cout << "Streaming stores: never" << endl;
+        if (!Benchmark(params))
+            goto Failed;
+
+        codec_set_streaming_stores(StreamAlways);
+        cout << "Streaming stores: always" << endl;
+        Benchmark(params);
+        goto Failed;
+    }
+
+    if (compare_decode_batch)
+    {
+        const unsigned stripe_count = argc >= 7 ? atoi(argv[6]) : 4;
+
+        BenchmarkBatch(params, stripe_count > 3 ? stripe_count : 3);
+        goto Failed;
+    }
+
+    if (compare_slices || compare_columns)
+    {
+        cout << "Execution mode: layers" << endl;
+        if (!Benchmark(params))
+            goto Failed;
+
+        codec_set_execution_mode(compare_columns ? ExecuteColumns : ExecuteSlices, 0);
+
+        cout << "Execution mode: " << (compare_columns ? "columns" : "slices") << endl;
+        Benchmark(params);
+        goto Failed;
+    }
+
     if (!Benchmark(params))
         goto Failed;
 
+    // Repeat the stripes through the encoder and decoder context API
+    if (!BenchmarkContext(params))
+        goto Failed;
+
 #if 1
     static const unsigned kMaxLargeRandomData = 32768;
     static const unsigned kMaxSmallRandomData = 128;